@@ -29,6 +29,8 @@
 */
 #include "atmosphere/color.h"
 
+#include <cmath>
+
 #include "atmosphere/atmosphere.h"
 #include "math/matrix.h"
 
@@ -46,6 +48,26 @@ constexpr Wavelength lambda_r = 680.0 * nm;
 constexpr Wavelength lambda_g = 550.0 * nm;
 constexpr Wavelength lambda_b = 440.0 * nm;
 
+// The CIELAB nonlinearity.
+double LabF(double t) {
+  constexpr double delta = 6.0 / 29.0;
+  return t > delta * delta * delta ?
+      std::cbrt(t) : t / (3.0 * delta * delta) + 4.0 / 29.0;
+}
+
+// Converts the given linear sRGB color to CIELAB, with a D65 reference white of
+// luminance 'white_luminance'.
+void GetLab(const Color& c, Luminance white_luminance, double lab[3]) {
+  static const Matrix3<Number> sRGB_to_XYZ = inverse(XYZ_to_sRGB);
+  const Color XYZ = sRGB_to_XYZ * c;
+  const double x = LabF((XYZ.x / (0.95047 * white_luminance))());
+  const double y = LabF((XYZ.y / white_luminance)());
+  const double z = LabF((XYZ.z / (1.08883 * white_luminance))());
+  lab[0] = 116.0 * y - 16.0;
+  lab[1] = 500.0 * (x - y);
+  lab[2] = 200.0 * (y - z);
+}
+
 }  // namespace
 
 Color GetSrgbColorNaive(const RadianceSpectrum& spectrum) {
@@ -112,10 +134,19 @@ RadianceSpectrum GetApproximateSpectrumFrom3SpectrumSamples(
 }
 
 Color WhiteBalanceNaive(const Color& c) {
-  const Color sun_color = GetSrgbColor(SolarSpectrum() * (1.0 / sr));
-  const Luminance sun_luminance =
+  static const Color sun_color = GetSrgbColor(SolarSpectrum() * (1.0 / sr));
+  static const Luminance sun_luminance =
       dot(sun_color, vec3(1.0 / 3.0, 1.0 / 3.0, 1.0 / 3.0));
-  const auto white_point = sun_color / sun_luminance;
+  static const auto white_point = sun_color / sun_luminance;
   return Color(c.x / white_point.x, c.y / white_point.y, c.z / white_point.z);
 }
 
+Number GetDeltaE(const Color& c1, const Color& c2, Luminance white_luminance) {
+  double lab1[3];
+  double lab2[3];
+  GetLab(c1, white_luminance, lab1);
+  GetLab(c2, white_luminance, lab2);
+  return std::sqrt((lab1[0] - lab2[0]) * (lab1[0] - lab2[0]) +
+      (lab1[1] - lab2[1]) * (lab1[1] - lab2[1]) +
+      (lab1[2] - lab2[2]) * (lab1[2] - lab2[2]));
+}
@@ -62,4 +62,9 @@ RadianceSpectrum GetApproximateSpectrumFrom3SpectrumSamples(
 // (normalized) sun color.
 Color WhiteBalanceNaive(const Color& c);
 
+// Returns the CIE76 color difference (Delta E) between two linear sRGB colors,
+// converted to CIELAB with a D65 reference white of luminance
+// 'white_luminance'. A difference of about 2.3 is just noticeable.
+Number GetDeltaE(const Color& c1, const Color& c2, Luminance white_luminance);
+
 #endif  // ATMOSPHERE_COLOR_H_
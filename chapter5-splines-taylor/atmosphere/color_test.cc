@@ -0,0 +1,65 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/color.h"
+
+#include <string>
+
+#include "test/test_case.h"
+
+class TestColor : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestColor(const std::string& name, T test)
+      : TestCase("TestColor " + name, static_cast<Test>(test)) {}
+
+  void TestDeltaE() {
+    const Luminance white_luminance = 1000.0 * cd_per_square_meter;
+    const Color white(white_luminance, white_luminance, white_luminance);
+    const Color black(0.0 * cd_per_square_meter, 0.0 * cd_per_square_meter,
+        0.0 * cd_per_square_meter);
+    const Color blue(100.0 * cd_per_square_meter, 200.0 * cd_per_square_meter,
+        500.0 * cd_per_square_meter);
+    ExpectNear(0.0, GetDeltaE(blue, blue, white_luminance)(), 1e-9);
+    ExpectNear(100.0, GetDeltaE(white, black, white_luminance)(), 1e-2);
+    ExpectNear(GetDeltaE(blue, white, white_luminance)(),
+        GetDeltaE(white, blue, white_luminance)(), 1e-9);
+    // The difference only depends on the colors relatively to the white.
+    ExpectNear(GetDeltaE(blue, white, white_luminance)(),
+        GetDeltaE(blue * 3.0, white * 3.0, white_luminance * 3.0)(), 1e-9);
+    ExpectTrue(GetDeltaE(blue, blue * 1.01, white_luminance)() < 1.0);
+    ExpectTrue(GetDeltaE(blue, blue * 2.0, white_luminance)() > 10.0);
+  }
+};
+
+namespace {
+
+TestColor deltae("deltae", &TestColor::TestDeltaE);
+
+}  // anonymous namespace
@@ -35,9 +35,11 @@
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <vector>
 
-#include "minpng/minpng.h"
+#include "atmosphere/png_writer.h"
 #include "physics/cie.h"
+#include "util/profiling.h"
 #include "util/progress_bar.h"
 
 namespace {
@@ -158,21 +160,37 @@ Number GetColorErrorSquare(Color a, Color b) {
   return dot(ta - tb, ta - tb);
 }
 
-void WritePngArgb(const std::string& name, void* pixels, int width,
+// Saves the image asynchronously, with PngWriter::Default().
+void WritePngArgb(const std::string& name, const uint32_t* pixels, int width,
     int height) {
-  write_png(name.c_str(), pixels, width, height);
+  PngWriter::Default().Write(name,
+      std::vector<uint32_t>(pixels, pixels + width * height), width, height);
 }
 
+// A sum of squared errors and its number of terms. Used to compute RMSEs in
+// parallel, with one sum per ReduceJobs job.
+template<typename T>
+struct ErrorSquareSum {
+  T sum;
+  int count;
+
+  ErrorSquareSum operator+(const ErrorSquareSum& other) const {
+    return ErrorSquareSum{sum + other.sum, count + other.count};
+  }
+};
+
 }  // anonymous namespace
 
 Comparisons::Comparisons(const std::string& name, const Atmosphere& atmosphere,
     const MeasuredAtmospheres& reference, Wavelength min_wavelength,
     Wavelength max_wavelength)
     : name_(name), atmosphere_(atmosphere), reference_(reference),
-      min_wavelength_(min_wavelength), max_wavelength_(max_wavelength) {}
+      min_wavelength_(min_wavelength), max_wavelength_(max_wavelength),
+      radiance_cache_(atmosphere) {}
 
 void Comparisons::RenderSkyImage(const std::string& name, Angle sun_zenith,
     Angle sun_azimuth, bool white_balance) const {
+  PROFILE_SCOPE("RenderSkyImage");
   const int width = 1024;
   const int height = 576;
   const Angle kHorizontalFov = 90.0 * deg;
@@ -266,8 +284,26 @@ void Comparisons::PlotSunIlluminanceAttenuation() const {
 
 void Comparisons::PlotRadiance(const std::string& name, Angle sun_zenith,
     Angle sun_azimuth, Angle view_zenith, Angle view_azimuth) const {
-  RadianceSpectrum radiance = atmosphere_.GetSkyRadiance(
-      0.0 * m, sun_zenith, sun_azimuth, view_zenith, view_azimuth);
+  SaveRadiance(name, view_zenith, view_azimuth, atmosphere_.GetSkyRadiance(
+      0.0 * m, sun_zenith, sun_azimuth, view_zenith, view_azimuth));
+}
+
+void Comparisons::PlotSampleRadiances(const std::string& name,
+    Angle sun_zenith, Angle sun_azimuth) const {
+  auto radiances = radiance_cache_.Get<9>(sun_zenith, sun_azimuth);
+  for (int i = 0; i < 9; ++i) {
+    for (int j = 0; j < 9; ++j) {
+      Angle view_zenith;
+      Angle view_azimuth;
+      HemisphericalFunction<Number>::GetSampleDirection(
+          i, j, &view_zenith, &view_azimuth);
+      SaveRadiance(name, view_zenith, view_azimuth, radiances->Get(i, j));
+    }
+  }
+}
+
+void Comparisons::SaveRadiance(const std::string& name, Angle view_zenith,
+    Angle view_azimuth, const RadianceSpectrum& radiance) const {
   std::stringstream filename;
   filename << GetOutputDir() << "radiance_" << name << "_"
            << view_zenith.to(deg) << "_" << view_azimuth.to(deg) << "_" << name_
@@ -282,8 +318,10 @@ void Comparisons::PlotRadiance(const std::string& name, Angle sun_zenith,
 
 void Comparisons::RenderLuminanceAndImage(const std::string& name,
     Angle sun_zenith, Angle sun_azimuth) const {
-  const Luminance zenith_luminance = GetLuminance(atmosphere_.GetSkyRadiance(
-      0.0 * m, sun_zenith, sun_azimuth, 0.0 * deg, 0.0 * deg));
+  PROFILE_SCOPE("RenderLuminanceAndImage");
+  // The zenith is the central sample of the cached 9x9 radiances.
+  const Luminance zenith_luminance = GetLuminance(
+      radiance_cache_.Get<9>(sun_zenith, sun_azimuth)->Get(4, 4));
 
   const int width = 256;
   const int height = 256;
@@ -295,9 +333,8 @@ void Comparisons::RenderLuminanceAndImage(const std::string& name,
   std::unique_ptr<uint32_t[]> pixels6(new uint32_t[width * height]);
   std::unique_ptr<uint32_t[]> pixels7(new uint32_t[width * height]);
 
-  double square_error_sum = 0.0;
-  int count = 0;
-  RunJobs([&](unsigned int j) {
+  ErrorSquareSum<double> square_error = ReduceJobs(
+      [&](unsigned int j, ErrorSquareSum<double>* partial_square_error) {
     for (int i = 0; i < width; ++i) {
       Number x = (i + 0.5 - width / 2.0) / (width / 2.0);
       Number y = (height / 2.0 - 0.5 - j) / (height / 2.0);
@@ -316,7 +353,10 @@ void Comparisons::RenderLuminanceAndImage(const std::string& name,
       Angle view_azimuth = atan2(x, -y);
       RadianceSpectrum radiance = atmosphere_.GetSkyRadiance(
           0.0 * m, sun_zenith, sun_azimuth, view_zenith, view_azimuth);
-      const Luminance view_dir_luminance = GetLuminance(radiance);
+      // Luminance and full spectral color, in a single pass.
+      Color rgb;
+      Luminance view_dir_luminance;
+      GetSrgbColorsAndLuminances(&radiance, 1, &rgb, &view_dir_luminance);
       Number relative_luminance = view_dir_luminance / zenith_luminance;
 
       int red, green, blue;
@@ -327,8 +367,8 @@ void Comparisons::RenderLuminanceAndImage(const std::string& name,
       GetScaleColor(relative_luminance() * 100.0, &red, &green, &blue);
       pixels2[i + j * width] = (0xFF << 24) | (red << 16) | (green << 8) | blue;
 
-      Color rgb = GetSrgbColor(radiance);
-      Color rgb_original = GetOriginalColor(radiance);
+      Color rgb_original = atmosphere_.GetOriginalNumberOfWavelengths() ==
+          DimensionlessSpectrum::SIZE ? rgb : GetOriginalColor(radiance);
       Color rgb_approx_spectral = GetSrgbColorFrom3SpectrumSamples(radiance);
 
       const Luminance rgb_max = std::max(rgb.x, std::max(rgb.y, rgb.z));
@@ -355,16 +395,16 @@ void Comparisons::RenderLuminanceAndImage(const std::string& name,
       b = 255.0 * c.z();
       pixels6[i + j * width] = (0xFF << 24) | (r << 16) | (g << 8) | b;
 
-      square_error_sum += (r - red) * (r - red) + (g - green) * (g - green) +
-          (b - blue) * (b - blue);
-      count += 1;
+      partial_square_error->sum += (r - red) * (r - red) +
+          (g - green) * (g - green) + (b - blue) * (b - blue);
+      partial_square_error->count += 1;
 
       r = std::abs(r - red) * 10;
       g = std::abs(g - green) * 10;
       b = std::abs(b - blue) * 10;
       pixels7[i + j * width] = (0xFF << 24) | (r << 16) | (g << 8) | b;
     }
-  }, height);
+  }, height, ErrorSquareSum<double>{0.0, 0});
   DrawCrosses(sun_zenith, sun_azimuth, width, height, pixels1.get());
   DrawCrosses(sun_zenith, sun_azimuth, width, height, pixels2.get());
   DrawCrosses(sun_zenith, sun_azimuth, width, height, pixels3.get());
@@ -401,7 +441,7 @@ void Comparisons::RenderLuminanceAndImage(const std::string& name,
       GetOutputDir() + "image_approx_diff_" + name + "_" + name_ + ".png";
   WritePngArgb(filename7, pixels7.get(), width, height);
 
-  double mean_square_error = sqrt(square_error_sum / count);
+  double mean_square_error = sqrt(square_error.sum / square_error.count);
   double psnr = 10.0 * log(255 * 255 / mean_square_error) / log(10.0);
   std::ofstream psnr_stream(
        GetOutputDir() + "image_approx_psnr_" + name + "_" + name_ + ".txt");
@@ -441,6 +481,7 @@ void Comparisons::PlotLuminanceProfile(const std::string& name,
 SpectralRadiance Comparisons::PlotRelativeError(const std::string& name,
     Angle sun_zenith, Angle sun_azimuth,
     SpectralRadiance* rmse_with_approximate_spectrum) const {
+  PROFILE_SCOPE("PlotRelativeError");
   // Relative error for the measured directions, and interpolated in between.
   HemisphericalFunction<Number> relative_error;
   Number rgb_rmse;
@@ -498,13 +539,15 @@ SpectralRadiance Comparisons::PlotRelativeError(const std::string& name,
 
 void Comparisons::PlotRelativeError(const std::string& name,
     const Atmosphere& reference, Angle sun_zenith, Angle sun_azimuth) const {
+  PROFILE_SCOPE("PlotRelativeError");
   const int width = 256;
   const int height = 256;
   std::unique_ptr<uint32_t[]> pixels(new uint32_t[width * height]);
-  int count = 0;
-  auto error_square_sum = 0.0 * watt_per_square_meter_per_sr_per_nm *
+  auto zero = 0.0 * watt_per_square_meter_per_sr_per_nm *
       watt_per_square_meter_per_sr_per_nm;
-  RunJobs([&](unsigned int j) {
+  typedef ErrorSquareSum<decltype(zero)> SpectralErrorSquareSum;
+  SpectralErrorSquareSum error_square = ReduceJobs(
+      [&](unsigned int j, SpectralErrorSquareSum* partial_error_square) {
     for (int i = 0; i < width; ++i) {
       Number x = (i + 0.5 - width / 2.0) / (width / 2.0);
       Number y = (height / 2.0 - 0.5 - j) / (height / 2.0);
@@ -527,8 +570,9 @@ void Comparisons::PlotRelativeError(const std::string& name,
       for (unsigned int k = 0; k < model_spectrum.size(); ++k) {
         if (model_spectrum.GetSample(k) >= min_wavelength_ &&
             model_spectrum.GetSample(k) <= max_wavelength_) {
-          count += 1;
-          error_square_sum += (model_spectrum[k] - reference_spectrum[k]) *
+          partial_error_square->count += 1;
+          partial_error_square->sum +=
+              (model_spectrum[k] - reference_spectrum[k]) *
               (model_spectrum[k] - reference_spectrum[k]);
         }
       }
@@ -536,13 +580,13 @@ void Comparisons::PlotRelativeError(const std::string& name,
       GetErrorColor(relative_error(), &red, &green, &blue);
       pixels[i + j * width] = (0xFF << 24) | (red << 16) | (green << 8) | blue;
     }
-  }, height);
+  }, height, SpectralErrorSquareSum{zero, 0});
   DrawCrosses(sun_zenith, sun_azimuth, width, height, pixels.get());
   std::string filename =
       GetOutputDir() + "relative_error_" + name + "_" + name_ + ".png";
   WritePngArgb(filename, pixels.get(), width, height);
 
-  SpectralRadiance rmse = sqrt(error_square_sum / count);
+  SpectralRadiance rmse = sqrt(error_square.sum / error_square.count);
   double rounded_rmse =
       round(rmse.to(1e-4 * watt_per_square_meter_per_sr_per_nm)) / 10.0;
   std::ofstream file(GetOutputDir() + "error_" + name + "_" + name_ + ".txt");
@@ -569,6 +613,44 @@ SpectralRadiance Comparisons::ComputeTotalRmse(
   return sqrt(error_square_sum / sun_zenith.size());
 }
 
+Number Comparisons::ComputeMeanDeltaE(const Atmosphere* reference,
+    const std::vector<Angle>& sun_zenith,
+    const std::vector<Angle>& sun_azimuth) const {
+  PROFILE_SCOPE("ComputeMeanDeltaE");
+  Number delta_e_sum = 0.0;
+  for (unsigned int k = 0; k < sun_zenith.size(); ++k) {
+    auto model_radiances =
+        radiance_cache_.Get<9>(sun_zenith[k], sun_azimuth[k]);
+    Color model_colors[9][9];
+    Color reference_colors[9][9];
+    Luminance white_luminance = 0.0 * cd_per_square_meter;
+    for (int i = 0; i < 9; ++i) {
+      for (int j = 0; j < 9; ++j) {
+        Angle view_zenith;
+        Angle view_azimuth;
+        HemisphericalFunction<Number>::GetSampleDirection(
+            i, j, &view_zenith, &view_azimuth);
+        RadianceSpectrum reference_spectrum = reference ?
+            reference->GetSkyRadiance(0.0 * m, sun_zenith[k], sun_azimuth[k],
+                view_zenith, view_azimuth) :
+            reference_.GetSkyRadianceMeasurement(0.0 * m, sun_zenith[k],
+                sun_azimuth[k], view_zenith, view_azimuth);
+        model_colors[i][j] = GetSrgbColor(model_radiances->Get(i, j));
+        reference_colors[i][j] = GetSrgbColor(reference_spectrum);
+        white_luminance =
+            std::max(white_luminance, GetLuminance(reference_spectrum));
+      }
+    }
+    for (int i = 0; i < 9; ++i) {
+      for (int j = 0; j < 9; ++j) {
+        delta_e_sum += GetDeltaE(
+            model_colors[i][j], reference_colors[i][j], white_luminance);
+      }
+    }
+  }
+  return delta_e_sum / (81.0 * sun_zenith.size());
+}
+
 Luminance Comparisons::ComputeZenithLuminance(Angle sun_zenith) const {
   return GetLuminance(
       atmosphere_.GetSkyRadiance(0.0 * m, sun_zenith, 0.0 * deg, 0.0 * deg));
@@ -717,6 +799,7 @@ SpectralRadiance Comparisons::ComputeRelativeErrorAndRmse(Angle sun_zenith,
       SpectralRadiance* rmse_with_approximate_spectrum,
       Number* rgb_rmse, Number* original_rgb_rmse,
       Number* approximate_rgb_rmse) const {
+  PROFILE_SCOPE("ComputeRelativeErrorAndRmse");
   int count = 0;
   auto error_square_sum = 0.0 * watt_per_square_meter_per_sr_per_nm *
       watt_per_square_meter_per_sr_per_nm;
@@ -724,14 +807,14 @@ SpectralRadiance Comparisons::ComputeRelativeErrorAndRmse(Angle sun_zenith,
   Number rgb_error_square_sum = 0.0;
   auto original_rgb_error_square_sum = rgb_error_square_sum;
   auto approximate_rgb_error_square_sum = rgb_error_square_sum;
+  auto model_radiances = radiance_cache_.Get<9>(sun_zenith, sun_azimuth);
   for (int i = 0; i < 9; ++i) {
     for (int j = 0; j < 9; ++j) {
       Angle view_zenith;
       Angle view_azimuth;
       HemisphericalFunction<Number>::GetSampleDirection(
           i, j, &view_zenith, &view_azimuth);
-      RadianceSpectrum model_spectrum = atmosphere_.GetSkyRadiance(
-          0.0 * m, sun_zenith, sun_azimuth, view_zenith, view_azimuth);
+      const RadianceSpectrum& model_spectrum = model_radiances->Get(i, j);
       RadianceSpectrum model_approximate_spectrum =
           GetApproximateSpectrumFrom3SpectrumSamples(model_spectrum);
       RadianceSpectrum measured_spectrum = reference_.GetSkyRadianceMeasurement(
@@ -37,6 +37,7 @@
 #include "atmosphere/color.h"
 #include "atmosphere/hemispherical_function.h"
 #include "atmosphere/measurement/measured_atmospheres.h"
+#include "atmosphere/radiance_cache.h"
 #include "math/angle.h"
 #include "physics/units.h"
 
@@ -56,6 +57,11 @@ class Comparisons {
   void PlotRadiance(const std::string& name, Angle sun_zenith,
       Angle sun_azimuth, Angle view_zenith, Angle view_azimuth) const;
 
+  // Same as PlotRadiance for each of the 9x9 HemisphericalFunction sample
+  // directions, using the cached model radiances for this Sun direction.
+  void PlotSampleRadiances(const std::string& name, Angle sun_zenith,
+      Angle sun_azimuth) const;
+
   void RenderLuminanceAndImage(const std::string& name, Angle sun_zenith,
       Angle sun_azimuth) const;
 
@@ -72,6 +78,15 @@ class Comparisons {
   SpectralRadiance ComputeTotalRmse(const std::vector<Angle>& sun_zenith,
       const std::vector<Angle>& sun_azimuth) const;
 
+  // Returns the mean CIE76 color difference between the model and the
+  // reference sky colors, over the 9x9 sample directions and the given Sun
+  // directions. The reference is the measurements if 'reference' is null. The
+  // colors are converted to CIELAB with a white of the maximum reference
+  // luminance for each Sun direction.
+  Number ComputeMeanDeltaE(const Atmosphere* reference,
+      const std::vector<Angle>& sun_zenith,
+      const std::vector<Angle>& sun_azimuth) const;
+
   Luminance ComputeZenithLuminance(Angle sun_zenith) const;
   void ComputeIrradiance(Angle sun_zenith, Irradiance* sun,
       Irradiance* sky) const;
@@ -93,6 +108,12 @@ class Comparisons {
   const MeasuredAtmospheres& reference_;
   Wavelength min_wavelength_;
   Wavelength max_wavelength_;
+  // The model radiance at the 9x9 sample directions, for each Sun direction,
+  // shared by the outputs computed for this Sun direction.
+  mutable RadianceCache radiance_cache_;
+
+  void SaveRadiance(const std::string& name, Angle view_zenith,
+      Angle view_azimuth, const RadianceSpectrum& radiance) const;
 
   Color GetOriginalColor(const RadianceSpectrum& radiance) const;
 
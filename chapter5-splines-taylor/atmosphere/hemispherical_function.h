@@ -36,71 +36,121 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
+#include "math/file.h"
 #include "physics/units.h"
 
 // A function from the hemisphere to values of type T represented by its values
-// at 9x9 sample points mapped from the unit square to the hemisphere (using
+// at NxN sample points mapped from the unit square to the hemisphere (using
 // "A low distortion map between disk and square.", Hirley et al. 1997), and
-// interpolated with bicubic interpolation in between.
-template<class T>
+// interpolated with bicubic interpolation in between. N must be odd, so that
+// the central sample is at the zenith. The default 9x9 resolution is the one of
+// the Kider measurements, and its Load / Save file format is unchanged.
+//
+// The interpolated value in a given direction is a linear combination of at
+// most kMaxWeights sample values, whose indices and weights depend only on the
+// direction. They can be computed once with GetWeights() and then reused to
+// interpolate several functions in the same directions.
+template<class T, int N = 9>
 class HemisphericalFunction {
+  static_assert(N >= 3 && N % 2 == 1, "N must be an odd number at least 3");
+
  public:
+  static constexpr int kMaxWeights = 16;
+
+  // The sample values, designated by their index i * N + j, and their weights
+  // in the interpolated value in some direction.
+  struct Weights {
+    int count;
+    int index[kMaxWeights];
+    double weight[kMaxWeights];
+  };
+
+  HemisphericalFunction() : value_(N * N) {}
+
+  static constexpr int Size() { return N; }
+
   inline const T& Get(int i, int j) const {
-    assert(i >= 0 && i < 9 && j >= 0 && j < 9);
-    return value_[i][j];
+    assert(i >= 0 && i < N && j >= 0 && j < N);
+    return value_[i * N + j];
   }
 
   inline T& Get(int i, int j) {
-    assert(i >= 0 && i < 9 && j >= 0 && j < 9);
-    return value_[i][j];
+    assert(i >= 0 && i < N && j >= 0 && j < N);
+    return value_[i * N + j];
   }
 
   inline void Set(int i, int j, const T& value) {
-    assert(i >= 0 && i < 9 && j >= 0 && j < 9);
-    value_[i][j] = value;
+    assert(i >= 0 && i < N && j >= 0 && j < N);
+    value_[i * N + j] = value;
   }
 
   static void GetSampleDirection(int i, int j, Angle* view_zenith,
       Angle* view_azimuth) {
     double r;
     double phi;
-    ToUnitDisk((i + 0.5) / 9, (j + 0.5) / 9, &r, &phi);
+    ToUnitDisk((i + 0.5) / N, (j + 0.5) / N, &r, &phi);
     *view_zenith = acos(1.0 - r * r) * rad;
     *view_azimuth = phi * rad;
   }
 
-  T operator()(Angle view_zenith, Angle view_azimuth) const {
+  static Weights GetWeights(Angle view_zenith, Angle view_azimuth) {
     // Computes the nearest ring indices corresponding to view_zenith and
     // returns the cubic interpolation of the function values on these rings
     // (themselves interpolated from the sample values using cubic
     // interpolation, see below).
     Number z = cos(view_zenith);
     double r = std::sqrt(1.0 - z());
-    double u = 4.5 * r;
+    double u = 0.5 * N * r;
     int i = std::floor(u);
     u -= i;
-    return Cubic(u, GetRing(i - 1, view_azimuth), GetRing(i, view_azimuth),
-        GetRing(i + 1, view_azimuth), GetRing(i + 2, view_azimuth));
+    double cubic_weights[4];
+    GetCubicWeights(u, cubic_weights);
+    double azimuth = view_azimuth.to(dimensional::pi);
+    Weights weights;
+    weights.count = 0;
+    for (int k = 0; k < 4; ++k) {
+      AddRingWeights(i - 1 + k, azimuth, cubic_weights[k], &weights);
+    }
+    return weights;
+  }
+
+  T operator()(const Weights& weights) const {
+    assert(weights.count > 0);
+    T result = value_[weights.index[0]] * weights.weight[0];
+    for (int k = 1; k < weights.count; ++k) {
+      result = result + value_[weights.index[k]] * weights.weight[k];
+    }
+    return result;
+  }
+
+  T operator()(Angle view_zenith, Angle view_azimuth) const {
+    return (*this)(GetWeights(view_zenith, view_azimuth));
+  }
+
+  // Interpolates this function in 'count' directions, given by their weights.
+  void Interpolate(const Weights* weights, int count, T* values) const {
+    for (int k = 0; k < count; ++k) {
+      values[k] = (*this)(weights[k]);
+    }
   }
 
   void Load(const std::string& filename) {
     std::ifstream file(filename, std::ifstream::binary | std::ifstream::in);
-    for (int i = 0; i < 9; ++i) {
-      file.read(reinterpret_cast<char*>(&(value_[i])), 9 * sizeof(T));
-    }
+    file.read(reinterpret_cast<char*>(value_.data()), N * N * sizeof(T));
     file.close();
   }
 
   void Save(const std::string& filename) const {
-    std::ofstream file(filename, std::ofstream::binary);
-    for (int i = 0; i < 9; ++i) {
-      file.write(reinterpret_cast<const char*>(&(value_[i])), 9 * sizeof(T));
-    }
-    file.close();
+    dimensional::WriteFileAtomically(filename,
+        reinterpret_cast<const char*>(value_.data()), N * N * sizeof(T));
   }
 
  private:
+  // The index of the central sample, at the zenith, and of the last ring.
+  static constexpr int kCenter = N / 2;
+
   // From "A low distortion map between disk and square.", Hirley et al. 1997.
   static void ToUnitDisk(double x, double y, double *r, double *phi) {
     double a = 2 * x - 1;
@@ -128,86 +178,134 @@ class HemisphericalFunction {
     }
   }
 
-  // Returns the interpolated value of the hemispherical function on the given
-  // ring (see GetRing below), using cubic interpolation of the nearest samples
-  // on this ring. Also extrapolate the results to ring index -1 such that the
-  // interpolated function is differentiable at the zenith, and to ring indices
-  // larger than 4 to extrapolate the function up to the horizon.
-  T GetRing(int ring_index, Angle view_azimuth) const {
+  // Returns the sample indices i * N + j of all the rings, one after the other.
+  // Ring 0 is the zenith sample kCenter,kCenter, and ring k > 0 contains the 8k
+  // samples at distance k from it (in the infinity norm), starting at azimuth 0
+  // and ordered by increasing azimuth (sample k * m of this ring is at azimuth
+  // m * 45). Ring k starts at index GetRingStart(k).
+  static const std::vector<int>& GetRingSamples() {
+    static const std::vector<int> ring_samples = ComputeRingSamples();
+    return ring_samples;
+  }
+
+  static int GetRingStart(int ring_index) {
+    return ring_index == 0 ? 0 : 1 + 4 * ring_index * (ring_index - 1);
+  }
+
+  static std::vector<int> ComputeRingSamples() {
+    std::vector<int> ring_samples(N * N);
+    ring_samples[0] = kCenter * N + kCenter;
+    for (int ring_index = 1; ring_index <= kCenter; ++ring_index) {
+      for (int k = 0; k < 8 * ring_index; ++k) {
+        int dx = std::max(-ring_index, std::min(ring_index,
+            std::abs(k - 4 * ring_index) - 2 * ring_index));
+        int dy = std::max(-ring_index, std::min(ring_index,
+            std::abs((k + 6 * ring_index) % (8 * ring_index) -
+                4 * ring_index) - 2 * ring_index));
+        ring_samples[GetRingStart(ring_index) + k] =
+            (kCenter + dx) * N + kCenter + dy;
+      }
+    }
+    return ring_samples;
+  }
+
+  static void AddWeight(int index, double weight, Weights* weights) {
+    for (int k = 0; k < weights->count; ++k) {
+      if (weights->index[k] == index) {
+        weights->weight[k] += weight;
+        return;
+      }
+    }
+    assert(weights->count < kMaxWeights);
+    weights->index[weights->count] = index;
+    weights->weight[weights->count] = weight;
+    weights->count += 1;
+  }
+
+  // Adds the weights of the interpolated value of the hemispherical function on
+  // the given ring, multiplied by 'scale', using cubic interpolation of the
+  // nearest samples on this ring. Also extrapolate the results to ring index -1
+  // such that the interpolated function is differentiable at the zenith, and to
+  // ring indices larger than kCenter to extrapolate the function up to (and
+  // below) the horizon.
+  static void AddRingWeights(int ring_index, double azimuth, double scale,
+      Weights* weights) {
     assert(ring_index >= -1);
     if (ring_index == -1) {
       // Computes the value such that the finite difference derivative
-      //   0.5 * (GetRing(1, view_azimuth) - GetRing(-1, view_azimuth))
-      // is equal to GetZenithDerivative(view_azimuth).
-      return GetRing(1, view_azimuth) - GetZenithDerivative(view_azimuth) * 2.0;
-    } else if (ring_index > 4) {
-      // Noting R(i) = GetRing(ring_index + i, view_azimuth), computes the value
-      // R(0) such that the second derivative at -1, R(-2) - 2R(-1) + R(0) is
-      // equal to the second derivative at -2, R(-3) - 2R(-2) + R(-1).
-      return GetRing(ring_index - 3, view_azimuth) -
-          GetRing(ring_index - 2, view_azimuth) * 3.0 +
-          GetRing(ring_index - 1, view_azimuth) * 3.0;
+      //   0.5 * (Ring(1) - Ring(-1))
+      // is equal to the zenith derivative in direction 'azimuth'.
+      AddRingWeights(1, azimuth, scale, weights);
+      AddZenithDerivativeWeights(azimuth, -2.0 * scale, weights);
+    } else if (ring_index > kCenter) {
+      // Extrapolates the last 3 rings with a constant second derivative, i.e.
+      // with the quadratic polynomial through these rings, evaluated at t.
+      double t = ring_index - kCenter;
+      AddRingWeights(kCenter - 2, azimuth, scale * 0.5 * t * (t + 1.0),
+          weights);
+      AddRingWeights(kCenter - 1, azimuth, -scale * t * (t + 2.0), weights);
+      AddRingWeights(kCenter, azimuth, scale * 0.5 * (t + 1.0) * (t + 2.0),
+          weights);
+    } else if (ring_index == 0) {
+      AddWeight(kCenter * N + kCenter, scale, weights);
     } else {
       // Normal case: cubic interpolation of the nearest samples along the ring.
-      double u = view_azimuth.to(dimensional::pi) * (4 * ring_index);
+      const int* ring = GetRingSamples().data() + GetRingStart(ring_index);
+      int ring_size = 8 * ring_index;
+      double u = azimuth * (4 * ring_index);
       int i = std::floor(u);
       u -= i;
-      return Cubic(u, GetRing(ring_index, i - 1), GetRing(ring_index, i),
-          GetRing(ring_index, i + 1), GetRing(ring_index, i + 2));
-    }
-  }
-
-  // Returns the value of the sample point designated by the given ring index
-  // (0 is for the zenith sample 4,4, 1 is for samples 5,4 5,5 4,5 3,5 3,4 etc,
-  // and so on up to ring index 4) and index in ring (0 is for azimuth 0,
-  // ring_index for azimuth 45, k * ring_index for azimuth k * 45).
-  const T& GetRing(int ring_index, int index_in_ring) const {
-    assert(ring_index >= 0 && ring_index < 5);
-    if (ring_index == 0) {
-      return value_[4][4];
-    } else {
-      while (index_in_ring < 0) {
-        index_in_ring += 8 * ring_index;
+      i = ((i - 1) % ring_size + ring_size) % ring_size;
+      double cubic_weights[4];
+      GetCubicWeights(u, cubic_weights);
+      for (int k = 0; k < 4; ++k) {
+        AddWeight(ring[i], scale * cubic_weights[k], weights);
+        i = i + 1 == ring_size ? 0 : i + 1;
       }
-      int dx = std::max(-ring_index, std::min(ring_index,
-          std::abs(index_in_ring % (8 * ring_index) - 4 * ring_index) -
-              2 * ring_index));
-      int dy = std::max(-ring_index, std::min(ring_index,
-          std::abs((index_in_ring + 6 * ring_index) % (8 * ring_index) -
-              4 * ring_index) - 2 * ring_index));
-      return value_[4 + dx][4 + dy];
     }
   }
 
-  // Returns the derivative of the interpolated function at the zenith, in
-  // direction view_azimuth. For this, estimates the derivatives in the x and y
-  // directions from the 8 samples around the zenith, and returns a linear
-  // combination of those depending on the azimuth angle.
-  T GetZenithDerivative(Angle view_azimuth) const {
+  // Adds the weights of the derivative of the interpolated function at the
+  // zenith, in direction 'azimuth', multiplied by 'scale'. For this, estimates
+  // the derivatives in the x and y directions from the 8 samples around the
+  // zenith, and uses a linear combination of those depending on the azimuth.
+  static void AddZenithDerivativeWeights(double azimuth, double scale,
+      Weights* weights) {
     constexpr double norm = 1.0 / sqrt(2.0);
-    constexpr double scale = 0.5 / (1.0 + 2.0 * norm);
-    T derivative_x = ((value_[5][4] - value_[3][4]) +
-        (value_[5][5] - value_[3][3]) * norm +
-        (value_[5][3] - value_[3][5]) * norm) * scale;
-    T derivative_y = ((value_[4][5] - value_[4][3]) +
-        (value_[5][5] - value_[3][3]) * norm +
-        (value_[3][5] - value_[5][3]) * norm) * scale;
-    return
-        derivative_x * cos(view_azimuth)() + derivative_y * sin(view_azimuth)();
+    constexpr double normalization = 0.5 / (1.0 + 2.0 * norm);
+    constexpr int c = kCenter;
+    double x = std::cos(azimuth * dimensional::PI) * scale * normalization;
+    double y = std::sin(azimuth * dimensional::PI) * scale * normalization;
+    AddWeight((c + 1) * N + c, x, weights);
+    AddWeight((c - 1) * N + c, -x, weights);
+    AddWeight(c * N + c + 1, y, weights);
+    AddWeight(c * N + c - 1, -y, weights);
+    AddWeight((c + 1) * N + c + 1, (x + y) * norm, weights);
+    AddWeight((c - 1) * N + c - 1, -(x + y) * norm, weights);
+    AddWeight((c + 1) * N + c - 1, (x - y) * norm, weights);
+    AddWeight((c - 1) * N + c + 1, (y - x) * norm, weights);
   }
 
-  static T Cubic(double u, T am1, T a0, T a1, T a2) {
-    return (a0 * 2.0 + ((-am1 + a1) + ((am1 * 2.0 - a0 * 5.0 + a1 * 4.0 - a2) +
-        (-am1 + a0 * 3.0 - a1 * 3.0 + a2) * u) * u) * u) * 0.5;
+  // The weights w such that the cubic interpolation of am1, a0, a1, a2 at u is
+  // w[0] * am1 + w[1] * a0 + w[2] * a1 + w[3] * a2.
+  static void GetCubicWeights(double u, double w[4]) {
+    double u2 = u * u;
+    double u3 = u2 * u;
+    w[0] = 0.5 * (-u + 2.0 * u2 - u3);
+    w[1] = 0.5 * (2.0 - 5.0 * u2 + 3.0 * u3);
+    w[2] = 0.5 * (u + 4.0 * u2 - 3.0 * u3);
+    w[3] = 0.5 * (-u2 + u3);
   }
 
   // The function values in the unit square, mapped to the hemisphere using
-  // "A low distortion map between disk and square.", Hirley et al. 1997. The
+  // "A low distortion map between disk and square.", Hirley et al. 1997, and
+  // stored row by row (value i * N + j is the value of sample i,j). The
   // positive x axis corresponds to azimuth 0 (North), and the positive y axis
-  // to azimuth 90 (East). More precisely, element [4][4] corresponds to the
-  // zenith, element [8][4] corresponds to azimuth 0 and elevation 12.1151 from
-  // the horizon, and element[4][8] to azimuth 90 and the same elevation.
-  T value_[9][9];
+  // to azimuth 90 (East). More precisely, for N = 9, element [4][4] corresponds
+  // to the zenith, element [8][4] corresponds to azimuth 0 and elevation
+  // 12.1151 from the horizon, and element[4][8] to azimuth 90 and the same
+  // elevation.
+  std::vector<T> value_;
 };
 
 #endif  // ATMOSPHERE_HEMISPHERICAL_FUNCTION_H_
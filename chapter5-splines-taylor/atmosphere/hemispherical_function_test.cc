@@ -30,6 +30,7 @@
 #include "atmosphere/hemispherical_function.h"
 
 #include <string>
+#include <vector>
 
 #include "test/test_case.h"
 
@@ -123,6 +124,83 @@ class TestHemisphericalFunction : public dimensional::TestCase {
       }
     }
   }
+
+  void TestWeights() {
+    CheckWeights<3>();
+    CheckWeights<5>();
+    CheckWeights<9>();
+    CheckWeights<65>();
+  }
+
+  void TestHighResolution() {
+    constexpr int kSize = 65;
+    HemisphericalFunction<double, kSize> f;
+    for (int i = 0; i < kSize; ++i) {
+      for (int j = 0; j < kSize; ++j) {
+        Angle view_zenith;
+        Angle view_azimuth;
+        HemisphericalFunction<double, kSize>::GetSampleDirection(
+            i, j, &view_zenith, &view_azimuth);
+        f.Set(i, j, SmoothFunction(view_zenith, view_azimuth));
+      }
+    }
+    for (int i = 0; i < kSize; i += 4) {
+      for (int j = 0; j < kSize; j += 4) {
+        Angle view_zenith;
+        Angle view_azimuth;
+        HemisphericalFunction<double, kSize>::GetSampleDirection(
+            i, j, &view_zenith, &view_azimuth);
+        ExpectNear(f.Get(i, j), f(view_zenith, view_azimuth), 1e-8);
+      }
+    }
+    for (int i = 0; i <= 85; i += 5) {
+      for (int j = 0; j < 360; j += 7) {
+        Angle view_zenith = i * deg;
+        Angle view_azimuth = j * deg;
+        ExpectNear(SmoothFunction(view_zenith, view_azimuth),
+            f(view_zenith, view_azimuth), 1e-3);
+      }
+    }
+  }
+
+ private:
+  template<int N>
+  void CheckWeights() {
+    HemisphericalFunction<double, N> f;
+    for (int i = 0; i < N; ++i) {
+      for (int j = 0; j < N; ++j) {
+        f.Set(i, j, i * 10 + j);
+      }
+    }
+    std::vector<typename HemisphericalFunction<double, N>::Weights> weights;
+    std::vector<double> expected_values;
+    for (int i = 0; i <= 100; i += 5) {
+      for (int j = -360; j <= 720; j += 11) {
+        Angle view_zenith = i * deg;
+        Angle view_azimuth = j * deg;
+        weights.push_back(HemisphericalFunction<double, N>::GetWeights(
+            view_zenith, view_azimuth));
+        expected_values.push_back(f(view_zenith, view_azimuth));
+        double weight_sum = 0.0;
+        for (int k = 0; k < weights.back().count; ++k) {
+          weight_sum += weights.back().weight[k];
+        }
+        ExpectNear(1.0, weight_sum, 1e-9);
+      }
+    }
+    std::vector<double> values(weights.size());
+    f.Interpolate(weights.data(), weights.size(), values.data());
+    for (unsigned int k = 0; k < values.size(); ++k) {
+      ExpectEquals(expected_values[k], values[k]);
+    }
+  }
+
+  static double SmoothFunction(Angle view_zenith, Angle view_azimuth) {
+    double x = sin(view_zenith)() * cos(view_azimuth)();
+    double y = sin(view_zenith)() * sin(view_azimuth)();
+    double z = cos(view_zenith)();
+    return 1.0 + x - 2.0 * y + x * y + z * z;
+  }
 };
 
 namespace {
@@ -135,6 +213,10 @@ TestHemisphericalFunction interpolation(
     "interpolation", &TestHemisphericalFunction::TestInterpolation);
 TestHemisphericalFunction loadsave(
     "loadsave", &TestHemisphericalFunction::TestLoadSave);
+TestHemisphericalFunction weights(
+    "weights", &TestHemisphericalFunction::TestWeights);
+TestHemisphericalFunction highresolution(
+    "highresolution", &TestHemisphericalFunction::TestHighResolution);
 
 }  // anonymous namespace
 
@@ -29,6 +29,8 @@
 */
 #include "atmosphere/measurement/measured_atmosphere.h"
 
+#include <sys/stat.h>
+
 #include <algorithm>
 #include <cassert>
 #include <fstream>
@@ -36,6 +38,8 @@
 #include <sstream>
 #include <vector>
 
+#include "atmosphere/measurement/measurement_dataset.h"
+
 namespace {
 
 std::string ToString(double x) {
@@ -117,19 +121,15 @@ MeasuredAtmosphere::MeasuredAtmosphere(const std::string& directory,
     : directory_(directory), date_(date), hour_(hour), minutes_(minutes) {
   const std::string cache_file_name =
       cache_directory + "/" + date + hour + minutes + ".dat";
-  if (cache_directory.length() > 0) {
-    std::ifstream f;
-    f.open(cache_file_name);
-    if (f.good()) {
-      f.close();
-      measurements_.Load(cache_file_name);
-      std::ifstream file(cache_file_name + ".params",
-          std::ifstream::binary | std::ifstream::in);
-      file.read(reinterpret_cast<char*>(&sun_zenith_), sizeof(sun_zenith_));
-      file.read(reinterpret_cast<char*>(&sun_azimuth_), sizeof(sun_azimuth_));
-      file.close();
-      return;
-    }
+  if (cache_directory.length() > 0 &&
+      IsUpToDate(cache_file_name, directory, date, hour, minutes)) {
+    measurements_.Load(cache_file_name);
+    std::ifstream file(cache_file_name + ".params",
+        std::ifstream::binary | std::ifstream::in);
+    file.read(reinterpret_cast<char*>(&sun_zenith_), sizeof(sun_zenith_));
+    file.read(reinterpret_cast<char*>(&sun_azimuth_), sizeof(sun_azimuth_));
+    file.close();
+    return;
   }
 
   std::cout << "Loading " << hour << "h" << minutes << "..." << std::endl;
@@ -176,6 +176,39 @@ MeasuredAtmosphere::MeasuredAtmosphere(const std::string& directory,
   }
 }
 
+MeasuredAtmosphere::MeasuredAtmosphere(const MeasurementDataset& dataset,
+    int index)
+    : directory_(dataset.directory(index)), date_(dataset.date(index)),
+      hour_(dataset.hour(index)), minutes_(dataset.minutes(index)),
+      sun_zenith_(dataset.sun_zenith(index)),
+      sun_azimuth_(dataset.sun_azimuth(index)) {
+  for (int i = 0; i < 9; ++i) {
+    for (int j = 0; j < 9; ++j) {
+      measurements_.Set(i, j, dataset.GetRadiance(index, i, j));
+    }
+  }
+}
+
+bool MeasuredAtmosphere::IsUpToDate(const std::string& filename,
+    const std::string& directory, const std::string& date,
+    const std::string& hour, const std::string& minutes) {
+  struct stat file_stat;
+  if (stat(filename.c_str(), &file_stat) != 0) {
+    return false;
+  }
+  for (int i = 0; i < 81; ++i) {
+    int x, y;
+    struct stat source_stat;
+    std::string source = GetFileNameAndSampleLocation(
+        directory, date, hour, minutes, i, &x, &y);
+    if (stat(source.c_str(), &source_stat) == 0 &&
+        source_stat.st_mtime > file_stat.st_mtime) {
+      return false;
+    }
+  }
+  return true;
+}
+
 std::string MeasuredAtmosphere::GetSourceFileName(int i, int j) const {
   if (i == 8 && j == 4) {
     // Measurement sample 0 (north) seems systematically wrong.
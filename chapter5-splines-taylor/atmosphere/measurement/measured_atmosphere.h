@@ -37,6 +37,8 @@
 #include "math/angle.h"
 #include "physics/units.h"
 
+class MeasurementDataset;
+
 class MeasuredAtmosphere : public Atmosphere {
  public:
   MeasuredAtmosphere(const std::string& directory, const std::string& date,
@@ -44,11 +46,25 @@ class MeasuredAtmosphere : public Atmosphere {
       Angle sun_azimuth, const std::string& cache_directory,
       bool compute_azimuth_from_data = true);
 
+  // Creates the atmosphere corresponding to the given measurement of a
+  // compiled dataset.
+  MeasuredAtmosphere(const MeasurementDataset& dataset, int index);
+
+  // Returns true if 'filename' exists and is at least as recent as the text
+  // files of the given measurement (the missing text files are ignored, so
+  // that files derived from them can still be used without them).
+  static bool IsUpToDate(const std::string& filename,
+      const std::string& directory, const std::string& date,
+      const std::string& hour, const std::string& minutes);
+
   std::string GetSourceFileName(int i, int j) const;
   std::string GetSourceFileName(Angle view_zenith, Angle view_azimuth) const;
 
   inline const Angle sun_zenith() const { return sun_zenith_; }
   inline const Angle sun_azimuth() const { return sun_azimuth_; }
+  inline const HemisphericalFunction<RadianceSpectrum>& measurements() const {
+    return measurements_;
+  }
 
   IrradianceSpectrum GetSunIrradiance(Length altitude,
       Angle sun_zenith) const;
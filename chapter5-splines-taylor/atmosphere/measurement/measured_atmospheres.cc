@@ -29,29 +29,87 @@
 */
 #include "atmosphere/measurement/measured_atmospheres.h"
 
+#include <cassert>
+#include <utility>
+
+#include "util/progress_bar.h"
+
 void MeasuredAtmospheres::AddAtmosphere(const MeasuredAtmosphere* atmosphere) {
-  measurements_.push_back(
-      std::unique_ptr<const MeasuredAtmosphere>(atmosphere));
+  Measurement measurement;
+  measurement.sun_zenith = atmosphere->sun_zenith();
+  measurement.sun_azimuth = atmosphere->sun_azimuth();
+  measurement.index = -1;
+  measurement.atmosphere.reset(atmosphere);
+  measurement.created.reset(new std::once_flag());
+  measurements_.push_back(std::move(measurement));
 }
 
-IrradianceSpectrum MeasuredAtmospheres::GetSunIrradiance(Length altitude,
-    Angle sun_zenith) const {
+void MeasuredAtmospheres::AddDataset(
+    std::shared_ptr<const MeasurementDataset> dataset) {
+  for (int i = 0; i < dataset->size(); ++i) {
+    Measurement measurement;
+    measurement.sun_zenith = dataset->sun_zenith(i);
+    measurement.sun_azimuth = dataset->sun_azimuth(i);
+    measurement.dataset = dataset;
+    measurement.index = i;
+    measurement.created.reset(new std::once_flag());
+    measurements_.push_back(std::move(measurement));
+  }
+}
+
+void MeasuredAtmospheres::AddDatasets(
+    const std::vector<std::string>& filenames) {
+  std::vector<std::shared_ptr<const MeasurementDataset>> datasets(
+      filenames.size());
+  RunJobs([&](unsigned int i) {
+    datasets[i] = std::make_shared<const MeasurementDataset>(filenames[i]);
+  }, filenames.size());
+  for (unsigned int i = 0; i < datasets.size(); ++i) {
+    AddDataset(datasets[i]);
+  }
+}
+
+const MeasuredAtmosphere& MeasuredAtmospheres::GetMeasurement(
+    int index) const {
+  assert(index >= 0 && index < num_measurements());
+  const Measurement& measurement = measurements_[index];
+  std::call_once(*measurement.created, [&measurement]() {
+    if (!measurement.atmosphere) {
+      measurement.atmosphere.reset(
+          new MeasuredAtmosphere(*measurement.dataset, measurement.index));
+    }
+  });
+  return *measurement.atmosphere;
+}
+
+const MeasuredAtmosphere* MeasuredAtmospheres::Find(Angle sun_zenith,
+    const Angle* sun_azimuth) const {
   for (unsigned int i = 0; i < measurements_.size(); ++i) {
-    if (measurements_[i]->sun_zenith() == sun_zenith) {
-      return measurements_[i]->GetSunIrradiance(altitude, sun_zenith);
+    if (measurements_[i].sun_zenith == sun_zenith &&
+        (sun_azimuth == nullptr ||
+         measurements_[i].sun_azimuth == *sun_azimuth)) {
+      return &GetMeasurement(i);
     }
   }
+  return nullptr;
+}
+
+IrradianceSpectrum MeasuredAtmospheres::GetSunIrradiance(Length altitude,
+    Angle sun_zenith) const {
+  const MeasuredAtmosphere* measurement = Find(sun_zenith, nullptr);
+  if (measurement != nullptr) {
+    return measurement->GetSunIrradiance(altitude, sun_zenith);
+  }
   assert(false);
   return IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm);
 }
 
 RadianceSpectrum MeasuredAtmospheres::GetSkyRadiance(Length altitude,
     Angle sun_zenith, Angle view_zenith, Angle view_sun_azimuth) const {
-  for (unsigned int i = 0; i < measurements_.size(); ++i) {
-    if (measurements_[i]->sun_zenith() == sun_zenith) {
-      return measurements_[i]->GetSkyRadiance(
-          altitude, sun_zenith, view_zenith, view_sun_azimuth);
-    }
+  const MeasuredAtmosphere* measurement = Find(sun_zenith, nullptr);
+  if (measurement != nullptr) {
+    return measurement->GetSkyRadiance(
+        altitude, sun_zenith, view_zenith, view_sun_azimuth);
   }
   assert(false);
   return RadianceSpectrum(0.0 * watt_per_square_meter_per_sr_per_nm);
@@ -60,12 +118,10 @@ RadianceSpectrum MeasuredAtmospheres::GetSkyRadiance(Length altitude,
 RadianceSpectrum MeasuredAtmospheres::GetSkyRadiance(Length altitude,
     Angle sun_zenith, Angle sun_azimuth, Angle view_zenith,
     Angle view_azimuth) const {
-  for (unsigned int i = 0; i < measurements_.size(); ++i) {
-    if (measurements_[i]->sun_zenith() == sun_zenith &&
-        measurements_[i]->sun_azimuth() == sun_azimuth) {
-      return measurements_[i]->GetSkyRadiance(
-          altitude, sun_zenith, sun_azimuth, view_zenith, view_azimuth);
-    }
+  const MeasuredAtmosphere* measurement = Find(sun_zenith, &sun_azimuth);
+  if (measurement != nullptr) {
+    return measurement->GetSkyRadiance(
+        altitude, sun_zenith, sun_azimuth, view_zenith, view_azimuth);
   }
   assert(false);
   return RadianceSpectrum(0.0 * watt_per_square_meter_per_sr_per_nm);
@@ -74,12 +130,10 @@ RadianceSpectrum MeasuredAtmospheres::GetSkyRadiance(Length altitude,
 RadianceSpectrum MeasuredAtmospheres::GetSkyRadianceMeasurement(Length altitude,
     Angle sun_zenith, Angle sun_azimuth, Angle view_zenith,
     Angle view_azimuth) const {
-  for (unsigned int i = 0; i < measurements_.size(); ++i) {
-    if (measurements_[i]->sun_zenith() == sun_zenith &&
-        measurements_[i]->sun_azimuth() == sun_azimuth) {
-      return measurements_[i]->GetSkyRadianceMeasurement(
-          altitude, sun_zenith, sun_azimuth, view_zenith, view_azimuth);
-    }
+  const MeasuredAtmosphere* measurement = Find(sun_zenith, &sun_azimuth);
+  if (measurement != nullptr) {
+    return measurement->GetSkyRadianceMeasurement(
+        altitude, sun_zenith, sun_azimuth, view_zenith, view_azimuth);
   }
   assert(false);
   return RadianceSpectrum(0.0 * watt_per_square_meter_per_sr_per_nm);
@@ -87,10 +141,9 @@ RadianceSpectrum MeasuredAtmospheres::GetSkyRadianceMeasurement(Length altitude,
 
 IrradianceSpectrum MeasuredAtmospheres::GetSkyIrradiance(Length altitude,
     Angle sun_zenith) const {
-  for (unsigned int i = 0; i < measurements_.size(); ++i) {
-    if (measurements_[i]->sun_zenith() == sun_zenith) {
-      return measurements_[i]->GetSkyIrradiance(altitude, sun_zenith);
-    }
+  const MeasuredAtmosphere* measurement = Find(sun_zenith, nullptr);
+  if (measurement != nullptr) {
+    return measurement->GetSkyIrradiance(altitude, sun_zenith);
   }
   assert(false);
   return IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm);
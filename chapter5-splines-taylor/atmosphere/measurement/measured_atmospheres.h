@@ -31,11 +31,13 @@
 #define ATMOSPHERE_MEASUREMENT_MEASURED_ATMOSPHERES_H_
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "atmosphere/atmosphere.h"
 #include "atmosphere/measurement/measured_atmosphere.h"
+#include "atmosphere/measurement/measurement_dataset.h"
 #include "math/angle.h"
 #include "physics/units.h"
 
@@ -44,6 +46,19 @@ class MeasuredAtmospheres : public Atmosphere {
   // Takes ownership of the given object.
   void AddAtmosphere(const MeasuredAtmosphere* atmosphere);
 
+  // Adds all the measurements of the given dataset. The corresponding
+  // MeasuredAtmosphere objects are only created when first needed.
+  void AddDataset(std::shared_ptr<const MeasurementDataset> dataset);
+
+  // Opens the given dataset files (e.g. one per day) in parallel, and adds
+  // their measurements in the given order.
+  void AddDatasets(const std::vector<std::string>& filenames);
+
+  int num_measurements() const { return measurements_.size(); }
+
+  // Returns the measurement with the given index, in insertion order.
+  const MeasuredAtmosphere& GetMeasurement(int index) const;
+
   IrradianceSpectrum GetSunIrradiance(Length altitude,
       Angle sun_zenith) const;
 
@@ -62,7 +77,24 @@ class MeasuredAtmospheres : public Atmosphere {
       Angle sun_zenith) const;
 
  private:
-  std::vector<std::unique_ptr<const MeasuredAtmosphere>> measurements_;
+  struct Measurement {
+    Angle sun_zenith;
+    Angle sun_azimuth;
+    // The dataset and index from which 'atmosphere' is created, if null.
+    std::shared_ptr<const MeasurementDataset> dataset;
+    int index;
+    mutable std::unique_ptr<const MeasuredAtmosphere> atmosphere;
+    // Guards the lazy creation of 'atmosphere', without any lock once it is
+    // created (in a unique_ptr, since std::once_flag is not movable).
+    std::unique_ptr<std::once_flag> created;
+  };
+
+  // Returns the first measurement with the given sun zenith angle (and sun
+  // azimuth angle, if not null), or null if there is none.
+  const MeasuredAtmosphere* Find(Angle sun_zenith,
+      const Angle* sun_azimuth) const;
+
+  std::vector<Measurement> measurements_;
 };
 
 #endif  // ATMOSPHERE_MEASUREMENT_MEASURED_ATMOSPHERES_H_
@@ -0,0 +1,239 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/measurement/measurement_dataset.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include "atmosphere/measurement/measured_atmosphere.h"
+#include "util/progress_bar.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'K', 'I', 'D', 'E', 'R', 'D', 'A', 'T'};
+constexpr int kVersion = 1;
+constexpr int kNumSamples = 9 * 9;
+constexpr int kNumWavelengths = RadianceSpectrum::SIZE;
+
+void CopyString(const std::string& value, char* output, size_t output_size) {
+  if (value.length() >= output_size) {
+    std::cerr << "String '" << value << "' is too long for a measurement "
+        << "dataset (max " << output_size - 1 << " characters)" << std::endl;
+    ::exit(-1);
+  }
+  std::memset(output, 0, output_size);
+  std::memcpy(output, value.c_str(), value.length());
+}
+
+}  // anonymous namespace
+
+struct MeasurementDataset::Header {
+  char magic[8];
+  int32_t version;
+  int32_t num_measurements;
+  int32_t num_samples;
+  int32_t num_wavelengths;
+};
+
+struct MeasurementDataset::IndexEntry {
+  char directory[128];
+  char date[16];
+  char hour[8];
+  char minutes[8];
+};
+
+void MeasurementDataset::Compile(const std::vector<Source>& sources,
+    const std::string& cache_directory, const std::string& filename) {
+  std::vector<std::unique_ptr<MeasuredAtmosphere>> atmospheres(sources.size());
+  RunJobs([&](unsigned int i) {
+    const Source& source = sources[i];
+    atmospheres[i].reset(new MeasuredAtmosphere(source.directory, source.date,
+        source.hour, source.minutes, source.sun_zenith, source.sun_azimuth,
+        cache_directory, source.compute_azimuth_from_data));
+  }, sources.size());
+
+  Header header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.num_measurements = sources.size();
+  header.num_samples = kNumSamples;
+  header.num_wavelengths = kNumWavelengths;
+
+  std::vector<IndexEntry> index(sources.size());
+  std::vector<double> sun_zenith(sources.size());
+  std::vector<double> sun_azimuth(sources.size());
+  std::vector<double> radiance;
+  for (unsigned int k = 0; k < sources.size(); ++k) {
+    const MeasuredAtmosphere& atmosphere = *atmospheres[k];
+    CopyString(sources[k].directory, index[k].directory,
+        sizeof(index[k].directory));
+    CopyString(sources[k].date, index[k].date, sizeof(index[k].date));
+    CopyString(sources[k].hour, index[k].hour, sizeof(index[k].hour));
+    CopyString(sources[k].minutes, index[k].minutes, sizeof(index[k].minutes));
+    sun_zenith[k] = atmosphere.sun_zenith().to(rad);
+    sun_azimuth[k] = atmosphere.sun_azimuth().to(rad);
+    for (int i = 0; i < 9; ++i) {
+      for (int j = 0; j < 9; ++j) {
+        const RadianceSpectrum& spectrum = atmosphere.measurements().Get(i, j);
+        for (int l = 0; l < kNumWavelengths; ++l) {
+          radiance.push_back(
+              spectrum[l].to(watt_per_square_meter_per_sr_per_nm));
+        }
+      }
+    }
+  }
+
+  // Write to a temporary file first, so that an interrupted compilation never
+  // leaves a truncated dataset behind.
+  const std::string tmp_filename = filename + ".tmp";
+  std::ofstream file(tmp_filename, std::ofstream::binary);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(index.data()),
+      index.size() * sizeof(IndexEntry));
+  file.write(reinterpret_cast<const char*>(sun_zenith.data()),
+      sun_zenith.size() * sizeof(double));
+  file.write(reinterpret_cast<const char*>(sun_azimuth.data()),
+      sun_azimuth.size() * sizeof(double));
+  file.write(reinterpret_cast<const char*>(radiance.data()),
+      radiance.size() * sizeof(double));
+  file.close();
+  if (!file.good() || std::rename(tmp_filename.c_str(), filename.c_str())) {
+    std::cerr << "Cannot write file '" << filename << "'" << std::endl;
+    ::exit(-1);
+  }
+}
+
+bool MeasurementDataset::IsUpToDate(const std::vector<Source>& sources,
+    const std::string& filename) {
+  for (const Source& source : sources) {
+    if (!MeasuredAtmosphere::IsUpToDate(filename, source.directory,
+        source.date, source.hour, source.minutes)) {
+      return false;
+    }
+  }
+  return std::ifstream(filename).good();
+}
+
+MeasurementDataset::MeasurementDataset(const std::string& filename)
+    : data_(nullptr), data_size_(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd < 0 || fstat(fd, &file_stat) != 0) {
+    std::cerr << "Cannot open file '" << filename << "'" << std::endl;
+    ::exit(-1);
+  }
+  data_size_ = file_stat.st_size;
+  void* data = data_size_ >= sizeof(Header) ?
+      mmap(nullptr, data_size_, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (data == MAP_FAILED) {
+    std::cerr << "Cannot map file '" << filename << "'" << std::endl;
+    ::exit(-1);
+  }
+  data_ = static_cast<const char*>(data);
+
+  header_ = reinterpret_cast<const Header*>(data_);
+  const size_t n = header_->num_measurements;
+  if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header_->version != kVersion || header_->num_samples != kNumSamples ||
+      header_->num_wavelengths != kNumWavelengths ||
+      data_size_ != sizeof(Header) + n * (sizeof(IndexEntry) +
+          (2 + kNumSamples * kNumWavelengths) * sizeof(double))) {
+    std::cerr << "Invalid measurement dataset file '" << filename << "'"
+        << std::endl;
+    ::exit(-1);
+  }
+  index_ = reinterpret_cast<const IndexEntry*>(data_ + sizeof(Header));
+  sun_zenith_ = reinterpret_cast<const double*>(index_ + n);
+  sun_azimuth_ = sun_zenith_ + n;
+  radiance_ = sun_azimuth_ + n;
+}
+
+MeasurementDataset::~MeasurementDataset() {
+  munmap(const_cast<char*>(data_), data_size_);
+}
+
+int MeasurementDataset::size() const {
+  return header_->num_measurements;
+}
+
+std::string MeasurementDataset::directory(int index) const {
+  assert(index >= 0 && index < size());
+  return index_[index].directory;
+}
+
+std::string MeasurementDataset::date(int index) const {
+  assert(index >= 0 && index < size());
+  return index_[index].date;
+}
+
+std::string MeasurementDataset::hour(int index) const {
+  assert(index >= 0 && index < size());
+  return index_[index].hour;
+}
+
+std::string MeasurementDataset::minutes(int index) const {
+  assert(index >= 0 && index < size());
+  return index_[index].minutes;
+}
+
+Angle MeasurementDataset::sun_zenith(int index) const {
+  assert(index >= 0 && index < size());
+  return sun_zenith_[index] * rad;
+}
+
+Angle MeasurementDataset::sun_azimuth(int index) const {
+  assert(index >= 0 && index < size());
+  return sun_azimuth_[index] * rad;
+}
+
+RadianceSpectrum MeasurementDataset::GetRadiance(int index, int i,
+    int j) const {
+  assert(index >= 0 && index < size());
+  assert(i >= 0 && i < 9 && j >= 0 && j < 9);
+  const double* values =
+      radiance_ + ((index * 9 + i) * 9 + j) * kNumWavelengths;
+  RadianceSpectrum result;
+  for (int l = 0; l < kNumWavelengths; ++l) {
+    result[l] = values[l] * watt_per_square_meter_per_sr_per_nm;
+  }
+  return result;
+}
@@ -0,0 +1,108 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef ATMOSPHERE_MEASUREMENT_MEASUREMENT_DATASET_H_
+#define ATMOSPHERE_MEASUREMENT_MEASUREMENT_DATASET_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "math/angle.h"
+#include "physics/units.h"
+
+// A read-only set of Kider sky measurements (typically all the measurements
+// of one day), compiled into a single binary file from the original text
+// files. The file is memory mapped, so that opening it is cheap and only the
+// measurements which are actually used are read from disk.
+//
+// File layout (native endianness): a header, an index with the source
+// directory and time of each measurement, followed by one column per
+// attribute: the sun zenith angles, the sun azimuth angles (in radians), and
+// the 9x9 radiance spectra of each measurement (in W.m^-2.sr^-1.nm^-1,
+// contiguous for a given measurement).
+class MeasurementDataset {
+ public:
+  // The location and the theoretical sun direction of the measurements made at
+  // a given time, as required by the MeasuredAtmosphere constructor.
+  struct Source {
+    std::string directory;
+    std::string date;
+    std::string hour;
+    std::string minutes;
+    Angle sun_zenith;
+    Angle sun_azimuth;
+    bool compute_azimuth_from_data = true;
+  };
+
+  // Loads the given measurements from their text files in parallel (or from
+  // their individual cache files in 'cache_directory', if any), and packs them
+  // into a single dataset file.
+  static void Compile(const std::vector<Source>& sources,
+      const std::string& cache_directory, const std::string& filename);
+
+  // Returns true if the given dataset file exists and is at least as recent as
+  // the text files of the given measurements, i.e. if it does not need to be
+  // compiled again.
+  static bool IsUpToDate(const std::vector<Source>& sources,
+      const std::string& filename);
+
+  explicit MeasurementDataset(const std::string& filename);
+  ~MeasurementDataset();
+
+  MeasurementDataset(const MeasurementDataset& rhs) = delete;
+  MeasurementDataset& operator=(const MeasurementDataset& rhs) = delete;
+
+  int size() const;
+
+  std::string directory(int index) const;
+  std::string date(int index) const;
+  std::string hour(int index) const;
+  std::string minutes(int index) const;
+  Angle sun_zenith(int index) const;
+  Angle sun_azimuth(int index) const;
+
+  // Returns the radiance of the (i,j) sample of the HemisphericalFunction of
+  // the given measurement.
+  RadianceSpectrum GetRadiance(int index, int i, int j) const;
+
+ private:
+  struct Header;
+  struct IndexEntry;
+
+  const char* data_;
+  size_t data_size_;
+  const Header* header_;
+  const IndexEntry* index_;
+  const double* sun_zenith_;
+  const double* sun_azimuth_;
+  const double* radiance_;
+};
+
+#endif  // ATMOSPHERE_MEASUREMENT_MEASUREMENT_DATASET_H_
@@ -0,0 +1,137 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/measurement/measurement_dataset.h"
+
+#include <utime.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "atmosphere/measurement/measured_atmosphere.h"
+#include "atmosphere/measurement/measured_atmospheres.h"
+#include "test/test_case.h"
+
+class TestMeasurementDataset : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestMeasurementDataset(const std::string& name, T test)
+      : TestCase("TestMeasurementDataset " + name, static_cast<Test>(test)) {}
+
+  static MeasurementDataset::Source GetTestSource() {
+    MeasurementDataset::Source source;
+    source.directory = "atmosphere/measurement/testdata";
+    source.date = "2013-05-27";
+    source.hour = "11";
+    source.minutes = "45";
+    source.sun_zenith = 1.0 * deg;
+    source.sun_azimuth = 2.0 * deg;
+    source.compute_azimuth_from_data = false;
+    return source;
+  }
+
+  void TestCompileAndLoad() {
+    const std::string filename = "output/Debug/measurement_dataset_test.kider";
+    std::remove(filename.c_str());
+    MeasurementDataset::Source source = GetTestSource();
+    MeasurementDataset::Compile({source}, "", filename);
+
+    MeasuredAtmosphere expected(source.directory, source.date, source.hour,
+        source.minutes, source.sun_zenith, source.sun_azimuth, "",
+        false /* compute_azimuth_from_data */);
+    MeasurementDataset dataset(filename);
+    ExpectEquals(1, dataset.size());
+    ExpectTrue(source.directory == dataset.directory(0));
+    ExpectTrue(source.date == dataset.date(0));
+    ExpectTrue(source.hour == dataset.hour(0));
+    ExpectTrue(source.minutes == dataset.minutes(0));
+    ExpectTrue(expected.sun_zenith() == dataset.sun_zenith(0));
+    ExpectTrue(expected.sun_azimuth() == dataset.sun_azimuth(0));
+
+    MeasuredAtmosphere actual(dataset, 0);
+    ExpectTrue(
+        expected.GetSourceFileName(3, 4) == actual.GetSourceFileName(3, 4));
+    for (int i = 0; i < 9; ++i) {
+      for (int j = 0; j < 9; ++j) {
+        for (int l = 0; l < 40; ++l) {
+          ExpectEquals(
+              expected.measurements().Get(i, j)[l].to(
+                  watt_per_square_meter_per_sr_per_nm),
+              actual.measurements().Get(i, j)[l].to(
+                  watt_per_square_meter_per_sr_per_nm));
+        }
+      }
+    }
+  }
+
+  void TestIsUpToDate() {
+    const std::string filename =
+        "output/Debug/measurement_dataset_test_up_to_date.kider";
+    std::remove(filename.c_str());
+    MeasurementDataset::Source source = GetTestSource();
+    ExpectFalse(MeasurementDataset::IsUpToDate({source}, filename));
+    MeasurementDataset::Compile({source}, "", filename);
+    ExpectTrue(MeasurementDataset::IsUpToDate({source}, filename));
+
+    // A dataset older than its measurement files must be compiled again.
+    struct utimbuf times;
+    times.actime = 1;
+    times.modtime = 1;
+    utime(filename.c_str(), &times);
+    ExpectFalse(MeasurementDataset::IsUpToDate({source}, filename));
+  }
+
+  void TestLazyLoadFromMeasuredAtmospheres() {
+    const std::string filename =
+        "output/Debug/measurement_dataset_test_lazy.kider";
+    std::remove(filename.c_str());
+    MeasurementDataset::Compile({GetTestSource()}, "", filename);
+    MeasuredAtmospheres atmospheres;
+    atmospheres.AddDatasets({filename, filename});
+    ExpectEquals(2, atmospheres.num_measurements());
+    const MeasuredAtmosphere& atmosphere = atmospheres.GetMeasurement(1);
+    SpectralRadiance sr1 = atmospheres.GetSkyRadiance(0 * m,
+        atmosphere.sun_zenith(), atmosphere.sun_azimuth(),
+        (90.0 - 12.1151) * deg, (360.0 - 326.25) * deg)(400.0 * nm);
+    ExpectNear(29, sr1.to(watt_per_square_meter_per_sr_per_nm), 1e-3);
+  }
+};
+
+namespace {
+
+TestMeasurementDataset compileandload(
+    "compileandload", &TestMeasurementDataset::TestCompileAndLoad);
+TestMeasurementDataset isuptodate(
+    "isuptodate", &TestMeasurementDataset::TestIsUpToDate);
+TestMeasurementDataset lazyloadfrommeasuredatmospheres(
+    "lazyloadfrommeasuredatmospheres",
+    &TestMeasurementDataset::TestLazyLoadFromMeasuredAtmospheres);
+
+}  // anonymous namespace
@@ -33,10 +33,12 @@
 #include <string>
 
 #include "atmosphere/model/bruneton/core.h"
+#include "util/profiling.h"
 
 Bruneton::Bruneton(ScatteringType scattering_type,
     int original_number_of_wavelength)
         : original_number_of_wavelength_(original_number_of_wavelength) {
+  PROFILE_SCOPE("Bruneton precomputation");
   std::ifstream f;
   std::string name;
   const std::string cache_directory = "output/cache/bruneton/";
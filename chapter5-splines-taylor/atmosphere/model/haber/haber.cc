@@ -30,8 +30,10 @@
 #include "atmosphere/model/haber/haber.h"
 
 #include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <sstream>
 #include <string>
@@ -81,43 +83,50 @@ Haber::Haber(ScatteringType scattering_type)
     rayleigh_density_[i] = exp(-layer_center / RayleighScaleHeight);
     mie_density_[i] = exp(-layer_center / MieScaleHeight);
   }
-  int num_cells = 0;
   for (int i = 0; i < kNumTheta; ++i) {
+    first_ring_[i] = rings_.size();
     Angle theta_min = i * kDeltaPhi;
     Angle theta_max = (i + 1) * kDeltaPhi;
     Angle theta = (i + 0.5) * kDeltaPhi;
-    for (int j = 0; j < kNumPhi / 2; ++j) {
-      Angle phi = (j + 0.5) * kDeltaPhi;
-      for (int k = 0; k < kNumShell; ++k) {
-        Length r_min = kMinShellRadius * pow(kShellRatio, k);
-        Length r_max = kMinShellRadius * pow(kShellRatio, k + 1);
-        Length r = (r_min + r_max) * 0.5;
-        Cell cell;
-        cell.center.x = r * cos(phi) * sin(theta);
-        cell.center.y = r * sin(phi) * sin(theta);
-        cell.center.z = r * cos(theta) + EarthRadius;
-        if (length(cell.center) <= EarthRadius) {
-          continue;
-        }
-        if (length(cell.center) >= EarthRadius + kMaxLayerHeight) {
-          break;
-        }
-        cell.volume = (r_max * r_max * r_max - r_min * r_min * r_min) / 3.0 *
-            (2.0 * PI / kNumPhi) * (cos(theta_min) - cos(theta_max));
-        cell.radial_width = r_max - r_min;
-        cell.shell_index = k;
-        cell.layer_index = GetLayerIndex(cell.center);
-        assert(cell.layer_index >= 0 && cell.layer_index < kNumLayers);
-        cells_[i][j].push_back(cell);
-        ++num_cells;
+    for (int k = 0; k < kNumShell; ++k) {
+      Length r_min = kMinShellRadius * pow(kShellRatio, k);
+      Length r_max = kMinShellRadius * pow(kShellRatio, k + 1);
+      Length r = (r_min + r_max) * 0.5;
+      // The distance to the Earth center does not depend on the azimuth, so
+      // the same cells are kept for all the azimuth indices.
+      Position center0 = Position(r * cos(0.5 * kDeltaPhi) * sin(theta),
+          r * sin(0.5 * kDeltaPhi) * sin(theta), r * cos(theta) + EarthRadius);
+      if (length(center0) <= EarthRadius) {
+        continue;
+      }
+      if (length(center0) >= EarthRadius + kMaxLayerHeight) {
+        break;
+      }
+      Ring ring;
+      ring.theta_index = i;
+      ring.shell_index = k;
+      ring.layer_index = GetLayerIndex(center0);
+      ring.volume = (r_max * r_max * r_max - r_min * r_min * r_min) / 3.0 *
+          (2.0 * PI / kNumPhi) * (cos(theta_min) - cos(theta_max));
+      ring.radial_width = r_max - r_min;
+      assert(ring.layer_index >= 0 && ring.layer_index < kNumLayers);
+      if (k % 4 == 0) {
+        active_rings_.push_back(rings_.size());
+      }
+      rings_.push_back(ring);
+      for (int j = 0; j < kNumPhi / 2; ++j) {
+        Angle phi = (j + 0.5) * kDeltaPhi;
+        center_.push_back(Position(r * cos(phi) * sin(theta),
+            r * sin(phi) * sin(theta), r * cos(theta) + EarthRadius));
       }
     }
   }
-  for (int i = 0; i < kNumTheta; ++i) {
-    for (int j = 0; j < kNumPhi / 2; ++j) {
-      assert(cells_[i][j].size() == cells_[i][0].size());
-    }
-  }
+  first_ring_[kNumTheta] = rings_.size();
+  assert(center_.size() == rings_.size() * (kNumPhi / 2));
+  iso_.resize(center_.size());
+  aniso_.resize(center_.size());
+  last_.resize(center_.size());
+  current_.resize(center_.size());
 }
 
 IrradianceSpectrum Haber::GetSunIrradiance(Length altitude,
@@ -166,6 +175,7 @@ void Haber::MaybeInit(Angle sun_zenith) const {
     ComputeSkyDome(sun_zenith, SINGLE_SCATTERING_ONLY);
     sky_dome_.Save(GetCacheFileName(sun_zenith, SINGLE_SCATTERING_ONLY));
 
+    MaybeComputeCellToCellTable();
     constexpr int kNumScatteringOrders = 4;
     for (int i = 2; i <= kNumScatteringOrders; ++i) {
       std::cout << "Precomputing (sun zenith angle " << sun_zenith.to(deg)
@@ -186,187 +196,224 @@ void Haber::MaybeInit(Angle sun_zenith) const {
   sky_dome_.Load(name);
 }
 
+void Haber::MaybeComputeCellToCellTable() const {
+  if (!AllocateCellToCellTable()) {
+    return;
+  }
+  std::cout << "Precomputing cell to cell table..." << std::endl;
+  const int num_active_rings = active_rings_.size();
+  ProgressBar progress_bar(num_active_rings);
+  RunJobs([&](unsigned int t) {
+    ComputeCellToCellTable(t);
+    progress_bar.Increment(1);
+  }, num_active_rings);
+}
+
+bool Haber::AllocateCellToCellTable() const {
+  constexpr int kNumDeltaPhi = kNumPhi / 2 + 1;
+  const int num_active_rings = active_rings_.size();
+  const size_t table_size =
+      static_cast<size_t>(num_active_rings) * num_active_rings * kNumDeltaPhi;
+  if (cell_to_cell_table_.rayleigh_length.size() == table_size) {
+    return false;
+  }
+  cell_to_cell_table_.rayleigh_length.resize(table_size);
+  cell_to_cell_table_.mie_length.resize(table_size);
+  cell_to_cell_table_.inverse_distance_square.resize(table_size);
+  return true;
+}
+
+void Haber::ComputeCellToCellTable(int active_ring_index) const {
+  constexpr int kNumDeltaPhi = kNumPhi / 2 + 1;
+  const int num_active_rings = active_rings_.size();
+  const int t = active_ring_index;
+  const Position& target0 = center_[GetCellIndex(active_rings_[t], 0)];
+  for (int s = 0; s < num_active_rings; ++s) {
+    const size_t offset =
+        (static_cast<size_t>(t) * num_active_rings + s) * kNumDeltaPhi;
+    for (int d = 0; d < kNumDeltaPhi; ++d) {
+      Length rayleigh_length = 0.0 * m;
+      Length mie_length = 0.0 * m;
+      Area distance_square = 0.0 * m2;
+      if (s != t || d != 0) {
+        Position source = GetCellCenter(active_rings_[s], d);
+        GetOpticalLength(source, target0, &rayleigh_length, &mie_length);
+        distance_square = dot(source - target0, source - target0);
+      }
+      cell_to_cell_table_.rayleigh_length[offset + d] = rayleigh_length.to(m);
+      cell_to_cell_table_.mie_length[offset + d] = mie_length.to(m);
+      cell_to_cell_table_.inverse_distance_square[offset + d] =
+          distance_square == 0.0 * m2 ? 0.0 : (m2 / distance_square)();
+    }
+  }
+}
+
 void Haber::ComputeSingleScatter(Angle sun_zenith) const {
-  for (int i = 0; i < kNumTheta; ++i) {
+  for (unsigned int r = 0; r < rings_.size(); ++r) {
+    const Ring& ring = rings_[r];
     for (int j = 0; j < kNumPhi / 2; ++j) {
-      std::vector<Cell>& cells = cells_[i][j];
-      for (unsigned int k = 0; k < cells.size(); ++k) {
-        Cell& cell = cells[k];
-        Position q =
-            GetRayIntersectionWithLastLayer(cell.center, sun_zenith);
-        auto I =
-            GetTransmittance(cell.center, q) * SolarSpectrum() * cell.volume;
-        cell.iso =
-            I * RayleighScattering() * rayleigh_density_[cell.layer_index];
-        cell.aniso = I * MieScattering() * mie_density_[cell.layer_index];
-        cell.current = PowerSpectrum(0.0 * watt / nm);
-      }
+      const int c = GetCellIndex(r, j);
+      Position q = GetRayIntersectionWithLastLayer(center_[c], sun_zenith);
+      auto I = GetTransmittance(center_[c], q) * SolarSpectrum() * ring.volume;
+      iso_[c] = I * RayleighScattering() * rayleigh_density_[ring.layer_index];
+      aniso_[c] = I * MieScattering() * mie_density_[ring.layer_index];
+      current_[c] = PowerSpectrum(0.0 * watt / nm);
     }
   }
 }
 
 void Haber::ComputeMultipleScatter(Angle sun_zenith,
     bool double_scatter) const {
-  int total_progress = 0;
-  for (int i_tgt = 0; i_tgt < kNumTheta; ++i_tgt) {
-    for (size_t k_tgt = 0; k_tgt < cells_[i_tgt][0].size(); ++k_tgt) {
-      if (cells_[i_tgt][0][k_tgt].shell_index % 4 != 0) {
+  const int num_active_rings = active_rings_.size();
+  ProgressBar progress_bar(num_active_rings);
+  // Each job writes only to the cells of its target ring, so jobs never write
+  // to the same cells.
+  RunJobs([&](unsigned int t) {
+    ComputeMultipleScatter(sun_zenith, double_scatter, t);
+    progress_bar.Increment(1);
+  }, num_active_rings);
+}
+
+void Haber::ComputeMultipleScatter(Angle sun_zenith, bool double_scatter,
+    int active_ring_index) const {
+  // A function from wavelength to solid angle values.
+  typedef WavelengthFunction<0, 0, 1, 0, 0> SolidAngleSpectrum;
+  constexpr int kNumDeltaPhi = kNumPhi / 2 + 1;
+  const int num_active_rings = active_rings_.size();
+  const int t = active_ring_index;
+  const Direction sun_dir = Direction(sin(sun_zenith), 0.0, cos(sun_zenith));
+  const InverseSolidAngle iso_phase = 1.0 / (4.0 * PI * sr);
+  const int target_ring_index = active_rings_[t];
+  const Ring& target_ring = rings_[target_ring_index];
+  auto target_scatter = (
+      RayleighScattering() * rayleigh_density_[target_ring.layer_index] +
+      MieScattering() * mie_density_[target_ring.layer_index]) *
+          target_ring.volume;
+
+  // The transmittances times the solid angles subtended by the source cells,
+  // as seen from the target cells, for each azimuth index difference.
+  SolidAngleSpectrum transmitted_solid_angle[kNumDeltaPhi];
+  RadianceSpectrum src_radiance[kNumPhi / 2];
+  IrradianceSpectrum irradiance[kNumPhi / 2];
+  for (int j = 0; j < kNumPhi / 2; ++j) {
+    irradiance[j] = IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm);
+  }
+
+  for (int s = 0; s < num_active_rings; ++s) {
+    const int src_ring_index = active_rings_[s];
+    const Ring& src_ring = rings_[src_ring_index];
+    const size_t offset =
+        (static_cast<size_t>(t) * num_active_rings + s) * kNumDeltaPhi;
+    auto src_solid_angle_times_area =
+        src_ring.volume / (src_ring.radial_width * 4.0 * PI) * sr;
+    for (int d = 0; d < kNumDeltaPhi; ++d) {
+      Length rayleigh_length =
+          cell_to_cell_table_.rayleigh_length[offset + d] * m;
+      Length mie_length = cell_to_cell_table_.mie_length[offset + d] * m;
+      if (std::isinf(rayleigh_length.to(m))) {
+        transmitted_solid_angle[d] = SolidAngleSpectrum(0.0 * sr);
         continue;
       }
-      for (int i_src = 0; i_src < kNumTheta; ++i_src) {
-        for (size_t k_src = 0; k_src < cells_[i_src][0].size(); ++k_src) {
-          if (cells_[i_src][0][k_src].shell_index % 4 != 0) {
-            continue;
-          }
-          total_progress += 1;
-        }
-      }
+      Number inverse_distance_square =
+          cell_to_cell_table_.inverse_distance_square[offset + d];
+      transmitted_solid_angle[d] = exp(-(RayleighScattering() *
+          rayleigh_length + MieExtinction() * mie_length)) *
+          (src_solid_angle_times_area * inverse_distance_square / m2);
     }
-  }
-  ProgressBar progress_bar(total_progress);
-
-  RunJobs([&](int i_tgt) {
-    Direction sun_dir = Direction(sin(sun_zenith), 0.0, cos(sun_zenith));
-    DimensionlessSpectrum transmittances[kNumPhi];
-    for (size_t k_tgt = 0; k_tgt < cells_[i_tgt][0].size(); ++k_tgt) {
-      Cell& target0 = cells_[i_tgt][0][k_tgt];
-      if (target0.shell_index % 4 != 0) {
-        continue;
+
+    auto inverse_area = src_ring.radial_width / src_ring.volume;
+    if (!double_scatter) {
+      for (int j = 0; j < kNumPhi / 2; ++j) {
+        src_radiance[j] = last_[GetCellIndex(src_ring_index, j)] *
+            iso_phase * inverse_area;
       }
-      auto target0_scatter = (
-          RayleighScattering() * rayleigh_density_[target0.layer_index] +
-          MieScattering() * mie_density_[target0.layer_index]) * target0.volume;
-
-      for (int i_src = 0; i_src < kNumTheta; ++i_src) {
-        for (size_t k_src = 0; k_src < cells_[i_src][0].size(); ++k_src) {
-          if (cells_[i_src][0][k_src].shell_index % 4 != 0) {
-            continue;
-          }
-          // Precompute and cache the transmittances from target0 to all cells
-          // in ring (i_src,*,k_src).
-          for (int j_src = 0; j_src < kNumPhi; ++j_src) {
-            int j = j_src < kNumPhi / 2 ? j_src : kNumPhi - 1 - j_src;
-            Cell& src = cells_[i_src][j][k_src];
-            if (i_src == i_tgt && j_src == 0 && k_src == k_tgt) {
-              transmittances[j_src] = DimensionlessSpectrum(1.0);
-            } else {
-              Position src_center = src.center;
-              if (j_src >= kNumPhi / 2) {
-                src_center.y = -src_center.y;
-              }
-              transmittances[j_src] =
-                  GetTransmittance(src_center, target0.center);
-            }
-          }
-
-          for (int j_tgt = 0; j_tgt < kNumPhi / 2; ++j_tgt) {
-            Cell& target = cells_[i_tgt][j_tgt][k_tgt];
-            for (int j_src = 0; j_src < kNumPhi; ++j_src) {
-              int j = j_src < kNumPhi / 2 ? j_src : kNumPhi - 1 - j_src;
-              Cell& src = cells_[i_src][j][k_src];
-              if (i_src == i_tgt && j_src == j_tgt && k_src == k_tgt) {
-                continue;
-              }
-              Position src_center = src.center;
-              if (j_src >= kNumPhi / 2) {
-                src_center.y = -src_center.y;
-              }
-              Position segment = src_center - target.center;
-              Area segment_length_square = dot(segment, segment);
-              Direction d = segment / sqrt(segment_length_square);
-              InverseSolidAngle iso_phase = 1.0 / (4.0 * PI * sr);
-              InverseSolidAngle mie_phase = MiePhaseFunction(dot(d, sun_dir));
-
-              RadianceSpectrum src_radiance;
-              if (double_scatter) {
-                src_radiance =
-                    (src.iso * iso_phase + src.aniso * mie_phase) *
-                    (src.radial_width / src.volume);
-              } else {
-                src_radiance =
-                    src.last * iso_phase * (src.radial_width / src.volume);
-              }
-              auto src_solid_angle = src.volume /
-                  (src.radial_width * 4.0 * PI * segment_length_square) * sr;
-              int transmittance_index = (j_src - j_tgt + kNumPhi) % kNumPhi;
-              target.current += transmittances[transmittance_index] *
-                  src_radiance * target0_scatter * src_solid_angle;
-            }
-          }
-          progress_bar.Increment(1);
+    }
+
+    for (int j_tgt = 0; j_tgt < kNumPhi / 2; ++j_tgt) {
+      const Position& target_center =
+          center_[GetCellIndex(target_ring_index, j_tgt)];
+      for (int j_src = 0; j_src < kNumPhi; ++j_src) {
+        if (s == t && j_src == j_tgt) {
+          continue;
+        }
+        int j = j_src < kNumPhi / 2 ? j_src : kNumPhi - 1 - j_src;
+        int delta_phi = (j_src - j_tgt + kNumPhi) % kNumPhi;
+        int d = delta_phi <= kNumPhi / 2 ? delta_phi : kNumPhi - delta_phi;
+        if (double_scatter) {
+          const int src = GetCellIndex(src_ring_index, j);
+          Position segment =
+              GetCellCenter(src_ring_index, j_src) - target_center;
+          Direction dir = segment / length(segment);
+          InverseSolidAngle mie_phase = MiePhaseFunction(dot(dir, sun_dir));
+          irradiance[j_tgt] += transmitted_solid_angle[d] *
+              ((iso_[src] * iso_phase + aniso_[src] * mie_phase) *
+                  inverse_area);
+        } else {
+          irradiance[j_tgt] += transmitted_solid_angle[d] * src_radiance[j];
         }
       }
     }
-  }, kNumTheta);
+  }
+
+  for (int j = 0; j < kNumPhi / 2; ++j) {
+    current_[GetCellIndex(target_ring_index, j)] =
+        irradiance[j] * target_scatter;
+  }
 }
 
 void Haber::InterpolateMultipleScatter(bool double_scatter) const {
   PowerSpectrum sum_over_all_cells = PowerSpectrum(0.0 * watt / nm);
   PowerSpectrum sum_over_active_cells = PowerSpectrum(0.0 * watt / nm);
   for (int i = 0; i < kNumTheta; ++i) {
+    std::map<int, int> ring_from_shell_index;
+    for (int r = first_ring_[i]; r < first_ring_[i + 1]; ++r) {
+      ring_from_shell_index[rings_[r].shell_index] = r;
+    }
     for (int j = 0; j < kNumPhi / 2; ++j) {
-      std::vector<Cell>& cells = cells_[i][j];
-      std::map<int, int> index_from_shell_index;
-      for (unsigned int k = 0; k < cells.size(); ++k) {
-        Cell& cell = cells[k];
-        index_from_shell_index[cell.shell_index] = k;
-        if (double_scatter) {
-          if (cell.shell_index % 4 == 0) {
-            sum_over_active_cells += cell.iso + cell.aniso;
-          }
-          sum_over_all_cells += cell.iso + cell.aniso;
-        } else {
-          if (cell.shell_index % 4 == 0) {
-            sum_over_active_cells += cell.last;
-          }
-          sum_over_all_cells += cell.last;
+      for (int r = first_ring_[i]; r < first_ring_[i + 1]; ++r) {
+        const int c = GetCellIndex(r, j);
+        PowerSpectrum cell_power =
+            double_scatter ? iso_[c] + aniso_[c] : last_[c];
+        if (rings_[r].shell_index % 4 == 0) {
+          sum_over_active_cells += cell_power;
         }
+        sum_over_all_cells += cell_power;
       }
-      for (unsigned int k = 0; k < cells.size(); ++k) {
-        Cell& cell = cells[k];
-        if (cell.shell_index % 4 != 0) {
-          int shell_index0 = 4 * (cell.shell_index / 4);
-          int shell_index1 = shell_index0 + 4;
-          int index0 = Lookup(index_from_shell_index, shell_index0);
-          int index1 = Lookup(index_from_shell_index, shell_index1);
-          if (index0 >= 0 && index1 >= 0) {
-            double u = (cell.shell_index % 4) / 4.0;
-            cell.current =
-                cells[index0].current * (1.0 - u) + cells[index1].current * u;
-          } else if (index0 >= 0) {
-            cell.current = cells[index0].current;
-          } else if (index1 >= 0) {
-            cell.current = cells[index1].current;
-          } else {
-            cell.current = PowerSpectrum(0.0 * watt / nm);
-          }
+      for (int r = first_ring_[i]; r < first_ring_[i + 1]; ++r) {
+        const int shell_index = rings_[r].shell_index;
+        if (shell_index % 4 == 0) {
+          continue;
+        }
+        const int c = GetCellIndex(r, j);
+        int shell_index0 = 4 * (shell_index / 4);
+        int shell_index1 = shell_index0 + 4;
+        int ring0 = Lookup(ring_from_shell_index, shell_index0);
+        int ring1 = Lookup(ring_from_shell_index, shell_index1);
+        if (ring0 >= 0 && ring1 >= 0) {
+          double u = (shell_index % 4) / 4.0;
+          current_[c] = current_[GetCellIndex(ring0, j)] * (1.0 - u) +
+              current_[GetCellIndex(ring1, j)] * u;
+        } else if (ring0 >= 0) {
+          current_[c] = current_[GetCellIndex(ring0, j)];
+        } else if (ring1 >= 0) {
+          current_[c] = current_[GetCellIndex(ring1, j)];
+        } else {
+          current_[c] = PowerSpectrum(0.0 * watt / nm);
         }
       }
     }
   }
   Number scale = Integral(sum_over_all_cells) / Integral(sum_over_active_cells);
-  for (int i = 0; i < kNumTheta; ++i) {
-    for (int j = 0; j < kNumPhi / 2; ++j) {
-      std::vector<Cell>& cells = cells_[i][j];
-      for (unsigned int k = 0; k < cells.size(); ++k) {
-        Cell& cell = cells[k];
-        cell.current = cell.current * scale;
-      }
-    }
+  for (unsigned int c = 0; c < current_.size(); ++c) {
+    current_[c] = current_[c] * scale;
   }
 }
 
 void Haber::AccumulateMultipleScatter() const {
-  for (int i = 0; i < kNumTheta; ++i) {
-    for (int j = 0; j < kNumPhi / 2; ++j) {
-      std::vector<Cell>& cells = cells_[i][j];
-      for (unsigned int k = 0; k < cells.size(); ++k) {
-        Cell& cell = cells[k];
-        cell.iso = cell.iso + cell.current;
-        cell.last = cell.current;
-        cell.current = PowerSpectrum(0.0 * watt / nm);
-      }
-    }
+  for (unsigned int c = 0; c < current_.size(); ++c) {
+    iso_[c] = iso_[c] + current_[c];
+    last_[c] = current_[c];
+    current_[c] = PowerSpectrum(0.0 * watt / nm);
   }
 }
 
@@ -382,16 +429,15 @@ void Haber::ComputeSkyDome(Angle sun_zenith,
       InverseSolidAngle mie_phase = MiePhaseFunction(view_sun);
       RadianceSpectrum radiance =
           RadianceSpectrum(0.0 * watt_per_square_meter_per_sr_per_nm);
-      std::vector<Cell>& cells = cells_[i][j];
-      for (unsigned int k = 0; k < cells.size(); ++k) {
-        Cell& cell = cells[k];
-        auto inverse_area = cell.radial_width / cell.volume;
+      for (int r = first_ring_[i]; r < first_ring_[i + 1]; ++r) {
+        const int c = GetCellIndex(r, j);
+        auto inverse_area = rings_[r].radial_width / rings_[r].volume;
         if (scattering_type == DOUBLE_SCATTERING_ONLY) {
-          radiance += GetTransmittance(viewer, cell.center) *
-              (cell.last * iso_phase) * inverse_area;
+          radiance += GetTransmittance(viewer, center_[c]) *
+              (last_[c] * iso_phase) * inverse_area;
         } else {
-          radiance += GetTransmittance(viewer, cell.center) *
-              (cell.iso * iso_phase + cell.aniso * mie_phase) * inverse_area;
+          radiance += GetTransmittance(viewer, center_[c]) *
+              (iso_[c] * iso_phase + aniso_[c] * mie_phase) * inverse_area;
         }
       }
       sky_dome_.Set(i, j, radiance);
@@ -399,28 +445,56 @@ void Haber::ComputeSkyDome(Angle sun_zenith,
   }
 }
 
+Haber::Position Haber::GetCellCenter(int ring_index, int phi_index) const {
+  if (phi_index < kNumPhi / 2) {
+    return center_[GetCellIndex(ring_index, phi_index)];
+  }
+  Position center = center_[GetCellIndex(ring_index, kNumPhi - 1 - phi_index)];
+  center.y = -center.y;
+  return center;
+}
+
 DimensionlessSpectrum Haber::GetTransmittance(const Position& p,
     const Position& q) const {
+  Length rayleigh_length;
+  Length mie_length;
+  GetOpticalLength(p, q, &rayleigh_length, &mie_length);
+  if (std::isinf(rayleigh_length.to(m))) {
+    return DimensionlessSpectrum(0.0);
+  }
+  DimensionlessSpectrum optical_depth = RayleighScattering() * rayleigh_length +
+      MieExtinction() * mie_length;
+  return exp(-optical_depth);
+}
+
+void Haber::GetOpticalLength(const Position& p, const Position& q,
+    Length* rayleigh_length, Length* mie_length) const {
   // Compute where the line (p,q) is the closest to the Earth center.
   Number t = dot(p, p - q) / dot(p - q, p - q);
   if (t > 0.0 && t < 1.0) {
-    // If it is between p and q, compute the transmittance in two steps, unless
-    // the nearest distance to the center is less than the Earth radius.
+    // If it is between p and q, compute the optical length in two steps,
+    // unless the nearest distance to the center is less than the Earth radius.
     Position r = p + (q - p) * t;
     if (length(r) <= EarthRadius) {
-      return DimensionlessSpectrum(0.0);
+      *rayleigh_length = std::numeric_limits<double>::infinity() * m;
+      *mie_length = std::numeric_limits<double>::infinity() * m;
     } else {
-      return GetTransmittanceSimple(p, r) * GetTransmittanceSimple(r, q);
+      Length rayleigh_length_pr;
+      Length mie_length_pr;
+      GetOpticalLengthSimple(p, r, &rayleigh_length_pr, &mie_length_pr);
+      GetOpticalLengthSimple(r, q, rayleigh_length, mie_length);
+      *rayleigh_length += rayleigh_length_pr;
+      *mie_length += mie_length_pr;
     }
   } else {
-    return GetTransmittanceSimple(p, q);
+    GetOpticalLengthSimple(p, q, rayleigh_length, mie_length);
   }
 }
 
-DimensionlessSpectrum Haber::GetTransmittanceSimple(const Position& p,
-    const Position& q) const {
+void Haber::GetOpticalLengthSimple(const Position& p, const Position& q,
+    Length* rayleigh_length, Length* mie_length) const {
   // We assume here that the segment p,q traverses each layer only once. This is
-  // ensured by GetTransmittance above, which splits the segment in two if
+  // ensured by GetOpticalLength above, which splits the segment in two if
   // necessary.
   int start_layer_index = GetLayerIndex(p);
   int end_layer_index = GetLayerIndex(q);
@@ -435,25 +509,21 @@ DimensionlessSpectrum Haber::GetTransmittanceSimple(const Position& p,
     b = dot(p, q - p) / pq;
     c = dot(p, p);
   }
-  Length rayleigh_length = 0.0 * m;
-  Length mie_length = 0.0 * m;
+  *rayleigh_length = 0.0 * m;
+  *mie_length = 0.0 * m;
   Length distance_to_previous_layer = 0.0 * m;
   for (int i = start_layer_index; i < end_layer_index; ++i) {
     Length r_i = EarthRadius + GetLayerHeight(i + 1);
     Length distance_to_layer = -b + sqrt(b * b - c + r_i * r_i);
     Length layer_length = distance_to_layer - distance_to_previous_layer;
-    rayleigh_length += rayleigh_density_[i] * layer_length;
-    mie_length += mie_density_[i] * layer_length;
+    *rayleigh_length += rayleigh_density_[i] * layer_length;
+    *mie_length += mie_density_[i] * layer_length;
     distance_to_previous_layer = distance_to_layer;
   }
-  rayleigh_length +=
+  *rayleigh_length +=
       rayleigh_density_[end_layer_index] * (pq - distance_to_previous_layer);
-  mie_length +=
+  *mie_length +=
       mie_density_[end_layer_index] * (pq - distance_to_previous_layer);
-
-  DimensionlessSpectrum optical_depth = RayleighScattering() * rayleigh_length +
-      MieExtinction() * mie_length;
-  return exp(-optical_depth);
 }
 
 Haber::Position Haber::GetRayIntersectionWithLastLayer(const Position& p,
@@ -76,29 +76,62 @@ class Haber : public Atmosphere {
   typedef dimensional::Vector3<Length> Position;
   typedef dimensional::Vector3<Number> Direction;
 
-  struct Cell {
-    Position center;
-    Volume volume;
-    Length radial_width;
+  // The cells with the same theta and shell indices form a ring of
+  // kNumPhi / 2 cells (the other half is obtained by symmetry with respect to
+  // the vertical plane containing the Sun). All the cells of a ring have the
+  // same volume, radial width and layer.
+  struct Ring {
+    int theta_index;
     int shell_index;
     int layer_index;
-    PowerSpectrum iso;
-    PowerSpectrum aniso;
-    PowerSpectrum last;
-    PowerSpectrum current;
+    Volume volume;
+    Length radial_width;
+  };
+
+  // The optical lengths and inverse square distances between the first cell of
+  // each active target ring and the cells of each active source ring, for each
+  // azimuth index difference between 0 and kNumPhi / 2 (the other ones are
+  // obtained by symmetry). These values do not depend on the Sun direction,
+  // and are thus computed once and reused for all the scattering orders and
+  // Sun zenith angles. Values are stored in m and 1/m^2, respectively, and
+  // segments intersecting the ground have an infinite optical length.
+  struct CellToCellTable {
+    std::vector<float> rayleigh_length;
+    std::vector<float> mie_length;
+    std::vector<float> inverse_distance_square;
   };
 
   void MaybeInit(Angle sun_zenith) const;
+  void MaybeComputeCellToCellTable() const;
+  // Allocates the cell to cell table, and returns false if it was already.
+  bool AllocateCellToCellTable() const;
+  // Computes the cell to cell table values for the given active target ring.
+  void ComputeCellToCellTable(int active_ring_index) const;
   void ComputeSingleScatter(Angle sun_zenith) const;
   void ComputeMultipleScatter(Angle sun_zenith, bool double_scatter) const;
+  // Computes the light scattered in the cells of the given active target ring,
+  // from all the cells of all the active source rings.
+  void ComputeMultipleScatter(Angle sun_zenith, bool double_scatter,
+      int active_ring_index) const;
   void InterpolateMultipleScatter(bool double_scatter) const;
   void AccumulateMultipleScatter() const;
   void ComputeSkyDome(Angle sun_zenith, ScatteringType scattering_type) const;
 
+  // Returns the index of the cell with the given ring and azimuth indices, for
+  // azimuth indices between 0 and kNumPhi / 2 - 1.
+  static int GetCellIndex(int ring_index, int phi_index) {
+    return ring_index * (kNumPhi / 2) + phi_index;
+  }
+  // Returns the center of the cell with the given ring and azimuth indices, for
+  // azimuth indices between 0 and kNumPhi - 1.
+  Position GetCellCenter(int ring_index, int phi_index) const;
+
   DimensionlessSpectrum GetTransmittance(const Position& p,
       const Position& q) const;
-  DimensionlessSpectrum GetTransmittanceSimple(const Position& p,
-      const Position& q) const;
+  void GetOpticalLength(const Position& p, const Position& q,
+      Length* rayleigh_length, Length* mie_length) const;
+  void GetOpticalLengthSimple(const Position& p, const Position& q,
+      Length* rayleigh_length, Length* mie_length) const;
 
   static Position GetRayIntersectionWithLastLayer(const Position& p,
       Angle view_zenith);
@@ -108,10 +141,27 @@ class Haber : public Atmosphere {
   ScatteringType scattering_type_;
   Number rayleigh_density_[kNumLayers];
   Number mie_density_[kNumLayers];
+
+  // The rings sorted by theta index and then by shell index, the rings with
+  // a given theta index i being in [first_ring_[i], first_ring_[i + 1]).
+  std::vector<Ring> rings_;
+  int first_ring_[kNumTheta + 1];
+  // The indices of the rings whose shell index is a multiple of 4, on which
+  // multiple scattering is computed (and interpolated in between).
+  std::vector<int> active_rings_;
+  // The cells in structure-of-arrays layout, indexed with GetCellIndex.
+  std::vector<Position> center_;
+  mutable std::vector<PowerSpectrum> iso_;
+  mutable std::vector<PowerSpectrum> aniso_;
+  mutable std::vector<PowerSpectrum> last_;
+  mutable std::vector<PowerSpectrum> current_;
+
+  mutable CellToCellTable cell_to_cell_table_;
   mutable Angle current_sun_zenith_;
-  mutable std::vector<Cell> cells_[kNumTheta][kNumPhi / 2];
   mutable dimensional::BinaryFunction<kNumTheta, kNumPhi / 2, RadianceSpectrum>
       sky_dome_;
+
+  friend class TestHaber;
 };
 
 #endif  // ATMOSPHERE_MODEL_HABER_HABER_H_
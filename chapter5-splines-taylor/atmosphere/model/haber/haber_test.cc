@@ -0,0 +1,147 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/model/haber/haber.h"
+
+#include <cmath>
+#include <string>
+
+#include "test/test_case.h"
+
+class TestHaber : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestHaber(const std::string& name, T test)
+      : TestCase("TestHaber " + name, static_cast<Test>(test)) {}
+
+  // Checks that the multiple scattering computed with the float cell to cell
+  // table, for a few active target rings, is the same as with a direct double
+  // precision computation over all the (non symmetric) source cells.
+  void TestMultipleScatter() {
+    Haber haber(Haber::ALL_ORDERS);
+    haber.AllocateCellToCellTable();
+    const int num_active_rings = haber.active_rings_.size();
+    const int targets[3] = {0, num_active_rings / 2, num_active_rings - 1};
+    for (int t : targets) {
+      haber.ComputeCellToCellTable(t);
+    }
+    for (double sun_zenith_deg : {30.0, 70.0}) {
+      const Angle sun_zenith = sun_zenith_deg * deg;
+      haber.ComputeSingleScatter(sun_zenith);
+      // Arbitrary values for the previous scattering order.
+      haber.last_ = haber.aniso_;
+      for (bool double_scatter : {true, false}) {
+        for (int t : targets) {
+          haber.ComputeMultipleScatter(sun_zenith, double_scatter, t);
+          for (int j : {0, 17, Haber::kNumPhi / 2 - 1}) {
+            PowerSpectrum expected =
+                GetMultipleScatter(haber, sun_zenith, double_scatter, t, j);
+            const PowerSpectrum& actual =
+                haber.current_[Haber::GetCellIndex(haber.active_rings_[t], j)];
+            for (unsigned int i = 0; i < expected.size(); ++i) {
+              ExpectTrue(expected[i].to(watt / nm) > 0.0);
+              ExpectNear(expected[i].to(watt / nm), actual[i].to(watt / nm),
+                  1e-5 * expected[i].to(watt / nm));
+            }
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  // Returns the center of the cell with the given ring and azimuth indices, for
+  // azimuth indices between 0 and kNumPhi - 1.
+  static Haber::Position GetCellCenter(const Haber::Ring& ring, int phi_index) {
+    Length r = Haber::kMinShellRadius * (pow(Haber::kShellRatio,
+        ring.shell_index) + pow(Haber::kShellRatio, ring.shell_index + 1)) *
+            0.5;
+    Angle theta = (ring.theta_index + 0.5) * Haber::kDeltaPhi;
+    Angle phi = (phi_index + 0.5) * Haber::kDeltaPhi;
+    return Haber::Position(r * cos(phi) * sin(theta),
+        r * sin(phi) * sin(theta), r * cos(theta) + EarthRadius);
+  }
+
+  // Returns the power scattered in the given cell of the given active target
+  // ring, from all the cells of all the active source rings, computed without
+  // the cell to cell table nor the azimuthal symmetry.
+  static PowerSpectrum GetMultipleScatter(const Haber& haber,
+      Angle sun_zenith, bool double_scatter, int t, int j_tgt) {
+    const Haber::Direction sun_dir =
+        Haber::Direction(sin(sun_zenith), 0.0, cos(sun_zenith));
+    const InverseSolidAngle iso_phase = 1.0 / (4.0 * PI * sr);
+    const Haber::Ring& target_ring = haber.rings_[haber.active_rings_[t]];
+    const Haber::Position target = GetCellCenter(target_ring, j_tgt);
+    IrradianceSpectrum irradiance =
+        IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm);
+    for (unsigned int s = 0; s < haber.active_rings_.size(); ++s) {
+      const int src_ring_index = haber.active_rings_[s];
+      const Haber::Ring& src_ring = haber.rings_[src_ring_index];
+      auto inverse_area = src_ring.radial_width / src_ring.volume;
+      for (int j_src = 0; j_src < Haber::kNumPhi; ++j_src) {
+        if (static_cast<int>(s) == t && j_src == j_tgt) {
+          continue;
+        }
+        const Haber::Position source = GetCellCenter(src_ring, j_src);
+        Length rayleigh_length;
+        Length mie_length;
+        haber.GetOpticalLength(source, target, &rayleigh_length, &mie_length);
+        if (std::isinf(rayleigh_length.to(m))) {
+          continue;
+        }
+        DimensionlessSpectrum transmittance = exp(-(RayleighScattering() *
+            rayleigh_length + MieExtinction() * mie_length));
+        SolidAngle solid_angle =
+            src_ring.volume / (src_ring.radial_width * 4.0 * PI) * sr /
+                dot(source - target, source - target);
+        const int j = j_src < Haber::kNumPhi / 2 ?
+            j_src : Haber::kNumPhi - 1 - j_src;
+        const int src = Haber::GetCellIndex(src_ring_index, j);
+        RadianceSpectrum radiance;
+        if (double_scatter) {
+          Haber::Direction dir = (source - target) / length(source - target);
+          radiance = (haber.iso_[src] * iso_phase + haber.aniso_[src] *
+              MiePhaseFunction(dot(dir, sun_dir))) * inverse_area;
+        } else {
+          radiance = haber.last_[src] * iso_phase * inverse_area;
+        }
+        irradiance += transmittance * radiance * solid_angle;
+      }
+    }
+    const int layer = target_ring.layer_index;
+    return irradiance * (RayleighScattering() * haber.rayleigh_density_[layer] +
+        MieScattering() * haber.mie_density_[layer]) * target_ring.volume;
+  }
+};
+
+namespace {
+
+TestHaber multiplescatter("multiplescatter", &TestHaber::TestMultipleScatter);
+
+}  // anonymous namespace
@@ -30,6 +30,12 @@
 #include "atmosphere/model/hosek/hosek.h"
 
 #include <algorithm>
+#include <cmath>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
 
 #include "atmosphere/model/hosek/ArHosekSkyModel.h"
 
@@ -52,12 +58,72 @@ const double originalSolarRadianceTable[] = {
   19870.8
 };
 
+// A thread-safe cache of immutable values, which keeps at most 'max_size'
+// values (the most recently inserted ones). The values are created outside
+// the lock, and a value can thus be created twice if two threads need it at the
+// same time (only one is kept).
+template<typename Key, typename Value>
+class Cache {
+ public:
+  explicit Cache(unsigned int max_size) : max_size_(max_size) {}
+
+  template<typename Create>
+  std::shared_ptr<const Value> Get(const Key& key, Create create) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = values_.find(key);
+      if (it != values_.end()) {
+        return it->second;
+      }
+    }
+    std::shared_ptr<const Value> value = create();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto inserted = values_.insert(std::make_pair(key, value));
+    if (inserted.second) {
+      keys_.push_back(key);
+      if (keys_.size() > max_size_) {
+        values_.erase(keys_.front());
+        keys_.pop_front();
+      }
+    }
+    return inserted.first->second;
+  }
+
+ private:
+  const unsigned int max_size_;
+  std::mutex mutex_;
+  std::map<Key, std::shared_ptr<const Value>> values_;
+  std::deque<Key> keys_;
+};
+
+// The Hosek model states, for a given sun zenith angle (in radians), turbidity
+// and ground albedo. Each state contains the model parameters for 11
+// wavelengths, which take about 1 kB.
+typedef std::tuple<double, double, double> StateKey;
+Cache<StateKey, ArHosekSkyModelState> state_cache(4096);
+
+std::shared_ptr<const ArHosekSkyModelState> GetState(Angle sun_zenith,
+    double turbidity, double albedo) {
+  return state_cache.Get(StateKey(sun_zenith.to(rad), turbidity, albedo),
+      [&]() {
+        return std::shared_ptr<const ArHosekSkyModelState>(
+            arhosekskymodelstate_alloc_init((pi / 2.0 - sun_zenith).to(rad),
+                turbidity, albedo),
+            [](const ArHosekSkyModelState* state) {
+              arhosekskymodelstate_free(
+                  const_cast<ArHosekSkyModelState*>(state));
+            });
+      });
+}
+
+}  // anonymous namespace
+
 // The Hosek sky radiance was computed uding 'originalSolarRadianceTable' as
 // the solar radiance, but we want the result for SolarSpectrum(), used in all
 // other models. Thus we correct the result for each wavelength by the ratio
 // between the two spectra at this wavelength (including also the Sun solid
 // angle to convert radiance to irradiance values).
-double SolarSpectrumCorrectionFactor(Wavelength lambda) {
+double Hosek::SolarSpectrumCorrectionFactor(Wavelength lambda) {
   double x = (lambda.to(nm) - 320.0) / 40.0;
   if (x < 0.0 || x > 10.0) {
     return 1.0;
@@ -71,20 +137,77 @@ double SolarSpectrumCorrectionFactor(Wavelength lambda) {
   return (new_irradiance / (old_radiance * kSunSolidAngle))();
 }
 
-}  // anonymous namespace
+// The parameters of the Hosek model for each wavelength of a RadianceSpectrum,
+// for a given sun zenith angle and turbidity. The radiance at each wavelength
+// is a linear interpolation of the Hosek radiance formula at the 2 closest
+// Hosek wavelengths (with the configuration of the state for the ground albedo
+// at this wavelength). The 9 configuration parameters of these 2 * 40 terms
+// are stored in separate arrays, so that GetSkyRadiance can evaluate the Hosek
+// formula for all of them in a single loop without branches.
+struct Hosek::SpectralState {
+  static constexpr int kNumTerms = 2 * RadianceSpectrum::SIZE;
 
-Hosek::Hosek(double turbidity) : turbidity_(turbidity) {
-  for (unsigned int i = 0; i < DimensionlessSpectrum::SIZE; ++i) {
-    sky_model_state_[i] = NULL;
-  }
-}
+  std::shared_ptr<const ArHosekSkyModelState>
+      states[RadianceSpectrum::SIZE];
+  double config[9][kNumTerms];
+  // The interpolation weight, radiance scale and emission correction factor
+  // of each term, kept separate to multiply them in the same order as in
+  // arhosekskymodel_radiance(). The weight is 0 for the terms that this
+  // function does not compute.
+  double weight[kNumTerms];
+  double radiance_scale[kNumTerms];
+  double emission_correction[kNumTerms];
+  double solar_spectrum_correction[RadianceSpectrum::SIZE];
+};
 
-Hosek::~Hosek() {
-  for (unsigned int i = 0; i < DimensionlessSpectrum::SIZE; ++i) {
-    if (sky_model_state_[i] != NULL) {
-      arhosekskymodelstate_free(sky_model_state_[i]);
-    }
+constexpr int Hosek::SpectralState::kNumTerms;
+
+Hosek::Hosek(double turbidity) : turbidity_(turbidity) {}
+
+std::shared_ptr<const Hosek::SpectralState> Hosek::GetSpectralState(
+    Angle sun_zenith) const {
+  typedef std::tuple<double, double> Key;
+  static Cache<Key, SpectralState> cache(256);
+  // Most calls use the same sun zenith angle as the previous one in the same
+  // thread, and can thus avoid locking the cache.
+  thread_local Key last_key;
+  thread_local std::shared_ptr<const SpectralState> last_state;
+  Key key(sun_zenith.to(rad), turbidity_);
+  if (last_state && key == last_key) {
+    return last_state;
   }
+  last_state = cache.Get(key, [&]() {
+    std::shared_ptr<SpectralState> state(new SpectralState());
+    const DimensionlessSpectrum& albedo = GroundAlbedo();
+    for (unsigned int i = 0; i < albedo.size(); ++i) {
+      state->states[i] = GetState(sun_zenith, turbidity_, albedo[i]());
+      const ArHosekSkyModelState& hosek_state = *state->states[i];
+      // Same interpolation as in arhosekskymodel_radiance().
+      const double lambda = albedo.GetSample(i).to(nm);
+      state->solar_spectrum_correction[i] =
+          SolarSpectrumCorrectionFactor(lambda * nm);
+      const int low_wl = (lambda - 320.0) / 40.0;
+      const double interp = fmod((lambda - 320.0) / 40.0, 1.0);
+      for (int k = 0; k < 2; ++k) {
+        const int wl = low_wl + k;
+        const int term = 2 * i + k;
+        const bool valid = low_wl >= 0 && low_wl < 11 && wl < 11 &&
+            (k == 0 || interp >= 1e-6);
+        for (int j = 0; j < 9; ++j) {
+          state->config[j][term] = valid ? hosek_state.configs[wl][j] : 0.0;
+        }
+        // 1 - interp is not computed if interp < 1e-6, but 1 * x == x.
+        state->weight[term] = !valid ? 0.0 : k == 1 ? interp :
+            interp < 1e-6 ? 1.0 : 1.0 - interp;
+        state->radiance_scale[term] = valid ? hosek_state.radiances[wl] : 0.0;
+        state->emission_correction[term] =
+            valid ? hosek_state.emission_correction_factor_sky[wl] : 0.0;
+      }
+    }
+    return state;
+  });
+  last_key = key;
+  return last_state;
 }
 
 IrradianceSpectrum Hosek::GetSunIrradiance(Length altitude,
@@ -92,7 +215,7 @@ IrradianceSpectrum Hosek::GetSunIrradiance(Length altitude,
 #ifdef A_USE_UNIFORM_IRRADIANCE_METHOD
     return IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm);
 #else
-  MaybeInitSkyModelState(sun_zenith);
+  std::shared_ptr<const SpectralState> state = GetSpectralState(sun_zenith);
   IrradianceSpectrum result;
   for (unsigned int i = 0; i < result.size(); ++i) {
     Wavelength lambda = result.GetSample(i);
@@ -102,10 +225,12 @@ IrradianceSpectrum Hosek::GetSunIrradiance(Length altitude,
       result[i] = 0.0 * watt_per_square_meter_per_nm;
       continue;
     }
+    ArHosekSkyModelState* hosek_state =
+        const_cast<ArHosekSkyModelState*>(state->states[i].get());
     double sun_and_sky_radiance = arhosekskymodel_solar_radiance(
-        sky_model_state_[i], sun_zenith.to(rad), 0.0, lambda.to(nm));
+        hosek_state, sun_zenith.to(rad), 0.0, lambda.to(nm));
     double sky_radiance = arhosekskymodel_radiance(
-        sky_model_state_[i], sun_zenith.to(rad), 0.0, lambda.to(nm));
+        hosek_state, sun_zenith.to(rad), 0.0, lambda.to(nm));
     double sun_radiance = (sun_and_sky_radiance - sky_radiance) *
         SolarSpectrumCorrectionFactor(lambda);
     result[i] =
@@ -117,32 +242,47 @@ IrradianceSpectrum Hosek::GetSunIrradiance(Length altitude,
 
 RadianceSpectrum Hosek::GetSkyRadiance(Length altitude, Angle sun_zenith,
     Angle view_zenith, Angle view_sun_azimuth) const {
-  MaybeInitSkyModelState(sun_zenith);
-  double gamma =
+  std::shared_ptr<const SpectralState> state = GetSpectralState(sun_zenith);
+  const double theta = view_zenith.to(rad);
+  const double gamma =
       GetViewSunAngle(sun_zenith, view_zenith, view_sun_azimuth).to(rad);
+  // The terms of ArHosekSkyModel_GetRadianceInternal() which do not depend on
+  // the wavelength. The other ones are computed exactly as in this function,
+  // so that the results are identical to those of arhosekskymodel_radiance().
+  const double cos_theta = cos(theta);
+  const double cos_gamma = cos(gamma);
+  const double ray_m = cos_gamma * cos_gamma;
+  const double zenith = sqrt(cos_theta);
+
+  constexpr int kNumTerms = SpectralState::kNumTerms;
+  double radiance[kNumTerms];
+  const double (&c)[9][kNumTerms] = state->config;
+  for (int k = 0; k < kNumTerms; ++k) {
+    const double exp_m = exp(c[4][k] * gamma);
+    const double mie_m = (1.0 + cos_gamma * cos_gamma) / pow(
+        (1.0 + c[8][k] * c[8][k] - 2.0 * c[8][k] * cos_gamma), 1.5);
+    radiance[k] = (1.0 + c[0][k] * exp(c[1][k] / (cos_theta + 0.01))) *
+        (c[2][k] + c[3][k] * exp_m + c[5][k] * ray_m + c[6][k] * mie_m +
+         c[7][k] * zenith);
+  }
+
+  // Terms with a 0 weight are not computed in arhosekskymodel_radiance(), and
+  // must thus be ignored even if their radiance is not finite.
   RadianceSpectrum result;
   for (unsigned int i = 0; i < result.size(); ++i) {
-    Wavelength lambda = result.GetSample(i);
-    result[i] = arhosekskymodel_radiance(sky_model_state_[i],
-        view_zenith.to(rad), gamma, lambda.to(nm)) *
-        SolarSpectrumCorrectionFactor(lambda) *
+    const int low = 2 * i;
+    const int high = 2 * i + 1;
+    double value = 0.0;
+    if (state->weight[low] != 0.0) {
+      value = state->weight[low] * (radiance[low] *
+          state->radiance_scale[low] * state->emission_correction[low]);
+      if (state->weight[high] != 0.0) {
+        value += state->weight[high] * radiance[high] *
+            state->radiance_scale[high] * state->emission_correction[high];
+      }
+    }
+    result[i] = value * state->solar_spectrum_correction[i] *
         watt_per_square_meter_per_sr_per_nm;
   }
   return result;
 }
-
-void Hosek::MaybeInitSkyModelState(Angle sun_zenith) const {
-  if (sky_model_state_[0] != NULL && sun_zenith == current_sun_zenith_) {
-    return;
-  }
-  if (sky_model_state_[0] != NULL) {
-    for (unsigned int i = 0; i < DimensionlessSpectrum::SIZE; ++i) {
-      arhosekskymodelstate_free(sky_model_state_[i]);
-    }
-  }
-  for (unsigned int i = 0; i < DimensionlessSpectrum::SIZE; ++i) {
-    sky_model_state_[i] = arhosekskymodelstate_alloc_init(
-        (pi / 2.0 - sun_zenith).to(rad), turbidity_, GroundAlbedo()[i]());
-  }
-  current_sun_zenith_ = sun_zenith;
-}
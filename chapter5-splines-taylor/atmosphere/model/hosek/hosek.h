@@ -30,16 +30,17 @@
 #ifndef ATMOSPHERE_MODEL_HOSEK_HOSEK_H_
 #define ATMOSPHERE_MODEL_HOSEK_HOSEK_H_
 
+#include <memory>
+
 #include "atmosphere/atmosphere.h"
 #include "math/angle.h"
 #include "physics/units.h"
 
-struct ArHosekSkyModelState;
-
+// The Hosek-Wilkie model. Its states for each sun zenith angle are stored in a
+// cache shared by all the instances, so that this model is thread-safe.
 class Hosek : public Atmosphere {
  public:
   explicit Hosek(double turbidity);
-  virtual ~Hosek();
 
   int GetOriginalNumberOfWavelengths() const override { return 11; }
 
@@ -49,12 +50,17 @@ class Hosek : public Atmosphere {
   RadianceSpectrum GetSkyRadiance(Length altitude, Angle sun_zenith,
       Angle view_zenith, Angle view_sun_azimuth) const override;
 
+  // The factor by which the original Hosek radiance is multiplied at the given
+  // wavelength, to get the radiance for SolarSpectrum().
+  static double SolarSpectrumCorrectionFactor(Wavelength lambda);
+
  private:
-  void MaybeInitSkyModelState(Angle sun_zenith) const;
+  struct SpectralState;
+
+  std::shared_ptr<const SpectralState> GetSpectralState(
+      Angle sun_zenith) const;
 
   double turbidity_;
-  mutable Angle current_sun_zenith_;
-  mutable ArHosekSkyModelState* sky_model_state_[DimensionlessSpectrum::SIZE];
 };
 
 #endif  // ATMOSPHERE_MODEL_HOSEK_HOSEK_H_
@@ -0,0 +1,121 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/model/hosek/hosek.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "atmosphere/model/hosek/ArHosekSkyModel.h"
+#include "test/test_case.h"
+
+class TestHosek : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestHosek(const std::string& name, T test)
+      : TestCase("TestHosek " + name, static_cast<Test>(test)) {}
+
+  // Checks that GetSkyRadiance is exactly equal to the original Hosek model
+  // radiance times the solar spectrum correction factor.
+  void TestSkyRadiance() {
+    const double turbidity = 2.5;
+    Hosek hosek(turbidity);
+    for (double sun_zenith_deg : {10.0, 45.0, 80.0}) {
+      const Angle sun_zenith = sun_zenith_deg * deg;
+      std::vector<ArHosekSkyModelState*> states;
+      for (unsigned int i = 0; i < GroundAlbedo().size(); ++i) {
+        states.push_back(arhosekskymodelstate_alloc_init(
+            (pi / 2.0 - sun_zenith).to(rad), turbidity, GroundAlbedo()[i]()));
+      }
+      for (double view_zenith_deg : {0.0, 30.0, 60.0, 89.0}) {
+        for (double view_azimuth_deg : {0.0, 90.0, 180.0}) {
+          const Angle view_zenith = view_zenith_deg * deg;
+          const Angle view_sun_azimuth = view_azimuth_deg * deg;
+          RadianceSpectrum radiance = hosek.GetSkyRadiance(
+              0.0 * m, sun_zenith, view_zenith, view_sun_azimuth);
+          // Same formula as in Atmosphere::GetViewSunAngle.
+          double gamma = acos(cos(view_sun_azimuth) * sin(view_zenith) *
+              sin(sun_zenith) + cos(view_zenith) * cos(sun_zenith)).to(rad);
+          for (unsigned int i = 0; i < radiance.size(); ++i) {
+            const Wavelength lambda = radiance.GetSample(i);
+            double expected = arhosekskymodel_radiance(states[i],
+                view_zenith.to(rad), gamma, lambda.to(nm)) *
+                Hosek::SolarSpectrumCorrectionFactor(lambda);
+            ExpectEquals(expected,
+                radiance[i].to(watt_per_square_meter_per_sr_per_nm));
+          }
+        }
+      }
+      for (ArHosekSkyModelState* state : states) {
+        arhosekskymodelstate_free(state);
+      }
+    }
+  }
+
+  void TestThreadSafety() {
+    Hosek hosek(3.0);
+    const Angle sun_zenith[4] = {20.0 * deg, 40.0 * deg, 60.0 * deg,
+        70.0 * deg};
+    RadianceSpectrum expected[4];
+    for (int i = 0; i < 4; ++i) {
+      expected[i] = Hosek(3.0).GetSkyRadiance(
+          0.0 * m, sun_zenith[i], 30.0 * deg, 45.0 * deg);
+    }
+    int num_errors[4] = {0, 0, 0, 0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.push_back(std::thread([&, t]() {
+        for (int k = 0; k < 100; ++k) {
+          int i = (t + k) % 4;
+          RadianceSpectrum radiance = hosek.GetSkyRadiance(
+              0.0 * m, sun_zenith[i], 30.0 * deg, 45.0 * deg);
+          for (unsigned int j = 0; j < radiance.size(); ++j) {
+            num_errors[t] += radiance[j] == expected[i][j] ? 0 : 1;
+          }
+        }
+      }));
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    for (int t = 0; t < 4; ++t) {
+      ExpectEquals(0, num_errors[t]);
+    }
+  }
+};
+
+namespace {
+
+TestHosek skyradiance("skyradiance", &TestHosek::TestSkyRadiance);
+TestHosek threadsafety("threadsafety", &TestHosek::TestThreadSafety);
+
+}  // anonymous namespace
@@ -30,9 +30,12 @@
 #include "atmosphere/model/nishita/nishita96.h"
 
 #include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <sstream>
 #include <string>
 
+#include "util/profiling.h"
 #include "util/progress_bar.h"
 
 namespace {
@@ -44,53 +47,26 @@ constexpr Length kHorizonDist =
 
 }  // anonymous namespace
 
-Nishita96::Nishita96(ScatteringType scattering_type)
-    : Nishita93(), scattering_type_(scattering_type) {
+Nishita96::Nishita96(ScatteringType scattering_type,
+    int max_cached_sun_zeniths, bool use_float_tables)
+    : Nishita93(), scattering_type_(scattering_type),
+      max_cached_sun_zeniths_(std::max(1, max_cached_sun_zeniths)),
+      use_float_tables_(use_float_tables) {
 }
 
 RadianceSpectrum Nishita96::GetSkyRadiance(Length altitude, Angle sun_zenith,
     Angle view_zenith, Angle view_sun_azimuth) const {
-  MaybePrecomputeSingleScatteringTables(sun_zenith);
+  std::shared_ptr<const SingleScatteringTableSet> tables =
+      GetSingleScatteringTables(sun_zenith);
+  const Direction* sample_directions = tables->sample_directions;
   Position p(0.0 * m, 0.0 * m, EarthRadius + altitude);
   Direction view_dir(cos(view_sun_azimuth) * sin(view_zenith),
       sin(view_sun_azimuth) * sin(view_zenith), cos(view_zenith));
 
-  // Integral of the Rayleigh and Mie phase functions over the solid angle
-  // associated with each sampling direction (the solid angle for a sampling
-  // direction d_i is formed by the unit vectors v for which v is nearer to d_i
-  // than to any other sampling direction d_j, j!=i).
   Number rayleigh_phase_integral[8];
   Number mie_phase_integral[8];
-  for (int i = 0; i < 8; ++i) {
-    rayleigh_phase_integral[i] = 0.0;
-    mie_phase_integral[i] = 0.0;
-  }
-
-  constexpr int kNumOmega = 32;
-  constexpr Angle dtheta = pi / kNumOmega;
-  constexpr Angle dphi = pi / kNumOmega;
-  for (int i = 0; i < kNumOmega; ++i) {
-    Angle theta = (i + 0.5) * dtheta;
-    Number cos_theta = cos(theta);
-    for (int j = 0; j < 2 * kNumOmega; ++j) {
-      Angle phi = (j + 0.5) * dphi;
-      SolidAngle dw = sin(theta) * dtheta.to(rad) * dphi.to(rad) * sr;
-      Direction w(cos(phi) * sin(theta), sin(phi) * sin(theta), cos_theta);
-      Number drayleigh = RayleighPhaseFunction(dot(view_dir, w)) * dw;
-      Number dmie = MiePhaseFunction(dot(view_dir, w)) * dw;
-      int nearest_index = 0;
-      Number max_dot_product = dot(w, sample_directions_[0]);
-      for (int k = 1; k < 8; ++k) {
-        Number dot_product = dot(w, sample_directions_[i]);
-        if (dot_product > max_dot_product) {
-          nearest_index = k;
-          max_dot_product = dot_product;
-        }
-      }
-      rayleigh_phase_integral[nearest_index] += drayleigh;
-      mie_phase_integral[nearest_index] += dmie;
-    }
-  }
+  GetPhaseIntegrals(sample_directions, view_dir, rayleigh_phase_integral,
+      mie_phase_integral);
 
   Length r = EarthRadius + altitude;
   Number mu_s = cos(sun_zenith);
@@ -153,7 +129,7 @@ RadianceSpectrum Nishita96::GetSkyRadiance(Length altitude, Angle sun_zenith,
       WavelengthFunction<-1, 0, -1, 0, 0> double_scattering(0.0 / m / sr);
       for (int j = 0; j < 8; ++j) {
         double_scattering +=
-            sample_single_scattering_[j].GetSingleScattering(p_i) * (
+            tables->sample_single_scattering[j].GetSingleScattering(p_i) * (
             RayleighScattering() * rayleigh_density * rayleigh_phase_integral[j]
             + MieScattering() * mie_density * mie_phase_integral[j]);
       }
@@ -173,19 +149,110 @@ RadianceSpectrum Nishita96::GetSkyRadiance(Length altitude, Angle sun_zenith,
       double_scattering_integral) * SolarSpectrum();
 }
 
+void Nishita96::GetPhaseIntegrals(const Direction sample_directions[8],
+    const Direction& view_dir, Number rayleigh_phase_integral[8],
+    Number mie_phase_integral[8]) {
+  for (int i = 0; i < 8; ++i) {
+    rayleigh_phase_integral[i] = 0.0;
+    mie_phase_integral[i] = 0.0;
+  }
+
+  constexpr int kNumOmega = 32;
+  constexpr Angle dtheta = pi / kNumOmega;
+  constexpr Angle dphi = pi / kNumOmega;
+  for (int i = 0; i < kNumOmega; ++i) {
+    Angle theta = (i + 0.5) * dtheta;
+    Number cos_theta = cos(theta);
+    for (int j = 0; j < 2 * kNumOmega; ++j) {
+      Angle phi = (j + 0.5) * dphi;
+      SolidAngle dw = sin(theta) * dtheta.to(rad) * dphi.to(rad) * sr;
+      Direction w(cos(phi) * sin(theta), sin(phi) * sin(theta), cos_theta);
+      Number drayleigh = RayleighPhaseFunction(dot(view_dir, w)) * dw;
+      Number dmie = MiePhaseFunction(dot(view_dir, w)) * dw;
+      int nearest_index = 0;
+      Number max_dot_product = dot(w, sample_directions[0]);
+      for (int k = 1; k < 8; ++k) {
+        Number dot_product = dot(w, sample_directions[k]);
+        if (dot_product > max_dot_product) {
+          nearest_index = k;
+          max_dot_product = dot_product;
+        }
+      }
+      rayleigh_phase_integral[nearest_index] += drayleigh;
+      mie_phase_integral[nearest_index] += dmie;
+    }
+  }
+}
+
 void Nishita96::SingleScatteringTable::Init(
     Angle sun_zenith, Angle view_zenith) {
   view_zenith_ = view_zenith;
   cos_view_zenith_ = cos(view_zenith);
   sin_view_zenith_ = sin(view_zenith);
-  value_.Set(WavelengthFunction<0, 0, -1, 0, 0>(0.0 / sr));
+  value_.reset(new SingleScatteringFunction(
+      WavelengthFunction<0, 0, -1, 0, 0>(0.0 / sr)));
+  float_value_.clear();
+}
+
+void Nishita96::SingleScatteringTable::ConvertToFloat() {
+  float_value_.resize(kNumSteps * kNumSteps * kNumSteps * kNumWavelengths);
+  for (int k = 0; k < kNumSteps; ++k) {
+    for (int j = 0; j < kNumSteps; ++j) {
+      for (int i = 0; i < kNumSteps; ++i) {
+        const WavelengthFunction<0, 0, -1, 0, 0>& value = value_->Get(i, j, k);
+        float* output = &float_value_[GetFloatValueIndex(i, j, k)];
+        for (int l = 0; l < kNumWavelengths; ++l) {
+          output[l] = value[l].to(1.0 / sr);
+        }
+      }
+    }
+  }
+  value_.reset();
 }
 
 WavelengthFunction<0, 0, -1, 0, 0>
 Nishita96::SingleScatteringTable::GetSingleScattering(const Position& p) const {
   vec3 u;
   GetU(p, &u);
-  return value_(u.x(), u.y(), u.z());
+  if (value_) {
+    return (*value_)(u.x(), u.y(), u.z());
+  }
+  // Same trilinear interpolation as in dimensional::TernaryFunction.
+  double x = u.x() * kNumSteps - 0.5;
+  double y = u.y() * kNumSteps - 0.5;
+  double z = u.z() * kNumSteps - 0.5;
+  int i = std::floor(x);
+  int j = std::floor(y);
+  int k = std::floor(z);
+  x -= i;
+  y -= j;
+  z -= k;
+  int i0 = std::max(0, std::min(kNumSteps - 1, i));
+  int i1 = std::max(0, std::min(kNumSteps - 1, i + 1));
+  int j0 = std::max(0, std::min(kNumSteps - 1, j));
+  int j1 = std::max(0, std::min(kNumSteps - 1, j + 1));
+  int k0 = std::max(0, std::min(kNumSteps - 1, k));
+  int k1 = std::max(0, std::min(kNumSteps - 1, k + 1));
+  const float* v000 = &float_value_[GetFloatValueIndex(i0, j0, k0)];
+  const float* v100 = &float_value_[GetFloatValueIndex(i1, j0, k0)];
+  const float* v010 = &float_value_[GetFloatValueIndex(i0, j1, k0)];
+  const float* v110 = &float_value_[GetFloatValueIndex(i1, j1, k0)];
+  const float* v001 = &float_value_[GetFloatValueIndex(i0, j0, k1)];
+  const float* v101 = &float_value_[GetFloatValueIndex(i1, j0, k1)];
+  const float* v011 = &float_value_[GetFloatValueIndex(i0, j1, k1)];
+  const float* v111 = &float_value_[GetFloatValueIndex(i1, j1, k1)];
+  WavelengthFunction<0, 0, -1, 0, 0> result;
+  for (int l = 0; l < kNumWavelengths; ++l) {
+    result[l] = (v000[l] * ((1.0 - x) * (1.0 - y) * (1.0 - z)) +
+        v100[l] * (x * (1.0 - y) * (1.0 - z)) +
+        v010[l] * ((1.0 - x) * y * (1.0 - z)) +
+        v110[l] * (x * y * (1.0 - z)) +
+        v001[l] * ((1.0 - x) * (1.0 - y) * z) +
+        v101[l] * (x * (1.0 - y) * z) +
+        v011[l] * ((1.0 - x) * y * z) +
+        v111[l] * (x * y * z)) / sr;
+  }
+  return result;
 }
 
 void Nishita96::SingleScatteringTable::GetPosition(const vec3& u,
@@ -225,11 +292,49 @@ void Nishita96::SingleScatteringTable::GetU(const Position& p, vec3* u) const {
   u->z = 0.5 / kNumSteps + (kNumSteps - 1.0) / kNumSteps * u->z;
 }
 
-void Nishita96::MaybePrecomputeSingleScatteringTables(Angle sun_zenith) const {
-  if (current_sun_zenith_ == sun_zenith) {
-    return;
+std::shared_ptr<const Nishita96::SingleScatteringTableSet>
+Nishita96::GetSingleScatteringTables(Angle sun_zenith) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    for (auto it = table_sets_.begin(); it != table_sets_.end(); ++it) {
+      if (it->first == sun_zenith) {
+        table_sets_.splice(table_sets_.begin(), table_sets_, it);
+        return it->second;
+      }
+    }
+    // If another thread is computing these tables, wait for it and look again
+    // in the cache (the tables might already be evicted when we get there).
+    if (std::find(pending_sun_zeniths_.begin(), pending_sun_zeniths_.end(),
+        sun_zenith) == pending_sun_zeniths_.end()) {
+      break;
+    }
+    table_set_added_.wait(lock);
   }
-  current_sun_zenith_ = sun_zenith;
+  pending_sun_zeniths_.push_back(sun_zenith);
+  lock.unlock();
+
+  std::shared_ptr<const SingleScatteringTableSet> table_set =
+      LoadOrComputeSingleScatteringTables(sun_zenith);
+
+  lock.lock();
+  pending_sun_zeniths_.erase(std::find(pending_sun_zeniths_.begin(),
+      pending_sun_zeniths_.end(), sun_zenith));
+  table_sets_.emplace_front(sun_zenith, table_set);
+  // Callers still using an evicted table set keep it alive until they are done.
+  while (table_sets_.size() > max_cached_sun_zeniths_) {
+    table_sets_.pop_back();
+  }
+  table_set_added_.notify_all();
+  return table_set;
+}
+
+std::shared_ptr<Nishita96::SingleScatteringTableSet>
+Nishita96::LoadOrComputeSingleScatteringTables(Angle sun_zenith) const {
+  PROFILE_SCOPE("Nishita96 single scattering tables");
+  std::shared_ptr<SingleScatteringTableSet> output =
+      std::make_shared<SingleScatteringTableSet>();
+  std::string filenames[8];
+  std::vector<int> missing_tables;
   for (int i = 0; i < 8; ++i) {
     Angle view_zenith;
     switch (i) {
@@ -258,41 +363,58 @@ void Nishita96::MaybePrecomputeSingleScatteringTables(Angle sun_zenith) const {
         view_zenith = sun_zenith + pi / 2.0;
         break;
     }
-    sample_directions_[i] = Direction(sin(view_zenith), 0.0, cos(view_zenith));
-    sample_single_scattering_[i].Init(sun_zenith, view_zenith);
+    output->sample_directions[i] =
+        Direction(sin(view_zenith), 0.0, cos(view_zenith));
+    output->sample_single_scattering[i].Init(sun_zenith, view_zenith);
 
     std::stringstream filename;
     filename << "output/cache/nishita/single_scatter_" << sun_zenith.to(deg)
         << "_" << i << ".dat";
+    filenames[i] = filename.str();
     std::ifstream f;
-    f.open(filename.str());
+    f.open(filenames[i]);
     if (f.good()) {
       f.close();
-      sample_single_scattering_[i].value_.Load(filename.str());
+      output->sample_single_scattering[i].value_->Load(filenames[i]);
     } else {
-      PreComputeSingleScatteringTable(
-          sun_zenith, view_zenith, &sample_single_scattering_[i]);
-      sample_single_scattering_[i].value_.Save(filename.str());
+      missing_tables.push_back(i);
+    }
+  }
+  if (!missing_tables.empty()) {
+    PreComputeSingleScatteringTables(sun_zenith, missing_tables, output.get());
+    for (int i : missing_tables) {
+      output->sample_single_scattering[i].value_->Save(filenames[i]);
     }
   }
+  if (use_float_tables_) {
+    for (int i = 0; i < 8; ++i) {
+      output->sample_single_scattering[i].ConvertToFloat();
+    }
+  }
+  return output;
 }
 
-void Nishita96::PreComputeSingleScatteringTable(Angle sun_zenith,
-    Angle view_zenith, SingleScatteringTable* output) const {
+void Nishita96::PreComputeSingleScatteringTables(Angle sun_zenith,
+    const std::vector<int>& table_indices,
+    SingleScatteringTableSet* output) const {
   Direction sun_dir(sin(sun_zenith), 0.0, cos(sun_zenith));
-  ProgressBar progress_bar(kNumSteps * kNumSteps);
-  RunJobs([&](int i) {
-    for (int j = 0; j < kNumSteps; ++j) {
-      Position p0;
-      Position p1;
-      output->GetPosition(vec3(i, j, 0) / Number(kNumSteps - 1.0), &p0);
-      output->GetPosition(vec3(i, j, 1) / Number(kNumSteps - 1.0), &p1);
-      Length step = length(p1 - p0);
-      Direction d = (p1 - p0) / step;
-      PreComputeSingleScattering(p0, d, step, sun_dir, i, j, &(output->value_));
-      progress_bar.Increment(1);
-    }
-  }, kNumSteps);
+  const unsigned int num_jobs =
+      table_indices.size() * kNumSteps * kNumSteps;
+  ProgressBar progress_bar(num_jobs);
+  RunJobs([&](unsigned int job) {
+    SingleScatteringTable* table = &output->sample_single_scattering[
+        table_indices[job / (kNumSteps * kNumSteps)]];
+    int i = job % kNumSteps;
+    int j = (job / kNumSteps) % kNumSteps;
+    Position p0;
+    Position p1;
+    table->GetPosition(vec3(i, j, 0) / Number(kNumSteps - 1.0), &p0);
+    table->GetPosition(vec3(i, j, 1) / Number(kNumSteps - 1.0), &p1);
+    Length step = length(p1 - p0);
+    Direction d = (p1 - p0) / step;
+    PreComputeSingleScattering(p0, d, step, sun_dir, i, j, table->value_.get());
+    progress_bar.Increment(1);
+  }, num_jobs);
 }
 
 void Nishita96::PreComputeSingleScattering(const Position& p,
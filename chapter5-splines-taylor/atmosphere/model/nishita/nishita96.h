@@ -30,6 +30,13 @@
 #ifndef ATMOSPHERE_MODEL_NISHITA_NISHITA96_H_
 #define ATMOSPHERE_MODEL_NISHITA_NISHITA96_H_
 
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 #include "atmosphere/atmosphere.h"
 #include "atmosphere/model/nishita/nishita93.h"
 #include "math/angle.h"
@@ -43,13 +50,19 @@ class Nishita96 : public Nishita93 {
     SINGLE_SCATTERING_ONLY, DOUBLE_SCATTERING_ONLY, ALL_ORDERS
   };
 
-  explicit Nishita96(ScatteringType scattering_type);
+  // The single scattering tables precomputed for the last
+  // 'max_cached_sun_zeniths' sun zenith angles are kept in memory, in single
+  // instead of double precision if 'use_float_tables' is true (each set of
+  // tables for a given sun zenith takes about 92 MB in double precision).
+  explicit Nishita96(ScatteringType scattering_type,
+      int max_cached_sun_zeniths = 4, bool use_float_tables = false);
 
   RadianceSpectrum GetSkyRadiance(Length altitude, Angle sun_zenith,
       Angle view_zenith, Angle view_sun_azimuth) const override;
 
  private:
   static constexpr int kNumSteps = 33;
+  static constexpr int kNumWavelengths = DimensionlessSpectrum::SIZE;
 
   typedef dimensional::TernaryFunction<kNumSteps, kNumSteps, kNumSteps,
       WavelengthFunction<0, 0, -1, 0, 0>> SingleScatteringFunction;
@@ -60,22 +73,56 @@ class Nishita96 : public Nishita93 {
    public:
     void Init(Angle sun_zenith, Angle view_zenith);
 
+    // Replaces value_ with its single precision version in float_value_.
+    void ConvertToFloat();
+
     WavelengthFunction<0, 0, -1, 0, 0> GetSingleScattering(
         const Position& p) const;
 
     void GetPosition(const dimensional::vec3& u, Position* p) const;
     void GetU(const Position& p, dimensional::vec3* u) const;
 
+    static int GetFloatValueIndex(int i, int j, int k) {
+      return (i + j * kNumSteps + k * kNumSteps * kNumSteps) * kNumWavelengths;
+    }
+
     Angle view_zenith_;
     Number cos_view_zenith_;
     Number sin_view_zenith_;
-    SingleScatteringFunction value_;
+    std::unique_ptr<SingleScatteringFunction> value_;
+    // The values of value_ in 1/sr, with the same layout, or an empty vector
+    // if ConvertToFloat has not been called.
+    std::vector<float> float_value_;
   };
 
-  void MaybePrecomputeSingleScatteringTables(Angle sun_zenith) const;
+  struct SingleScatteringTableSet {
+    Direction sample_directions[8];
+    SingleScatteringTable sample_single_scattering[8];
+  };
 
-  void PreComputeSingleScatteringTable(Angle sun_zenith, Angle view_zenith,
-      SingleScatteringTable* output) const;
+  // Computes the integrals of the Rayleigh and Mie phase functions, for the
+  // given view direction, over the solid angle associated with each sampling
+  // direction (made of the directions nearer to this sampling direction than
+  // to any other one).
+  static void GetPhaseIntegrals(const Direction sample_directions[8],
+      const Direction& view_dir, Number rayleigh_phase_integral[8],
+      Number mie_phase_integral[8]);
+
+  // Returns the tables for the given sun zenith angle, from the in memory
+  // cache if possible, and otherwise from the disk cache or by computing them.
+  // Thread safe. The tables are loaded or computed without holding the mutex,
+  // and only once if several threads need them at the same time.
+  std::shared_ptr<const SingleScatteringTableSet> GetSingleScatteringTables(
+      Angle sun_zenith) const;
+
+  std::shared_ptr<SingleScatteringTableSet> LoadOrComputeSingleScatteringTables(
+      Angle sun_zenith) const;
+
+  // Precomputes the tables with the given indices, in parallel over all their
+  // (i, j) slices.
+  void PreComputeSingleScatteringTables(Angle sun_zenith,
+      const std::vector<int>& table_indices,
+      SingleScatteringTableSet* output) const;
 
   void PreComputeSingleScattering(const Position& p, const Direction& d,
       Length step, const Direction& sun_dir, int i, int j,
@@ -101,9 +148,17 @@ class Nishita96 : public Nishita93 {
       const Direction& d);
 
   ScatteringType scattering_type_;
-  mutable Angle current_sun_zenith_;
-  mutable dimensional::Vector3<Number> sample_directions_[8];
-  mutable SingleScatteringTable sample_single_scattering_[8];
+  unsigned int max_cached_sun_zeniths_;
+  bool use_float_tables_;
+  // The cached table sets, from the most to the least recently used.
+  mutable std::list<std::pair<Angle,
+      std::shared_ptr<const SingleScatteringTableSet>>> table_sets_;
+  // The sun zenith angles whose tables are being loaded or computed.
+  mutable std::vector<Angle> pending_sun_zeniths_;
+  mutable std::mutex mutex_;
+  mutable std::condition_variable table_set_added_;
+
+  friend class TestNishita96;
 };
 
 #endif  // ATMOSPHERE_MODEL_NISHITA_NISHITA96_H_
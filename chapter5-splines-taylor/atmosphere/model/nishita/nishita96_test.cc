@@ -0,0 +1,149 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/model/nishita/nishita96.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/test_case.h"
+
+class TestNishita96 : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestNishita96(const std::string& name, T test)
+      : TestCase("TestNishita96 " + name, static_cast<Test>(test)) {}
+
+  // Checks that the phase function integrals over the solid angles associated
+  // with the sampling directions sum to 1, and that the Mie one is maximal for
+  // the sampling direction nearest to the view direction.
+  void TestPhaseIntegrals() {
+    // The sampling directions for a sun zenith angle of 45 degrees, every 45
+    // degrees in the x-z plane.
+    Nishita96::Direction sample_directions[8];
+    const double view_zenith_deg[8] = {0, 180, 90, -90, 45, 225, -45, 135};
+    for (int i = 0; i < 8; ++i) {
+      Angle view_zenith = view_zenith_deg[i] * deg;
+      sample_directions[i] =
+          Nishita96::Direction(sin(view_zenith), 0.0, cos(view_zenith));
+    }
+    for (int k = 0; k < 8; ++k) {
+      Number rayleigh_phase_integral[8];
+      Number mie_phase_integral[8];
+      Nishita96::GetPhaseIntegrals(sample_directions, sample_directions[k],
+          rayleigh_phase_integral, mie_phase_integral);
+      Number rayleigh_sum = 0.0;
+      Number mie_sum = 0.0;
+      int max_index = 0;
+      for (int i = 0; i < 8; ++i) {
+        rayleigh_sum += rayleigh_phase_integral[i];
+        mie_sum += mie_phase_integral[i];
+        if (mie_phase_integral[i] > mie_phase_integral[max_index]) {
+          max_index = i;
+        }
+      }
+      ExpectNear(1.0, rayleigh_sum(), 1e-2);
+      ExpectNear(1.0, mie_sum(), 1e-2);
+      ExpectEquals(k, max_index);
+    }
+  }
+
+  void TestTableCache() {
+    Nishita96 nishita(Nishita96::SINGLE_SCATTERING_ONLY,
+        2 /* max_cached_sun_zeniths */);
+    auto tables_30 = nishita.GetSingleScatteringTables(30.0 * deg);
+    ExpectTrue(tables_30 == nishita.GetSingleScatteringTables(30.0 * deg));
+    auto tables_40 = nishita.GetSingleScatteringTables(40.0 * deg);
+    // 30 becomes the most recently used, so 40 must be evicted by 50.
+    ExpectTrue(tables_30 == nishita.GetSingleScatteringTables(30.0 * deg));
+    auto tables_50 = nishita.GetSingleScatteringTables(50.0 * deg);
+    ExpectEquals(2, nishita.table_sets_.size());
+    ExpectTrue(nishita.table_sets_.front().second == tables_50);
+    ExpectTrue(nishita.table_sets_.back().second == tables_30);
+    ExpectTrue(tables_30 == nishita.GetSingleScatteringTables(30.0 * deg));
+    ExpectTrue(tables_40 != nishita.GetSingleScatteringTables(40.0 * deg));
+    // The evicted tables remain valid while they are used.
+    ExpectNear(sin(40.0 * deg)(), tables_40->sample_directions[4].x(), 1e-12);
+  }
+
+  // Checks that threads needing the same tables at the same time wait for the
+  // first one to compute them, instead of computing them again.
+  void TestConcurrentTableCache() {
+    Nishita96 nishita(Nishita96::SINGLE_SCATTERING_ONLY);
+    std::vector<std::shared_ptr<const Nishita96::SingleScatteringTableSet>>
+        tables(4);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < tables.size(); ++i) {
+      threads.push_back(std::thread([&nishita, &tables, i]() {
+        tables[i] = nishita.GetSingleScatteringTables(60.0 * deg);
+      }));
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    for (unsigned int i = 1; i < tables.size(); ++i) {
+      ExpectTrue(tables[i] == tables[0]);
+    }
+    ExpectTrue(nishita.pending_sun_zeniths_.empty());
+  }
+
+  void TestFloatTables() {
+    Nishita96 double_nishita(Nishita96::DOUBLE_SCATTERING_ONLY);
+    Nishita96 float_nishita(Nishita96::DOUBLE_SCATTERING_ONLY,
+        4 /* max_cached_sun_zeniths */, true /* use_float_tables */);
+    const Angle sun_zenith = 30.0 * deg;
+    for (double view_zenith_deg : {0.0, 45.0, 80.0}) {
+      for (double view_azimuth_deg : {0.0, 90.0, 180.0}) {
+        RadianceSpectrum expected = double_nishita.GetSkyRadiance(0.0 * m,
+            sun_zenith, view_zenith_deg * deg, view_azimuth_deg * deg);
+        RadianceSpectrum actual = float_nishita.GetSkyRadiance(0.0 * m,
+            sun_zenith, view_zenith_deg * deg, view_azimuth_deg * deg);
+        for (unsigned int i = 0; i < expected.size(); ++i) {
+          double value = expected[i].to(watt_per_square_meter_per_sr_per_nm);
+          ExpectTrue(value > 0.0);
+          ExpectNear(value,
+              actual[i].to(watt_per_square_meter_per_sr_per_nm), 1e-5 * value);
+        }
+      }
+    }
+  }
+};
+
+namespace {
+
+TestNishita96 phaseintegrals(
+    "phaseintegrals", &TestNishita96::TestPhaseIntegrals);
+TestNishita96 tablecache("tablecache", &TestNishita96::TestTableCache);
+TestNishita96 concurrenttablecache(
+    "concurrenttablecache", &TestNishita96::TestConcurrentTableCache);
+TestNishita96 floattables("floattables", &TestNishita96::TestFloatTables);
+
+}  // anonymous namespace
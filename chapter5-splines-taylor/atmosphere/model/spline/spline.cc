@@ -1,19 +1,18 @@
 #include "atmosphere/model/spline/spline.h"
 #include "atmosphere/model/spline/Spline2dSolution.h"
 #include <iomanip>
-#include "timing.h"
+#include "util/profiling.h"
 
-Spline::Spline() : num_samples(1024),
-                   num_samples_light(1),
+Spline::Spline(uint32_t num_samples, uint32_t num_samples_light, int height_points, int distance_points)
+                 : num_samples(num_samples),
+                   num_samples_light(num_samples_light),
                    planet_radius(EarthRadius.to(m)),
                    atmosphere_radius(AtmosphereRadius.to(m)),
                    h_rayleigh(RayleighScaleHeight.to(m)),
                    h_mie(MieScaleHeight.to(m)),
                    inner_radius(EarthRadius)
 {
-
-    int height_points     = 50;
-    int distance_points   = 20;
+    PROFILE_SCOPE("Spline precomputation");
 
     double scaling_factor = 1.0;
 
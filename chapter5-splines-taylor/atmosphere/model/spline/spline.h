@@ -25,7 +25,9 @@ typedef dimensional::Vector3<Number> Direction;
 class Spline : public Atmosphere
 {
 public:
-    Spline();
+    /* The default numbers of samples and of spline grid points are the ones used in the comparisons */
+    explicit Spline(uint32_t num_samples = 1024, uint32_t num_samples_light = 1,
+                    int height_points = 50, int distance_points = 20);
 
     int GetOriginalNumberOfWavelengths() const override { return 3; }
 
@@ -6,8 +6,9 @@ typedef dimensional::Vector3<Length> Position;
 typedef dimensional::Vector3<Length> Vector;
 typedef dimensional::Vector3<Number> Direction;
 
-Taylor::Taylor() : num_samples(1024),
-                   num_samples_light(1)
+Taylor::Taylor(uint32_t num_samples, uint32_t num_samples_light)
+    : num_samples(num_samples),
+      num_samples_light(num_samples_light)
 {
     
 }
@@ -9,7 +9,8 @@
 /* Taylor based method */
 class Taylor : public Atmosphere {
  public:
-  Taylor();
+  /* The default numbers of samples are the ones used in the comparisons */
+  explicit Taylor(uint32_t num_samples = 1024, uint32_t num_samples_light = 1);
 
   int GetOriginalNumberOfWavelengths() const override { return 3; }
 
@@ -6,9 +6,9 @@ typedef dimensional::Vector3<Length> Position;
 typedef dimensional::Vector3<Length> Vector;
 typedef dimensional::Vector3<Number> Direction;
 
-Trapezoidal::Trapezoidal() 
-    : num_samples(8),
-      num_samples_light(128)
+Trapezoidal::Trapezoidal(uint32_t num_samples, uint32_t num_samples_light)
+    : num_samples(num_samples),
+      num_samples_light(num_samples_light)
 {
     std::cout << "TRAPEZOIDAL RULE INFO" << std::endl;
     std::cout << "VIEW SAMPLES = " << num_samples << std::endl << std::endl;
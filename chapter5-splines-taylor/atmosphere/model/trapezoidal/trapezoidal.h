@@ -9,7 +9,9 @@
 /* Trapezoidal method */
 class Trapezoidal : public Atmosphere {
  public:
-  Trapezoidal();
+  /* The default numbers of samples are the ones used in the comparisons */
+  explicit Trapezoidal(uint32_t num_samples = 8,
+                       uint32_t num_samples_light = 128);
 
   int GetOriginalNumberOfWavelengths() const override { return 3; }
 
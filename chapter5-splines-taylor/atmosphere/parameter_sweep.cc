@@ -0,0 +1,368 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/parameter_sweep.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "atmosphere/comparisons.h"
+#include "atmosphere/hemispherical_function.h"
+#include "util/progress_bar.h"
+
+namespace {
+
+// Returns all the combinations of one value from each of the given sets.
+std::vector<std::vector<int>> CartesianProduct(
+    const std::vector<std::vector<int>>& values) {
+  std::vector<std::vector<int>> result(1);
+  for (const std::vector<int>& axis_values : values) {
+    std::vector<std::vector<int>> new_result;
+    for (const std::vector<int>& prefix : result) {
+      for (int value : axis_values) {
+        new_result.push_back(prefix);
+        new_result.back().push_back(value);
+      }
+    }
+    result.swap(new_result);
+  }
+  return result;
+}
+
+// Returns the indices begin, begin + stride, ... up to end which are in
+// [0, size - 1], plus size - 1 if end is after the last grid index.
+std::vector<int> GetAxisIndices(int begin, int end, int stride, int size) {
+  std::vector<int> result;
+  for (int i = begin; i <= end; i += stride) {
+    if (i >= 0 && i < size) {
+      result.push_back(i);
+    }
+  }
+  if (end >= size - 1 && (result.empty() || result.back() != size - 1)) {
+    result.push_back(size - 1);
+  }
+  return result;
+}
+
+// Updates a 64-bit FNV-1a hash with the bytes of the given value.
+void HashValue(double value, uint64_t* hash) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+  for (unsigned int i = 0; i < sizeof(value); ++i) {
+    *hash = (*hash ^ bytes[i]) * 1099511628211ull;
+  }
+}
+
+}  // anonymous namespace
+
+int SweepAxis::size() const {
+  return static_cast<int>(std::floor((max - min) / step + 1e-6)) + 1;
+}
+
+int SweepAxis::index(double value) const {
+  return static_cast<int>(std::round((value - min) / step));
+}
+
+ParameterSweep::ParameterSweep(const std::vector<SweepAxis>& axes,
+    const std::string& checkpoint_filename, const std::string& inputs)
+    : axes_(axes), checkpoint_filename_(checkpoint_filename), inputs_(inputs) {
+  LoadCheckpoint();
+}
+
+void ParameterSweep::Run(CostFunction cost, bool parallel) {
+  std::vector<std::vector<int>> axis_indices;
+  for (const SweepAxis& axis : axes_) {
+    axis_indices.push_back(
+        GetAxisIndices(0, axis.size() - 1, 1, axis.size()));
+  }
+  Evaluate(cost, CartesianProduct(axis_indices), parallel);
+}
+
+void ParameterSweep::RunCoarseToFine(CostFunction cost, int num_levels,
+    bool parallel) {
+  int stride = 1 << num_levels;
+  std::vector<std::vector<int>> axis_indices;
+  for (const SweepAxis& axis : axes_) {
+    axis_indices.push_back(
+        GetAxisIndices(0, axis.size() - 1, stride, axis.size()));
+  }
+  Evaluate(cost, CartesianProduct(axis_indices), parallel);
+  while (stride > 1) {
+    double min_cost;
+    Index center;
+    Point min_point = GetMinimum(&min_cost);
+    for (unsigned int i = 0; i < axes_.size(); ++i) {
+      center.push_back(axes_[i].index(min_point[i]));
+    }
+    int window = stride;
+    stride /= 2;
+    axis_indices.clear();
+    for (unsigned int i = 0; i < axes_.size(); ++i) {
+      axis_indices.push_back(
+          GetAxisIndices(center[i] - window, center[i] + window, stride,
+              axes_[i].size()));
+    }
+    Evaluate(cost, CartesianProduct(axis_indices), parallel);
+  }
+}
+
+ParameterSweep::Point ParameterSweep::GetMinimum(double* min_cost) const {
+  assert(!results_.empty());
+  auto min = results_.begin();
+  for (auto it = results_.begin(); it != results_.end(); ++it) {
+    if (it->second < min->second) {
+      min = it;
+    }
+  }
+  *min_cost = min->second;
+  return GetPoint(min->first);
+}
+
+void ParameterSweep::SaveTable() const {
+  const std::string temp_filename = checkpoint_filename_ + ".tmp";
+  std::ofstream output(temp_filename);
+  output << GetHeader() << std::endl;
+  for (const auto& result : results_) {
+    for (double value : GetPoint(result.first)) {
+      output << value << " ";
+    }
+    output << result.second << std::endl;
+  }
+  output.close();
+  std::rename(temp_filename.c_str(), checkpoint_filename_.c_str());
+}
+
+std::vector<std::pair<ParameterSweep::Point, double>>
+ParameterSweep::GetResults() const {
+  std::vector<std::pair<Point, double>> results;
+  for (const auto& result : results_) {
+    results.push_back(std::make_pair(GetPoint(result.first), result.second));
+  }
+  return results;
+}
+
+std::string ParameterSweep::GetInputsFingerprint(
+    const MeasuredAtmospheres& measurements, Wavelength min_wavelength,
+    Wavelength max_wavelength) {
+  uint64_t hash = 14695981039346656037ull;
+  HashValue(min_wavelength.to(nm), &hash);
+  HashValue(max_wavelength.to(nm), &hash);
+  for (int k = 0; k < measurements.num_measurements(); ++k) {
+    const MeasuredAtmosphere& measurement = measurements.GetMeasurement(k);
+    HashValue(measurement.sun_zenith().to(rad), &hash);
+    HashValue(measurement.sun_azimuth().to(rad), &hash);
+    for (int i = 0; i < 9; ++i) {
+      for (int j = 0; j < 9; ++j) {
+        const RadianceSpectrum& radiance = measurement.measurements().Get(i, j);
+        for (unsigned int l = 0; l < RadianceSpectrum::SIZE; ++l) {
+          HashValue(radiance[l].to(watt_per_square_meter_per_sr_per_nm),
+              &hash);
+        }
+      }
+    }
+  }
+  std::stringstream fingerprint;
+  fingerprint << std::hex << hash;
+  return fingerprint.str();
+}
+
+ParameterSweep::CostFunction ParameterSweep::TotalRmseCost(
+    AtmosphereFactory factory, const MeasuredAtmospheres& reference,
+    const std::vector<Angle>& sun_zenith,
+    const std::vector<Angle>& sun_azimuth, Wavelength min_wavelength,
+    Wavelength max_wavelength) {
+  return [factory, &reference, &sun_zenith, &sun_azimuth, min_wavelength,
+      max_wavelength](const Point& point) {
+    std::unique_ptr<Atmosphere> atmosphere = factory(point);
+    SpectralRadiance rmse = Comparisons("", *atmosphere, reference,
+        min_wavelength, max_wavelength).ComputeTotalRmse(
+            sun_zenith, sun_azimuth);
+    return rmse.to(1e-3 * watt_per_square_meter_per_sr_per_nm);
+  };
+}
+
+ParameterSweep::CostFunction ParameterSweep::MeanDeltaECost(
+    AtmosphereFactory factory, const MeasuredAtmospheres& measurements,
+    const Atmosphere* reference, const std::vector<Angle>& sun_zenith,
+    const std::vector<Angle>& sun_azimuth, Wavelength min_wavelength,
+    Wavelength max_wavelength) {
+  return [factory, &measurements, reference, &sun_zenith, &sun_azimuth,
+      min_wavelength, max_wavelength](const Point& point) {
+    std::unique_ptr<Atmosphere> atmosphere = factory(point);
+    return Comparisons("", *atmosphere, measurements, min_wavelength,
+        max_wavelength).ComputeMeanDeltaE(reference, sun_zenith,
+            sun_azimuth)();
+  };
+}
+
+ParameterSweep::CostFunction ParameterSweep::QueryTimeCost(
+    AtmosphereFactory factory, const std::vector<Angle>& sun_zenith,
+    const std::vector<Angle>& sun_azimuth,
+    const benchmark::Options& options) {
+  // The filter would skip the query benchmark, whose result is needed.
+  benchmark::Options query_options = options;
+  query_options.filter.clear();
+  return [factory, &sun_zenith, &sun_azimuth, query_options](
+      const Point& point) {
+    std::unique_ptr<Atmosphere> atmosphere = factory(point);
+    benchmark::Runner runner(query_options);
+    const int num_queries = 81 * sun_zenith.size();
+    runner.RunWarm("query", benchmark::Parameters(), num_queries,
+        [&](int query) {
+      Angle view_zenith;
+      Angle view_azimuth;
+      HemisphericalFunction<Number>::GetSampleDirection(
+          query % 9, (query / 9) % 9, &view_zenith, &view_azimuth);
+      RadianceSpectrum radiance = atmosphere->GetSkyRadiance(0.0 * m,
+          sun_zenith[query / 81], sun_azimuth[query / 81], view_zenith,
+          view_azimuth);
+      benchmark::DoNotOptimize(radiance);
+    });
+    return runner.results().back().median_ns;
+  };
+}
+
+ParameterSweep::Point ParameterSweep::GetPoint(const Index& index) const {
+  Point point;
+  for (unsigned int i = 0; i < axes_.size(); ++i) {
+    point.push_back(axes_[i].value(index[i]));
+  }
+  return point;
+}
+
+std::string ParameterSweep::GetHeader() const {
+  std::stringstream header;
+  header << "# grid";
+  for (const SweepAxis& axis : axes_) {
+    header << " " << axis.min << " " << axis.max << " " << axis.step;
+  }
+  header << " inputs " << (inputs_.empty() ? "-" : inputs_);
+  return header.str();
+}
+
+void ParameterSweep::LoadCheckpoint() {
+  std::ifstream input(checkpoint_filename_);
+  std::string line;
+  if (!input) {
+    return;
+  }
+  const bool has_line = static_cast<bool>(std::getline(input, line));
+  if (has_line && line[0] == '#' && line != GetHeader()) {
+    // Kept aside, since it may have taken hours to compute.
+    std::cout << "Ignoring " << checkpoint_filename_
+        << ", computed with a different grid or different inputs (renamed to "
+        << checkpoint_filename_ << ".stale)" << std::endl;
+    input.close();
+    std::rename(checkpoint_filename_.c_str(),
+        (checkpoint_filename_ + ".stale").c_str());
+    return;
+  }
+  // Checkpoints without header were written before the header was added, with
+  // the same grid point format.
+  const bool is_legacy = !has_line || line[0] != '#';
+  if (is_legacy && has_line) {
+    ParseCheckpointLine(line);
+  }
+  while (std::getline(input, line)) {
+    ParseCheckpointLine(line);
+  }
+  input.close();
+  if (is_legacy) {
+    std::cout << "Converting " << checkpoint_filename_
+        << ", without header, to the current format (the original file is "
+        << "renamed to " << checkpoint_filename_ << ".legacy)" << std::endl;
+    std::rename(checkpoint_filename_.c_str(),
+        (checkpoint_filename_ + ".legacy").c_str());
+    SaveTable();
+  }
+}
+
+void ParameterSweep::ParseCheckpointLine(const std::string& line) {
+  std::stringstream line_stream(line);
+  Index index;
+  for (const SweepAxis& axis : axes_) {
+    double value;
+    if (!(line_stream >> value)) {
+      return;
+    }
+    const int axis_index = axis.index(value);
+    if (axis_index < 0 || axis_index >= axis.size()) {
+      return;
+    }
+    index.push_back(axis_index);
+  }
+  double cost;
+  if (line_stream >> cost) {
+    results_[index] = cost;
+  }
+}
+
+void ParameterSweep::Evaluate(CostFunction cost,
+    const std::vector<Index>& indices, bool parallel) {
+  std::vector<Index> missing_indices;
+  for (const Index& index : indices) {
+    if (results_.find(index) == results_.end()) {
+      missing_indices.push_back(index);
+    }
+  }
+  if (missing_indices.empty()) {
+    return;
+  }
+
+  const bool new_checkpoint = !std::ifstream(checkpoint_filename_).good();
+  std::ofstream output(checkpoint_filename_, std::ofstream::app);
+  if (new_checkpoint) {
+    output << GetHeader() << std::endl;
+  }
+  ProgressBar progress_bar(missing_indices.size());
+  auto job = [&](unsigned int i) {
+    Point point = GetPoint(missing_indices[i]);
+    double value = cost(point);
+    std::lock_guard<std::mutex> lock(mutex_);
+    results_[missing_indices[i]] = value;
+    for (double parameter : point) {
+      output << parameter << " ";
+    }
+    output << value << std::endl;
+    progress_bar.Increment(1);
+  };
+  if (parallel) {
+    RunJobs(job, missing_indices.size());
+  } else {
+    for (unsigned int i = 0; i < missing_indices.size(); ++i) {
+      job(i);
+    }
+  }
+  output.close();
+}
@@ -0,0 +1,158 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef ATMOSPHERE_PARAMETER_SWEEP_H_
+#define ATMOSPHERE_PARAMETER_SWEEP_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "atmosphere/atmosphere.h"
+#include "atmosphere/measurement/measured_atmospheres.h"
+#include "math/angle.h"
+#include "physics/units.h"
+#include "util/benchmark.h"
+
+// One axis of a regular parameter grid, with values min, min + step, ... up to
+// max (included).
+struct SweepAxis {
+  double min;
+  double max;
+  double step;
+
+  int size() const;
+  double value(int index) const { return min + index * step; }
+  int index(double value) const;
+};
+
+// Evaluates a cost function on the points of a regular parameter grid. Each
+// result is appended to a checkpoint file as soon as it is computed, and the
+// results already present in this file are reused instead of being computed
+// again. A sweep interrupted at any time can thus be resumed by running it
+// again with the same checkpoint file. The checkpoint file starts with a header
+// identifying the grid and the inputs of the cost function, and is renamed to
+// <checkpoint file>.stale (instead of being reused) if they change. Checkpoint
+// files without header, from older versions, are reused and converted.
+class ParameterSweep {
+ public:
+  typedef std::vector<double> Point;
+  typedef std::function<double(const Point&)> CostFunction;
+  typedef std::function<std::unique_ptr<Atmosphere>(const Point&)>
+      AtmosphereFactory;
+
+  // The checkpoint file uses one line per grid point, with the parameter
+  // values followed by the cost, separated by spaces, after a '#' header line.
+  // 'inputs' identifies the inputs of the cost function (see
+  // GetInputsFingerprint), the checkpointed results are only reused if it is
+  // the same as when they were computed.
+  ParameterSweep(const std::vector<SweepAxis>& axes,
+      const std::string& checkpoint_filename, const std::string& inputs = "");
+
+  // Evaluates the cost function on all the grid points which are not yet in
+  // the checkpoint file. If 'parallel' is true the points are evaluated
+  // concurrently, which requires a thread-safe cost function.
+  void Run(CostFunction cost, bool parallel);
+
+  // Finds the grid point with the smallest cost without evaluating the whole
+  // grid: first evaluates the grid subsampled with a stride of 2^num_levels,
+  // then repeatedly halves the stride and only evaluates the points around the
+  // current minimum, until the stride is 1.
+  void RunCoarseToFine(CostFunction cost, int num_levels, bool parallel);
+
+  // Returns the grid point with the smallest cost among those evaluated so far.
+  Point GetMinimum(double* min_cost) const;
+
+  // Rewrites the checkpoint file with the results sorted in grid order.
+  void SaveTable() const;
+
+  int num_results() const { return results_.size(); }
+
+  // Returns the grid points evaluated so far, with their cost, in grid order.
+  std::vector<std::pair<Point, double>> GetResults() const;
+
+  // Returns a hash of the given measurements (their sun angles and radiance
+  // samples) and wavelength range, to use as 'inputs' of the constructor.
+  static std::string GetInputsFingerprint(
+      const MeasuredAtmospheres& measurements, Wavelength min_wavelength,
+      Wavelength max_wavelength);
+
+  // Returns a cost function computing the total RMSE, in mW/m^2/sr/nm, between
+  // the measurements and the atmosphere model created by 'factory' for each
+  // grid point. The factory is called concurrently for parallel sweeps, and
+  // the returned models are not shared between threads.
+  static CostFunction TotalRmseCost(AtmosphereFactory factory,
+      const MeasuredAtmospheres& reference,
+      const std::vector<Angle>& sun_zenith,
+      const std::vector<Angle>& sun_azimuth, Wavelength min_wavelength,
+      Wavelength max_wavelength);
+
+  // Returns a cost function computing the mean CIE76 color difference between
+  // the atmosphere model created by 'factory' for each grid point and
+  // 'reference', or the measurements if 'reference' is null (see
+  // Comparisons::ComputeMeanDeltaE).
+  static CostFunction MeanDeltaECost(AtmosphereFactory factory,
+      const MeasuredAtmospheres& measurements, const Atmosphere* reference,
+      const std::vector<Angle>& sun_zenith,
+      const std::vector<Angle>& sun_azimuth, Wavelength min_wavelength,
+      Wavelength max_wavelength);
+
+  // Returns a cost function computing the median time per sky radiance query,
+  // in ns, of the atmosphere model created by 'factory' for each grid point,
+  // for the 9x9 sample directions and the given Sun directions. The model
+  // creation (including its precomputations) is not timed. Sweeps using this
+  // cost function should not be parallel, to avoid timing interferences.
+  static CostFunction QueryTimeCost(AtmosphereFactory factory,
+      const std::vector<Angle>& sun_zenith,
+      const std::vector<Angle>& sun_azimuth,
+      const benchmark::Options& options);
+
+ private:
+  typedef std::vector<int> Index;
+
+  Point GetPoint(const Index& index) const;
+  std::string GetHeader() const;
+  void LoadCheckpoint();
+  // Adds the result in the given checkpoint line, if it is a valid grid point.
+  void ParseCheckpointLine(const std::string& line);
+  void Evaluate(CostFunction cost, const std::vector<Index>& indices,
+      bool parallel);
+
+  std::vector<SweepAxis> axes_;
+  std::string checkpoint_filename_;
+  std::string inputs_;
+  std::map<Index, double> results_;
+  std::mutex mutex_;
+};
+
+#endif  // ATMOSPHERE_PARAMETER_SWEEP_H_
@@ -0,0 +1,160 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/parameter_sweep.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "test/test_case.h"
+
+class TestParameterSweep : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestParameterSweep(const std::string& name, T test)
+      : TestCase("TestParameterSweep " + name, static_cast<Test>(test)) {}
+
+  void TestRun() {
+    const std::string filename = "output/Debug/parameter_sweep_test_run.txt";
+    std::remove(filename.c_str());
+    std::atomic_int num_calls(0);
+    ParameterSweep::CostFunction cost =
+        [&num_calls](const ParameterSweep::Point& p) {
+          ++num_calls;
+          return (p[0] - 0.3) * (p[0] - 0.3) + (p[1] - 2.0) * (p[1] - 2.0);
+        };
+    std::vector<SweepAxis> axes = {{0.0, 1.0, 0.1}, {1.0, 4.0, 0.5}};
+    ParameterSweep sweep(axes, filename);
+    sweep.Run(cost, true /* parallel */);
+    ExpectEquals(11 * 7, num_calls);
+    ExpectEquals(11 * 7, sweep.num_results());
+    double min_cost;
+    ParameterSweep::Point min = sweep.GetMinimum(&min_cost);
+    ExpectNear(0.3, min[0], 1e-9);
+    ExpectNear(2.0, min[1], 1e-9);
+    ExpectNear(0.0, min_cost, 1e-9);
+    const auto results = sweep.GetResults();
+    ExpectEquals(11 * 7, results.size());
+    ExpectNear(0.0, results[0].first[0], 1e-9);
+    ExpectNear(1.0, results[0].first[1], 1e-9);
+    ExpectNear(0.0, results[1].first[0], 1e-9);
+    ExpectNear(1.5, results[1].first[1], 1e-9);
+    ExpectNear(0.09 + 1.0, results[0].second, 1e-9);
+
+    // Running the same sweep again must reuse the checkpointed results.
+    num_calls = 0;
+    ParameterSweep resumed_sweep(axes, filename);
+    ExpectEquals(11 * 7, resumed_sweep.num_results());
+    resumed_sweep.Run(cost, true /* parallel */);
+    ExpectEquals(0, num_calls);
+    resumed_sweep.SaveTable();
+    ExpectEquals(11 * 7, ParameterSweep(axes, filename).num_results());
+  }
+
+  void TestCheckpointInputs() {
+    const std::string filename =
+        "output/Debug/parameter_sweep_test_checkpoint_inputs.txt";
+    std::remove(filename.c_str());
+    ParameterSweep::CostFunction cost = [](const ParameterSweep::Point& p) {
+      return p[0];
+    };
+    std::vector<SweepAxis> axes = {{0.0, 1.0, 0.1}};
+    ParameterSweep(axes, filename, "dataset_1").Run(cost, false);
+    ExpectEquals(11, ParameterSweep(axes, filename, "dataset_1").num_results());
+
+    // The results computed with other inputs, or for another grid, must not be
+    // reused (but are kept aside).
+    std::remove((filename + ".stale").c_str());
+    ExpectEquals(0, ParameterSweep(axes, filename, "dataset_2").num_results());
+    ExpectTrue(std::ifstream(filename + ".stale").good());
+    ExpectEquals(11,
+        ParameterSweep(axes, filename + ".stale", "dataset_1").num_results());
+    ParameterSweep(axes, filename, "dataset_1").Run(cost, false);
+    ExpectEquals(0, ParameterSweep({{0.0, 1.0, 0.2}}, filename,
+        "dataset_1").num_results());
+  }
+
+  void TestLegacyCheckpoint() {
+    const std::string filename =
+        "output/Debug/parameter_sweep_test_legacy_checkpoint.txt";
+    // A checkpoint written before the header was added, with a point outside
+    // the grid.
+    std::ofstream(filename) << "0.5 0.25\n0.7 0.35\n2.0 1.0\n";
+    int num_calls = 0;
+    ParameterSweep::CostFunction cost =
+        [&num_calls](const ParameterSweep::Point& p) {
+          ++num_calls;
+          return p[0] / 2.0;
+        };
+    std::vector<SweepAxis> axes = {{0.0, 1.0, 0.1}};
+    ParameterSweep sweep(axes, filename, "dataset_1");
+    ExpectEquals(2, sweep.num_results());
+    sweep.Run(cost, false);
+    ExpectEquals(9, num_calls);
+
+    // The checkpoint is converted, and the original file is kept.
+    std::ifstream legacy(filename + ".legacy");
+    std::string line;
+    ExpectTrue(std::getline(legacy, line) && line == "0.5 0.25");
+    ExpectEquals(11, ParameterSweep(axes, filename, "dataset_1").num_results());
+  }
+
+  void TestRunCoarseToFine() {
+    const std::string filename =
+        "output/Debug/parameter_sweep_test_coarse_to_fine.txt";
+    std::remove(filename.c_str());
+    int num_calls = 0;
+    ParameterSweep::CostFunction cost =
+        [&num_calls](const ParameterSweep::Point& p) {
+          ++num_calls;
+          return std::abs(p[0] - 2.87);
+        };
+    ParameterSweep sweep({{2.0, 4.0, 0.01}}, filename);
+    sweep.RunCoarseToFine(cost, 4, false /* parallel */);
+    double min_cost;
+    ParameterSweep::Point min = sweep.GetMinimum(&min_cost);
+    ExpectNear(2.87, min[0], 1e-9);
+    ExpectTrue(num_calls < 201 / 4);
+  }
+};
+
+namespace {
+
+TestParameterSweep run("run", &TestParameterSweep::TestRun);
+TestParameterSweep checkpointinputs(
+    "checkpointinputs", &TestParameterSweep::TestCheckpointInputs);
+TestParameterSweep legacycheckpoint(
+    "legacycheckpoint", &TestParameterSweep::TestLegacyCheckpoint);
+TestParameterSweep runcoarsetofine(
+    "runcoarsetofine", &TestParameterSweep::TestRunCoarseToFine);
+
+}  // anonymous namespace
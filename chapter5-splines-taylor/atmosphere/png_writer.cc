@@ -0,0 +1,327 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/png_writer.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util/progress_bar.h"
+
+namespace {
+
+// The target size of the chunks of filtered rows compressed in parallel.
+constexpr size_t kChunkSize = 256 * 1024;
+// The deflate window size, i.e. the maximum dictionary size.
+constexpr size_t kDictionarySize = 32 * 1024;
+// The PNG filter types: none, sub, up, average and Paeth.
+constexpr int kNumFilters = 5;
+
+void AppendBigEndian(uint32_t value, std::string* output) {
+  output->push_back(static_cast<char>((value >> 24) & 0xFF));
+  output->push_back(static_cast<char>((value >> 16) & 0xFF));
+  output->push_back(static_cast<char>((value >> 8) & 0xFF));
+  output->push_back(static_cast<char>(value & 0xFF));
+}
+
+void AppendChunk(const char* type, const std::string& data,
+    std::string* output) {
+  const Bytef* type_bytes = reinterpret_cast<const Bytef*>(type);
+  const Bytef* data_bytes = reinterpret_cast<const Bytef*>(data.data());
+  uLong crc = crc32(crc32(0, Z_NULL, 0), type_bytes, 4);
+  crc = crc32(crc, data_bytes, data.size());
+  AppendBigEndian(data.size(), output);
+  output->append(type, 4);
+  output->append(data);
+  AppendBigEndian(crc, output);
+}
+
+// Converts a row of premultiplied ARGB pixels to non premultiplied RGBA bytes.
+void GetRgbaRow(const uint32_t* pixels, int width, unsigned char* output) {
+  for (int i = 0; i < width; ++i) {
+    uint32_t alpha = (pixels[i] >> 24) & 0xFF;
+    if (alpha == 0) {
+      output[0] = output[1] = output[2] = output[3] = 0;
+    } else {
+      output[0] = 255 * ((pixels[i] >> 16) & 0xFF) / alpha;
+      output[1] = 255 * ((pixels[i] >> 8) & 0xFF) / alpha;
+      output[2] = 255 * (pixels[i] & 0xFF) / alpha;
+      output[3] = alpha;
+    }
+    output += 4;
+  }
+}
+
+unsigned char Paeth(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = std::abs(p - a);
+  int pb = std::abs(p - b);
+  int pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+// Writes the filter type byte followed by the filtered bytes of 'row', using
+// the filter which minimizes the sum of the absolute values of its output (as
+// signed bytes). 'previous_row' must be all zeros for the first row, and
+// 'scratch' must contain kNumFilters * row_size bytes.
+void FilterRow(const unsigned char* row, const unsigned char* previous_row,
+    size_t row_size, unsigned char* scratch, unsigned char* output) {
+  constexpr size_t kBytesPerPixel = 4;
+  int best_filter = 0;
+  unsigned int best_cost = 0;
+  for (int filter = 0; filter < kNumFilters; ++filter) {
+    unsigned char* filtered = scratch + filter * row_size;
+    unsigned int cost = 0;
+    for (size_t k = 0; k < row_size; ++k) {
+      int a = k >= kBytesPerPixel ? row[k - kBytesPerPixel] : 0;
+      int b = previous_row[k];
+      int c = k >= kBytesPerPixel ? previous_row[k - kBytesPerPixel] : 0;
+      int predictor = 0;
+      switch (filter) {
+        case 1: predictor = a; break;
+        case 2: predictor = b; break;
+        case 3: predictor = (a + b) / 2; break;
+        case 4: predictor = Paeth(a, b, c); break;
+      }
+      unsigned char value = row[k] - predictor;
+      filtered[k] = value;
+      cost += value < 128 ? value : 256 - value;
+    }
+    if (filter == 0 || cost < best_cost) {
+      best_filter = filter;
+      best_cost = cost;
+    }
+  }
+  output[0] = best_filter;
+  std::copy(scratch + best_filter * row_size,
+      scratch + (best_filter + 1) * row_size, output + 1);
+}
+
+void CheckZlibResult(int result, int expected_result) {
+  assert(result == expected_result);
+}
+
+// Compresses 'data' into a raw deflate stream fragment, using the 'dictionary'
+// bytes which precede it. The fragment ends on a byte boundary, so that it can
+// be followed by the fragment of the next data, unless 'last' is true, in which
+// case it ends the stream.
+std::string Deflate(const unsigned char* data, size_t size,
+    const unsigned char* dictionary, size_t dictionary_size, bool last,
+    int compression_level) {
+  z_stream stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+  CheckZlibResult(deflateInit2(&stream, compression_level, Z_DEFLATED,
+      -15 /* raw deflate, 32 kB window */, 8, Z_DEFAULT_STRATEGY), Z_OK);
+  if (dictionary_size > 0) {
+    deflateSetDictionary(&stream, dictionary, dictionary_size);
+  }
+  // deflateBound does not include the empty block of Z_SYNC_FLUSH.
+  std::string output(deflateBound(&stream, size) + 16, '\0');
+  stream.next_in = const_cast<Bytef*>(data);
+  stream.avail_in = size;
+  stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+  stream.avail_out = output.size();
+  CheckZlibResult(deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH),
+      last ? Z_STREAM_END : Z_OK);
+  assert(stream.avail_in == 0);
+  output.resize(stream.total_out);
+  deflateEnd(&stream);
+  return output;
+}
+
+}  // anonymous namespace
+
+std::string EncodePng(const uint32_t* pixels, int width, int height,
+    int compression_level) {
+  const size_t row_size = 4 * static_cast<size_t>(width);
+  const size_t filtered_row_size = row_size + 1;
+  const int rows_per_chunk =
+      std::max<size_t>(1, kChunkSize / filtered_row_size);
+  const unsigned int num_chunks =
+      (height + rows_per_chunk - 1) / rows_per_chunk;
+
+  auto run = [num_chunks](std::function<void(unsigned int)> job) {
+    if (num_chunks > 1) {
+      RunJobs(job, num_chunks);
+    } else {
+      for (unsigned int chunk = 0; chunk < num_chunks; ++chunk) {
+        job(chunk);
+      }
+    }
+  };
+
+  // Filters all the rows, each chunk being filtered independently.
+  std::vector<unsigned char> filtered(filtered_row_size * height);
+  run([&](unsigned int chunk) {
+    int begin = chunk * rows_per_chunk;
+    int end = std::min(begin + rows_per_chunk, height);
+    std::vector<unsigned char> previous_row(row_size, 0);
+    std::vector<unsigned char> row(row_size);
+    std::vector<unsigned char> scratch(kNumFilters * row_size);
+    if (begin > 0) {
+      GetRgbaRow(pixels + (begin - 1) * static_cast<size_t>(width), width,
+          previous_row.data());
+    }
+    for (int j = begin; j < end; ++j) {
+      GetRgbaRow(pixels + j * static_cast<size_t>(width), width, row.data());
+      FilterRow(row.data(), previous_row.data(), row_size, scratch.data(),
+          filtered.data() + j * filtered_row_size);
+      std::swap(row, previous_row);
+    }
+  });
+
+  // Compresses each chunk with the end of the previous one as dictionary.
+  std::vector<std::string> compressed(num_chunks);
+  std::vector<uLong> adler(num_chunks);
+  run([&](unsigned int chunk) {
+    size_t begin = chunk * rows_per_chunk * filtered_row_size;
+    size_t end = std::min(begin + rows_per_chunk * filtered_row_size,
+        filtered.size());
+    size_t dictionary_size = std::min(begin, kDictionarySize);
+    compressed[chunk] = Deflate(filtered.data() + begin, end - begin,
+        filtered.data() + begin - dictionary_size, dictionary_size,
+        chunk + 1 == num_chunks, compression_level);
+    adler[chunk] = adler32(adler32(0, Z_NULL, 0), filtered.data() + begin,
+        end - begin);
+  });
+
+  std::string idat("\x78\x9c", 2);
+  uLong checksum = adler32(0, Z_NULL, 0);
+  for (unsigned int chunk = 0; chunk < num_chunks; ++chunk) {
+    idat += compressed[chunk];
+    size_t chunk_size = std::min<size_t>(rows_per_chunk,
+        height - chunk * rows_per_chunk) * filtered_row_size;
+    checksum = adler32_combine(checksum, adler[chunk], chunk_size);
+  }
+  if (num_chunks == 0) {
+    idat += Deflate(nullptr, 0, nullptr, 0, true, compression_level);
+  }
+  AppendBigEndian(checksum, &idat);
+
+  std::string ihdr;
+  AppendBigEndian(width, &ihdr);
+  AppendBigEndian(height, &ihdr);
+  // 8 bits per sample, RGBA, deflate, adaptive filtering, no interlace.
+  ihdr.append("\x08\x06\x00\x00\x00", 5);
+
+  std::string png("\x89PNG\r\n\x1A\n", 8);
+  AppendChunk("IHDR", ihdr, &png);
+  AppendChunk("IDAT", idat, &png);
+  AppendChunk("IEND", "", &png);
+  return png;
+}
+
+bool WritePng(const std::string& filename, const uint32_t* pixels, int width,
+    int height) {
+  std::string png = EncodePng(pixels, width, height);
+  std::ofstream file(filename, std::ofstream::binary);
+  file.write(png.data(), png.size());
+  file.close();
+  return !file.fail();
+}
+
+PngWriter::PngWriter(unsigned int num_threads, unsigned int max_pending)
+    : max_pending_(std::max(1u, max_pending)) {
+  for (unsigned int i = 0; i < std::max(1u, num_threads); ++i) {
+    threads_.push_back(std::thread([this]() {
+      while (true) {
+        Image image;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          changed_.wait(lock, [this]() {
+            return stopped_ || !pending_.empty();
+          });
+          if (pending_.empty()) {
+            return;
+          }
+          image = std::move(pending_.front());
+          pending_.pop_front();
+          ++num_writing_;
+        }
+        changed_.notify_all();
+        if (!WritePng(image.filename, image.pixels.data(), image.width,
+                image.height)) {
+          std::cerr << "Cannot write " << image.filename << std::endl;
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          --num_writing_;
+        }
+        changed_.notify_all();
+      }
+    }));
+  }
+}
+
+PngWriter::~PngWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  changed_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void PngWriter::Write(const std::string& filename,
+    std::vector<uint32_t> pixels, int width, int height) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this]() { return pending_.size() < max_pending_; });
+    pending_.push_back(Image{filename, std::move(pixels), width, height});
+  }
+  changed_.notify_all();
+}
+
+void PngWriter::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() {
+    return pending_.empty() && num_writing_ == 0;
+  });
+}
+
+PngWriter& PngWriter::Default() {
+  static PngWriter writer(2, 16);
+  return writer;
+}
@@ -0,0 +1,91 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef ATMOSPHERE_PNG_WRITER_H_
+#define ATMOSPHERE_PNG_WRITER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Encodes an image with 32 bits ARGB pixels with premultiplied alpha, stored
+// row by row from the top left corner, into a deflate compressed RGBA PNG file
+// content. Each row uses the PNG filter which minimizes the sum of the
+// absolute values of its output bytes. Large images are split in chunks of
+// rows which are compressed in parallel, each with the previous 32 kB of data
+// as dictionary, and then concatenated in a single zlib stream.
+std::string EncodePng(const uint32_t* pixels, int width, int height,
+    int compression_level = 6);
+
+// Encodes and saves the given image with EncodePng. Returns false if the file
+// could not be written.
+bool WritePng(const std::string& filename, const uint32_t* pixels, int width,
+    int height);
+
+// Saves images in background threads, so that the threads producing them do
+// not wait for the PNG compression nor for the disk. At most 'max_pending'
+// images are waiting to be saved, after which Write blocks until one of them
+// is saved, to bound the memory used by the pending images.
+class PngWriter {
+ public:
+  PngWriter(unsigned int num_threads, unsigned int max_pending);
+  ~PngWriter();
+
+  void Write(const std::string& filename, std::vector<uint32_t> pixels,
+      int width, int height);
+
+  // Waits until all the images passed to Write have been saved.
+  void Wait();
+
+  // The writer shared by all the Comparisons instances, which also must be
+  // waited for before exiting.
+  static PngWriter& Default();
+
+ private:
+  struct Image {
+    std::string filename;
+    std::vector<uint32_t> pixels;
+    int width;
+    int height;
+  };
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<Image> pending_;
+  unsigned int max_pending_;
+  unsigned int num_writing_ = 0;
+  bool stopped_ = false;
+  std::vector<std::thread> threads_;
+};
+
+#endif  // ATMOSPHERE_PNG_WRITER_H_
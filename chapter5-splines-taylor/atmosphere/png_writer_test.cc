@@ -0,0 +1,188 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/png_writer.h"
+
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "test/test_case.h"
+
+namespace {
+
+uint32_t ReadBigEndian(const std::string& data, size_t offset) {
+  return (static_cast<uint32_t>(static_cast<unsigned char>(data[offset])) << 24)
+      | (static_cast<unsigned char>(data[offset + 1]) << 16)
+      | (static_cast<unsigned char>(data[offset + 2]) << 8)
+      | static_cast<unsigned char>(data[offset + 3]);
+}
+
+int Predictor(int filter, int a, int b, int c) {
+  switch (filter) {
+    case 1: return a;
+    case 2: return b;
+    case 3: return (a + b) / 2;
+    case 4: {
+      int p = a + b - c;
+      int pa = std::abs(p - a);
+      int pb = std::abs(p - b);
+      int pc = std::abs(p - c);
+      return pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+    }
+    default: return 0;
+  }
+}
+
+// A pattern with smooth gradients, noise and transparent pixels, which uses
+// all the PNG filters.
+std::vector<uint32_t> MakeImage(int width, int height) {
+  std::vector<uint32_t> pixels(width * height);
+  uint32_t random = 1;
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      random = random * 1664525 + 1013904223;
+      uint32_t red = (i * 255) / width;
+      uint32_t green = (j * 255) / height;
+      uint32_t blue = (i + j) % 7 == 0 ? (random >> 24) : 128;
+      pixels[i + j * width] = (i * i + j * j) % 97 == 0 ?
+          0 : (0xFF << 24) | (red << 16) | (green << 8) | blue;
+    }
+  }
+  return pixels;
+}
+
+}  // anonymous namespace
+
+class TestPngWriter : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestPngWriter(const std::string& name, T test)
+      : TestCase("TestPngWriter " + name, static_cast<Test>(test)) {}
+
+  void TestEncodePng() {
+    // Large enough to be compressed in several chunks.
+    const int width = 300;
+    const int height = 700;
+    std::vector<uint32_t> pixels = MakeImage(width, height);
+    std::string png = EncodePng(pixels.data(), width, height);
+    ExpectTrue(png.substr(0, 8) == std::string("\x89PNG\r\n\x1A\n", 8));
+
+    // Decodes the chunks, and checks their CRC.
+    std::string idat;
+    size_t offset = 8;
+    while (offset + 12 <= png.size()) {
+      uint32_t length = ReadBigEndian(png, offset);
+      std::string type = png.substr(offset + 4, 4);
+      const Bytef* type_and_data =
+          reinterpret_cast<const Bytef*>(png.data() + offset + 4);
+      ExpectEquals(crc32(0, type_and_data, length + 4),
+          ReadBigEndian(png, offset + 8 + length));
+      if (type == "IHDR") {
+        ExpectEquals(width, ReadBigEndian(png, offset + 8));
+        ExpectEquals(height, ReadBigEndian(png, offset + 12));
+      } else if (type == "IDAT") {
+        idat += png.substr(offset + 8, length);
+      }
+      offset += length + 12;
+    }
+    ExpectEquals(png.size(), offset);
+    ExpectTrue(idat.size() < pixels.size() * 4 / 2);
+
+    // Decompresses and unfilters the image data, and compares it with the
+    // original pixels.
+    const size_t row_size = 4 * width;
+    std::vector<unsigned char> filtered((row_size + 1) * height);
+    uLongf filtered_size = filtered.size();
+    ExpectEquals(Z_OK, uncompress(filtered.data(), &filtered_size,
+        reinterpret_cast<const Bytef*>(idat.data()), idat.size()));
+    ExpectEquals(filtered.size(), filtered_size);
+    std::vector<unsigned char> previous_row(row_size, 0);
+    std::vector<unsigned char> row(row_size);
+    int num_errors = 0;
+    for (int j = 0; j < height; ++j) {
+      const unsigned char* input = filtered.data() + j * (row_size + 1);
+      int filter = input[0];
+      for (size_t k = 0; k < row_size; ++k) {
+        int a = k >= 4 ? row[k - 4] : 0;
+        int c = k >= 4 ? previous_row[k - 4] : 0;
+        row[k] = input[k + 1] + Predictor(filter, a, previous_row[k], c);
+      }
+      for (int i = 0; i < width; ++i) {
+        uint32_t pixel = pixels[i + j * width];
+        uint32_t rgba = (row[4 * i] << 24) | (row[4 * i + 1] << 16) |
+            (row[4 * i + 2] << 8) | row[4 * i + 3];
+        uint32_t expected_rgba = (pixel << 8) | (pixel >> 24);
+        num_errors += rgba == expected_rgba ? 0 : 1;
+      }
+      std::swap(row, previous_row);
+    }
+    ExpectEquals(0, num_errors);
+  }
+
+  void TestPngWriterQueue() {
+    const int width = 64;
+    const int height = 32;
+    std::vector<uint32_t> pixels = MakeImage(width, height);
+    std::string expected_png = EncodePng(pixels.data(), width, height);
+    std::vector<std::string> filenames;
+    {
+      PngWriter writer(2, 3);
+      for (int i = 0; i < 10; ++i) {
+        std::ostringstream filename;
+        filename << "output/Debug/png_writer_test_" << i << ".png";
+        filenames.push_back(filename.str());
+        std::remove(filenames.back().c_str());
+        writer.Write(filenames.back(), pixels, width, height);
+      }
+      writer.Wait();
+    }
+    for (const std::string& filename : filenames) {
+      std::ifstream file(filename, std::ifstream::binary);
+      std::stringstream png;
+      png << file.rdbuf();
+      ExpectTrue(png.str() == expected_png);
+      std::remove(filename.c_str());
+    }
+  }
+};
+
+namespace {
+
+TestPngWriter encodepng("encodepng", &TestPngWriter::TestEncodePng);
+TestPngWriter pngwriterqueue(
+    "pngwriterqueue", &TestPngWriter::TestPngWriterQueue);
+
+}  // anonymous namespace
@@ -0,0 +1,95 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/radiance_cache.h"
+
+#include <utility>
+
+constexpr size_t RadianceCache::kDefaultMaxBytes;
+
+RadianceCache::RadianceCache(const Atmosphere& atmosphere, size_t max_bytes)
+    : atmosphere_(atmosphere), max_bytes_(max_bytes), bytes_(0), hits_(0),
+      misses_(0) {}
+
+void RadianceCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  keys_.clear();
+  bytes_ = 0;
+}
+
+size_t RadianceCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+size_t RadianceCache::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+unsigned int RadianceCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+unsigned int RadianceCache::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+std::shared_ptr<const void> RadianceCache::Find(const Key& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    misses_ += 1;
+    return nullptr;
+  }
+  hits_ += 1;
+  return it->second.value;
+}
+
+std::shared_ptr<const void> RadianceCache::Insert(const Key& key,
+    std::shared_ptr<const void> value, size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto inserted = entries_.insert(std::make_pair(key, Entry{value, bytes}));
+  if (!inserted.second) {
+    return inserted.first->second.value;
+  }
+  keys_.push_back(key);
+  bytes_ += bytes;
+  // The new value is returned even if it does not fit in the budget alone.
+  while (bytes_ > max_bytes_ && keys_.size() > 1) {
+    auto oldest = entries_.find(keys_.front());
+    bytes_ -= oldest->second.bytes;
+    entries_.erase(oldest);
+    keys_.pop_front();
+  }
+  return value;
+}
@@ -0,0 +1,123 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef ATMOSPHERE_RADIANCE_CACHE_H_
+#define ATMOSPHERE_RADIANCE_CACHE_H_
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include "atmosphere/atmosphere.h"
+#include "atmosphere/hemispherical_function.h"
+#include "math/angle.h"
+#include "physics/units.h"
+#include "util/profiling.h"
+
+// Memoizes the sky radiance of an atmosphere model at the NxN sample directions
+// of a HemisphericalFunction, for given Sun directions, so that the outputs
+// using the same (Sun, view) directions compute these radiances only once.
+// The atmosphere models are immutable, so the cached values remain valid as
+// long as the model: a model with other parameters is another Atmosphere
+// instance, with its own cache. The cache is bounded by a memory budget, and
+// evicts the oldest hemispheres when it is exceeded. It is thread-safe.
+class RadianceCache {
+ public:
+  template<int N>
+  using Hemisphere = HemisphericalFunction<RadianceSpectrum, N>;
+
+  // The default memory budget, in bytes (about 2500 9x9 hemispheres).
+  static constexpr size_t kDefaultMaxBytes = 64 << 20;
+
+  explicit RadianceCache(const Atmosphere& atmosphere,
+      size_t max_bytes = kDefaultMaxBytes);
+
+  // Returns the sky radiance at ground level of the atmosphere model, at the
+  // NxN sample directions given by Hemisphere<N>::GetSampleDirection, for the
+  // given Sun direction.
+  template<int N>
+  std::shared_ptr<const Hemisphere<N>> Get(Angle sun_zenith,
+      Angle sun_azimuth) {
+    Key key(N, sun_zenith.to(rad), sun_azimuth.to(rad));
+    std::shared_ptr<const void> value = Find(key);
+    if (!value) {
+      PROFILE_SCOPE("RadianceCache::Get");
+      std::shared_ptr<Hemisphere<N>> hemisphere =
+          std::make_shared<Hemisphere<N>>();
+      for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+          Angle view_zenith;
+          Angle view_azimuth;
+          Hemisphere<N>::GetSampleDirection(i, j, &view_zenith, &view_azimuth);
+          hemisphere->Set(i, j, atmosphere_.GetSkyRadiance(0.0 * m,
+              sun_zenith, sun_azimuth, view_zenith, view_azimuth));
+        }
+      }
+      value = Insert(key, hemisphere, N * N * sizeof(RadianceSpectrum));
+    }
+    return std::static_pointer_cast<const Hemisphere<N>>(value);
+  }
+
+  void Clear();
+
+  size_t size() const;
+  size_t bytes() const;
+  unsigned int hits() const;
+  unsigned int misses() const;
+
+ private:
+  // The hemisphere resolution N, and the Sun zenith and azimuth in radians.
+  typedef std::tuple<int, double, double> Key;
+
+  struct Entry {
+    std::shared_ptr<const void> value;
+    size_t bytes;
+  };
+
+  std::shared_ptr<const void> Find(const Key& key);
+
+  // Adds a newly computed value, unless another thread added one for the same
+  // key in the meantime. Returns the cached value.
+  std::shared_ptr<const void> Insert(const Key& key,
+      std::shared_ptr<const void> value, size_t bytes);
+
+  const Atmosphere& atmosphere_;
+  const size_t max_bytes_;
+  mutable std::mutex mutex_;
+  std::map<Key, Entry> entries_;
+  std::deque<Key> keys_;
+  size_t bytes_;
+  unsigned int hits_;
+  unsigned int misses_;
+};
+
+#endif  // ATMOSPHERE_RADIANCE_CACHE_H_
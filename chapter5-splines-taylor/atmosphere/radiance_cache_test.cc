@@ -0,0 +1,166 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/radiance_cache.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/test_case.h"
+
+namespace {
+
+// A sky whose radiance depends on the Sun and view zenith angles, and which
+// counts the number of GetSkyRadiance calls.
+class CountingSky : public Atmosphere {
+ public:
+  CountingSky() : num_calls(0) {}
+
+  using Atmosphere::GetSkyRadiance;
+
+  IrradianceSpectrum GetSunIrradiance(Length altitude,
+      Angle sun_zenith) const {
+    return IrradianceSpectrum(0.0 * watt_per_square_meter_per_nm);
+  }
+
+  RadianceSpectrum GetSkyRadiance(Length altitude, Angle sun_zenith,
+      Angle view_zenith, Angle view_sun) const {
+    ++num_calls;
+    return RadianceSpectrum((1.0 + sun_zenith.to(rad) + view_zenith.to(rad)) *
+        watt_per_square_meter_per_sr_per_nm);
+  }
+
+  mutable std::atomic_int num_calls;
+};
+
+}  // anonymous namespace
+
+class TestRadianceCache : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestRadianceCache(const std::string& name, T test)
+      : TestCase("TestRadianceCache " + name, static_cast<Test>(test)) {}
+
+  void TestGet() {
+    CountingSky sky;
+    RadianceCache cache(sky);
+    auto radiances = cache.Get<9>(30.0 * deg, 90.0 * deg);
+    ExpectEquals(9 * 9, sky.num_calls);
+    for (int i = 0; i < 9; ++i) {
+      for (int j = 0; j < 9; ++j) {
+        Angle view_zenith;
+        Angle view_azimuth;
+        RadianceCache::Hemisphere<9>::GetSampleDirection(
+            i, j, &view_zenith, &view_azimuth);
+        RadianceSpectrum expected = sky.GetSkyRadiance(
+            0.0 * m, 30.0 * deg, 90.0 * deg, view_zenith, view_azimuth);
+        ExpectEquals(expected[0].to(watt_per_square_meter_per_sr_per_nm),
+            radiances->Get(i, j)[0].to(watt_per_square_meter_per_sr_per_nm));
+      }
+    }
+
+    // The same Sun direction must reuse the cached radiances, while another
+    // Sun direction or resolution must compute new ones.
+    sky.num_calls = 0;
+    ExpectTrue(cache.Get<9>(30.0 * deg, 90.0 * deg) == radiances);
+    ExpectEquals(0, sky.num_calls);
+    cache.Get<9>(30.0 * deg, 45.0 * deg);
+    ExpectEquals(9 * 9, sky.num_calls);
+    cache.Get<5>(30.0 * deg, 90.0 * deg);
+    ExpectEquals(9 * 9 + 5 * 5, sky.num_calls);
+    ExpectEquals(3, cache.size());
+    ExpectEquals(1, cache.hits());
+    ExpectEquals(3, cache.misses());
+
+    cache.Clear();
+    ExpectEquals(0, cache.size());
+    ExpectEquals(0, cache.bytes());
+  }
+
+  void TestMemoryBudget() {
+    CountingSky sky;
+    const size_t hemisphere_bytes = 9 * 9 * sizeof(RadianceSpectrum);
+    RadianceCache cache(sky, 3 * hemisphere_bytes);
+    for (int i = 0; i < 5; ++i) {
+      cache.Get<9>(i * 10.0 * deg, 0.0 * deg);
+    }
+    ExpectEquals(3, cache.size());
+    ExpectEquals(3 * hemisphere_bytes, cache.bytes());
+
+    // The oldest hemispheres must have been evicted.
+    sky.num_calls = 0;
+    cache.Get<9>(40.0 * deg, 0.0 * deg);
+    ExpectEquals(0, sky.num_calls);
+    cache.Get<9>(0.0 * deg, 0.0 * deg);
+    ExpectEquals(9 * 9, sky.num_calls);
+
+    // A hemisphere larger than the budget is still returned.
+    RadianceCache small_cache(sky, hemisphere_bytes / 2);
+    auto radiances = small_cache.Get<9>(0.0 * deg, 0.0 * deg);
+    ExpectTrue(radiances != nullptr);
+    ExpectEquals(1, small_cache.size());
+  }
+
+  void TestThreadSafety() {
+    CountingSky sky;
+    RadianceCache cache(sky);
+    std::vector<std::thread> threads;
+    std::atomic_int errors(0);
+    for (int t = 0; t < 4; ++t) {
+      threads.push_back(std::thread([&cache, &errors]() {
+        for (int i = 0; i < 100; ++i) {
+          Angle sun_zenith = (i % 10) * 5.0 * deg;
+          auto radiances = cache.Get<9>(sun_zenith, 0.0 * deg);
+          double expected = 1.0 + sun_zenith.to(rad);
+          if (radiances->Get(4, 4)[0].to(watt_per_square_meter_per_sr_per_nm)
+              != expected) {
+            ++errors;
+          }
+        }
+      }));
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    ExpectEquals(0, errors);
+    ExpectEquals(10, cache.size());
+  }
+};
+
+namespace {
+
+TestRadianceCache get("get", &TestRadianceCache::TestGet);
+TestRadianceCache memorybudget(
+    "memorybudget", &TestRadianceCache::TestMemoryBudget);
+TestRadianceCache threadsafety(
+    "threadsafety", &TestRadianceCache::TestThreadSafety);
+
+}  // anonymous namespace
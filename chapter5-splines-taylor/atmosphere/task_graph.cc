@@ -0,0 +1,265 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/task_graph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <thread>
+
+#include "util/profiling.h"
+
+int TaskGraph::AddTask(const std::string& name, Task task,
+    const std::vector<int>& dependencies, const std::string& exclusive_group,
+    double memory) {
+  const int task_id = tasks_.size();
+  Node node;
+  node.name = name;
+  node.task = task;
+  node.num_dependencies = dependencies.size();
+  node.exclusive_group = exclusive_group;
+  node.memory = memory;
+  node.memory_release_task = -1;
+  node.held_memory = 0.0;
+  node.num_memory_holders = 0;
+  node.thread_index = -1;
+  node.start_time = 0.0;
+  node.end_time = 0.0;
+  for (int dependency : dependencies) {
+    // Dependencies on previous tasks only, which excludes cycles.
+    assert(dependency >= 0 && dependency < task_id);
+    tasks_[dependency].dependents.push_back(task_id);
+  }
+  tasks_.push_back(node);
+  return task_id;
+}
+
+void TaskGraph::HoldMemoryUntil(int task_id, int release_task_id) {
+  assert(task_id >= 0 && task_id < release_task_id &&
+      release_task_id < num_tasks());
+  assert(tasks_[task_id].memory_release_task == -1);
+  tasks_[task_id].memory_release_task = release_task_id;
+  if (tasks_[task_id].memory > 0.0) {
+    tasks_[release_task_id].held_memory += tasks_[task_id].memory;
+    tasks_[release_task_id].num_memory_holders += 1;
+  }
+}
+
+void TaskGraph::Run(unsigned int num_threads, double max_memory) {
+  std::vector<int> task_ids(tasks_.size());
+  std::iota(task_ids.begin(), task_ids.end(), 0);
+  RunTasks(task_ids, num_threads, max_memory);
+}
+
+void TaskGraph::RunTasks(const std::vector<int>& task_ids,
+    unsigned int num_threads, double max_memory) {
+  if (!has_run_) {
+    start_ = std::chrono::steady_clock::now();
+    has_run_ = true;
+  }
+  const auto start = start_;
+  auto now = [start]() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+  };
+
+  // The tasks which are not selected are considered as already started.
+  const int num_tasks = tasks_.size();
+  const int num_selected_tasks = task_ids.size();
+  std::vector<int> num_remaining_dependencies(num_tasks);
+  std::vector<bool> started(num_tasks, true);
+  for (int i : task_ids) {
+    num_remaining_dependencies[i] = tasks_[i].num_dependencies;
+    started[i] = false;
+  }
+  std::set<std::string> running_groups;
+  // The memory of the running tasks and the held memory, and the number of
+  // tasks using it.
+  double running_memory = 0.0;
+  int num_memory_users = 0;
+  int num_done = 0;
+  std::mutex mutex;
+  std::condition_variable condition;
+
+  // Returns the first task which can start now, or -1 if there is none. Must
+  // be called with the mutex locked.
+  auto find_task = [&]() {
+    for (int i = 0; i < num_tasks; ++i) {
+      const Node& node = tasks_[i];
+      if (started[i] || num_remaining_dependencies[i] > 0) {
+        continue;
+      }
+      if (!node.exclusive_group.empty() &&
+          running_groups.count(node.exclusive_group) > 0) {
+        continue;
+      }
+      // Tasks without memory are never blocked by the budget, so that those
+      // releasing held memory can always run.
+      if (node.memory > 0.0 && num_memory_users > 0 &&
+          running_memory + node.memory > max_memory) {
+        continue;
+      }
+      return i;
+    }
+    return -1;
+  };
+
+  auto worker = [&](int thread_index) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      int task_id = -1;
+      condition.wait(lock, [&]() {
+        task_id = find_task();
+        return task_id >= 0 || num_done == num_selected_tasks;
+      });
+      if (task_id < 0) {
+        break;
+      }
+      Node& node = tasks_[task_id];
+      started[task_id] = true;
+      if (!node.exclusive_group.empty()) {
+        running_groups.insert(node.exclusive_group);
+      }
+      if (node.memory > 0.0) {
+        running_memory += node.memory;
+        num_memory_users += 1;
+      }
+      node.thread_index = thread_index;
+      node.start_time = now();
+      lock.unlock();
+
+      {
+        profiling::Scope scope(profiling::Intern(node.name));
+        node.task();
+      }
+
+      lock.lock();
+      node.end_time = now();
+      if (!node.exclusive_group.empty()) {
+        running_groups.erase(node.exclusive_group);
+      }
+      if (node.memory > 0.0 && node.memory_release_task < 0) {
+        running_memory -= node.memory;
+        num_memory_users -= 1;
+      }
+      running_memory -= node.held_memory;
+      num_memory_users -= node.num_memory_holders;
+      num_done += 1;
+      for (int dependent : node.dependents) {
+        num_remaining_dependencies[dependent] -= 1;
+      }
+      condition.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < std::max(1u, num_threads); ++i) {
+    threads.push_back(std::thread(worker, i));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  total_time_ = now();
+}
+
+std::vector<std::vector<int>> TaskGraph::GetIndependentSets() const {
+  // Union-find of the tasks, merging each task with its dependents and with
+  // the first task of its exclusive group.
+  std::vector<int> parent(tasks_.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  std::function<int(int)> find = [&parent, &find](int i) {
+    return parent[i] == i ? i : parent[i] = find(parent[i]);
+  };
+  auto merge = [&parent, &find](int i, int j) {
+    i = find(i);
+    j = find(j);
+    parent[std::max(i, j)] = std::min(i, j);
+  };
+  std::map<std::string, int> group_tasks;
+  for (int i = 0; i < num_tasks(); ++i) {
+    for (int dependent : tasks_[i].dependents) {
+      merge(i, dependent);
+    }
+    const std::string& group = tasks_[i].exclusive_group;
+    if (!group.empty()) {
+      auto it = group_tasks.insert(std::make_pair(group, i)).first;
+      merge(it->second, i);
+    }
+  }
+
+  // The root of each set is its first task, so the sets are created in order.
+  std::vector<std::vector<int>> sets;
+  std::map<int, int> set_index;
+  for (int i = 0; i < num_tasks(); ++i) {
+    const int root = find(i);
+    if (set_index.count(root) == 0) {
+      set_index[root] = sets.size();
+      sets.push_back(std::vector<int>());
+    }
+    sets[set_index[root]].push_back(i);
+  }
+  return sets;
+}
+
+void TaskGraph::SaveTimingReport(const std::string& filename) const {
+  double total_task_time = 0.0;
+  for (int i = 0; i < num_tasks(); ++i) {
+    total_task_time += duration(i);
+  }
+  std::ofstream file(filename);
+  file << "# total time " << total_time_ << " s, sum of task times "
+      << total_task_time << " s" << std::endl;
+  file << "# id start duration thread name" << std::endl;
+  for (int i = 0; i < num_tasks(); ++i) {
+    const Node& node = tasks_[i];
+    if (node.thread_index < 0) {
+      continue;
+    }
+    file << i << " " << node.start_time << " " << duration(i) << " "
+        << node.thread_index << " " << node.name << std::endl;
+  }
+  file.close();
+}
+
+const std::string& TaskGraph::name(int task_id) const {
+  assert(task_id >= 0 && task_id < num_tasks());
+  return tasks_[task_id].name;
+}
+
+double TaskGraph::duration(int task_id) const {
+  assert(task_id >= 0 && task_id < num_tasks());
+  return tasks_[task_id].end_time - tasks_[task_id].start_time;
+}
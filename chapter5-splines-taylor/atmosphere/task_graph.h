@@ -0,0 +1,113 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef ATMOSPHERE_TASK_GRAPH_H_
+#define ATMOSPHERE_TASK_GRAPH_H_
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A set of tasks with dependencies, run concurrently by a pool of threads.
+// Tasks which share some non thread-safe state (e.g. an atmosphere model
+// caching data for the last sun zenith angle) can be put in the same exclusive
+// group, so that they never run at the same time. Each task can also declare
+// an estimate of the memory it uses, so that the total estimated memory of the
+// running tasks stays below a given budget. This memory can be held after the
+// task is done, until another task is done (e.g. for a model created by a task,
+// used by its dependents, and deleted by a last task).
+class TaskGraph {
+ public:
+  typedef std::function<void()> Task;
+
+  // Adds a task and returns its id. The task starts only after all its
+  // dependencies, which must have been added before, are done. Tasks with the
+  // same non empty exclusive group never run concurrently. 'memory' is in MB.
+  int AddTask(const std::string& name, Task task,
+      const std::vector<int>& dependencies = {},
+      const std::string& exclusive_group = "", double memory = 0.0);
+
+  // Keeps the memory of 'task_id' reserved after this task is done, until
+  // 'release_task_id', which must depend (directly or not) on it, is done.
+  void HoldMemoryUntil(int task_id, int release_task_id);
+
+  // Runs all the tasks, with at most 'num_threads' tasks at the same time, and
+  // at most 'max_memory' MB of estimated memory, running or held (except for a
+  // task starting when no memory is used). Among the tasks which can start,
+  // the one added first is started first.
+  void Run(unsigned int num_threads, double max_memory);
+
+  // Same as Run, for the given tasks only. They must include all their
+  // dependencies, e.g. they can be some of the GetIndependentSets() sets.
+  void RunTasks(const std::vector<int>& task_ids, unsigned int num_threads,
+      double max_memory);
+
+  // Returns the tasks grouped in sets such that the tasks of a set only depend
+  // on tasks of the same set, and share no exclusive group with the tasks of
+  // the other sets. The sets can thus be run separately, e.g. in different
+  // processes. The sets, and the tasks in each set, are in the order in which
+  // the tasks were added.
+  std::vector<std::vector<int>> GetIndependentSets() const;
+
+  // Saves the start time (since the start of the first run) and duration of
+  // each task which has been run, in seconds, one task per line in the order
+  // in which they were added.
+  void SaveTimingReport(const std::string& filename) const;
+
+  int num_tasks() const { return tasks_.size(); }
+  const std::string& name(int task_id) const;
+  double duration(int task_id) const;
+
+ private:
+  struct Node {
+    std::string name;
+    Task task;
+    std::vector<int> dependents;
+    int num_dependencies;
+    std::string exclusive_group;
+    double memory;
+    // The task after which 'memory' is released, or -1 for this task.
+    int memory_release_task;
+    // The memory held by other tasks, released after this task, and the number
+    // of these tasks with a non zero memory.
+    double held_memory;
+    int num_memory_holders;
+    int thread_index;
+    double start_time;
+    double end_time;
+  };
+
+  std::vector<Node> tasks_;
+  bool has_run_ = false;
+  std::chrono::steady_clock::time_point start_;
+  double total_time_ = 0.0;
+};
+
+#endif  // ATMOSPHERE_TASK_GRAPH_H_
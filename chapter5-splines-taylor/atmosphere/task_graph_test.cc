@@ -0,0 +1,196 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/task_graph.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/test_case.h"
+
+class TestTaskGraph : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestTaskGraph(const std::string& name, T test)
+      : TestCase("TestTaskGraph " + name, static_cast<Test>(test)) {}
+
+  void TestDependencies() {
+    std::mutex mutex;
+    std::vector<int> order;
+    auto task = [&](int id) {
+      return [&, id]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(id);
+      };
+    };
+    TaskGraph graph;
+    int a = graph.AddTask("a", task(0));
+    int b = graph.AddTask("b", task(1), {a});
+    int c = graph.AddTask("c", task(2), {a});
+    graph.AddTask("d", task(3), {b, c});
+    graph.Run(4, 0.0);
+
+    ExpectEquals(4, order.size());
+    ExpectEquals(0, order[0]);
+    ExpectEquals(3, order[3]);
+    for (int i = 0; i < graph.num_tasks(); ++i) {
+      ExpectTrue(graph.duration(i) >= 0.0);
+    }
+  }
+
+  void TestExclusiveGroup() {
+    std::atomic<int> num_running(0);
+    std::atomic<int> max_num_running(0);
+    std::atomic<int> num_done(0);
+    auto task = [&]() {
+      int n = ++num_running;
+      if (n > max_num_running) {
+        max_num_running = n;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      --num_running;
+      ++num_done;
+    };
+    TaskGraph graph;
+    for (int i = 0; i < 8; ++i) {
+      graph.AddTask("exclusive", task, {}, "group");
+    }
+    graph.Run(4, 0.0);
+    ExpectEquals(8, num_done);
+    ExpectEquals(1, max_num_running);
+  }
+
+  void TestMemoryBudget() {
+    std::atomic<int> num_running(0);
+    std::atomic<int> max_num_running(0);
+    auto task = [&]() {
+      int n = ++num_running;
+      if (n > max_num_running) {
+        max_num_running = n;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      --num_running;
+    };
+    TaskGraph graph;
+    for (int i = 0; i < 8; ++i) {
+      graph.AddTask("big", task, {}, "", 100.0);
+    }
+    graph.Run(4, 250.0);
+    ExpectTrue(max_num_running <= 2);
+  }
+
+  void TestHeldMemory() {
+    // Each "model" is created by a first task, used by the next ones, and
+    // deleted by a last one. At most one model fits in the memory budget.
+    std::atomic<int> num_models(0);
+    std::atomic<int> max_num_models(0);
+    std::atomic<int> num_done(0);
+    auto create = [&]() {
+      int n = ++num_models;
+      if (n > max_num_models) {
+        max_num_models = n;
+      }
+    };
+    auto use = [&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      ++num_done;
+    };
+    auto destroy = [&]() { --num_models; };
+    TaskGraph graph;
+    for (int i = 0; i < 3; ++i) {
+      int init = graph.AddTask("init", create, {}, "", 100.0);
+      std::vector<int> uses;
+      for (int j = 0; j < 4; ++j) {
+        uses.push_back(graph.AddTask("use", use, {init}));
+      }
+      int day = graph.AddTask("day", destroy, uses);
+      graph.HoldMemoryUntil(init, day);
+    }
+    // A task larger than the budget must still run, alone.
+    graph.AddTask("huge", use, {}, "", 1000.0);
+    graph.Run(4, 150.0);
+    ExpectEquals(13, num_done);
+    ExpectEquals(1, max_num_models);
+  }
+
+  void TestIndependentSets() {
+    TaskGraph graph;
+    auto task = []() {};
+    int a = graph.AddTask("a", task);
+    int b = graph.AddTask("b", task, {}, "group");
+    int c = graph.AddTask("c", task, {a});
+    int d = graph.AddTask("d", task);
+    int e = graph.AddTask("e", task, {d}, "group");
+    int f = graph.AddTask("f", task);
+    std::vector<std::vector<int>> sets = graph.GetIndependentSets();
+    ExpectEquals(3, sets.size());
+    ExpectTrue(sets[0] == std::vector<int>({a, c}));
+    ExpectTrue(sets[1] == std::vector<int>({b, d, e}));
+    ExpectTrue(sets[2] == std::vector<int>({f}));
+  }
+
+  void TestRunTasks() {
+    std::mutex mutex;
+    std::vector<std::string> names;
+    TaskGraph graph;
+    auto task = [&](const std::string& name) {
+      return [&, name]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        names.push_back(name);
+      };
+    };
+    int a = graph.AddTask("a", task("a"));
+    graph.AddTask("b", task("b"));
+    int c = graph.AddTask("c", task("c"), {a});
+    graph.RunTasks({a, c}, 4, 0.0);
+    ExpectEquals(2, names.size());
+    ExpectTrue(names[0] == "a");
+    ExpectTrue(names[1] == "c");
+    ExpectTrue(graph.name(c) == "c");
+    graph.RunTasks({}, 4, 0.0);
+    ExpectEquals(2, names.size());
+  }
+};
+
+namespace {
+
+TestTaskGraph dependencies("dependencies", &TestTaskGraph::TestDependencies);
+TestTaskGraph exclusivegroup(
+    "exclusivegroup", &TestTaskGraph::TestExclusiveGroup);
+TestTaskGraph memorybudget("memorybudget", &TestTaskGraph::TestMemoryBudget);
+TestTaskGraph heldmemory("heldmemory", &TestTaskGraph::TestHeldMemory);
+TestTaskGraph independentsets(
+    "independentsets", &TestTaskGraph::TestIndependentSets);
+TestTaskGraph runtasks("runtasks", &TestTaskGraph::TestRunTasks);
+
+}  // anonymous namespace
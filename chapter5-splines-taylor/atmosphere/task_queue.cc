@@ -0,0 +1,194 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/task_queue.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+
+namespace {
+
+bool MakeDirectory(const std::string& directory) {
+  struct stat info;
+  return mkdir(directory.c_str(), 0755) == 0 ||
+      (stat(directory.c_str(), &info) == 0 && S_ISDIR(info.st_mode));
+}
+
+// Returns the entries of the given directory, except "." and "..", in
+// lexicographic order.
+std::vector<std::string> ListDirectory(const std::string& directory) {
+  std::vector<std::string> entries;
+  DIR* dir = opendir(directory.c_str());
+  if (dir == nullptr) {
+    return entries;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name != "." && name != "..") {
+      entries.push_back(name);
+    }
+  }
+  closedir(dir);
+  std::sort(entries.begin(), entries.end());
+  return entries;
+}
+
+// Sets the modification time of the given file to the current time of the file
+// system, and returns whether this file exists.
+bool Touch(const std::string& filename) {
+  return utime(filename.c_str(), nullptr) == 0;
+}
+
+void RemoveFiles(const std::string& directory) {
+  for (const std::string& name : ListDirectory(directory)) {
+    std::remove((directory + "/" + name).c_str());
+  }
+}
+
+}  // anonymous namespace
+
+TaskQueue::TaskQueue(const std::string& directory) : directory_(directory) {}
+
+bool TaskQueue::Reset(const std::vector<std::string>& jobs) {
+  std::remove((directory_ + "/ready").c_str());
+  if (!MakeDirectory(directory_) || !MakeDirectory(directory_ + "/pending") ||
+      !MakeDirectory(directory_ + "/running") ||
+      !MakeDirectory(directory_ + "/done") ||
+      !MakeDirectory(directory_ + "/reports")) {
+    return false;
+  }
+  RemoveFiles(directory_ + "/pending");
+  RemoveFiles(directory_ + "/running");
+  RemoveFiles(directory_ + "/done");
+  for (const std::string& worker : GetReportingWorkers()) {
+    RemoveFiles(directory_ + "/reports/" + worker);
+    rmdir((directory_ + "/reports/" + worker).c_str());
+  }
+  for (const std::string& job : jobs) {
+    std::ofstream(directory_ + "/pending/" + job);
+  }
+  std::ofstream ready(directory_ + "/ready");
+  return ready.good();
+}
+
+bool TaskQueue::IsReady() const {
+  return std::ifstream(directory_ + "/ready").good();
+}
+
+bool TaskQueue::Claim(const std::string& worker, std::string* job) {
+  for (const std::string& pending_job : List("pending")) {
+    const std::string pending_file = directory_ + "/pending/" + pending_job;
+    const std::string running_file = directory_ + "/running/" + pending_job;
+    // Starts the lease before the job becomes running, since the modification
+    // time is kept by the rename. The rename fails if another process claimed
+    // this job since it was listed.
+    Touch(pending_file);
+    if (std::rename(pending_file.c_str(), running_file.c_str()) == 0) {
+      std::ofstream(running_file) << worker << std::endl;
+      *job = pending_job;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TaskQueue::Renew(const std::string& worker, const std::string& job) {
+  return GetRunningWorker(job) == worker &&
+      Touch(directory_ + "/running/" + job);
+}
+
+bool TaskQueue::Complete(const std::string& worker, const std::string& job) {
+  return GetRunningWorker(job) == worker &&
+      std::rename((directory_ + "/running/" + job).c_str(),
+          (directory_ + "/done/" + job).c_str()) == 0;
+}
+
+int TaskQueue::Requeue(const std::string& worker) {
+  int count = 0;
+  for (const std::string& job : List("running")) {
+    const std::string running_file = directory_ + "/running/" + job;
+    if (GetRunningWorker(job) == worker &&
+        std::rename(running_file.c_str(),
+            (directory_ + "/pending/" + job).c_str()) == 0) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+int TaskQueue::RequeueExpired(double lease_seconds) {
+  // The current time of the file system, possibly on another machine.
+  const std::string clock_file = directory_ + "/clock";
+  std::ofstream(clock_file, std::ofstream::app).close();
+  struct stat info;
+  if (!Touch(clock_file) || stat(clock_file.c_str(), &info) != 0) {
+    return 0;
+  }
+  const time_t now = info.st_mtime;
+
+  int count = 0;
+  for (const std::string& job : List("running")) {
+    const std::string running_file = directory_ + "/running/" + job;
+    if (stat(running_file.c_str(), &info) == 0 &&
+        difftime(now, info.st_mtime) > lease_seconds &&
+        std::rename(running_file.c_str(),
+            (directory_ + "/pending/" + job).c_str()) == 0) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+std::string TaskQueue::GetReportDirectory(const std::string& worker) const {
+  const std::string directory = directory_ + "/reports/" + worker;
+  MakeDirectory(directory);
+  return directory + "/";
+}
+
+std::vector<std::string> TaskQueue::GetReportingWorkers() const {
+  return List("reports");
+}
+
+std::string TaskQueue::GetRunningWorker(const std::string& job) const {
+  std::string worker;
+  std::ifstream(directory_ + "/running/" + job) >> worker;
+  return worker;
+}
+
+std::vector<std::string> TaskQueue::List(
+    const std::string& subdirectory) const {
+  return ListDirectory(directory_ + "/" + subdirectory);
+}
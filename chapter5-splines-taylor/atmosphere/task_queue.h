@@ -0,0 +1,102 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef ATMOSPHERE_TASK_QUEUE_H_
+#define ATMOSPHERE_TASK_QUEUE_H_
+
+#include <string>
+#include <vector>
+
+// A queue of named jobs stored as files in a directory, which can be shared by
+// several processes, possibly on several machines (e.g. with NFS). A job is
+// pending, running or done, depending on the subdirectory containing its file,
+// and goes from one state to the next with an atomic rename, so that each job
+// is claimed by exactly one process. Running jobs are leased: their worker must
+// renew them periodically, otherwise they can be put back in the pending state
+// (e.g. if the worker's machine crashed). The processes can also save reports
+// (e.g. their task timings) in the queue directory.
+class TaskQueue {
+ public:
+  explicit TaskQueue(const std::string& directory);
+
+  // Removes all the jobs and reports, adds the given jobs (whose names must be
+  // valid file names) as pending, and then marks the queue as ready. Returns
+  // false if the queue directories can't be created.
+  bool Reset(const std::vector<std::string>& jobs);
+
+  // Returns whether the queue has been reset, possibly by another process.
+  bool IsReady() const;
+
+  // Moves the first pending job, in lexicographic order, to the running state,
+  // records that it is run by 'worker', and returns true. Returns false if
+  // there is no pending job.
+  bool Claim(const std::string& worker, std::string* job);
+
+  // Renews the lease of the given job, and returns whether this job is still
+  // run by 'worker' (its lease may have expired, and the job may then have
+  // been claimed by another worker).
+  bool Renew(const std::string& worker, const std::string& job);
+
+  // Moves the given job to the done state, if it is still run by 'worker', and
+  // returns whether it did so.
+  bool Complete(const std::string& worker, const std::string& job);
+
+  // Moves the running jobs of the given worker back to the pending state (e.g.
+  // after this worker crashed), and returns their number.
+  int Requeue(const std::string& worker);
+
+  // Moves the running jobs whose lease has not been renewed (or claimed) for
+  // more than 'lease_seconds' back to the pending state, and returns their
+  // number. The times are those of the file system, which may be on another
+  // machine.
+  int RequeueExpired(double lease_seconds);
+
+  int num_pending() const { return List("pending").size(); }
+  int num_running() const { return List("running").size(); }
+  int num_done() const { return List("done").size(); }
+
+  // Returns the directory where the given worker can save its reports, with a
+  // trailing '/', after creating it if necessary.
+  std::string GetReportDirectory(const std::string& worker) const;
+
+  // Returns the workers which saved some reports, in lexicographic order.
+  std::vector<std::string> GetReportingWorkers() const;
+
+ private:
+  // Returns the worker running the given job, or an empty string if the job is
+  // not running.
+  std::string GetRunningWorker(const std::string& job) const;
+
+  // Returns the files of the given subdirectory, in lexicographic order.
+  std::vector<std::string> List(const std::string& subdirectory) const;
+
+  std::string directory_;
+};
+
+#endif  // ATMOSPHERE_TASK_QUEUE_H_
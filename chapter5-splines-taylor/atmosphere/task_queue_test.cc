@@ -0,0 +1,161 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "atmosphere/task_queue.h"
+
+#include <utime.h>
+
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/test_case.h"
+
+class TestTaskQueue : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestTaskQueue(const std::string& name, T test)
+      : TestCase("TestTaskQueue " + name, static_cast<Test>(test)) {}
+
+  void TestClaim() {
+    TaskQueue queue("output/Debug/task_queue_test_claim");
+    ExpectTrue(queue.Reset({"b", "a", "c"}));
+    ExpectTrue(queue.IsReady());
+    ExpectEquals(3, queue.num_pending());
+
+    std::string job;
+    ExpectTrue(queue.Claim("worker1", &job));
+    ExpectTrue(job == "a");
+    ExpectTrue(queue.Claim("worker2", &job));
+    ExpectTrue(job == "b");
+    ExpectEquals(1, queue.num_pending());
+    ExpectEquals(2, queue.num_running());
+    ExpectTrue(queue.Complete("worker1", "a"));
+    ExpectEquals(1, queue.num_running());
+    ExpectEquals(1, queue.num_done());
+
+    // The job of a crashed worker can be claimed again.
+    ExpectEquals(0, queue.Requeue("worker1"));
+    ExpectEquals(1, queue.Requeue("worker2"));
+    ExpectTrue(queue.Claim("worker1", &job));
+    ExpectTrue(job == "b");
+    ExpectTrue(queue.Claim("worker1", &job));
+    ExpectTrue(job == "c");
+    ExpectTrue(!queue.Claim("worker1", &job));
+
+    // Resetting the queue removes the previous jobs and reports.
+    std::ofstream(queue.GetReportDirectory("worker1") + "report.txt") << 1;
+    ExpectEquals(1, queue.GetReportingWorkers().size());
+    ExpectTrue(queue.Reset({"d"}));
+    ExpectEquals(1, queue.num_pending());
+    ExpectEquals(0, queue.num_running());
+    ExpectEquals(0, queue.num_done());
+    ExpectEquals(0, queue.GetReportingWorkers().size());
+  }
+
+  void TestLeases() {
+    const std::string directory = "output/Debug/task_queue_test_leases";
+    TaskQueue queue(directory);
+    ExpectTrue(queue.Reset({"a", "b"}));
+    std::string job;
+    ExpectTrue(queue.Claim("worker1", &job));
+    ExpectTrue(queue.Claim("worker2", &job));
+    ExpectEquals(0, queue.RequeueExpired(60.0));
+
+    // The lease of "a" expires (its worker died), but not the one of "b".
+    struct utimbuf times;
+    times.actime = times.modtime = time(nullptr) - 120;
+    ExpectEquals(0, utime((directory + "/running/a").c_str(), &times));
+    ExpectTrue(queue.Renew("worker2", "b"));
+    ExpectEquals(1, queue.RequeueExpired(60.0));
+    ExpectEquals(1, queue.num_pending());
+    ExpectEquals(1, queue.num_running());
+    ExpectTrue(!queue.Renew("worker1", "a"));
+
+    // A claimed job gets a new lease, and only its new worker can renew and
+    // complete it.
+    ExpectTrue(queue.Claim("worker3", &job));
+    ExpectTrue(job == "a");
+    ExpectEquals(0, queue.RequeueExpired(60.0));
+    ExpectEquals(2, queue.num_running());
+    ExpectTrue(!queue.Renew("worker1", "a"));
+    ExpectTrue(!queue.Complete("worker1", "a"));
+    ExpectEquals(2, queue.num_running());
+    ExpectTrue(queue.Renew("worker3", "a"));
+    ExpectTrue(queue.Complete("worker3", "a"));
+    ExpectEquals(1, queue.num_done());
+  }
+
+  void TestConcurrentClaims() {
+    const std::string directory =
+        "output/Debug/task_queue_test_concurrent_claims";
+    TaskQueue queue(directory);
+    std::vector<std::string> jobs;
+    for (int i = 0; i < 100; ++i) {
+      jobs.push_back("job" + std::to_string(i));
+    }
+    ExpectTrue(queue.Reset(jobs));
+
+    std::mutex mutex;
+    std::multiset<std::string> claimed_jobs;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+      // Each worker uses its own TaskQueue, as if it was in another process.
+      threads.push_back(std::thread([&directory, &mutex, &claimed_jobs, i]() {
+        TaskQueue worker_queue(directory);
+        std::string job;
+        while (worker_queue.Claim("worker" + std::to_string(i), &job)) {
+          worker_queue.Complete("worker" + std::to_string(i), job);
+          std::lock_guard<std::mutex> lock(mutex);
+          claimed_jobs.insert(job);
+        }
+      }));
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    ExpectEquals(100, claimed_jobs.size());
+    ExpectEquals(100, std::set<std::string>(
+        claimed_jobs.begin(), claimed_jobs.end()).size());
+    ExpectEquals(100, queue.num_done());
+  }
+};
+
+namespace {
+
+TestTaskQueue claim("claim", &TestTaskQueue::TestClaim);
+TestTaskQueue leases("leases", &TestTaskQueue::TestLeases);
+TestTaskQueue concurrentclaims(
+    "concurrentclaims", &TestTaskQueue::TestConcurrentClaims);
+
+}  // anonymous namespace
@@ -0,0 +1,286 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "atmosphere/atmosphere.h"
+#include "atmosphere/model/bruneton/bruneton.h"
+#include "atmosphere/model/haber/haber.h"
+#include "atmosphere/model/hosek/hosek.h"
+#include "atmosphere/model/nishita/nishita93.h"
+#include "atmosphere/model/nishita/nishita96.h"
+#include "atmosphere/model/oneal/oneal.h"
+#include "atmosphere/model/preetham/preetham.h"
+#include "atmosphere/model/spline/spline.h"
+#include "atmosphere/model/taylor/taylor.h"
+#include "atmosphere/model/trapezoidal/trapezoidal.h"
+#include "math/angle.h"
+#include "physics/units.h"
+#include "util/benchmark.h"
+
+namespace
+{
+
+  // The view directions of the queries, in the upper hemisphere.
+  constexpr int kNumViewZeniths = 8;
+  constexpr int kNumViewAzimuths = 8;
+  constexpr int kNumQueries = kNumViewZeniths * kNumViewAzimuths;
+
+  // A model to benchmark. 'create' returns a new instance with the given
+  // number of view samples, or with its default parameters if 'samples' is 0
+  // (the models which have no number of samples always use their defaults).
+  struct Model
+  {
+    std::string name;
+    bool has_samples;
+    std::function<std::unique_ptr<Atmosphere>(uint32_t samples)> create;
+  };
+
+  std::vector<Model> GetModels()
+  {
+    return {
+        {"taylor", true,
+         [](uint32_t samples)
+         {
+           return std::unique_ptr<Atmosphere>(
+               samples > 0 ? new Taylor(samples) : new Taylor());
+         }},
+        {"spline", true,
+         [](uint32_t samples)
+         {
+           return std::unique_ptr<Atmosphere>(
+               samples > 0 ? new Spline(samples) : new Spline());
+         }},
+        {"trapezoidal", true,
+         [](uint32_t samples)
+         {
+           return std::unique_ptr<Atmosphere>(
+               samples > 0 ? new Trapezoidal(samples) : new Trapezoidal());
+         }},
+        {"bruneton", false,
+         [](uint32_t)
+         {
+           return std::unique_ptr<Atmosphere>(
+               new Bruneton(Bruneton::SINGLE_SCATTERING_ONLY, 3));
+         }},
+        {"elek", false,
+         [](uint32_t)
+         {
+           return std::unique_ptr<Atmosphere>(
+               new Bruneton(Bruneton::SINGLE_SCATTERING_ONLY, 15));
+         }},
+        {"nishita93", false,
+         [](uint32_t) { return std::unique_ptr<Atmosphere>(new Nishita93()); }},
+        {"nishita96", false,
+         [](uint32_t)
+         {
+           return std::unique_ptr<Atmosphere>(
+               new Nishita96(Nishita96::ALL_ORDERS));
+         }},
+        {"preetham", false,
+         [](uint32_t)
+         { return std::unique_ptr<Atmosphere>(new Preetham(Turbidity)); }},
+        {"hosek", false,
+         [](uint32_t)
+         { return std::unique_ptr<Atmosphere>(new Hosek(Turbidity)); }},
+        {"oneal", false,
+         [](uint32_t) { return std::unique_ptr<Atmosphere>(new ONeal()); }},
+        {"haber", false,
+         [](uint32_t)
+         { return std::unique_ptr<Atmosphere>(new Haber(Haber::ALL_ORDERS)); }},
+    };
+  }
+
+  bool Contains(const std::vector<std::string> &list, const std::string &item)
+  {
+    for (const std::string &element : list)
+    {
+      if (element == item)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+} // anonymous namespace
+
+// Measures the time per GetSkyRadiance query of the models, for several sun
+// zenith angles (each benchmark queries a fixed set of view directions), and
+// for several numbers of samples of the models which have one. The warm runs
+// reuse a model already queried with the same sun zenith, while each cold run
+// uses a new model, with empty caches. The results are saved in the JSON format
+// of Google Benchmark.
+int main(int argc, char **argv)
+{
+  std::string models = "";
+  std::string sun_zeniths = "15,35,55,75";
+  std::string samples = "";
+  std::string output_file = "output/benchmark.json";
+  benchmark::Options options;
+  options.out = &std::cout;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      std::cerr << "Missing value for " << arg << std::endl;
+      return -1;
+    }
+    const char *value = argv[++i];
+    if (arg == "--models")
+    {
+      models = value;
+    }
+    else if (arg == "--sun-zeniths")
+    {
+      sun_zeniths = value;
+    }
+    else if (arg == "--samples")
+    {
+      samples = value;
+    }
+    else if (arg == "--min-time")
+    {
+      options.min_seconds = std::atof(value);
+    }
+    else if (arg == "--repetitions")
+    {
+      options.repetitions = std::atoi(value);
+    }
+    else if (arg == "--cold-repetitions")
+    {
+      options.cold_repetitions = std::atoi(value);
+    }
+    else if (arg == "--filter")
+    {
+      options.filter = value;
+    }
+    else if (arg == "--output")
+    {
+      output_file = value;
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [--models taylor,spline,...] [--sun-zeniths 15,35,55,75]"
+                << " [--samples 16,128,1024] [--min-time seconds]"
+                << " [--repetitions N] [--cold-repetitions N]"
+                << " [--filter substring] [--output benchmark.json]"
+                << std::endl;
+      return -1;
+    }
+  }
+
+  const std::vector<std::string> model_names = benchmark::SplitList(models);
+  std::vector<uint32_t> sample_counts;
+  for (const std::string &count : benchmark::SplitList(samples))
+  {
+    sample_counts.push_back(std::atoi(count.c_str()));
+  }
+  if (sample_counts.empty())
+  {
+    sample_counts.push_back(0);
+  }
+
+  std::vector<Angle> view_zenith(kNumQueries);
+  std::vector<Angle> view_azimuth(kNumQueries);
+  for (int i = 0; i < kNumViewZeniths; ++i)
+  {
+    for (int j = 0; j < kNumViewAzimuths; ++j)
+    {
+      view_zenith[i * kNumViewAzimuths + j] =
+          (i + 0.5) / kNumViewZeniths * 90.0 * deg;
+      view_azimuth[i * kNumViewAzimuths + j] =
+          j * 360.0 / kNumViewAzimuths * deg;
+    }
+  }
+
+  benchmark::Runner runner(options);
+  runner.AddContext("benchmark", "GetSkyRadiance");
+  runner.AddContext("view_directions", std::to_string(kNumQueries));
+
+  for (const Model &model : GetModels())
+  {
+    if (!model_names.empty() && !Contains(model_names, model.name))
+    {
+      continue;
+    }
+    for (uint32_t sample_count : sample_counts)
+    {
+      if (!model.has_samples && sample_count != sample_counts[0])
+      {
+        continue;
+      }
+      std::unique_ptr<Atmosphere> atmosphere;
+      for (const std::string &zenith : benchmark::SplitList(sun_zeniths))
+      {
+        benchmark::Parameters parameters;
+        if (model.has_samples && sample_count > 0)
+        {
+          parameters.push_back({"samples", std::to_string(sample_count)});
+        }
+        parameters.push_back({"sun_zenith", zenith});
+        if (!runner.Matches(model.name, parameters))
+        {
+          continue;
+        }
+
+        const Angle sun_zenith = std::atof(zenith.c_str()) * deg;
+        const auto query = [&](int i)
+        {
+          benchmark::DoNotOptimize(atmosphere->GetSkyRadiance(
+              0.0 * m, sun_zenith, view_zenith[i], view_azimuth[i]));
+        };
+        runner.RunCold(model.name, parameters, kNumQueries,
+                       [&]() { atmosphere = model.create(sample_count); },
+                       query);
+        if (!atmosphere)
+        {
+          atmosphere = model.create(sample_count);
+        }
+        runner.RunWarm(model.name, parameters, kNumQueries, query);
+      }
+    }
+  }
+
+  if (!runner.WriteJson(output_file))
+  {
+    std::cerr << "Can't save file " << output_file << std::endl;
+    return -1;
+  }
+  std::cout << "Results saved to " << output_file << std::endl;
+  return 0;
+}
@@ -38,6 +38,8 @@
 #include <memory>
 #include <string>
 
+#include "math/file.h"
+
 #include "math/vector.h"
 
 namespace dimensional {
@@ -124,10 +126,8 @@ class BinaryFunction {
   }
 
   void Save(const std::string& filename) const {
-    std::ofstream file(filename, std::ofstream::binary);
-    file.write(
+    WriteFileAtomically(filename,
         reinterpret_cast<const char*>(value_.get()), NX * NY * sizeof(T));
-    file.close();
   }
 
  protected:
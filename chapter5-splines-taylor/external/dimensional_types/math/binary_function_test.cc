@@ -30,6 +30,8 @@
 #include "math/binary_function.h"
 
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "test/test_case.h"
 
@@ -120,6 +122,34 @@ class BinaryFunctionTest : public TestCase {
       }
     }
   }
+
+  void TestConcurrentSave() {
+    constexpr int kNumThreads = 8;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t) {
+      threads.push_back(std::thread([t]() {
+        BinaryFunction<64, 64, double> f(t);
+        for (int k = 0; k < 10; ++k) {
+          f.Save("output/Debug/binary_fuction_concurrent_test.dat");
+        }
+      }));
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+
+    // The file must contain the values saved by one of the threads, not a mix
+    // of them.
+    BinaryFunction<64, 64, double> g(-1.0);
+    g.Load("output/Debug/binary_fuction_concurrent_test.dat");
+    const double value = g.Get(0, 0);
+    ExpectTrue(value >= 0.0 && value < kNumThreads);
+    for (unsigned int j = 0; j < g.size_y(); ++j) {
+      for (unsigned int i = 0; i < g.size_x(); ++i) {
+        ExpectEquals(value, g.Get(i, j));
+      }
+    }
+  }
 };
 
 namespace {
@@ -129,6 +159,8 @@ BinaryFunctionTest set("set", &BinaryFunctionTest::TestSet);
 BinaryFunctionTest interpolation(
     "interpolation", &BinaryFunctionTest::TestInterpolation);
 BinaryFunctionTest loadsave("loadsave", &BinaryFunctionTest::TestLoadSave);
+BinaryFunctionTest concurrentsave(
+    "concurrentsave", &BinaryFunctionTest::TestConcurrentSave);
 
 }  // anonymous namespace
 
@@ -38,6 +38,7 @@
 #include <memory>
 #include <string>
 
+#include "math/file.h"
 #include "math/vector.h"
 
 namespace dimensional {
@@ -130,10 +131,8 @@ class TernaryFunction {
   }
 
   void Save(const std::string& filename) const {
-    std::ofstream file(filename, std::ofstream::binary);
-    file.write(
+    WriteFileAtomically(filename,
         reinterpret_cast<const char*>(value_.get()), NX * NY * NZ * sizeof(T));
-    file.close();
   }
 
  protected:
@@ -1,15 +0,0 @@
-#include "minpng.h"
-
-int main()
-{
-	int width = 2;
-	int height = 2;
-	char d[] = {
-		0xff, 0xaa, 0x55, 0xff,
-		0xff, 0x55, 0xaa, 0xff,
-		0xff, 0xaa, 0x55, 0xff,
-		0xff, 0x55, 0xaa, 0xff,
-	};
-	write_png("out.png",d, width, height);
-	return 0;
-}
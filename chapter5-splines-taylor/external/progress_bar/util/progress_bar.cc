@@ -29,61 +29,184 @@
 
 #include "util/progress_bar.h"
 
-#include <chrono>
+#include <algorithm>
+#include <condition_variable>
+#include <iomanip>
 #include <iostream>
-#include <limits>
-
-std::mutex ProgressBar::mutex_;
-
-ProgressBar::ProgressBar(unsigned int progress_max) : progress_(0) {
-  thread_ = std::thread([this, progress_max]() {
-    constexpr unsigned int kProgressBarWidth = 64;
-    std::unique_lock<std::mutex> lock(mutex_);
-    while (true) {
-      stop_.wait_for(lock, std::chrono::seconds(1));
-      if (progress_ >= progress_max) {
-        for (unsigned int i = 0; i < kProgressBarWidth + 2; ++i) {
-          std::cout << " ";
-        }
-        std::cout << "\r";
-        std::cout.flush();
-        return;
-      }
-      float progress = static_cast<float>(progress_) / progress_max;
-      unsigned int bar_progress =
-          static_cast<unsigned int>(progress * kProgressBarWidth);
-      std::cout << "[";
-      for (unsigned int i = 0; i < kProgressBarWidth; ++i) {
-        std::cout << (i <= bar_progress ? "#" : "-");
-      }
-      std::cout << "]\r";
-      std::cout.flush();
-    }
-  });
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr unsigned int kProgressBarWidth = 64;
+
+// The reported progress bars, in creation order, and the generation of the
+// reporter thread (incremented each time it is stopped).
+std::mutex reporter_mutex;
+std::condition_variable reporter_condition;
+std::vector<const ProgressBar*> reported_progress_bars;
+unsigned int reporter_generation = 0;
+std::thread reporter_thread;
+
+// The RunJobs threads budget, and the number of threads which can still be
+// started (which can be temporarily negative after a SetMaxJobThreads call).
+std::mutex job_threads_mutex;
+int max_job_threads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+int available_job_threads = max_job_threads;
+
+// Takes at most 'count' threads from the available ones, and returns how many.
+unsigned int AcquireJobThreads(unsigned int count) {
+  std::lock_guard<std::mutex> lock(job_threads_mutex);
+  int acquired = std::max(0, std::min(static_cast<int>(count),
+                                      available_job_threads));
+  available_job_threads -= acquired;
+  return acquired;
+}
+
+void ReleaseJobThreads(unsigned int count) {
+  std::lock_guard<std::mutex> lock(job_threads_mutex);
+  available_job_threads += count;
+}
+
+}  // anonymous namespace
+
+constexpr unsigned int ProgressBar::kNumSlots;
+std::atomic_bool ProgressBar::enabled_by_default_(true);
+
+ProgressBar::ProgressBar(unsigned int progress_max)
+    : enabled_(enabled_by_default_),
+      progress_max_(progress_max),
+      start_(std::chrono::steady_clock::now()) {
+  for (Counter& counter : counters_) {
+    counter.value = 0;
+  }
+  if (enabled_) {
+    Register(this);
+  }
 }
 
 ProgressBar::~ProgressBar() {
+  if (enabled_) {
+    Unregister(this);
+  }
+}
+
+unsigned int ProgressBar::progress() const {
+  unsigned int progress = 0;
+  for (const Counter& counter : counters_) {
+    progress += counter.value.load(std::memory_order_relaxed);
+  }
+  return progress;
+}
+
+double ProgressBar::elapsed_seconds() const {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start_).count();
+}
+
+double ProgressBar::items_per_second() const {
+  double elapsed = elapsed_seconds();
+  return elapsed > 0.0 ? progress() / elapsed : 0.0;
+}
+
+std::string ProgressBar::GetReport(unsigned int bar_width) const {
+  unsigned int current_progress = std::min(progress(), progress_max_);
+  double elapsed = elapsed_seconds();
+  double rate = elapsed > 0.0 ? current_progress / elapsed : 0.0;
+  float fraction = static_cast<float>(current_progress) / progress_max_;
+  unsigned int bar_progress = static_cast<unsigned int>(fraction * bar_width);
+  std::ostringstream line;
+  line << "[";
+  for (unsigned int i = 0; i < bar_width; ++i) {
+    line << (i <= bar_progress ? "#" : "-");
+  }
+  line << "] " << std::fixed << std::setprecision(0) << elapsed << "s";
+  if (rate > 0.0) {
+    line << ", ETA " << (progress_max_ - current_progress) / rate << "s, "
+         << std::setprecision(rate < 10.0 ? 2 : 0) << rate << " items/s";
+  }
+  return line.str();
+}
+
+void ProgressBar::Register(const ProgressBar* progress_bar) {
+  std::lock_guard<std::mutex> lock(reporter_mutex);
+  reported_progress_bars.push_back(progress_bar);
+  if (reported_progress_bars.size() == 1) {
+    reporter_thread = std::thread(RunReporter, reporter_generation);
+  }
+}
+
+void ProgressBar::Unregister(const ProgressBar* progress_bar) {
+  std::thread stopped_reporter_thread;
   {
-    std::lock_guard<std::mutex> lock_guard(mutex_);
-    progress_ = std::numeric_limits<unsigned int>::max();
+    std::lock_guard<std::mutex> lock(reporter_mutex);
+    reported_progress_bars.erase(std::find(reported_progress_bars.begin(),
+        reported_progress_bars.end(), progress_bar));
+    if (!reported_progress_bars.empty()) {
+      return;
+    }
+    // A new reporter thread can start before this one is joined, but this one
+    // then stops without printing anything.
+    reporter_generation += 1;
+    stopped_reporter_thread = std::move(reporter_thread);
   }
-  stop_.notify_one();
-  thread_.join();
+  reporter_condition.notify_all();
+  stopped_reporter_thread.join();
+}
+
+void ProgressBar::RunReporter(unsigned int generation) {
+  std::unique_lock<std::mutex> lock(reporter_mutex);
+  std::string::size_type last_line_size = 0;
+  while (!reporter_condition.wait_for(lock, std::chrono::seconds(1),
+             [generation]() { return reporter_generation != generation; })) {
+    // The bars are shortened so that the line stays short enough.
+    const unsigned int bar_width =
+        std::max(8u, kProgressBarWidth /
+            static_cast<unsigned int>(reported_progress_bars.size()));
+    std::string line;
+    for (const ProgressBar* progress_bar : reported_progress_bars) {
+      line += (line.empty() ? "" : " | ") + progress_bar->GetReport(bar_width);
+    }
+    line += "    ";
+    // Erases the end of the previous line, if it was longer.
+    const std::string::size_type line_size = line.size();
+    line.resize(std::max(line_size, last_line_size), ' ');
+    last_line_size = line_size;
+    std::cout << line << "\r";
+    std::cout.flush();
+  }
+  std::cout << std::string(last_line_size, ' ') << "\r";
+  std::cout.flush();
 }
 
 void RunJobs(std::function<void(unsigned int)> job, unsigned int job_count) {
-  constexpr unsigned int kNumThreads = 8;
-  std::thread threads[kNumThreads];
-  for (unsigned int thread_id = 0; thread_id < kNumThreads; ++thread_id) {
-    threads[thread_id] = std::thread([job, job_count, thread_id]() {
-      for (unsigned int job_id = 0; job_id < job_count; ++job_id) {
-        if (job_id % kNumThreads == thread_id) {
-          job(job_id);
-        }
-      }
-    });
+  constexpr unsigned int kMaxThreads = 8;
+  const unsigned int num_other_threads = AcquireJobThreads(
+      std::min(kMaxThreads, std::max(1u, job_count)) - 1);
+  // The jobs are distributed dynamically, since the number of threads varies.
+  std::atomic_uint next_job_id(0);
+  auto run_jobs = [&job, &next_job_id, job_count]() {
+    for (unsigned int job_id = next_job_id++; job_id < job_count;
+         job_id = next_job_id++) {
+      job(job_id);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < num_other_threads; ++i) {
+    threads.push_back(std::thread(run_jobs));
   }
-  for (unsigned int thread_id = 0; thread_id < kNumThreads; ++thread_id) {
-    threads[thread_id].join();
+  run_jobs();
+  for (std::thread& thread : threads) {
+    thread.join();
   }
+  ReleaseJobThreads(num_other_threads);
+}
+
+void SetMaxJobThreads(unsigned int max_threads) {
+  std::lock_guard<std::mutex> lock(job_threads_mutex);
+  available_job_threads += static_cast<int>(max_threads) - max_job_threads;
+  max_job_threads = max_threads;
 }
@@ -31,25 +31,96 @@
 #define UTIL_PROGRESS_BAR_H_
 
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
 #include <functional>
-#include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
+// A console progress bar, with the elapsed time, the estimated remaining time
+// and the throughput in items per second, for loops running on RunJobs
+// threads. Each thread increments its own counter, in its own cache line, and
+// a reporter thread shared by all the progress bars sums them once per second,
+// and prints all the progress bars on a single line (so that concurrent
+// progress bars do not overwrite each other). Disabled progress bars are not
+// reported and their Increment method does nothing.
 class ProgressBar {
  public:
   explicit ProgressBar(unsigned int progress_max);
   ~ProgressBar();
 
-  void Increment(unsigned int progress) { progress_ += progress; }
+  void Increment(unsigned int progress) {
+    if (enabled_) {
+      counters_[GetThreadSlot()].value.fetch_add(
+          progress, std::memory_order_relaxed);
+    }
+  }
+
+  // The sum of all the increments so far.
+  unsigned int progress() const;
+  double elapsed_seconds() const;
+  double items_per_second() const;
+
+  // Applies to the progress bars created afterwards. Enabled by default.
+  static void SetEnabled(bool enabled) { enabled_by_default_ = enabled; }
 
  private:
-  static std::mutex mutex_;
-  std::atomic_uint progress_;
-  std::condition_variable stop_;
-  std::thread thread_;
+  static constexpr unsigned int kNumSlots = 64;
+  static constexpr unsigned int kCacheLineSize = 64;
+
+  struct alignas(kCacheLineSize) Counter {
+    std::atomic_uint value;
+  };
+
+  // Threads get consecutive slots, so that concurrent RunJobs threads never
+  // share a counter (unless more than kNumSlots threads increment the same
+  // progress bar, in which case the relaxed atomic adds are still correct).
+  static unsigned int GetThreadSlot() {
+    static std::atomic_uint next_slot(0);
+    thread_local unsigned int slot = next_slot++ % kNumSlots;
+    return slot;
+  }
+
+  // Returns the report of this progress bar, with a bar of the given width.
+  std::string GetReport(unsigned int bar_width) const;
+
+  // Adds or removes a progress bar from the reported ones. The reporter thread
+  // is started with the first reported progress bar, and stopped with the last.
+  static void Register(const ProgressBar* progress_bar);
+  static void Unregister(const ProgressBar* progress_bar);
+  static void RunReporter(unsigned int generation);
+
+  static std::atomic_bool enabled_by_default_;
+  const bool enabled_;
+  const unsigned int progress_max_;
+  const std::chrono::steady_clock::time_point start_;
+  Counter counters_[kNumSlots];
 };
 
+// Runs job(job_id) for each job_id in [0, job_count), on the calling thread
+// and on at most 7 other threads. These other threads are taken from a process
+// wide budget, shared by all the concurrent (and nested) RunJobs calls, so that
+// calling RunJobs from many threads does not oversubscribe the machine.
 void RunJobs(std::function<void(unsigned int)> job, unsigned int job_count);
 
+// Sets the maximum number of threads started by all the RunJobs calls at the
+// same time. Defaults to the number of hardware threads minus one.
+void SetMaxJobThreads(unsigned int max_threads);
+
+// Runs job(job_id, &partial) for each job_id with RunJobs, where partial is a
+// copy of 'zero' owned by this job, and returns zero + partial_0 + ... +
+// partial_{job_count - 1}, summed in this order. The result thus does not
+// depend on the number of threads, nor on the order in which jobs complete.
+template<typename T, typename Job>
+T ReduceJobs(Job job, unsigned int job_count, const T& zero) {
+  std::vector<T> partials(job_count, zero);
+  RunJobs([&](unsigned int job_id) { job(job_id, &partials[job_id]); },
+      job_count);
+  T result = zero;
+  for (const T& partial : partials) {
+    result = result + partial;
+  }
+  return result;
+}
+
 #endif  // UTIL_PROGRESS_BAR_H_
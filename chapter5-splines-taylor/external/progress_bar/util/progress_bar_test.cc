@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2017 Eric Bruneton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "util/progress_bar.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/test_case.h"
+
+class TestProgressBar : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestProgressBar(const std::string& name, T test)
+      : TestCase("TestProgressBar " + name, static_cast<Test>(test)) {}
+
+  void TestProgress() {
+    ProgressBar progress_bar(100);
+    RunJobs([&progress_bar](unsigned int) { progress_bar.Increment(2); }, 50);
+    ExpectEquals(100, progress_bar.progress());
+    ExpectTrue(progress_bar.items_per_second() > 0.0);
+  }
+
+  void TestConcurrentProgressBars() {
+    // Progress bars created and deleted concurrently, and reported by the
+    // same reporter thread, which is started and stopped several times.
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+      threads.push_back(std::thread([]() {
+        for (int j = 0; j < 20; ++j) {
+          ProgressBar progress_bar(10);
+          progress_bar.Increment(10);
+          std::this_thread::sleep_for(std::chrono::milliseconds(j % 3));
+        }
+      }));
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    ProgressBar progress_bar(10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    progress_bar.Increment(10);
+    ExpectEquals(10, progress_bar.progress());
+  }
+
+  void TestRunJobs() {
+    std::vector<std::atomic_int> counts(100);
+    for (std::atomic_int& count : counts) {
+      count = 0;
+    }
+    RunJobs([&counts](unsigned int job_id) { ++counts[job_id]; },
+        counts.size());
+    for (const std::atomic_int& count : counts) {
+      ExpectEquals(1, count);
+    }
+  }
+
+  void TestReduceJobs() {
+    double sum = ReduceJobs<double>(
+        [](unsigned int job_id, double* partial) { *partial += job_id; },
+        100, 0.0);
+    ExpectEquals(4950.0, sum);
+  }
+
+  void TestNestedRunJobs() {
+    // 4 callers, each running RunJobs with nested RunJobs calls, must not use
+    // more than 4 + 3 threads at the same time.
+    SetMaxJobThreads(3);
+    std::atomic_int num_running(0);
+    std::atomic_int max_num_running(0);
+    std::atomic_int num_done(0);
+    auto job = [&](unsigned int) {
+      int n = ++num_running;
+      int max_n = max_num_running;
+      while (n > max_n && !max_num_running.compare_exchange_weak(max_n, n)) {}
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      --num_running;
+      ++num_done;
+    };
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 4; ++i) {
+      callers.push_back(std::thread([&job]() {
+        RunJobs([&job](unsigned int) { RunJobs(job, 8); }, 8);
+      }));
+    }
+    for (std::thread& caller : callers) {
+      caller.join();
+    }
+    SetMaxJobThreads(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    ExpectEquals(4 * 8 * 8, num_done);
+    ExpectTrue(max_num_running <= 4 + 3);
+  }
+};
+
+namespace {
+
+TestProgressBar progress("progress", &TestProgressBar::TestProgress);
+TestProgressBar concurrentprogressbars(
+    "concurrentprogressbars", &TestProgressBar::TestConcurrentProgressBars);
+TestProgressBar runjobs("runjobs", &TestProgressBar::TestRunJobs);
+TestProgressBar reducejobs("reducejobs", &TestProgressBar::TestReduceJobs);
+TestProgressBar nestedrunjobs(
+    "nestedrunjobs", &TestProgressBar::TestNestedRunJobs);
+
+}  // anonymous namespace
@@ -30,15 +30,27 @@
 */
 #define A_USE_UNIFORM_IRRADIANCE_METHOD
 
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "atmosphere/measurement/measured_atmosphere.h"
 #include "atmosphere/measurement/measured_atmospheres.h"
+#include "atmosphere/measurement/measurement_dataset.h"
 #include "atmosphere/model/bruneton/bruneton.h"
 #include "atmosphere/model/haber/haber.h"
 #include "atmosphere/model/hosek/hosek.h"
@@ -52,11 +64,15 @@
 #include "atmosphere/model/polradtran/polradtran.h"
 #include "atmosphere/model/preetham/preetham.h"
 #include "atmosphere/comparisons.h"
+#include "atmosphere/parameter_sweep.h"
+#include "atmosphere/png_writer.h"
 #include "atmosphere/sun_direction.h"
+#include "atmosphere/task_graph.h"
+#include "atmosphere/task_queue.h"
 #include "math/angle.h"
 #include "physics/units.h"
+#include "util/profiling.h"
 #include "util/progress_bar.h"
-#include "timing.h"
 
 namespace
 {
@@ -75,6 +91,13 @@ namespace
   constexpr int kNumMeasurements = 17;
   constexpr int kNumModels = 13;
   constexpr int kNumViewSamples = 5;
+  // An upper bound on the estimated memory used by the models whose
+  // comparisons run concurrently, in MB, for a process using all the cores.
+  constexpr double kMaxComparisonMemory = 2048.0;
+  // The duration of the queue job leases, after which the jobs of the workers
+  // which died are requeued, and the period of their renewal, in seconds.
+  constexpr double kJobLeaseSeconds = 120.0;
+  constexpr int kJobLeaseRenewalSeconds = 10;
 
   const char *kModels[kNumModels] = {
       "nishita93", "nishita96", "preetham", "oneal", "haber", "bruneton", "elek",
@@ -149,180 +172,107 @@ namespace
                                Wavelength min_wavelength, Wavelength max_wavelength)
   {
     std::cout << "Computing libRadtran RMSE table..." << std::endl;
-    auto index = [](double x) { return static_cast<int>(round(x * 1000)); };
-    auto key = [index](double alpha, double beta, double g) {
-      return std::make_pair(std::make_pair(index(alpha), index(beta)), index(g));
-    };
-    std::map<std::pair<std::pair<int, int>, int>, double> already_computed;
-    std::ifstream input(Comparisons::GetOutputDir() + "libradtran_rmse.txt");
-    if (input)
-    {
-      while (!input.eof())
-      {
-        double alpha, beta, g, rmse;
-        input >> alpha >> beta >> g >> rmse;
-        already_computed.insert(std::make_pair(key(alpha, beta, g), rmse));
-      }
-      input.close();
-    }
-
-    int total_progress = 0;
-    for (double alpha = 0.0; alpha <= 2.0; alpha += 0.2)
-    {
-      for (double beta = 0.02; beta <= 0.2; beta += 0.02)
-      {
-        for (double g = 0.5; g <= 0.9; g += 0.1)
-        {
-          if (already_computed.find(key(alpha, beta, g)) ==
-              already_computed.end())
-          {
-            ++total_progress;
-          }
-        }
-      }
-    }
-    ProgressBar progress_bar(total_progress);
-
-    SpectralRadiance min_rmse = 0.0 * watt_per_square_meter_per_sr_per_nm;
-    double min_alpha, min_beta, min_g;
-    std::ofstream output(Comparisons::GetOutputDir() + "libradtran_rmse.txt",
-                         std::ofstream::app);
-    for (double alpha = 0.0; alpha <= 2.0; alpha += 0.2)
-    {
-      for (double beta = 0.02; beta <= 0.2; beta += 0.02)
-      {
-        for (double g = 0.5; g <= 0.9; g += 0.1)
-        {
-          SpectralRadiance rmse;
-          auto it = already_computed.find(key(alpha, beta, g));
-          if (it != already_computed.end())
-          {
-            rmse = (it->second * 1e-3) * watt_per_square_meter_per_sr_per_nm;
-          }
-          else
-          {
-            LibRadtran lib_radtran(
-                libradtran_uvspec, alpha, beta, g, true /* ground_albedo */,
-                LibRadtran::HEMISPHERICAL_FUNCTION_CACHE);
-            Comparisons comparisons(
-                "", lib_radtran, measurements, min_wavelength, max_wavelength);
-            rmse = comparisons.ComputeTotalRmse(sun_zenith, sun_azimuth);
-            output << alpha << " " << beta << " " << g << " "
-                   << rmse.to(1e-3 * watt_per_square_meter_per_sr_per_nm)
-                   << std::endl;
-          }
-          if (min_rmse == 0.0 * watt_per_square_meter_per_sr_per_nm ||
-              rmse < min_rmse)
-          {
-            min_rmse = rmse;
-            min_alpha = alpha;
-            min_beta = beta;
-            min_g = g;
-          }
-          progress_bar.Increment(1);
-        }
-      }
-    }
-    output.close();
-    std::cout << "Smallest RMSE: "
-              << min_rmse.to(1e-3 * watt_per_square_meter_per_sr_per_nm)
-              << " at alpha=" << min_alpha << " beta=" << min_beta
-              << " g=" << min_g << std::endl;
+    // The sweep can't be parallel because all the LibRadtran instances use the
+    // same files in output/libradtran.
+    ParameterSweep sweep({{0.0, 2.0, 0.2}, {0.02, 0.2, 0.02}, {0.5, 0.9, 0.1}},
+                         Comparisons::GetOutputDir() + "libradtran_rmse.txt",
+                         ParameterSweep::GetInputsFingerprint(
+                             measurements, min_wavelength, max_wavelength));
+    sweep.Run(
+        ParameterSweep::TotalRmseCost(
+            [&libradtran_uvspec](const ParameterSweep::Point &p) {
+              return std::unique_ptr<Atmosphere>(new LibRadtran(
+                  libradtran_uvspec, p[0], p[1], p[2], true /* ground_albedo */,
+                  LibRadtran::HEMISPHERICAL_FUNCTION_CACHE));
+            },
+            measurements, sun_zenith, sun_azimuth, min_wavelength,
+            max_wavelength),
+        false /* parallel */);
+    sweep.SaveTable();
+
+    double min_rmse;
+    ParameterSweep::Point min = sweep.GetMinimum(&min_rmse);
+    std::cout << "Smallest RMSE: " << min_rmse
+              << " at alpha=" << min[0] << " beta=" << min[1]
+              << " g=" << min[2] << std::endl;
   }
 
   void SaveZenithLuminanceRmseTable(const MeasuredAtmospheres &measurements,
                                     const std::vector<Angle> &sun_zenith, Wavelength min_wavelength,
                                     Wavelength max_wavelength)
   {
-    std::ifstream input(
-        Comparisons::GetOutputDir() + "zenith_luminance_rmse.txt");
-    if (input)
-    {
-      input.close();
-    }
-    else
+    std::cout << "Computing zenith luminance RMSE table..." << std::endl;
+    Comparisons comparisons("", measurements, measurements, min_wavelength,
+                            max_wavelength);
+    std::vector<Luminance> measured;
+    for (unsigned int i = 0; i < sun_zenith.size(); ++i)
     {
-      std::cout << "Computing zenith luminance RMSE table..." << std::endl;
-      std::ofstream output(
-          Comparisons::GetOutputDir() + "zenith_luminance_rmse.txt");
-      Comparisons comparisons("", measurements, measurements, min_wavelength,
-                              max_wavelength);
-      for (double turbidity = 2.0; turbidity <= 4.0; turbidity += 0.01)
-      {
-        auto error_square_sum =
-            0.0 * cd_per_square_meter * cd_per_square_meter;
-        for (unsigned int i = 0; i < sun_zenith.size(); ++i)
-        {
-          Luminance measured = comparisons.ComputeZenithLuminance(sun_zenith[i]);
-          // See Eq. 1 in "Zenith luminance and sky luminance distributions for
-          // daylighting calculations", Karayel et al, Energy and Buildings, 1984.
-          Angle gamma = pi / 2.0 - sun_zenith[i];
-          Luminance model =
-              ((1.376 * turbidity - 1.81) * tan(gamma) + 0.38) *
-              kcd_per_square_meter;
-          error_square_sum += (measured - model) * (measured - model);
-        }
-        Luminance rmse = sqrt(error_square_sum / sun_zenith.size());
-        output << turbidity << " "
-               << rmse.to(cd_per_square_meter)
-               << std::endl;
-      }
-      output.close();
+      measured.push_back(comparisons.ComputeZenithLuminance(sun_zenith[i]));
     }
+    ParameterSweep sweep({{2.0, 4.0, 0.01}},
+                         Comparisons::GetOutputDir() + "zenith_luminance_rmse.txt",
+                         ParameterSweep::GetInputsFingerprint(
+                             measurements, min_wavelength, max_wavelength));
+    sweep.Run(
+        [&](const ParameterSweep::Point &p) {
+          double turbidity = p[0];
+          auto error_square_sum =
+              0.0 * cd_per_square_meter * cd_per_square_meter;
+          for (unsigned int i = 0; i < sun_zenith.size(); ++i)
+          {
+            // See Eq. 1 in "Zenith luminance and sky luminance distributions for
+            // daylighting calculations", Karayel et al, Energy and Buildings, 1984.
+            Angle gamma = pi / 2.0 - sun_zenith[i];
+            Luminance model =
+                ((1.376 * turbidity - 1.81) * tan(gamma) + 0.38) *
+                kcd_per_square_meter;
+            error_square_sum += (measured[i] - model) * (measured[i] - model);
+          }
+          Luminance rmse = sqrt(error_square_sum / sun_zenith.size());
+          return rmse.to(cd_per_square_meter);
+        },
+        true /* parallel */);
+    sweep.SaveTable();
   }
 
   void SavePreethamRmseTable(const MeasuredAtmospheres &measurements,
                              const std::vector<Angle> &sun_zenith, const std::vector<Angle> &sun_azimuth,
                              Wavelength min_wavelength, Wavelength max_wavelength)
   {
-    std::ifstream input(Comparisons::GetOutputDir() + "preetham_rmse.txt");
-    if (input)
-    {
-      input.close();
-    }
-    else
-    {
-      std::cout << "Computing Preetham RMSE table..." << std::endl;
-      std::ofstream output(Comparisons::GetOutputDir() + "preetham_rmse.txt");
-      for (double turbidity = 2.0; turbidity <= 4.0; turbidity += 0.01)
-      {
-        SpectralRadiance rmse = Comparisons("", Preetham(turbidity), measurements,
-                                            min_wavelength, max_wavelength)
-                                    .ComputeTotalRmse(
-                                        sun_zenith, sun_azimuth);
-        output << turbidity << " "
-               << rmse.to(1e-3 * watt_per_square_meter_per_sr_per_nm)
-               << std::endl;
-      }
-      output.close();
-    }
+    std::cout << "Computing Preetham RMSE table..." << std::endl;
+    ParameterSweep sweep({{2.0, 4.0, 0.01}},
+                         Comparisons::GetOutputDir() + "preetham_rmse.txt",
+                         ParameterSweep::GetInputsFingerprint(
+                             measurements, min_wavelength, max_wavelength));
+    sweep.Run(
+        ParameterSweep::TotalRmseCost(
+            [](const ParameterSweep::Point &p) {
+              return std::unique_ptr<Atmosphere>(new Preetham(p[0]));
+            },
+            measurements, sun_zenith, sun_azimuth, min_wavelength,
+            max_wavelength),
+        true /* parallel */);
+    sweep.SaveTable();
   }
 
   void SaveHosekRmseTable(const MeasuredAtmospheres &measurements,
                           const std::vector<Angle> &sun_zenith, const std::vector<Angle> &sun_azimuth,
                           Wavelength min_wavelength, Wavelength max_wavelength)
   {
-    std::ifstream input(Comparisons::GetOutputDir() + "hosek_rmse.txt");
-    if (input)
-    {
-      input.close();
-    }
-    else
-    {
-      std::cout << "Computing Hosek RMSE table..." << std::endl;
-      std::ofstream output(Comparisons::GetOutputDir() + "hosek_rmse.txt");
-      for (double turbidity = 2.0; turbidity <= 4.0; turbidity += 0.01)
-      {
-        SpectralRadiance rmse = Comparisons("", Hosek(turbidity), measurements,
-                                            min_wavelength, max_wavelength)
-                                    .ComputeTotalRmse(
-                                        sun_zenith, sun_azimuth);
-        output << turbidity << " "
-               << rmse.to(1e-3 * watt_per_square_meter_per_sr_per_nm)
-               << std::endl;
-      }
-      output.close();
-    }
+    std::cout << "Computing Hosek RMSE table..." << std::endl;
+    ParameterSweep sweep({{2.0, 4.0, 0.01}},
+                         Comparisons::GetOutputDir() + "hosek_rmse.txt",
+                         ParameterSweep::GetInputsFingerprint(
+                             measurements, min_wavelength, max_wavelength));
+    sweep.Run(
+        ParameterSweep::TotalRmseCost(
+            [](const ParameterSweep::Point &p) {
+              return std::unique_ptr<Atmosphere>(new Hosek(p[0]));
+            },
+            measurements, sun_zenith, sun_azimuth, min_wavelength,
+            max_wavelength),
+        true /* parallel */);
+    sweep.SaveTable();
   }
 
   void SaveRadiances(const Comparisons &comparisons,
@@ -334,18 +284,7 @@ namespace
     {
       if (i == 9)
       {
-        for (int x = 0; x < 9; ++x)
-        {
-          for (int y = 0; y < 9; ++y)
-          {
-            Angle view_zenith;
-            Angle view_azimuth;
-            HemisphericalFunction<Number>::GetSampleDirection(
-                x, y, &view_zenith, &view_azimuth);
-            comparisons.PlotRadiance(name[i], sun_zenith[i], sun_azimuth[i],
-                                     view_zenith, view_azimuth);
-          }
-        }
+        comparisons.PlotSampleRadiances(name[i], sun_zenith[i], sun_azimuth[i]);
       }
       else
       {
@@ -378,91 +317,81 @@ namespace
         "morning", sun_direction.zenith * deg, 30.0 * deg, white_balance);
   }
 
-  void SaveComparisons(const Comparisons &comparisons,
-                       const std::vector<std::string> &name, const std::vector<Angle> &sun_zenith,
-                       const std::vector<Angle> &sun_azimuth, Location measurement_location,
-                       Time measurement_date, bool save_radiances, bool is_measurement)
+  // The measurements and settings shared by all the model comparisons.
+  struct ComparisonInputs
   {
-    if (!is_measurement)
-    {
-      std::cout << "Computing sun illuminance attenuation..." << std::endl;
-      comparisons.PlotSunIlluminanceAttenuation();
-
-      SaveSkyImages(comparisons, measurement_location, measurement_date,
-                    false /* white_balance */);
-    }
+    const MeasuredAtmospheres *measured;
+    Wavelength min_wavelength;
+    Wavelength max_wavelength;
+    std::vector<std::string> name;
+    std::vector<Angle> sun_zenith;
+    std::vector<Angle> sun_azimuth;
+    Location measurement_location;
+    Time measurement_time;
+  };
 
+  // The results of the comparisons for each measurement, indexed like the
+  // measurements, and saved in this order once all of them are computed.
+  struct ComparisonResults
+  {
     std::vector<Luminance> zenith_luminance;
     std::vector<Irradiance> sun_irradiance;
     std::vector<Irradiance> sky_irradiance;
-    int count = 0;
-    auto error_square_sum = 0.0 * watt_per_square_meter_per_sr_per_nm *
-                            watt_per_square_meter_per_sr_per_nm;
-    auto error_square_sum_with_approximate_spectrum = error_square_sum;
-    for (int i : kIndices)
+    std::vector<SpectralRadiance> rmse;
+    std::vector<SpectralRadiance> rmse_with_approximate_spectrum;
+  };
+
+  void SaveMeasurementComparisons(const Comparisons &comparisons, int i,
+                                  const ComparisonInputs &inputs, bool save_radiances,
+                                  bool is_measurement, ComparisonResults *results)
+  {
+    const std::vector<std::string> &name = inputs.name;
+    const std::vector<Angle> &sun_zenith = inputs.sun_zenith;
+    const std::vector<Angle> &sun_azimuth = inputs.sun_azimuth;
+    if (save_radiances)
     {
-      std::cout << (i + 1) << "/" << sizeof(kIndices) / sizeof(kIndices[0]) << std::endl;
-      if (save_radiances)
+      if (i == 9)
       {
-        std::cout << "Computing radiance..." << std::endl;
-        if (i == 9)
-        {
-          for (int x = 0; x < 9; ++x)
-          {
-            for (int y = 0; y < 9; ++y)
-            {
-              Angle view_zenith;
-              Angle view_azimuth;
-              HemisphericalFunction<Number>::GetSampleDirection(
-                  x, y, &view_zenith, &view_azimuth);
-              comparisons.PlotRadiance(name[i], sun_zenith[i], sun_azimuth[i],
-                                       view_zenith, view_azimuth);
-            }
-          }
-        }
-        else
-        {
-          for (int j = 0; j < kNumViewSamples; ++j)
-          {
-            Angle view_zenith = kViewZenithSamples[j] * deg;
-            Angle view_azimuth = kViewAzimuthSamples[j] * deg;
-            comparisons.PlotRadiance(name[i], sun_zenith[i], sun_azimuth[i],
-                                     view_zenith, view_azimuth);
-          }
-        }
+        comparisons.PlotSampleRadiances(name[i], sun_zenith[i], sun_azimuth[i]);
       }
-      std::cout << "Computing luminance and image..." << std::endl;
-      comparisons.RenderLuminanceAndImage(name[i], sun_zenith[i], sun_azimuth[i]);
-      std::cout << "Computing luminance profile..." << std::endl;
-      comparisons.PlotLuminanceProfile(name[i], sun_zenith[i], sun_azimuth[i]);
-      if (!is_measurement)
+      else
       {
-        std::cout << "Computing relative error..." << std::endl;
-        SpectralRadiance rmse_with_approximate_spectrum;
-        SpectralRadiance rmse = comparisons.PlotRelativeError(name[i],
-                                                              sun_zenith[i], sun_azimuth[i], &rmse_with_approximate_spectrum);
-        count += 1;
-        error_square_sum += rmse * rmse;
-        error_square_sum_with_approximate_spectrum +=
-            rmse_with_approximate_spectrum * rmse_with_approximate_spectrum;
+        for (int j = 0; j < kNumViewSamples; ++j)
+        {
+          Angle view_zenith = kViewZenithSamples[j] * deg;
+          Angle view_azimuth = kViewAzimuthSamples[j] * deg;
+          comparisons.PlotRadiance(name[i], sun_zenith[i], sun_azimuth[i],
+                                   view_zenith, view_azimuth);
+        }
       }
-      std::cout << "Computing zenith luminance..." << std::endl;
-      zenith_luminance.push_back(
-          comparisons.ComputeZenithLuminance(sun_zenith[i]));
-      std::cout << "Computing irradiance..." << std::endl;
-      Irradiance sun, sky;
-      comparisons.ComputeIrradiance(sun_zenith[i], &sun, &sky);
-      sun_irradiance.push_back(sun);
-      sky_irradiance.push_back(sky);
     }
-    std::cout << "Computing sunrise luminance and image..." << std::endl;
+    comparisons.RenderLuminanceAndImage(name[i], sun_zenith[i], sun_azimuth[i]);
+    comparisons.PlotLuminanceProfile(name[i], sun_zenith[i], sun_azimuth[i]);
+    if (!is_measurement)
+    {
+      results->rmse[i] = comparisons.PlotRelativeError(name[i],
+                                                       sun_zenith[i], sun_azimuth[i],
+                                                       &results->rmse_with_approximate_spectrum[i]);
+    }
+    results->zenith_luminance[i] =
+        comparisons.ComputeZenithLuminance(sun_zenith[i]);
+    comparisons.ComputeIrradiance(sun_zenith[i], &results->sun_irradiance[i],
+                                  &results->sky_irradiance[i]);
+  }
+
+  void SaveDayComparisons(const Comparisons &comparisons,
+                          const ComparisonInputs &inputs, bool is_measurement,
+                          const ComparisonResults &results)
+  {
+    Time measurement_date = inputs.measurement_time;
     for (int i = 0; i < 3; ++i)
     {
       int minutes = (6 + i) * 60;
       measurement_date.hours = minutes / 60 + 4;
       measurement_date.minutes = minutes % 60;
       SunCoordinates sun_direction;
-      GetSunDirection(measurement_date, measurement_location, &sun_direction);
+      GetSunDirection(measurement_date, inputs.measurement_location,
+                      &sun_direction);
       std::string name = ToString(minutes / 60) + "h" + ToString(minutes % 60);
       if (is_measurement)
       {
@@ -477,34 +406,143 @@ namespace
       }
     }
 
-    comparisons.PlotDayZenithLuminance(sun_zenith, zenith_luminance);
-    comparisons.PlotDayIrradiance(sun_zenith, sun_irradiance, sky_irradiance);
+    comparisons.PlotDayZenithLuminance(inputs.sun_zenith,
+                                       results.zenith_luminance);
+    comparisons.PlotDayIrradiance(inputs.sun_zenith, results.sun_irradiance,
+                                  results.sky_irradiance);
     if (!is_measurement)
     {
+      int count = 0;
+      auto error_square_sum = 0.0 * watt_per_square_meter_per_sr_per_nm *
+                              watt_per_square_meter_per_sr_per_nm;
+      auto error_square_sum_with_approximate_spectrum = error_square_sum;
+      for (int i : kIndices)
+      {
+        count += 1;
+        error_square_sum += results.rmse[i] * results.rmse[i];
+        error_square_sum_with_approximate_spectrum +=
+            results.rmse_with_approximate_spectrum[i] *
+            results.rmse_with_approximate_spectrum[i];
+      }
+
       SpectralRadiance rmse = sqrt(error_square_sum / count);
       double rounded_rmse =
           round(rmse.to(1e-4 * watt_per_square_meter_per_sr_per_nm)) / 10.0;
       std::ofstream file_percent(Comparisons::GetOutputDir() +
                                  "error_total_" + comparisons.name() + ".txt");
       file_percent << rounded_rmse << std::endl;
-      std::cout << "Error total (rmse) = " << rounded_rmse << std::endl;
+      std::cout << comparisons.name() << " error total (rmse) = "
+                << rounded_rmse << std::endl;
       file_percent.close();
-    }
-    if (!is_measurement)
-    {
+
       SpectralRadiance rmse_with_approximate_spectrum =
           sqrt(error_square_sum_with_approximate_spectrum / count);
-      double rounded_rmse = round(rmse_with_approximate_spectrum.to(
-                                1e-4 * watt_per_square_meter_per_sr_per_nm)) /
-                            10.0;
-      std::ofstream file_percent(Comparisons::GetOutputDir() +
-                                 "error_total_with_approximate_spectrum_" + comparisons.name() + ".txt");
+      rounded_rmse = round(rmse_with_approximate_spectrum.to(
+                               1e-4 * watt_per_square_meter_per_sr_per_nm)) /
+                     10.0;
+      file_percent.open(Comparisons::GetOutputDir() +
+                        "error_total_with_approximate_spectrum_" + comparisons.name() + ".txt");
       file_percent << rounded_rmse << std::endl;
-      std::cout << "Error total (rmse) = " << rounded_rmse << std::endl;
+      std::cout << comparisons.name() << " error total (rmse) = "
+                << rounded_rmse << std::endl;
       file_percent.close();
     }
   }
 
+  // The state shared by the tasks comparing a model with the measurements.
+  struct ComparisonState
+  {
+    std::shared_ptr<const Atmosphere> atmosphere;
+    std::unique_ptr<Comparisons> comparisons;
+    ComparisonResults results;
+  };
+
+  typedef std::function<std::shared_ptr<const Atmosphere>()> AtmosphereFactory;
+
+  // Adds the tasks comparing the model created by 'factory' with the
+  // measurements: a task creating the model, one task per measurement, and a
+  // task saving the results for the whole day and deleting the model. Returns
+  // the id of the last task. Models caching data for the last sun zenith angle
+  // are not thread-safe across measurements, and must use an exclusive group.
+  // 'memory' is an estimate of the model's memory footprint, in MB, which is
+  // held from the creation of the model to its deletion.
+  int AddComparisonTasks(TaskGraph *graph, const std::string &model_name,
+                         AtmosphereFactory factory, const ComparisonInputs &inputs,
+                         bool save_radiances, bool is_measurement,
+                         const std::string &exclusive_group, double memory)
+  {
+    std::shared_ptr<ComparisonState> state = std::make_shared<ComparisonState>();
+    const int num_measurements = inputs.name.size();
+    state->results.zenith_luminance.resize(num_measurements);
+    state->results.sun_irradiance.resize(num_measurements);
+    state->results.sky_irradiance.resize(num_measurements);
+    state->results.rmse.resize(num_measurements);
+    state->results.rmse_with_approximate_spectrum.resize(num_measurements);
+
+    const ComparisonInputs *in = &inputs;
+    int init = graph->AddTask(
+        model_name + "/init",
+        [state, model_name, factory, in, is_measurement]()
+        {
+          state->atmosphere = factory();
+          state->comparisons.reset(new Comparisons(model_name, *state->atmosphere,
+                                                   *in->measured, in->min_wavelength,
+                                                   in->max_wavelength));
+          if (!is_measurement)
+          {
+            state->comparisons->PlotSunIlluminanceAttenuation();
+            SaveSkyImages(*state->comparisons, in->measurement_location,
+                          in->measurement_time, false /* white_balance */);
+          }
+        },
+        {}, exclusive_group, memory);
+
+    std::vector<int> measurement_tasks;
+    for (int i : kIndices)
+    {
+      measurement_tasks.push_back(graph->AddTask(
+          model_name + "/" + inputs.name[i],
+          [state, i, in, save_radiances, is_measurement]()
+          {
+            SaveMeasurementComparisons(*state->comparisons, i, *in,
+                                       save_radiances, is_measurement,
+                                       &state->results);
+          },
+          {init}, exclusive_group));
+    }
+
+    const int day = graph->AddTask(
+        model_name + "/day",
+        [state, in, is_measurement]()
+        {
+          SaveDayComparisons(*state->comparisons, *in, is_measurement,
+                             state->results);
+          state->comparisons.reset();
+          state->atmosphere.reset();
+        },
+        measurement_tasks, exclusive_group);
+    graph->HoldMemoryUntil(init, day);
+    return day;
+  }
+
+  // Adds a task saving the radiances of the model created by 'factory'.
+  int AddRadianceTask(TaskGraph *graph, const std::string &model_name,
+                      AtmosphereFactory factory, const ComparisonInputs &inputs,
+                      const std::string &exclusive_group, double memory)
+  {
+    const ComparisonInputs *in = &inputs;
+    return graph->AddTask(
+        model_name,
+        [model_name, factory, in]()
+        {
+          std::shared_ptr<const Atmosphere> atmosphere = factory();
+          SaveRadiances(Comparisons(model_name, *atmosphere, *in->measured,
+                                    in->min_wavelength, in->max_wavelength),
+                        in->name, in->sun_zenith, in->sun_azimuth);
+        },
+        {}, exclusive_group, memory);
+  }
+
   void SaveSolarSpectrum()
   {
     IrradianceSpectrum solar = SolarSpectrum();
@@ -660,7 +698,7 @@ namespace
     }
   }
 
-  void SavePlot(const std::vector<MeasuredAtmosphere *> &measurements,
+  void SavePlot(const std::vector<const MeasuredAtmosphere *> &measurements,
                 const std::vector<std::string> &names,
                 const std::vector<Angle> &sun_zenith,
                 const std::vector<Angle> &sun_azimuth)
@@ -1031,18 +1069,302 @@ namespace
     file.close();
   }
 
+  // Saves the task timings and the profiling reports in the given directory.
+  void SaveReports(const TaskGraph &graph, const std::string &directory)
+  {
+    graph.SaveTimingReport(directory + "task_timing.txt");
+    profiling::WriteChromeTrace(directory + "profile_trace.json");
+    profiling::WriteFoldedStacks(directory + "profile_stacks.txt");
+    std::ofstream profile_summary(directory + "profile_summary.txt");
+    profiling::PrintSummary(profile_summary);
+    profile_summary.close();
+  }
+
+  // The name of a worker process, unique across the machines sharing a queue.
+  std::string GetWorkerName(pid_t pid)
+  {
+    char host_name[256] = {0};
+    gethostname(host_name, sizeof(host_name) - 1);
+    return std::string(host_name) + "_" + std::to_string(pid);
+  }
+
+  // The name of the queue job running the given independent set of tasks.
+  // Names are prefixed with the set index, so that the jobs are claimed in the
+  // order in which the tasks were added.
+  std::string GetJobName(const TaskGraph &graph, const std::vector<int> &set,
+                         int set_index)
+  {
+    std::string name = std::to_string(set_index);
+    name = std::string(name.size() < 4 ? 4 - name.size() : 0, '0') + name +
+           "_" + graph.name(set[0]);
+    std::replace(name.begin(), name.end(), '/', '_');
+    return name;
+  }
+
+  // Runs the jobs of the queue, until there is no pending job. Each job runs an
+  // independent set of tasks of the graph (which must be the same as in the
+  // coordinator), with 'num_threads' threads and 'max_memory' MB, while a
+  // background thread renews its lease. The outputs are saved directly in the
+  // output directory, and the task timings and profiling reports in the queue.
+  // Returns false if a job is unknown.
+  bool RunWorker(TaskGraph *graph, const std::string &queue_directory,
+                 unsigned int num_threads, double max_memory)
+  {
+    TaskQueue queue(queue_directory);
+    const std::string worker = GetWorkerName(getpid());
+    const std::vector<std::vector<int>> sets = graph->GetIndependentSets();
+    std::map<std::string, int> set_indices;
+    for (unsigned int i = 0; i < sets.size(); ++i)
+    {
+      set_indices[GetJobName(*graph, sets[i], i)] = i;
+    }
+
+    std::string job;
+    while (queue.Claim(worker, &job))
+    {
+      std::cout << worker << " running " << job << "..." << std::endl;
+      auto it = set_indices.find(job);
+      if (it == set_indices.end())
+      {
+        std::cerr << "Unknown job " << job
+                  << " (the coordinator uses a different version?)"
+                  << std::endl;
+        return false;
+      }
+      std::mutex mutex;
+      std::condition_variable condition;
+      bool job_done = false;
+      bool lease_lost = false;
+      std::thread lease_renewer(
+          [&]()
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!lease_lost &&
+                   !condition.wait_for(
+                       lock, std::chrono::seconds(kJobLeaseRenewalSeconds),
+                       [&job_done]() { return job_done; }))
+            {
+              lease_lost = !queue.Renew(worker, job);
+            }
+          });
+      graph->RunTasks(sets[it->second], num_threads, max_memory);
+      // The job is done only when its images are saved.
+      PngWriter::Default().Wait();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        job_done = true;
+      }
+      condition.notify_one();
+      lease_renewer.join();
+      // If the lease expired (e.g. if this worker was suspended), the job may
+      // be run by another worker, which must complete it.
+      if (lease_lost || !queue.Complete(worker, job))
+      {
+        std::cerr << worker << " lost the lease of " << job
+                  << ", not completed" << std::endl;
+      }
+    }
+    SaveReports(*graph, queue.GetReportDirectory(worker));
+    return true;
+  }
+
+  // Starts a local worker process, running this program with the given
+  // arguments.
+  pid_t StartWorker(const char *program, const std::vector<std::string> &args)
+  {
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      std::vector<char *> argv;
+      argv.push_back(const_cast<char *>(program));
+      for (const std::string &arg : args)
+      {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+      }
+      argv.push_back(nullptr);
+      execv(program, argv.data());
+      std::cerr << "Can't start worker " << program << std::endl;
+      _exit(1);
+    }
+    return pid;
+  }
+
+  // Concatenates the given report of all the workers in the output directory.
+  void MergeReports(const TaskQueue &queue, const std::string &report_name)
+  {
+    std::ofstream output(Comparisons::GetOutputDir() + report_name);
+    for (const std::string &worker : queue.GetReportingWorkers())
+    {
+      std::ifstream input(queue.GetReportDirectory(worker) + report_name);
+      if (report_name != "profile_stacks.txt")
+      {
+        output << "# worker " << worker << std::endl;
+      }
+      output << input.rdbuf();
+    }
+    output.close();
+  }
+
+  // Splits the tasks of the graph into independent sets, adds one job per set
+  // in the queue, and waits until all the jobs are done, by 'num_workers' local
+  // worker processes and by any number of workers started on other machines
+  // sharing the queue directory (and the working directory). Local workers
+  // which fail are not restarted, but their jobs are put back in the queue, as
+  // well as the jobs whose lease expired (e.g. if a remote worker died).
+  // Finally, merges the task timings and profiling reports of the workers in
+  // the output directory. Returns false if some jobs could not be done.
+  bool RunCoordinator(const TaskGraph &graph,
+                      const std::string &queue_directory, int num_workers,
+                      const char *program,
+                      const std::vector<std::string> &worker_args)
+  {
+    TaskQueue queue(queue_directory);
+    const std::vector<std::vector<int>> sets = graph.GetIndependentSets();
+    std::vector<std::string> jobs;
+    for (unsigned int i = 0; i < sets.size(); ++i)
+    {
+      jobs.push_back(GetJobName(graph, sets[i], i));
+    }
+    if (!queue.Reset(jobs))
+    {
+      std::cerr << "Can't create the queue in " << queue_directory
+                << std::endl;
+      return false;
+    }
+    std::cout << jobs.size() << " jobs queued in " << queue_directory
+              << std::endl;
+
+    std::vector<pid_t> workers;
+    for (int i = 0; i < num_workers; ++i)
+    {
+      workers.push_back(StartWorker(program, worker_args));
+    }
+    int num_done = 0;
+    while ((num_done = queue.num_done()) < static_cast<int>(jobs.size()))
+    {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      const int num_expired = queue.RequeueExpired(kJobLeaseSeconds);
+      if (num_expired > 0)
+      {
+        std::cerr << num_expired << " job(s) requeued after their lease expired"
+                  << std::endl;
+      }
+      for (pid_t &worker : workers)
+      {
+        int status;
+        if (worker <= 0 || waitpid(worker, &status, WNOHANG) != worker)
+        {
+          continue;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+          std::cerr << "Worker " << GetWorkerName(worker) << " failed, "
+                    << queue.Requeue(GetWorkerName(worker))
+                    << " job(s) requeued" << std::endl;
+        }
+        worker = 0;
+      }
+      if (num_workers > 0 &&
+          std::count(workers.begin(), workers.end(), 0) == num_workers &&
+          queue.num_done() < static_cast<int>(jobs.size()))
+      {
+        std::cerr << "All the local workers stopped with "
+                  << jobs.size() - queue.num_done() << " job(s) not done"
+                  << std::endl;
+        return false;
+      }
+    }
+    for (pid_t worker : workers)
+    {
+      if (worker > 0)
+      {
+        waitpid(worker, nullptr, 0);
+      }
+    }
+
+    MergeReports(queue, "task_timing.txt");
+    MergeReports(queue, "profile_summary.txt");
+    MergeReports(queue, "profile_stacks.txt");
+    for (const std::string &worker : queue.GetReportingWorkers())
+    {
+      std::ifstream input(queue.GetReportDirectory(worker) +
+                          "profile_trace.json");
+      std::ofstream output(Comparisons::GetOutputDir() + "profile_trace_" +
+                           worker + ".json");
+      output << input.rdbuf();
+    }
+    return true;
+  }
+
 } // anonymous namespace
 
 int main(int argc, char **argv)
 {
-  if (argc < 2)
+  // With --coordinator, the comparisons are split into jobs which are run by
+  // worker processes (started with --worker, locally with --workers, or on
+  // other machines sharing the queue and working directories).
+  std::string coordinator_queue;
+  std::string worker_queue;
+  int num_workers = 0;
+  unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg(argv[i]);
+    if ((arg == "--coordinator" || arg == "--worker" || arg == "--workers" ||
+         arg == "--threads") &&
+        i + 1 < argc)
+    {
+      const std::string value(argv[++i]);
+      if (arg == "--coordinator")
+        coordinator_queue = value;
+      else if (arg == "--worker")
+        worker_queue = value;
+      else if (arg == "--workers")
+        num_workers = std::max(0, std::stoi(value));
+      else
+        num_threads = std::max(1, std::stoi(value));
+    }
+    else
+    {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.size() != 2 ||
+      (!coordinator_queue.empty() && !worker_queue.empty()) ||
+      (num_workers > 0 && coordinator_queue.empty()))
   {
     std::cerr << "Usage: " << argv[0]
+              << " [--coordinator <queue path> [--workers <N>] |"
+              << " --worker <queue path>] [--threads <N>]"
               << " <libRatran uvspec path> <libRadtran data path>" << std::endl;
     return -1;
   }
-  const std::string libradtran_uvspec(argv[1]);
-  const std::string libradtran_data(argv[2]);
+  const std::string libradtran_uvspec(paths[0]);
+  const std::string libradtran_data(paths[1]);
+  const bool is_worker = !worker_queue.empty();
+  if (is_worker)
+  {
+    // The coordinator compiles the measurement dataset before queuing jobs.
+    TaskQueue queue(worker_queue);
+    while (!queue.IsReady())
+    {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+  }
+  // The profiling scopes are coarse (tasks, precomputations, images), so they
+  // are always recorded. See the profile_* files in the output directory.
+  profiling::SetEnabled(true);
+
+  // The task graph threads, and the other threads started by RunJobs, use at
+  // most 'num_threads' cores (plus the ones of the threads calling RunJobs).
+  // The memory budget is reduced in proportion when not all the cores are used
+  // (e.g. by each of several local workers).
+  SetMaxJobThreads(num_threads - 1);
+  const double max_memory =
+      kMaxComparisonMemory *
+      std::min(1.0, static_cast<double>(num_threads) /
+                        std::max(1u, std::thread::hardware_concurrency()));
 
   // The measurements were made at Cornell University, Frank H.T. Rhodes Hall,
   // in 2013/05/27.
@@ -1058,8 +1380,8 @@ int main(int argc, char **argv)
   std::vector<std::string> name;
   std::vector<Angle> sun_zenith;
   std::vector<Angle> sun_azimuth;
-  std::vector<MeasuredAtmosphere *> measurements;
-  MeasuredAtmospheres measured;
+  std::vector<const MeasuredAtmosphere *> measurements;
+  std::vector<MeasurementDataset::Source> sources;
   for (int i = 0; i < kNumMeasurements; ++i)
   {
     int minutes = 9 * 60 + 30 + i * 15;
@@ -1068,19 +1390,40 @@ int main(int argc, char **argv)
     measurement_time.seconds = 0;
     SunCoordinates sun_direction;
     GetSunDirection(measurement_time, measurement_location, &sun_direction);
-    MeasuredAtmosphere *atmosphere = new MeasuredAtmosphere(
-        "input", "2013-05-27", ToString(minutes / 60), ToString(minutes % 60),
-        sun_direction.zenith * deg, sun_direction.azimuth * deg,
-        "output/cache/input");
+    MeasurementDataset::Source source;
+    source.directory = "input";
+    source.date = "2013-05-27";
+    source.hour = ToString(minutes / 60);
+    source.minutes = ToString(minutes % 60);
+    source.sun_zenith = sun_direction.zenith * deg;
+    source.sun_azimuth = sun_direction.azimuth * deg;
+    sources.push_back(source);
     name.push_back(ToString(minutes / 60) + "h" + ToString(minutes % 60));
-    sun_zenith.push_back(atmosphere->sun_zenith());
-    sun_azimuth.push_back(atmosphere->sun_azimuth());
-    measurements.push_back(atmosphere);
-    measured.AddAtmosphere(atmosphere);
-    std::ofstream sza(
-        Comparisons::GetOutputDir() + "sza_" + name.back() + ".txt");
-    sza << round(sun_direction.zenith) << std::endl;
-    sza.close();
+    if (!is_worker)
+    {
+      std::ofstream sza(
+          Comparisons::GetOutputDir() + "sza_" + name.back() + ".txt");
+      sza << round(sun_direction.zenith) << std::endl;
+      sza.close();
+    }
+  }
+
+  // The measurement text files are parsed only once (or again if they change),
+  // and packed into a single dataset file which is then memory mapped.
+  const std::string dataset_file_name = "output/cache/input/2013-05-27.kider";
+  if (!MeasurementDataset::IsUpToDate(sources, dataset_file_name))
+  {
+    MeasurementDataset::Compile(sources, "output/cache/input",
+                                dataset_file_name);
+  }
+  MeasuredAtmospheres measured;
+  measured.AddDatasets({dataset_file_name});
+  for (int i = 0; i < measured.num_measurements(); ++i)
+  {
+    const MeasuredAtmosphere &atmosphere = measured.GetMeasurement(i);
+    sun_zenith.push_back(atmosphere.sun_zenith());
+    sun_azimuth.push_back(atmosphere.sun_azimuth());
+    measurements.push_back(&atmosphere);
   }
 
   // The Hosek model does not support wavelengths larger than 720 nm. This is
@@ -1092,188 +1435,237 @@ int main(int argc, char **argv)
   const Wavelength min_wavelength = 360.0 * nm;
   const Wavelength max_wavelength = 720.0 * nm;
 
-  double start_time = 0.0;
-
-  SaveLibRadtranRmseTable(libradtran_uvspec, measured, sun_zenith, sun_azimuth,
-                          min_wavelength, max_wavelength);
-  SaveZenithLuminanceRmseTable(measured, sun_zenith, min_wavelength,
-                               max_wavelength);
-  SavePreethamRmseTable(measured, sun_zenith, sun_azimuth, min_wavelength,
-                        max_wavelength);
-  SaveHosekRmseTable(measured, sun_zenith, sun_azimuth, min_wavelength,
-                     max_wavelength);
-
-
-  std::cout << std::endl << "Taylor model..." << std::endl;
-  SaveComparisons(Comparisons("taylor", Taylor(), measured,
-                              min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, true, false);
-
+  ComparisonInputs inputs;
+  inputs.measured = &measured;
+  inputs.min_wavelength = min_wavelength;
+  inputs.max_wavelength = max_wavelength;
+  inputs.name = name;
+  inputs.sun_zenith = sun_zenith;
+  inputs.sun_azimuth = sun_azimuth;
+  inputs.measurement_location = measurement_location;
+  inputs.measurement_time = measurement_time;
+
+  // The (model, measurement) comparisons are independent and run concurrently,
+  // except for models caching data for the last sun zenith angle (Haber), and
+  // for the variants of a model sharing the same files on disk (in
+  // output/libradtran and output/cache/{bruneton,haber,nishita}), which use one
+  // exclusive group per model. The memory estimates are in MB.
+  TaskGraph graph;
+  graph.AddTask(
+      "rmse_tables/libradtran",
+      [&]()
+      {
+        SaveLibRadtranRmseTable(libradtran_uvspec, measured, sun_zenith,
+                                sun_azimuth, min_wavelength, max_wavelength);
+      },
+      {}, "libradtran", 0.0);
+  graph.AddTask(
+      "rmse_tables/zenith_luminance",
+      [&]()
+      {
+        SaveZenithLuminanceRmseTable(measured, sun_zenith, min_wavelength,
+                                     max_wavelength);
+      },
+      {}, "", 0.0);
+  graph.AddTask(
+      "rmse_tables/preetham",
+      [&]()
+      {
+        SavePreethamRmseTable(measured, sun_zenith, sun_azimuth,
+                              min_wavelength, max_wavelength);
+      },
+      {}, "", 0.0);
+  graph.AddTask(
+      "rmse_tables/hosek",
+      [&]()
+      {
+        SaveHosekRmseTable(measured, sun_zenith, sun_azimuth, min_wavelength,
+                           max_wavelength);
+      },
+      {}, "", 0.0);
+  AddComparisonTasks(
+      &graph, "taylor",
+      []() { return std::make_shared<Taylor>(); },
+      inputs, true, false, "", 0.0);
+  AddComparisonTasks(
+      &graph, "spline",
+      []() { return std::make_shared<Spline>(); },
+      inputs, true, false, "", 0.0);
+  AddComparisonTasks(
+      &graph, "trapezoidal",
+      []() { return std::make_shared<Trapezoidal>(); },
+      inputs, true, false, "", 0.0);
+  AddComparisonTasks(
+      &graph, "nishita93",
+      []() { return std::make_shared<Nishita93>(); },
+      inputs, true, false, "", 0.0);
+  AddComparisonTasks(
+      &graph, "nishita96",
+      []() { return std::make_shared<Nishita96>(Nishita96::ALL_ORDERS); },
+      inputs, true, false, "nishita96", 400.0);
+  AddComparisonTasks(
+      &graph, "preetham",
+      []() { return std::make_shared<Preetham>(Turbidity); },
+      inputs, true, false, "", 0.0);
+  AddComparisonTasks(
+      &graph, "oneal",
+      []() { return std::make_shared<ONeal>(); },
+      inputs, true, false, "", 0.0);
+  AddComparisonTasks(
+      &graph, "haber",
+      []() { return std::make_shared<Haber>(Haber::ALL_ORDERS); },
+      inputs, true, false, "haber", 200.0);
+  AddComparisonTasks(
+      &graph, "bruneton",
+      []()
+      {
+        return std::make_shared<Bruneton>(Bruneton::SINGLE_SCATTERING_ONLY, 3);
+      },
+      inputs, true, false, "bruneton", 100.0);
+  AddComparisonTasks(
+      &graph, "elek",
+      []()
+      {
+        return std::make_shared<Bruneton>(Bruneton::SINGLE_SCATTERING_ONLY, 15);
+      },
+      inputs, true, false, "bruneton", 100.0);
+  graph.AddTask(
+      "elek_whitebalance",
+      [&inputs]()
+      {
+        Bruneton elek(Bruneton::SINGLE_SCATTERING_ONLY, 15);
+        SaveSkyImages(Comparisons("elek_whitebalance", elek, *inputs.measured,
+                                  inputs.min_wavelength, inputs.max_wavelength),
+                      inputs.measurement_location, inputs.measurement_time,
+                      true /* white_balance */);
+      },
+      {}, "bruneton", 100.0);
+  AddComparisonTasks(
+      &graph, "hosek",
+      []() { return std::make_shared<Hosek>(Turbidity); },
+      inputs, true, false, "", 0.0);
+
+  AddRadianceTask(
+      &graph, "libradtran",
+      [&libradtran_uvspec]()
+      {
+        return std::make_shared<LibRadtran>(
+            libradtran_uvspec, LibRadtran::HEMISPHERICAL_FUNCTION_CACHE);
+      },
+      inputs, "libradtran", 0.0);
+  AddRadianceTask(
+      &graph, "libradtran_no_ground_albedo",
+      [&libradtran_uvspec]()
+      {
+        return std::make_shared<LibRadtran>(
+            libradtran_uvspec, MieAngstromAlpha, MieAngstromBeta,
+            MiePhaseFunctionG, false /* ground_albedo */,
+            LibRadtran::HEMISPHERICAL_FUNCTION_CACHE);
+      },
+      inputs, "libradtran", 0.0);
+  AddComparisonTasks(
+      &graph, "libradtran",
+      [&libradtran_uvspec]()
+      {
+        return std::make_shared<LibRadtran>(
+            libradtran_uvspec, LibRadtran::BINARY_FUNCTION_CACHE);
+      },
+      inputs, false, false, "libradtran", 0.0);
+
+  AddComparisonTasks(
+      &graph, "measurements",
+      [&measured]()
+      {
+        // Not owned.
+        return std::shared_ptr<const Atmosphere>(&measured,
+                                                 [](const Atmosphere *) {});
+      },
+      inputs, true, true, "", 0.0);
+
+  // Single and double scattering comparisons.
+  AddRadianceTask(
+      &graph, "nishita96_ss",
+      []()
+      {
+        return std::make_shared<Nishita96>(Nishita96::SINGLE_SCATTERING_ONLY);
+      },
+      inputs, "nishita96", 400.0);
+  AddRadianceTask(
+      &graph, "haber_ss",
+      []() { return std::make_shared<Haber>(Haber::SINGLE_SCATTERING_ONLY); },
+      inputs, "haber", 200.0);
+  AddRadianceTask(
+      &graph, "bruneton_ss",
+      []()
+      {
+        return std::make_shared<Bruneton>(Bruneton::SINGLE_SCATTERING_ONLY, 3);
+      },
+      inputs, "bruneton", 100.0);
+  AddRadianceTask(
+      &graph, "nishita96_ds",
+      []()
+      {
+        return std::make_shared<Nishita96>(Nishita96::DOUBLE_SCATTERING_ONLY);
+      },
+      inputs, "nishita96", 400.0);
+  AddRadianceTask(
+      &graph, "haber_ds",
+      []() { return std::make_shared<Haber>(Haber::DOUBLE_SCATTERING_ONLY); },
+      inputs, "haber", 200.0);
+  AddRadianceTask(
+      &graph, "bruneton_ds",
+      []()
+      {
+        return std::make_shared<Bruneton>(Bruneton::DOUBLE_SCATTERING_ONLY, 3);
+      },
+      inputs, "bruneton", 100.0);
+
+  // Polarization effect evaluation.
+  graph.AddTask(
+      "polradtran",
+      [&]()
+      {
+        PolRadtran polarized(libradtran_uvspec, libradtran_data, true);
+        Comparisons polradtran_vector("polradtran_vector", polarized, measured,
+                                      min_wavelength, max_wavelength);
+        polradtran_vector.RenderLuminanceAndImage("sza30", 30.0 * deg, 90.0 * deg);
+
+        PolRadtran non_polarized(libradtran_uvspec, libradtran_data, false);
+        Comparisons polradtran_scalar("polradtran_scalar", non_polarized, measured,
+                                      min_wavelength, max_wavelength);
+        polradtran_scalar.RenderLuminanceAndImage("sza30", 30.0 * deg, 90.0 * deg);
+        polradtran_scalar.PlotRelativeError("sza30", polarized, 30.0 * deg,
+                                            90.0 * deg);
+      },
+      {}, "libradtran", 0.0);
+
+  if (is_worker)
   {
-  std::cout << std::endl
-            << "Spline model..." << std::endl;
-  
-  auto start_time_spline_init = Timer::getTime();
-  auto spline_atmo = std::make_shared<Spline>();
-  std::cout << "Splines init time [s] = " << Timer::getTime() - start_time_spline_init << std::endl;
-
-  auto start_time_spline = Timer::getTime();
-
-  SaveComparisons(Comparisons("spline", *spline_atmo, measured,
-                              min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, true, false);
-
-  std::cout << "Splines time [s] = " << Timer::getTime() - start_time_spline << std::endl;
+    return RunWorker(&graph, worker_queue, num_threads, max_memory) ? 0 : -1;
+  }
+  else if (!coordinator_queue.empty())
+  {
+    // The local workers share the cores of this machine.
+    const unsigned int num_worker_threads =
+        std::max(1u, num_threads / std::max(1, num_workers));
+    std::vector<std::string> worker_args = {
+        "--worker", coordinator_queue, "--threads",
+        std::to_string(num_worker_threads), libradtran_uvspec, libradtran_data};
+    if (!RunCoordinator(graph, coordinator_queue, num_workers, argv[0],
+                        worker_args))
+    {
+      return -1;
+    }
   }
-  
-  std::cout << std::endl
-            << "Trapezoidal model..." << std::endl;
-
-  auto start_time_trap = Timer::getTime();
-
-  SaveComparisons(Comparisons("trapezoidal", Trapezoidal(), measured,
-                              min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, true, false);
-
-  std::cout << "Trapezoidal time [s] = " << Timer::getTime() - start_time_trap << std::endl;
-
-  std::cout << std::endl
-            << "Nishita93 model..." << std::endl;
-  SaveComparisons(Comparisons("nishita93", Nishita93(), measured,
-                              min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, true, false);
-
-  std::cout << std::endl
-            << "Nishita96 model..." << std::endl;
-  SaveComparisons(Comparisons("nishita96", Nishita96(Nishita96::ALL_ORDERS),
-                              measured, min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, true, false);
-
-  std::cout << std::endl
-            << "Preetham model..." << std::endl;
-  SaveComparisons(Comparisons("preetham", Preetham(Turbidity), measured,
-                              min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, true, false);
-
-  std::cout << std::endl
-            << "O'Neal model..." << std::endl;
-  SaveComparisons(Comparisons("oneal", ONeal(), measured, min_wavelength,
-                              max_wavelength),
-                  name, sun_zenith, sun_azimuth, measurement_location,
-                  measurement_time, true, false);
-
-  std::cout << std::endl
-            << "Haber model..." << std::endl;
-  SaveComparisons(Comparisons("haber", Haber(Haber::ALL_ORDERS), measured,
-                              min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, true, false);
-
-  std::cout << std::endl << "Bruneton model..." << std::endl;
-  
-  start_time = Timer::getTime();
-
-  SaveComparisons(Comparisons("bruneton", Bruneton(Bruneton::SINGLE_SCATTERING_ONLY, 3),
-                              measured, min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, true, false);
-
-  std::cout << "Bruneton's time [s] = " << Timer::getTime() - start_time << std::endl;
-
-  std::cout << std::endl
-            << "Elek model..." << std::endl;
-  SaveComparisons(Comparisons("elek", Bruneton(Bruneton::SINGLE_SCATTERING_ONLY, 15),
-                              measured, min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, true, false);
-  SaveSkyImages(
-      Comparisons("elek_whitebalance", Bruneton(Bruneton::SINGLE_SCATTERING_ONLY, 15),
-                  measured, min_wavelength, max_wavelength),
-      measurement_location,
-      measurement_time, true /* white_balance */);
-
-  std::cout << std::endl
-            << "Hosek model..." << std::endl;
-  SaveComparisons(Comparisons("hosek", Hosek(Turbidity), measured,
-                              min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, true, false);
-
-  std::cout << std::endl
-            << "libRadtran model..." << std::endl;
-  SaveRadiances(Comparisons("libradtran",
-                            LibRadtran(libradtran_uvspec, LibRadtran::HEMISPHERICAL_FUNCTION_CACHE),
-                            measured, min_wavelength, max_wavelength),
-                name, sun_zenith, sun_azimuth);
-
-  SaveRadiances(Comparisons("libradtran_no_ground_albedo",
-                            LibRadtran(libradtran_uvspec, MieAngstromAlpha, MieAngstromBeta,
-                                       MiePhaseFunctionG, false /* ground_albedo */,
-                                       LibRadtran::HEMISPHERICAL_FUNCTION_CACHE),
-                            measured, min_wavelength, max_wavelength),
-                name, sun_zenith, sun_azimuth);
-
-  SaveComparisons(Comparisons("libradtran",
-                              LibRadtran(libradtran_uvspec, LibRadtran::BINARY_FUNCTION_CACHE),
-                              measured, min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, false, false);
-
-  SaveComparisons(Comparisons("measurements", measured, measured,
-                              min_wavelength, max_wavelength),
-                  name, sun_zenith, sun_azimuth,
-                  measurement_location, measurement_time, true, true);
-
-  std::cout << std::endl
-            << "Single scattering comparisons..." << std::endl;
-  SaveRadiances(Comparisons("nishita96_ss",
-                            Nishita96(Nishita96::SINGLE_SCATTERING_ONLY),
-                            measured, min_wavelength, max_wavelength),
-                name, sun_zenith, sun_azimuth);
-  SaveRadiances(Comparisons("haber_ss",
-                            Haber(Haber::SINGLE_SCATTERING_ONLY),
-                            measured, min_wavelength, max_wavelength),
-                name, sun_zenith, sun_azimuth);
-  SaveRadiances(Comparisons("bruneton_ss",
-                            Bruneton(Bruneton::SINGLE_SCATTERING_ONLY, 3),
-                            measured, min_wavelength, max_wavelength),
-                name, sun_zenith, sun_azimuth);
-
-  std::cout << std::endl
-            << "Double scattering comparisons..." << std::endl;
-  SaveRadiances(Comparisons("nishita96_ds",
-                            Nishita96(Nishita96::DOUBLE_SCATTERING_ONLY),
-                            measured, min_wavelength, max_wavelength),
-                name, sun_zenith, sun_azimuth);
-  SaveRadiances(Comparisons("haber_ds",
-                            Haber(Haber::DOUBLE_SCATTERING_ONLY),
-                            measured, min_wavelength, max_wavelength),
-                name, sun_zenith, sun_azimuth);
-  SaveRadiances(Comparisons("bruneton_ds",
-                            Bruneton(Bruneton::DOUBLE_SCATTERING_ONLY, 3),
-                            measured, min_wavelength, max_wavelength),
-                name, sun_zenith, sun_azimuth);
-
-  std::cout << std::endl
-            << "Polarization effect evaluation..." << std::endl;
+  else
   {
-    PolRadtran polarized(libradtran_uvspec, libradtran_data, true);
-    Comparisons polradtran_vector("polradtran_vector", polarized, measured,
-                                  min_wavelength, max_wavelength);
-    polradtran_vector.RenderLuminanceAndImage("sza30", 30.0 * deg, 90.0 * deg);
-
-    PolRadtran non_polarized(libradtran_uvspec, libradtran_data, false);
-    Comparisons polradtran_scalar("polradtran_scalar", non_polarized, measured,
-                                  min_wavelength, max_wavelength);
-    polradtran_scalar.RenderLuminanceAndImage("sza30", 30.0 * deg, 90.0 * deg);
-    polradtran_scalar.PlotRelativeError("sza30", polarized, 30.0 * deg,
-                                        90.0 * deg);
+    std::cout << std::endl
+              << "Model comparisons (" << graph.num_tasks() << " tasks)..."
+              << std::endl;
+    graph.Run(num_threads, max_memory);
+    // The images are saved in background threads, by Comparisons.
+    PngWriter::Default().Wait();
+    SaveReports(graph, Comparisons::GetOutputDir());
   }
 
   SaveSolarSpectrum();
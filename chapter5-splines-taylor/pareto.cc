@@ -0,0 +1,330 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "atmosphere/atmosphere.h"
+#include "atmosphere/comparisons.h"
+#include "atmosphere/measurement/measured_atmospheres.h"
+#include "atmosphere/model/bruneton/bruneton.h"
+#include "atmosphere/model/hosek/hosek.h"
+#include "atmosphere/model/libradtran/libradtran.h"
+#include "atmosphere/model/nishita/nishita93.h"
+#include "atmosphere/model/oneal/oneal.h"
+#include "atmosphere/model/preetham/preetham.h"
+#include "atmosphere/model/spline/spline.h"
+#include "atmosphere/model/taylor/taylor.h"
+#include "atmosphere/model/trapezoidal/trapezoidal.h"
+#include "atmosphere/parameter_sweep.h"
+#include "math/angle.h"
+#include "physics/units.h"
+#include "util/benchmark.h"
+#include "util/pareto.h"
+
+namespace
+{
+
+  typedef ParameterSweep::Point Point;
+
+  // A method whose configurations are explored. They are the points of a
+  // regular grid with the given axes (a single point for the methods without
+  // parameters). The numbers of samples are swept with their base 2 logarithm.
+  struct Method
+  {
+    std::string name;
+    std::vector<SweepAxis> axes;
+    ParameterSweep::AtmosphereFactory create;
+    // Returns the parameter values of a configuration, without spaces.
+    std::function<std::string(const Point &p)> describe;
+  };
+
+  uint32_t Pow2(double log2)
+  {
+    return 1u << static_cast<int>(std::lround(log2));
+  }
+
+  std::string ToString(double value)
+  {
+    return std::to_string(std::lround(value));
+  }
+
+  Method FixedMethod(const std::string &name,
+                     std::function<Atmosphere *()> create)
+  {
+    return {name, {{0.0, 0.0, 1.0}},
+            [create](const Point &)
+            { return std::unique_ptr<Atmosphere>(create()); },
+            [](const Point &) { return std::string(); }};
+  }
+
+  // The LUT resolutions of the Bruneton and Elek models are compile time
+  // constants, so these models only have one configuration.
+  std::vector<Method> GetMethods()
+  {
+    return {
+        {"taylor", {{3.0, 10.0, 1.0}},
+         [](const Point &p)
+         { return std::unique_ptr<Atmosphere>(new Taylor(Pow2(p[0]))); },
+         [](const Point &p)
+         { return "samples=" + std::to_string(Pow2(p[0])); }},
+        {"trapezoidal", {{2.0, 8.0, 1.0}, {3.0, 8.0, 1.0}},
+         [](const Point &p)
+         {
+           return std::unique_ptr<Atmosphere>(
+               new Trapezoidal(Pow2(p[0]), Pow2(p[1])));
+         },
+         [](const Point &p)
+         {
+           return "samples=" + std::to_string(Pow2(p[0])) +
+                  ",light_samples=" + std::to_string(Pow2(p[1]));
+         }},
+        {"spline", {{3.0, 10.0, 1.0}, {10.0, 50.0, 20.0}, {10.0, 30.0, 10.0}},
+         [](const Point &p)
+         {
+           return std::unique_ptr<Atmosphere>(new Spline(
+               Pow2(p[0]), 1, std::lround(p[1]), std::lround(p[2])));
+         },
+         [](const Point &p)
+         {
+           return "samples=" + std::to_string(Pow2(p[0])) +
+                  ",height_points=" + ToString(p[1]) +
+                  ",distance_points=" + ToString(p[2]);
+         }},
+        FixedMethod("nishita93", []() { return new Nishita93(); }),
+        FixedMethod("preetham", []() { return new Preetham(Turbidity); }),
+        FixedMethod("hosek", []() { return new Hosek(Turbidity); }),
+        FixedMethod("oneal", []() { return new ONeal(); }),
+        FixedMethod("bruneton",
+                    []()
+                    {
+                      return new Bruneton(Bruneton::SINGLE_SCATTERING_ONLY,
+                                          3);
+                    }),
+        FixedMethod("elek",
+                    []()
+                    {
+                      return new Bruneton(Bruneton::SINGLE_SCATTERING_ONLY,
+                                          15);
+                    }),
+    };
+  }
+
+  bool Contains(const std::vector<std::string> &list, const std::string &item)
+  {
+    for (const std::string &element : list)
+    {
+      if (element == item)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+} // anonymous namespace
+
+// Explores the accuracy versus cost trade-off of the models: sweeps their
+// numbers of samples and spline grid sizes, measures the mean color difference
+// (CIE76 Delta E) of each configuration with a reference (the measurements or
+// libRadtran) and its time per sky radiance query, and prints the Pareto
+// frontier of these configurations and the cheapest one meeting each Delta E
+// budget. The errors and the times are checkpointed in the output directory,
+// the times in files specific to the given platform name, so that the same
+// errors can be reused to compare several platforms.
+int main(int argc, char **argv)
+{
+  std::string reference_name = "measurements";
+  std::string libradtran_uvspec = "/usr/local/bin/uvspec";
+  std::string methods = "";
+  std::string platform = "host";
+  std::string max_delta_e = "1,2,3,5";
+  int stride = 4;
+  benchmark::Options options;
+  options.min_seconds = 0.05;
+  options.repetitions = 3;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      std::cerr << "Missing value for " << arg << std::endl;
+      return -1;
+    }
+    const char *value = argv[++i];
+    if (arg == "--reference")
+    {
+      reference_name = value;
+    }
+    else if (arg == "--uvspec")
+    {
+      libradtran_uvspec = value;
+    }
+    else if (arg == "--methods")
+    {
+      methods = value;
+    }
+    else if (arg == "--platform")
+    {
+      platform = value;
+    }
+    else if (arg == "--max-delta-e")
+    {
+      max_delta_e = value;
+    }
+    else if (arg == "--stride")
+    {
+      stride = std::max(1, std::atoi(value));
+    }
+    else if (arg == "--min-time")
+    {
+      options.min_seconds = std::atof(value);
+    }
+    else if (arg == "--repetitions")
+    {
+      options.repetitions = std::atoi(value);
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [--reference measurements|libradtran]"
+                << " [--uvspec uvspec path] [--methods taylor,spline,...]"
+                << " [--platform name] [--max-delta-e 1,2,3,5]"
+                << " [--stride N] [--min-time seconds] [--repetitions N]"
+                << std::endl;
+      return -1;
+    }
+  }
+
+  // The measurements dataset is compiled by clearskymodels.
+  const std::string dataset_file_name = "output/cache/input/2013-05-27.kider";
+  if (!std::ifstream(dataset_file_name).good())
+  {
+    std::cerr << "Can't open " << dataset_file_name
+              << ", run clearskymodels (make all) first." << std::endl;
+    return -1;
+  }
+  MeasuredAtmospheres measured;
+  measured.AddDatasets({dataset_file_name});
+  std::vector<Angle> sun_zenith;
+  std::vector<Angle> sun_azimuth;
+  for (int i = 0; i < measured.num_measurements(); i += stride)
+  {
+    sun_zenith.push_back(measured.GetMeasurement(i).sun_zenith());
+    sun_azimuth.push_back(measured.GetMeasurement(i).sun_azimuth());
+  }
+
+  std::unique_ptr<Atmosphere> reference;
+  if (reference_name == "libradtran")
+  {
+    reference.reset(new LibRadtran(libradtran_uvspec,
+                                   LibRadtran::HEMISPHERICAL_FUNCTION_CACHE));
+  }
+  else if (reference_name != "measurements")
+  {
+    std::cerr << "Unknown reference " << reference_name << std::endl;
+    return -1;
+  }
+
+  // Same wavelength range as in the comparisons (see main.cc).
+  const Wavelength min_wavelength = 360.0 * nm;
+  const Wavelength max_wavelength = 720.0 * nm;
+  const std::string output_dir = Comparisons::GetOutputDir();
+  const std::vector<std::string> method_names = benchmark::SplitList(methods);
+  // The errors depend on the measurements, and on the subset which is used.
+  const std::string inputs =
+      ParameterSweep::GetInputsFingerprint(measured, min_wavelength,
+                                           max_wavelength) +
+      "_stride_" + std::to_string(stride);
+
+  std::vector<pareto::Configuration> configurations;
+  for (const Method &method : GetMethods())
+  {
+    if (!method_names.empty() && !Contains(method_names, method.name))
+    {
+      continue;
+    }
+    std::cout << "Exploring " << method.name << "..." << std::endl;
+    // All the LibRadtran queries use the same files in output/libradtran, so
+    // they can't be made in parallel.
+    ParameterSweep error_sweep(method.axes,
+                               output_dir + "pareto_delta_e_" + method.name +
+                                   "_" + reference_name + ".txt",
+                               inputs);
+    error_sweep.Run(
+        ParameterSweep::MeanDeltaECost(method.create, measured,
+                                       reference.get(), sun_zenith,
+                                       sun_azimuth, min_wavelength,
+                                       max_wavelength),
+        !reference /* parallel */);
+    ParameterSweep time_sweep(method.axes,
+                              output_dir + "pareto_time_" + method.name + "_" +
+                                  platform + ".txt",
+                              "stride_" + std::to_string(stride));
+    time_sweep.Run(ParameterSweep::QueryTimeCost(method.create, sun_zenith,
+                                                 sun_azimuth, options),
+                   false /* parallel */);
+
+    // Both sweeps evaluated the whole grid, and return it in the same order.
+    const auto errors = error_sweep.GetResults();
+    const auto times = time_sweep.GetResults();
+    for (unsigned int i = 0; i < errors.size() && i < times.size(); ++i)
+    {
+      configurations.push_back({method.name,
+                                method.describe(errors[i].first),
+                                times[i].second, errors[i].second});
+    }
+  }
+
+  std::vector<double> budgets;
+  for (const std::string &budget : benchmark::SplitList(max_delta_e))
+  {
+    budgets.push_back(std::atof(budget.c_str()));
+  }
+  const std::string table_file_name =
+      output_dir + "pareto_" + reference_name + "_" + platform + ".txt";
+  if (!pareto::WriteTable(table_file_name, configurations, "ns_per_query",
+                          "delta_e"))
+  {
+    std::cerr << "Can't save file " << table_file_name << std::endl;
+    return -1;
+  }
+  pareto::PrintSummary(std::cout, configurations, budgets, "ns_per_query",
+                       "delta_e");
+  std::cout << "Configurations saved to " << table_file_name << std::endl;
+  return 0;
+}
@@ -30,6 +30,10 @@
 #include "physics/cie.h"
 
 #include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
 #include <vector>
 
 namespace {
@@ -218,6 +222,118 @@ const DimensionlessSpectrum S0(360.0 * nm, 830.0 * nm, tables.S0_samples);
 const DimensionlessSpectrum S1(360.0 * nm, 830.0 * nm, tables.S1_samples);
 const DimensionlessSpectrum S2(360.0 * nm, 830.0 * nm, tables.S2_samples);
 
+// See GetSrgbColorsAndLuminances in cie.h.
+class ColorMatrix {
+ public:
+  typedef dimensional::Scalar<0, 1, 0, -1, 1> Weight;
+  static constexpr int kNumSamples = RadianceSpectrum::SIZE;
+
+  // Computes the matrix weights by linearity, with the same integrals as in
+  // the original conversion functions applied to each basis spectrum. This
+  // ensures that the integration rules (including the interpolation of the
+  // spectrum samples for a custom wavelength range) are exactly the same.
+  template<typename IntegralFunction>
+  explicit ColorMatrix(IntegralFunction integral) {
+    constexpr SpectralRadiance kUnit = watt_per_square_meter_per_sr_per_nm;
+    for (int i = 0; i < kNumSamples; ++i) {
+      RadianceSpectrum basis_spectrum(0.0 * kUnit);
+      basis_spectrum[i] = 1.0 * kUnit;
+      Color XYZ = Color(
+          MaxLuminousEfficacy * integral(x_bar * basis_spectrum),
+          MaxLuminousEfficacy * integral(y_bar * basis_spectrum),
+          MaxLuminousEfficacy * integral(z_bar * basis_spectrum));
+      Color RGB = XYZ_to_sRGB * XYZ;
+      weights_[0][i] = RGB.x / kUnit;
+      weights_[1][i] = RGB.y / kUnit;
+      weights_[2][i] = RGB.z / kUnit;
+      weights_[3][i] = XYZ.y / kUnit;
+    }
+  }
+
+  Luminance GetLuminance(const RadianceSpectrum& spectrum) const {
+    return Dot(weights_[3], spectrum);
+  }
+
+  Color GetSrgbColor(const RadianceSpectrum& spectrum) const {
+    return Clamp(Color(Dot(weights_[0], spectrum), Dot(weights_[1], spectrum),
+        Dot(weights_[2], spectrum)));
+  }
+
+  // Computes the 4 matrix rows in a single pass over the spectrum samples.
+  Color GetSrgbColorAndLuminance(const RadianceSpectrum& spectrum,
+      Luminance* luminance) const {
+    Luminance r = 0.0 * cd_per_square_meter;
+    Luminance g = 0.0 * cd_per_square_meter;
+    Luminance b = 0.0 * cd_per_square_meter;
+    Luminance y = 0.0 * cd_per_square_meter;
+    for (int i = 0; i < kNumSamples; ++i) {
+      r = r + weights_[0][i] * spectrum[i];
+      g = g + weights_[1][i] * spectrum[i];
+      b = b + weights_[2][i] * spectrum[i];
+      y = y + weights_[3][i] * spectrum[i];
+    }
+    *luminance = y;
+    return Clamp(Color(r, g, b));
+  }
+
+ private:
+  static Luminance Dot(const Weight* weights,
+      const RadianceSpectrum& spectrum) {
+    Luminance sum = 0.0 * cd_per_square_meter;
+    for (int i = 0; i < kNumSamples; ++i) {
+      sum = sum + weights[i] * spectrum[i];
+    }
+    return sum;
+  }
+
+  static Color Clamp(const Color& RGB) {
+    return Color(
+        std::max(RGB.x, 0.0 * cd_per_square_meter),
+        std::max(RGB.y, 0.0 * cd_per_square_meter),
+        std::max(RGB.z, 0.0 * cd_per_square_meter));
+  }
+
+  Weight weights_[4][kNumSamples];
+};
+
+constexpr int ColorMatrix::kNumSamples;
+
+const ColorMatrix& GetDefaultColorMatrix() {
+  static const ColorMatrix matrix([](const RadianceSpectrum& f) {
+    return Integral(f);
+  });
+  return matrix;
+}
+
+// Returns the matrix for a custom wavelength range and number of wavelengths.
+// The matrices are computed on demand and never deleted. Each thread keeps a
+// pointer to the last one it used, to avoid locking the global cache for each
+// conversion.
+const ColorMatrix& GetColorMatrix(Wavelength min_wavelength,
+    Wavelength max_wavelength, int number_of_wavelengths) {
+  typedef std::tuple<double, double, int> Key;
+  static std::mutex mutex;
+  static std::map<Key, std::unique_ptr<const ColorMatrix>> matrices;
+  thread_local Key last_key;
+  thread_local const ColorMatrix* last_matrix = nullptr;
+
+  Key key(min_wavelength.to(nm), max_wavelength.to(nm), number_of_wavelengths);
+  if (last_matrix != nullptr && key == last_key) {
+    return *last_matrix;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  std::unique_ptr<const ColorMatrix>& matrix = matrices[key];
+  if (!matrix) {
+    matrix.reset(new ColorMatrix([&](const RadianceSpectrum& f) {
+      return Integral(f, min_wavelength, max_wavelength,
+          number_of_wavelengths);
+    }));
+  }
+  last_key = key;
+  last_matrix = matrix.get();
+  return *matrix;
+}
+
 }  // anonymous namespace
 
 const DimensionlessSpectrum& cie_x_bar_function() { return x_bar; }
@@ -229,31 +345,27 @@ const DimensionlessSpectrum& S1_function() { return S1; }
 const DimensionlessSpectrum& S2_function() { return S2; }
 
 Luminance GetLuminance(const RadianceSpectrum& spectrum) {
-  return MaxLuminousEfficacy * Integral(y_bar * spectrum);
+  return GetDefaultColorMatrix().GetLuminance(spectrum);
 }
 
 Color GetSrgbColor(const RadianceSpectrum& spectrum) {
-  Color RGB = XYZ_to_sRGB * Color(
-      MaxLuminousEfficacy * Integral(cie_x_bar_function() * spectrum),
-      MaxLuminousEfficacy * Integral(cie_y_bar_function() * spectrum),
-      MaxLuminousEfficacy * Integral(cie_z_bar_function() * spectrum));
-  return Color(
-      std::max(RGB.x, 0.0 * cd_per_square_meter),
-      std::max(RGB.y, 0.0 * cd_per_square_meter),
-      std::max(RGB.z, 0.0 * cd_per_square_meter));
+  return GetDefaultColorMatrix().GetSrgbColor(spectrum);
 }
 
 Color GetSrgbColor(const RadianceSpectrum& spectrum, Wavelength min_wavelength,
     Wavelength max_wavelength, int number_of_wavelengths) {
-  Color RGB = XYZ_to_sRGB * Color(
-      MaxLuminousEfficacy * Integral(cie_x_bar_function() * spectrum,
-          min_wavelength, max_wavelength, number_of_wavelengths),
-      MaxLuminousEfficacy * Integral(cie_y_bar_function() * spectrum,
-          min_wavelength, max_wavelength, number_of_wavelengths),
-      MaxLuminousEfficacy * Integral(cie_z_bar_function() * spectrum,
-          min_wavelength, max_wavelength, number_of_wavelengths));
-  return Color(
-      std::max(RGB.x, 0.0 * cd_per_square_meter),
-      std::max(RGB.y, 0.0 * cd_per_square_meter),
-      std::max(RGB.z, 0.0 * cd_per_square_meter));
+  return GetColorMatrix(min_wavelength, max_wavelength, number_of_wavelengths)
+      .GetSrgbColor(spectrum);
+}
+
+void GetSrgbColorsAndLuminances(const RadianceSpectrum* spectra,
+    unsigned int count, Color* colors, Luminance* luminances) {
+  const ColorMatrix& matrix = GetDefaultColorMatrix();
+  for (unsigned int i = 0; i < count; ++i) {
+    if (luminances == nullptr) {
+      colors[i] = matrix.GetSrgbColor(spectra[i]);
+    } else {
+      colors[i] = matrix.GetSrgbColorAndLuminance(spectra[i], &luminances[i]);
+    }
+  }
 }
@@ -59,6 +59,13 @@ const DimensionlessSpectrum& S0_function();
 const DimensionlessSpectrum& S1_function();
 const DimensionlessSpectrum& S2_function();
 
+// The functions below use precomputed matrices, with one row for each of the
+// linear sRGB components (before clamping to 0) and one for the luminance.
+// Each row contains the weights of the spectrum samples, such that the
+// integrals of the CIE color matching functions times the spectrum, and the
+// conversion from XYZ to sRGB, are replaced with a single 4x40 matrix-vector
+// product.
+
 // Converts the given radiance spectrum to a luminance value, using the relation
 //   L = MaxLuminousEfficacy * integral of cie_y_bar_function * spectrum
 Luminance GetLuminance(const RadianceSpectrum& spectrum);
@@ -73,4 +80,9 @@ Color GetSrgbColor(const RadianceSpectrum& spectrum);
 Color GetSrgbColor(const RadianceSpectrum& spectrum, Wavelength min_wavelength,
     Wavelength max_wavelength, int number_of_wavelengths);
 
+// Same as GetSrgbColor and GetLuminance, for 'count' spectra at once. The
+// luminances are not computed if 'luminances' is null.
+void GetSrgbColorsAndLuminances(const RadianceSpectrum* spectra,
+    unsigned int count, Color* colors, Luminance* luminances);
+
 #endif  // PHYSICS_CIE_H_
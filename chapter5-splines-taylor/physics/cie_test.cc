@@ -29,6 +29,7 @@
 */
 #include "physics/cie.h"
 
+#include <algorithm>
 #include <string>
 
 #include "test/test_case.h"
@@ -58,12 +59,62 @@ class TestCie : public dimensional::TestCase {
     ExpectNear(-4.65, S1_function()(595.0 * nm)(), kEps);
     ExpectNear(2.65, S2_function()(595.0 * nm)(), kEps);
   }
+
+  void TestColorMatrix() {
+    // A smooth spectrum, with a negative value to test the clamping.
+    RadianceSpectrum spectrum[2];
+    for (unsigned int i = 0; i < spectrum[0].size(); ++i) {
+      Number u = i / (spectrum[0].size() - 1.0);
+      spectrum[0][i] = (1.0 + 2.0 * u - u * u) *
+          watt_per_square_meter_per_sr_per_nm;
+      spectrum[1][i] = (u - 0.25) * watt_per_square_meter_per_sr_per_nm;
+    }
+    const Wavelength min_wavelength = 410.0 * nm;
+    const Wavelength max_wavelength = 700.0 * nm;
+    const int number_of_wavelengths = 15;
+    Color colors[2];
+    Luminance luminances[2];
+    GetSrgbColorsAndLuminances(spectrum, 2, colors, luminances);
+    for (int k = 0; k < 2; ++k) {
+      // Reference values, computed with the original integrals.
+      Color RGB = XYZ_to_sRGB * Color(
+          MaxLuminousEfficacy * Integral(cie_x_bar_function() * spectrum[k]),
+          MaxLuminousEfficacy * Integral(cie_y_bar_function() * spectrum[k]),
+          MaxLuminousEfficacy * Integral(cie_z_bar_function() * spectrum[k]));
+      Luminance Y =
+          MaxLuminousEfficacy * Integral(cie_y_bar_function() * spectrum[k]);
+      ExpectColorNear(RGB, GetSrgbColor(spectrum[k]));
+      ExpectColorNear(RGB, colors[k]);
+      ExpectNear(Y, GetLuminance(spectrum[k]), 1e-9 * cd_per_square_meter);
+      ExpectNear(Y, luminances[k], 1e-9 * cd_per_square_meter);
+
+      RGB = XYZ_to_sRGB * Color(
+          MaxLuminousEfficacy * Integral(cie_x_bar_function() * spectrum[k],
+              min_wavelength, max_wavelength, number_of_wavelengths),
+          MaxLuminousEfficacy * Integral(cie_y_bar_function() * spectrum[k],
+              min_wavelength, max_wavelength, number_of_wavelengths),
+          MaxLuminousEfficacy * Integral(cie_z_bar_function() * spectrum[k],
+              min_wavelength, max_wavelength, number_of_wavelengths));
+      ExpectColorNear(RGB, GetSrgbColor(spectrum[k], min_wavelength,
+          max_wavelength, number_of_wavelengths));
+    }
+  }
+
+ private:
+  void ExpectColorNear(const Color& unclamped_expected, const Color& actual) {
+    const Luminance kZero = 0.0 * cd_per_square_meter;
+    const Luminance kEps = 1e-9 * cd_per_square_meter;
+    ExpectNear(std::max(unclamped_expected.x, kZero), actual.x, kEps);
+    ExpectNear(std::max(unclamped_expected.y, kZero), actual.y, kEps);
+    ExpectNear(std::max(unclamped_expected.z, kZero), actual.z, kEps);
+  }
 };
 
 namespace {
 
 TestCie colorfunctions("colorfunctions", &TestCie::TestColorFunctions);
 TestCie sfunctions("sfunctions", &TestCie::TestSFunctions);
+TestCie colormatrix("colormatrix", &TestCie::TestColorMatrix);
 
 }  // anonymous namespace
 
@@ -0,0 +1,153 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+    /* Nearest rank percentile of sorted values, p in [0, 100] */
+    double percentile(const std::vector<double>& sorted_values, double p)
+    {
+        if (sorted_values.empty())
+        {
+            return 0.0;
+        }
+
+        size_t rank = static_cast<size_t>(glm::ceil(p / 100.0 * sorted_values.size()));
+        return sorted_values[glm::clamp<size_t>(rank, 1, sorted_values.size()) - 1];
+    }
+
+    /* Writes the statistics of the values multiplied by scale, by default from seconds to milliseconds */
+    void writeStats(std::ostream& out, std::vector<double> values, double scale = 1e3)
+    {
+        std::sort(values.begin(), values.end());
+
+        double sum = 0.0;
+        for (double value : values)
+        {
+            sum += value;
+        }
+
+        double mean = values.empty() ? 0.0 : sum / values.size();
+
+        out << "{ \"mean\": " << scale * mean
+            << ", \"min\": "  << scale * (values.empty() ? 0.0 : values.front())
+            << ", \"p50\": "  << scale * percentile(values, 50.0)
+            << ", \"p95\": "  << scale * percentile(values, 95.0)
+            << ", \"p99\": "  << scale * percentile(values, 99.0)
+            << ", \"max\": "  << scale * (values.empty() ? 0.0 : values.back())
+            << " }";
+    }
+
+    template<typename Getter>
+    std::vector<double> collect(const std::vector<FrameStats>& frame_stats, Getter getter)
+    {
+        std::vector<double> values;
+        values.reserve(frame_stats.size());
+
+        for (const auto& stats : frame_stats)
+        {
+            values.push_back(getter(stats));
+        }
+
+        return values;
+    }
+}
+
+SceneSettings interpolateScenePath(const std::vector<SceneSettings>& key_frames, double t)
+{
+    if (key_frames.size() < 2)
+    {
+        return key_frames.empty() ? SceneSettings() : key_frames.front();
+    }
+
+    double x = glm::clamp(t, 0.0, 1.0) * (key_frames.size() - 1);
+    size_t i = glm::min(static_cast<size_t>(x), key_frames.size() - 2);
+    double a = x - i;
+
+    const SceneSettings& k0 = key_frames[i];
+    const SceneSettings& k1 = key_frames[i + 1];
+
+    SceneSettings scene;
+    scene.cam_position = glm::mix(k0.cam_position, k1.cam_position, a);
+    scene.cam_angles   = glm::mix(k0.cam_angles,   k1.cam_angles,   a);
+    scene.sun_angles   = glm::mix(k0.sun_angles,   k1.sun_angles,   a);
+
+    return scene;
+}
+
+bool saveBenchmarkReport(const BenchmarkResult& result, const std::string& file_name)
+{
+    std::ofstream out(file_name);
+
+    if (!out)
+    {
+        std::cerr << "Unable to write the benchmark report to " << file_name << std::endl;
+        return false;
+    }
+
+    const auto& frame_stats = result.frame_stats;
+    size_t num_frames       = frame_stats.size();
+    size_t num_bands        = num_frames > 0 ? frame_stats.front().band_times.size() : 0;
+
+    /* Ratio of the slowest band of rows to the mean one, 1 if the work is evenly balanced */
+    auto band_imbalance = collect(frame_stats, [](const FrameStats& stats)
+    {
+        double sum = 0.0, max = 0.0;
+        for (double time : stats.band_times)
+        {
+            sum += time;
+            max  = glm::max(max, time);
+        }
+
+        return sum > 0.0 ? max * stats.band_times.size() / sum : 1.0;
+    });
+
+    out << std::setprecision(6);
+    out << "{\n";
+    out << "  \"model\": \"" << result.model << "\",\n";
+    out << "  \"width\": " << result.width << ",\n";
+    out << "  \"height\": " << result.height << ",\n";
+    out << "  \"threads\": " << num_bands << ",\n";
+    out << "  \"warmup_frames\": " << result.warmup_frames << ",\n";
+    out << "  \"foreground\": " << (result.foreground ? "true" : "false") << ",\n";
+    out << "  \"covered_fraction\": " << result.covered_fraction << ",\n";
+    out << "  \"frames\": " << num_frames << ",\n";
+    out << "  \"total_time_s\": " << result.total_time << ",\n";
+    out << "  \"fps\": " << (result.total_time > 0.0 ? num_frames / result.total_time : 0.0) << ",\n";
+    out << "  \"mpixels_per_s\": " << (result.total_time > 0.0 ? 1e-6 * num_frames * result.width * result.height / result.total_time : 0.0) << ",\n";
+    out << "  \"frame_time_ms\": ";
+    writeStats(out, collect(frame_stats, [](const FrameStats& stats) { return stats.total; }));
+    out << ",\n";
+    out << "  \"stages_ms\": {\n";
+    out << "    \"prepass\": ";
+    writeStats(out, collect(frame_stats, [](const FrameStats& stats) { return stats.prepass; }));
+    out << ",\n";
+    out << "    \"sky_cache\": ";
+    writeStats(out, collect(frame_stats, [](const FrameStats& stats) { return stats.sky_cache; }));
+    out << ",\n";
+    out << "    \"dispatch\": ";
+    writeStats(out, collect(frame_stats, [](const FrameStats& stats) { return stats.dispatch; }));
+    out << ",\n";
+    out << "    \"raytrace\": ";
+    writeStats(out, collect(frame_stats, [](const FrameStats& stats) { return stats.raytrace; }));
+    out << ",\n";
+    out << "    \"join\": ";
+    writeStats(out, collect(frame_stats, [](const FrameStats& stats) { return stats.join; }));
+    out << "\n";
+    out << "  },\n";
+    out << "  \"band_imbalance\": ";
+    writeStats(out, band_imbalance, 1.0);
+    out << ",\n";
+    out << "  \"frame_times_ms\": [";
+    for (size_t i = 0; i < num_frames; ++i)
+    {
+        out << (i == 0 ? "" : ", ") << 1e3 * frame_stats[i].total;
+    }
+    out << "]\n";
+    out << "}\n";
+
+    return out.good();
+}
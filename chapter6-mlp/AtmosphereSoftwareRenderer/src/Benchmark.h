@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Foreground.h"
+#include "RenderContext.h"
+#include "Timing.h"
+#include "apps/FrameStats.h"
+
+struct SceneSettings
+{
+    glm::highp_dvec3 cam_position;
+    glm::highp_dvec2 cam_angles; // yaw, pitch
+    glm::highp_dvec2 sun_angles; // azimuth, elevation
+};
+
+struct BenchmarkSettings
+{
+    int         frames        = 200;
+    int         warmup_frames = 5;
+    std::string output_file   = "benchmark.json";
+    std::string frames_dir;   // if not empty, every measured frame is saved there as a PPM file
+    bool        foreground    = false; // draw the Foreground meshes before the sky, which skips the pixels they cover
+};
+
+struct BenchmarkResult
+{
+    std::string model;
+    int         width  = 0;
+    int         height = 0;
+    int         warmup_frames = 0;
+    double      total_time    = 0.0; // in seconds, without the warmup frames
+    bool        foreground       = false;
+    double      covered_fraction = 0.0; // fraction of the pixels covered by the foreground in the first frame
+
+    std::vector<FrameStats> frame_stats;
+};
+
+/* Camera and sun settings at t in [0, 1] on a path going linearly through the key frames */
+SceneSettings interpolateScenePath(const std::vector<SceneSettings>& key_frames, double t);
+
+/* Latency percentiles, throughput and per stage times of the frames, as JSON */
+bool saveBenchmarkReport(const BenchmarkResult& result, const std::string& file_name);
+
+/* Renders the frames of the benchmark offscreen, with any app having the AtmoNN / AtmoElek interface */
+template<typename App>
+BenchmarkResult runBenchmark(const std::string& model_name,
+                             App& app,
+                             RenderContext* target,
+                             const std::vector<SceneSettings>& path,
+                             const BenchmarkSettings& settings)
+{
+    BenchmarkResult result;
+    result.model         = model_name;
+    result.width         = target->getWidth();
+    result.height        = target->getHeight();
+    result.warmup_frames = settings.warmup_frames;
+    result.foreground    = settings.foreground;
+    result.frame_stats.reserve(settings.frames);
+
+    Foreground foreground;
+
+    float delta = 0.0f;
+    double start_time = 0.0;
+
+    for (int i = -settings.warmup_frames; i < settings.frames; ++i)
+    {
+        if (i == 0)
+        {
+            start_time = Time::getTime();
+        }
+
+        double t = settings.frames > 1 ? double(glm::max(i, 0)) / double(settings.frames - 1) : 0.0;
+        SceneSettings scene = interpolateScenePath(path, t);
+
+        app.setCameraPosition(scene.cam_position);
+        app.setCameraDir(scene.cam_angles.x, scene.cam_angles.y);
+        app.setSunDirection(scene.sun_angles.y, scene.sun_angles.x);
+
+        /* Depth prepass, the sky is only computed for the pixels left uncovered */
+        double prepass_time = 0.0;
+        if (settings.foreground)
+        {
+            double prepass_start_time = Time::getTime();
+            foreground.draw(target);
+            prepass_time = Time::getTime() - prepass_start_time;
+        }
+
+        app.updateAndRender(target, delta);
+        delta = static_cast<float>(prepass_time + app.getFrameStats().total);
+
+        if (i < 0)
+        {
+            continue;
+        }
+
+        if (i == 0)
+        {
+            result.covered_fraction = Foreground::getCoveredFraction(target);
+        }
+
+        result.frame_stats.push_back(app.getFrameStats());
+        result.frame_stats.back().prepass  = prepass_time;
+        result.frame_stats.back().total   += prepass_time;
+
+        if (!settings.frames_dir.empty())
+        {
+            char file_name[32];
+            snprintf(file_name, sizeof(file_name), "/frame_%05d.ppm", i);
+            target->saveToPPM(settings.frames_dir + file_name);
+        }
+    }
+
+    result.total_time = Time::getTime() - start_time;
+    return result;
+}
@@ -1,5 +1,7 @@
 #include "Bitmap.h"
+#include <fstream>
 #include <string>
+#include <vector>
 #include <glm/glm.hpp>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -75,3 +77,34 @@ void Bitmap::copyPixel(int dst_x, int dst_y, int src_x, int src_y, const Bitmap
 
     m_pixel_components[dst_index] = ((r & 0xFF) << 24) + ((g & 0xFF) << 16) + ((b & 0xFF) << 8) + (a & 0xFF);
 }
+
+
+bool Bitmap::saveToPPM(const std::string& file_name) const
+{
+    std::ofstream file(file_name, std::ios::binary);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    file << "P6\n" << m_width << " " << m_height << "\n255\n";
+
+    std::vector<unsigned char> row(m_width * 3);
+
+    for (int y = 0; y < m_height; ++y)
+    {
+        for (int x = 0; x < m_width; ++x)
+        {
+            Uint32 comp = m_pixel_components[x + y * m_width];
+
+            row[x * 3 + 0] = (comp >> 24) & 0xFF;
+            row[x * 3 + 1] = (comp >> 16) & 0xFF;
+            row[x * 3 + 2] = (comp >> 8)  & 0xFF;
+        }
+
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    return file.good();
+}
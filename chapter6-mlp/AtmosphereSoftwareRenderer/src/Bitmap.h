@@ -25,6 +25,8 @@ public:
                    const Bitmap* src,
                    float light_amt) const;
 
+    bool saveToPPM(const std::string& file_name) const;
+
     Uint32 getComponent(int index) const
     {
         return m_pixel_components[index]; 
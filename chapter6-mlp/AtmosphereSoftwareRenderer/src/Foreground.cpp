@@ -0,0 +1,67 @@
+#include "Foreground.h"
+
+#include <vector>
+#include <glm/glm.hpp>
+
+Foreground::Foreground()
+    : m_mountains(createMountains(128)),
+      m_texture  (1, 1)
+{
+    m_texture.drawPixel(0, 0, 58, 66, 62, 255);
+}
+
+void Foreground::draw(RenderContext* target) const
+{
+    target->clearDepthBuffer();
+
+    /* The vertices are already in clip space */
+    glm::mat4 identity(1.0f);
+    target->drawMesh(m_mountains, identity, identity, m_texture);
+}
+
+double Foreground::getCoveredFraction(const RenderContext* target)
+{
+    int width  = target->getWidth();
+    int height = target->getHeight();
+    int count  = 0;
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            count += target->isCoveredByGeometry(x, y) ? 1 : 0;
+        }
+    }
+
+    return width * height > 0 ? double(count) / double(width * height) : 0.0;
+}
+
+Mesh Foreground::createMountains(int num_columns)
+{
+    std::vector<Vertex> vertices;
+    std::vector<int>    indices;
+
+    glm::vec4 texcoords { 0.0f, 0.0f, 0.0f, 0.0f };
+    glm::vec4 normal    { 0.0f, 0.0f, 1.0f, 0.0f };
+
+    /* A bottom and a top vertex per column, the ridge line covers about the lower third of the screen */
+    for (int i = 0; i <= num_columns; ++i)
+    {
+        float x     = -1.0f + 2.0f * i / num_columns;
+        float ridge = -0.4f + 0.15f * glm::sin(3.1f * x) + 0.06f * glm::sin(11.3f * x + 1.0f) + 0.02f * glm::sin(37.0f * x);
+
+        vertices.push_back(Vertex({ x, -1.0f, 0.5f, 1.0f }, texcoords, normal));
+        vertices.push_back(Vertex({ x, ridge, 0.5f, 1.0f }, texcoords, normal));
+    }
+
+    /* Two counter clockwise triangles per column */
+    for (int i = 0; i < num_columns; ++i)
+    {
+        int bottom = 2 * i, top = 2 * i + 1, next_bottom = 2 * i + 2, next_top = 2 * i + 3;
+
+        indices.insert(indices.end(), { bottom, next_bottom, next_top });
+        indices.insert(indices.end(), { bottom, next_top,    top      });
+    }
+
+    return Mesh(vertices, indices);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Bitmap.h"
+#include "Mesh.h"
+#include "RenderContext.h"
+
+/* A mountain range silhouette fixed in front of the camera, covering the bottom of the screen, drawn before the sky
+ * as a depth prepass: the sky pass then skips the pixels it covers (see RenderContext::isCoveredByGeometry) */
+class Foreground
+{
+public:
+    Foreground();
+
+    /* Clears the depth buffer and draws the meshes */
+    void draw(RenderContext* target) const;
+
+    /* Fraction of the pixels covered by the meshes drawn since the last clearDepthBuffer() call */
+    static double getCoveredFraction(const RenderContext* target);
+
+private:
+    static Mesh createMountains(int num_columns);
+
+    Mesh   m_mountains;
+    Bitmap m_texture;
+};
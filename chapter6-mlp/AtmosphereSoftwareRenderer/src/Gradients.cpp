@@ -9,12 +9,6 @@ Gradients::Gradients(const Vertex & min_y, const Vertex & mid_y, const Vertex &
 
     float one_over_dy = -one_over_dx;
 
-    m_texcoord_x = new float[3];
-    m_texcoord_y = new float[3];
-    m_one_over_z = new float[3];
-    m_depth      = new float[3];
-    m_light_amt  = new float[3];
-
     m_one_over_z[0] = 1.0f / min_y.m_pos.w;
     m_one_over_z[1] = 1.0f / mid_y.m_pos.w;;
     m_one_over_z[2] = 1.0f / max_y.m_pos.w;;
@@ -56,35 +50,7 @@ Gradients::Gradients(const Vertex & min_y, const Vertex & mid_y, const Vertex &
     m_light_amt_step_y  = calcStepY(m_light_amt,  min_y, mid_y, max_y, one_over_dy);
 }
 
-Gradients::~Gradients()
-{
-    if(m_texcoord_x != nullptr)
-    {
-        delete[] m_texcoord_x;
-    }
-
-    if (m_texcoord_y != nullptr)
-    {
-        delete[] m_texcoord_y;
-    }
-
-    if (m_one_over_z != nullptr)
-    {
-        delete[] m_one_over_z;
-    }
-
-    if (m_depth != nullptr)
-    {
-        delete[] m_depth;
-    }
-
-    if (m_light_amt != nullptr)
-    {
-        delete[] m_light_amt;
-    }
-}
-
-float Gradients::calcStepX(float * values, const Vertex & min_y, const Vertex & mid_y, const Vertex & max_y, float one_over_dx) const
+float Gradients::calcStepX(const float* values, const Vertex & min_y, const Vertex & mid_y, const Vertex & max_y, float one_over_dx) const
 {
     return (((values[1] - values[2]) *
              (min_y.m_pos.y - max_y.m_pos.y)) -
@@ -92,7 +58,7 @@ float Gradients::calcStepX(float * values, const Vertex & min_y, const Vertex &
              (mid_y.m_pos.y - max_y.m_pos.y))) * one_over_dx;
 }
 
-float Gradients::calcStepY(float* values, const Vertex& min_y, const Vertex& mid_y, const Vertex& max_y, float one_over_dy) const
+float Gradients::calcStepY(const float* values, const Vertex& min_y, const Vertex& mid_y, const Vertex& max_y, float one_over_dy) const
 {
     return (((values[1] - values[2]) *
              (min_y.m_pos.x - max_y.m_pos.x)) -
@@ -6,7 +6,6 @@ class Gradients
 {
 public:
     Gradients(const Vertex& min_y, const Vertex& mid_y, const Vertex& max_y);
-    ~Gradients();
 
     float getTexcoordX(int loc) const { return m_texcoord_x[loc]; }
     float getTexcoordY(int loc) const { return m_texcoord_y[loc]; }
@@ -26,11 +25,11 @@ public:
     float getLightAmtStepY()  const { return m_light_amt_step_y; }
 
 private:
-    float* m_texcoord_x;
-    float* m_texcoord_y;
-    float* m_one_over_z;
-    float* m_depth;
-    float* m_light_amt;
+    float m_texcoord_x[3];
+    float m_texcoord_y[3];
+    float m_one_over_z[3];
+    float m_depth[3];
+    float m_light_amt[3];
 
     float m_texcoord_xx_step;
     float m_texcoord_xy_step;
@@ -46,6 +45,6 @@ private:
     float m_light_amt_step_x;
     float m_light_amt_step_y;
 
-    float calcStepX(float* values, const Vertex& min_y, const Vertex& mid_y, const Vertex& max_y, float one_over_dx) const;
-    float calcStepY(float* values, const Vertex& min_y, const Vertex& mid_y, const Vertex& max_y, float one_over_dy) const;
+    float calcStepX(const float* values, const Vertex& min_y, const Vertex& mid_y, const Vertex& max_y, float one_over_dx) const;
+    float calcStepY(const float* values, const Vertex& min_y, const Vertex& mid_y, const Vertex& max_y, float one_over_dy) const;
 };
@@ -14,3 +14,9 @@ Mesh::Mesh(const std::string& file_name)
         m_indices = model.m_indices;
     }
 }
+
+Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<int>& indices)
+    : m_vertices(vertices),
+      m_indices (indices)
+{
+}
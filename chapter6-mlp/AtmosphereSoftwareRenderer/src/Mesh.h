@@ -7,6 +7,7 @@ class Mesh
 {
 public:
     explicit Mesh(const std::string& file_name);
+    Mesh(const std::vector<Vertex>& vertices, const std::vector<int>& indices);
 
     Vertex getVertex(int loc) const { return m_vertices[loc]; }
 
@@ -1,13 +1,22 @@
 ﻿#include "RenderContext.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <utility>
 #include "MathUtils.h"
 #include "Edge.h"
 
 RenderContext::RenderContext(int width, int height)
-    : Bitmap       (width, height)
+    : Bitmap       (width, height),
+      m_num_tiles_x((width  + TILE_SIZE - 1) / TILE_SIZE),
+      m_num_tiles_y((height + TILE_SIZE - 1) / TILE_SIZE),
+      m_num_threads(glm::max(1u, std::thread::hardware_concurrency()))
 {
     m_zbuffer = new float[m_width * m_height];
-    std::fill_n(m_zbuffer, m_width * m_height, 9999999999);
+    std::fill_n(m_zbuffer, m_width * m_height, FAR_DEPTH);
+
+    m_thread_triangles.resize(m_num_threads);
+    m_tile_bins.resize(m_num_tiles_x * m_num_tiles_y);
 }
 
 RenderContext::~RenderContext()
@@ -18,11 +27,36 @@ RenderContext::~RenderContext()
     }
 }
 
-void RenderContext::drawScanLine(const Edge& left, const Edge& right, int j, const Bitmap& texture) const
+RenderContext::ScreenTriangle::ScreenTriangle(const Vertex& min_y, const Vertex& mid_y, const Vertex& max_y, bool handedness)
+    : min_y     (min_y),
+      mid_y     (mid_y),
+      max_y     (max_y),
+      handedness(handedness),
+      gradients (min_y, mid_y, max_y)
+{
+    float min_x = glm::min(min_y.m_pos.x, glm::min(mid_y.m_pos.x, max_y.m_pos.x));
+    float max_x = glm::max(min_y.m_pos.x, glm::max(mid_y.m_pos.x, max_y.m_pos.x));
+
+    /* Scanlines and spans cover the pixels from ceil(start) to ceil(end) - 1 */
+    tile_min_x = glm::max(static_cast<int>(glm::ceil(min_x)), 0) / TILE_SIZE;
+    tile_min_y = glm::max(static_cast<int>(glm::ceil(min_y.m_pos.y)), 0) / TILE_SIZE;
+    tile_max_x = glm::max(static_cast<int>(glm::ceil(max_x)) - 1, 0) / TILE_SIZE;
+    tile_max_y = glm::max(static_cast<int>(glm::ceil(max_y.m_pos.y)) - 1, 0) / TILE_SIZE;
+}
+
+void RenderContext::drawScanLine(const Edge& left, const Edge& right, int j, const Tile& tile, const Bitmap& texture) const
 {
     int x_min = static_cast<int>(glm::ceil(left.getX()));
     int x_max = static_cast<int>(glm::ceil(right.getX()));
-  
+
+    int x_begin = glm::max(x_min, tile.min_x);
+    int x_end   = glm::min(x_max, tile.max_x);
+
+    if (x_begin >= x_end)
+    {
+        return;
+    }
+
     float x_prestep = x_min - left.getX();
 
     float x_dist = right.getX() - left.getX();
@@ -38,13 +72,25 @@ void RenderContext::drawScanLine(const Edge& left, const Edge& right, int j, con
     float depth = left.getDepth() + depth_step_x * x_prestep;
     float light_amt = left.getLightAmt() + depth_step_x * x_prestep;
 
-    for (int i = x_min; i < x_max; ++i)
+    /* Skip the part of the span left of the tile */
+    if (x_begin > x_min)
     {
-        int index = i + j * m_width;
+        float skip = static_cast<float>(x_begin - x_min);
+
+        texcoord_x += texcoord_xx_step * skip;
+        texcoord_y += texcoord_yx_step * skip;
+        one_over_z += one_over_z_step_x * skip;
+        depth      += depth_step_x * skip;
+        light_amt  += light_amt_step_x * skip;
+    }
+
+    float* depth_row = tile.depth + (j - tile.min_y) * tile.depth_stride;
 
-        if (depth < m_zbuffer[index])
+    for (int i = x_begin; i < x_end; ++i)
+    {
+        if (depth < depth_row[i - tile.min_x])
         {
-            m_zbuffer[index] = depth;
+            depth_row[i - tile.min_x] = depth;
 
             float z = 1.0f / one_over_z;
             int src_x = static_cast<int>(z * texcoord_x * (texture.getWidth() - 1) + 0.5f);
@@ -61,7 +107,7 @@ void RenderContext::drawScanLine(const Edge& left, const Edge& right, int j, con
     }
 }
 
-void RenderContext::scanEdges(Edge& a, Edge& b, bool handedness, const Bitmap& texture) const
+void RenderContext::scanEdges(Edge& a, Edge& b, bool handedness, const Tile& tile, const Bitmap& texture) const
 {
     Edge* left  = &a;
     Edge* right = &b;
@@ -74,49 +120,52 @@ void RenderContext::scanEdges(Edge& a, Edge& b, bool handedness, const Bitmap& t
     int y_start = b.getStart();
     int y_end   = b.getEnd();
 
+    /* Edge a continues in the next call, so it is stepped over all the rows, including the ones outside of the tile */
     for (int j = y_start; j < y_end; ++j)
     {
-        drawScanLine(*left, *right, j, texture);
+        if (j >= tile.min_y && j < tile.max_y)
+        {
+            drawScanLine(*left, *right, j, tile, texture);
+        }
+
         left->step();
         right->step();
     }
 }
 
-void RenderContext::scanTriangle(const Vertex& min_y, const Vertex& mid_y, const Vertex& max_y, bool handedness, const Bitmap& texture) const
+void RenderContext::scanTriangle(const ScreenTriangle& triangle, const Tile& tile, const Bitmap& texture) const
 {
-    Gradients gradients  (min_y, mid_y, max_y);
-
-    Edge top_to_bottom   (gradients, min_y, max_y, 0);
-    Edge top_to_middle   (gradients, min_y, mid_y, 0);
-    Edge middle_to_bottom(gradients, mid_y, max_y, 1);
+    Edge top_to_bottom   (triangle.gradients, triangle.min_y, triangle.max_y, 0);
+    Edge top_to_middle   (triangle.gradients, triangle.min_y, triangle.mid_y, 0);
+    Edge middle_to_bottom(triangle.gradients, triangle.mid_y, triangle.max_y, 1);
 
-    scanEdges(top_to_bottom, top_to_middle,    handedness, texture);
-    scanEdges(top_to_bottom, middle_to_bottom, handedness, texture);
+    scanEdges(top_to_bottom, top_to_middle,    triangle.handedness, tile, texture);
+    scanEdges(top_to_bottom, middle_to_bottom, triangle.handedness, tile, texture);
 }
 
-void RenderContext::clipPolygonComponent(const std::vector<Vertex>& vertices, int component_index, float component_factor, std::vector<Vertex>& result)
+void RenderContext::clipPolygonComponent(const ClipPolygon& vertices, int component_index, float component_factor, ClipPolygon& result) const
 {
-    Vertex previous_vertex = vertices[vertices.size() - 1];
+    Vertex previous_vertex = vertices.vertices[vertices.count - 1];
     float previous_component = previous_vertex.get(component_index) * component_factor;
     bool previous_inside = previous_component <= previous_vertex.m_pos.w;
 
-    for(auto& v : vertices)
+    for(int i = 0; i < vertices.count; ++i)
     {
-        Vertex current_vertex = v;
+        const Vertex& current_vertex = vertices.vertices[i];
         float current_component = current_vertex.get(component_index) * component_factor;
         bool  current_inside = current_component <= current_vertex.m_pos.w;
 
         if(current_inside ^ previous_inside)
         {
-            float lerp_amt = (previous_vertex.m_pos.w - previous_component) / 
+            float lerp_amt = (previous_vertex.m_pos.w - previous_component) /
                              ((previous_vertex.m_pos.w - previous_component) - (current_vertex.m_pos.w - current_component));
 
-            result.push_back(previous_vertex.lerp(current_vertex, lerp_amt));
+            result.add(previous_vertex.lerp(current_vertex, lerp_amt));
         }
 
         if(current_inside)
         {
-            result.push_back(current_vertex);
+            result.add(current_vertex);
         }
 
         previous_vertex = current_vertex;
@@ -125,23 +174,23 @@ void RenderContext::clipPolygonComponent(const std::vector<Vertex>& vertices, in
     }
 }
 
-bool RenderContext::clipPolygonAxis(std::vector<Vertex>& vertices, std::vector<Vertex>& auxillary_list, int component_index)
+bool RenderContext::clipPolygonAxis(ClipPolygon& vertices, ClipPolygon& auxillary_list, int component_index) const
 {
     clipPolygonComponent(vertices, component_index, 1.0f, auxillary_list);
-    vertices.clear();
+    vertices.count = 0;
 
-    if(auxillary_list.empty())
+    if(auxillary_list.count == 0)
     {
         return false;
     }
 
     clipPolygonComponent(auxillary_list, component_index, -1.0f, vertices);
-    auxillary_list.clear();
+    auxillary_list.count = 0;
 
-    return !vertices.empty();
+    return vertices.count != 0;
 }
 
-void RenderContext::fillTriangle(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Bitmap& texture) const
+void RenderContext::setupTriangle(const Vertex& v1, const Vertex& v2, const Vertex& v3, std::vector<ScreenTriangle>& result) const
 {
     glm::mat4 screen_space_transform = MathUtils::initScreenSpace(m_width / 2.0f, m_height / 2.0f);
     glm::mat4 identity;
@@ -170,45 +219,183 @@ void RenderContext::fillTriangle(const Vertex& v1, const Vertex& v2, const Verte
         std::swap(max_y, mid_y);
     }
 
-    scanTriangle(min_y, mid_y, max_y, min_y.triangleArea(max_y, mid_y) >= 0.0f, texture);
+    result.emplace_back(min_y, mid_y, max_y, min_y.triangleArea(max_y, mid_y) >= 0.0f);
 }
 
-void RenderContext::drawMesh(const Mesh & mesh, const glm::mat4 & trans, const glm::mat4 & view_proj, const Bitmap& texture)
+void RenderContext::clipTriangle(const Vertex& v1, const Vertex& v2, const Vertex& v3, std::vector<ScreenTriangle>& result) const
 {
-    glm::mat4 mvp = view_proj * trans;
-    for(auto i = 0; i < mesh.getIndicesCount(); i += 3)
+    if(v1.isInsideViewFrustum() && v2.isInsideViewFrustum() && v3.isInsideViewFrustum())
     {
-        drawTriangle(mesh.getVertex(mesh.getIndex(i + 0)).transform(mvp, trans),
-                     mesh.getVertex(mesh.getIndex(i + 1)).transform(mvp, trans),
-                     mesh.getVertex(mesh.getIndex(i + 2)).transform(mvp, trans),
-                     texture);
+        setupTriangle(v1, v2, v3, result);
+        return;
+    }
+
+    ClipPolygon vertices;
+    ClipPolygon auxillary_list;
+
+    vertices.add(v1);
+    vertices.add(v2);
+    vertices.add(v3);
+
+    if(clipPolygonAxis(vertices, auxillary_list, 0) &&
+       clipPolygonAxis(vertices, auxillary_list, 1) &&
+       clipPolygonAxis(vertices, auxillary_list, 2))
+    {
+        const Vertex& init_vertex = vertices.vertices[0];
+        for(int i = 0; i < vertices.count - 1; ++i)
+        {
+            setupTriangle(init_vertex, vertices.vertices[i], vertices.vertices[i+1], result);
+        }
     }
 }
 
-void RenderContext::clearDepthBuffer() const
+void RenderContext::rasterizeTile(int tile_index, const Bitmap& texture) const
 {
-    std::fill_n(m_zbuffer, m_width * m_height, 9999999999);
+    const auto& bin = m_tile_bins[tile_index];
+
+    if (bin.empty())
+    {
+        return;
+    }
+
+    /* Depth values of the tile, copied to a local buffer which stays in the cache */
+    float depth[TILE_SIZE * TILE_SIZE];
+
+    Tile tile;
+    tile.min_x        = (tile_index % m_num_tiles_x) * TILE_SIZE;
+    tile.min_y        = (tile_index / m_num_tiles_x) * TILE_SIZE;
+    tile.max_x        = glm::min(tile.min_x + TILE_SIZE, m_width);
+    tile.max_y        = glm::min(tile.min_y + TILE_SIZE, m_height);
+    tile.depth        = depth;
+    tile.depth_stride = TILE_SIZE;
+
+    int tile_width = tile.max_x - tile.min_x;
+
+    for (int y = tile.min_y; y < tile.max_y; ++y)
+    {
+        std::copy_n(m_zbuffer + tile.min_x + y * m_width, tile_width, depth + (y - tile.min_y) * TILE_SIZE);
+    }
+
+    /* Triangles are rasterized in the order they were submitted, so the result is the same as a serial one */
+    for (const ScreenTriangle* triangle : bin)
+    {
+        scanTriangle(*triangle, tile, texture);
+    }
+
+    for (int y = tile.min_y; y < tile.max_y; ++y)
+    {
+        std::copy_n(depth + (y - tile.min_y) * TILE_SIZE, tile_width, m_zbuffer + tile.min_x + y * m_width);
+    }
 }
 
-void RenderContext::drawTriangle(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Bitmap& texture)
+void RenderContext::drawMesh(const Mesh & mesh, const glm::mat4 & trans, const glm::mat4 & view_proj, const Bitmap& texture)
 {
-    if(v1.isInsideViewFrustum() && v2.isInsideViewFrustum() && v3.isInsideViewFrustum())
+    glm::mat4 mvp = view_proj * trans;
+
+    int num_triangles = mesh.getIndicesCount() / 3;
+    int num_threads   = glm::max(1, glm::min(m_num_threads, num_triangles / 64));
+
+    /* Transform, clip and set up the triangles, each thread handles a contiguous range of them */
+    auto setup = [&](int thread_index)
     {
-        fillTriangle(v1, v2, v3, texture);
+        int begin = num_triangles * thread_index / num_threads;
+        int end   = num_triangles * (thread_index + 1) / num_threads;
+
+        auto& triangles = m_thread_triangles[thread_index];
+        triangles.clear();
+
+        for (int i = begin * 3; i < end * 3; i += 3)
+        {
+            clipTriangle(mesh.getVertex(mesh.getIndex(i + 0)).transform(mvp, trans),
+                         mesh.getVertex(mesh.getIndex(i + 1)).transform(mvp, trans),
+                         mesh.getVertex(mesh.getIndex(i + 2)).transform(mvp, trans),
+                         triangles);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i)
+    {
+        threads.emplace_back(setup, i);
+    }
+    setup(0);
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    threads.clear();
+
+    /* Binning only pays off when the tiles can be rasterized in parallel */
+    if (m_num_threads == 1)
+    {
+        Tile screen { 0, 0, m_width, m_height, m_zbuffer, m_width };
+
+        for (const auto& triangle : m_thread_triangles[0])
+        {
+            scanTriangle(triangle, screen, texture);
+        }
+
         return;
     }
 
-    std::vector<Vertex> vertices { v1, v2, v3 };
-    std::vector<Vertex> auxillary_list;
+    /* Sort the triangles into the tiles they overlap, in the order they were submitted */
+    for (auto& bin : m_tile_bins)
+    {
+        bin.clear();
+    }
 
-    if(clipPolygonAxis(vertices, auxillary_list, 0) &&
-       clipPolygonAxis(vertices, auxillary_list, 1) &&
-       clipPolygonAxis(vertices, auxillary_list, 2))
+    for (int i = 0; i < num_threads; ++i)
+    {
+        for (const ScreenTriangle& triangle : m_thread_triangles[i])
+        {
+            for (int ty = triangle.tile_min_y; ty <= glm::min(triangle.tile_max_y, m_num_tiles_y - 1); ++ty)
+            {
+                for (int tx = triangle.tile_min_x; tx <= glm::min(triangle.tile_max_x, m_num_tiles_x - 1); ++tx)
+                {
+                    m_tile_bins[tx + ty * m_num_tiles_x].push_back(&triangle);
+                }
+            }
+        }
+    }
+
+    /* Rasterize the tiles in parallel, each one is written by a single thread */
+    std::atomic<int> next_tile(0);
+    auto rasterize = [&]()
     {
-        Vertex init_vertex = vertices[0];
-        for(int i = 0; i < vertices.size() - 1; ++i)
+        for (int tile_index = next_tile++; tile_index < static_cast<int>(m_tile_bins.size()); tile_index = next_tile++)
         {
-            fillTriangle(init_vertex, vertices[i], vertices[i+1], texture);
+            rasterizeTile(tile_index, texture);
         }
+    };
+
+    for (int i = 1; i < m_num_threads; ++i)
+    {
+        threads.emplace_back(rasterize);
+    }
+    rasterize();
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+}
+
+void RenderContext::clearDepthBuffer() const
+{
+    std::fill_n(m_zbuffer, m_width * m_height, FAR_DEPTH);
+}
+
+void RenderContext::drawTriangle(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Bitmap& texture)
+{
+    auto& triangles = m_thread_triangles[0];
+    triangles.clear();
+    clipTriangle(v1, v2, v3, triangles);
+
+    Tile screen { 0, 0, m_width, m_height, m_zbuffer, m_width };
+
+    for (const auto& triangle : triangles)
+    {
+        scanTriangle(triangle, screen, texture);
     }
 }
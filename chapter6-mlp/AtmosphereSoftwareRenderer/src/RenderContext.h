@@ -1,7 +1,9 @@
 ﻿#pragma once
+#include <vector>
 #include "Bitmap.h"
 #include "Vertex.h"
 #include "Edge.h"
+#include "Gradients.h"
 #include "Mesh.h"
 
 class RenderContext : public Bitmap
@@ -10,18 +12,65 @@ public:
     RenderContext(int width, int height);
     virtual ~RenderContext();
 
+    /* Clips and sets up the triangles of the mesh, sorts them into screen tiles and rasterizes the tiles in parallel */
     void drawMesh(const Mesh& mesh, const glm::mat4& trans, const glm::mat4 & view_proj, const Bitmap& texture);
     void clearDepthBuffer() const;
 
     void drawTriangle(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Bitmap& texture);
 
+    /* True if a mesh was drawn at the pixel since the last clearDepthBuffer() call */
+    bool isCoveredByGeometry(int x, int y) const { return m_zbuffer[x + y * m_width] < FAR_DEPTH; }
+
+    static const int TILE_SIZE = 64;
+    static constexpr float FAR_DEPTH = 9999999999.0f;
+
 private:
+    /* A triangle clipped by the 6 frustum planes has at most 3 + 6 vertices */
+    static const int MAX_CLIP_VERTICES = 9;
+
+    struct ClipPolygon
+    {
+        Vertex vertices[MAX_CLIP_VERTICES];
+        int    count = 0;
+
+        void add(const Vertex& v) { if (count < MAX_CLIP_VERTICES) vertices[count++] = v; }
+    };
+
+    /* Screen space triangle, with its vertices sorted by y */
+    struct ScreenTriangle
+    {
+        ScreenTriangle(const Vertex& min_y, const Vertex& mid_y, const Vertex& max_y, bool handedness);
+
+        Vertex    min_y, mid_y, max_y;
+        bool      handedness;
+        Gradients gradients;
+        int       tile_min_x, tile_min_y, tile_max_x, tile_max_y; // range of overlapped tiles, inclusive
+    };
+
+    /* Pixels [min_x, max_x) x [min_y, max_y) and their depth values, depth points to the one of (min_x, min_y) */
+    struct Tile
+    {
+        int    min_x, min_y, max_x, max_y;
+        float* depth;
+        int    depth_stride;
+    };
+
     float* m_zbuffer;
 
-    void drawScanLine(const Edge& left, const Edge& right, int j, const Bitmap& texture) const;
-    void scanEdges(Edge& a, Edge& b, bool handedness, const Bitmap& texture) const;
-    void scanTriangle(const Vertex& min_y, const Vertex& mid_y, const Vertex& max_y, bool handedness, const Bitmap& texture) const;
-    void fillTriangle(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Bitmap& texture) const;
-    void clipPolygonComponent(const std::vector<Vertex>& vertices, int component_index, float component_factor, std::vector<Vertex>& result);
-    bool clipPolygonAxis(std::vector<Vertex>& vertices, std::vector<Vertex>& auxillary_list, int component_index);
+    int m_num_tiles_x;
+    int m_num_tiles_y;
+    int m_num_threads;
+
+    /* Kept between the draw calls to reuse their memory */
+    std::vector<std::vector<ScreenTriangle>>        m_thread_triangles;
+    std::vector<std::vector<const ScreenTriangle*>> m_tile_bins;
+
+    void drawScanLine(const Edge& left, const Edge& right, int j, const Tile& tile, const Bitmap& texture) const;
+    void scanEdges(Edge& a, Edge& b, bool handedness, const Tile& tile, const Bitmap& texture) const;
+    void scanTriangle(const ScreenTriangle& triangle, const Tile& tile, const Bitmap& texture) const;
+    void setupTriangle(const Vertex& v1, const Vertex& v2, const Vertex& v3, std::vector<ScreenTriangle>& result) const;
+    void clipTriangle(const Vertex& v1, const Vertex& v2, const Vertex& v3, std::vector<ScreenTriangle>& result) const;
+    void rasterizeTile(int tile_index, const Bitmap& texture) const;
+    void clipPolygonComponent(const ClipPolygon& vertices, int component_index, float component_factor, ClipPolygon& result) const;
+    bool clipPolygonAxis(ClipPolygon& vertices, ClipPolygon& auxillary_list, int component_index) const;
 };
@@ -14,6 +14,6 @@ Time::~Time()
 
 double Time::getTime()
 {
-    auto now = std::chrono::system_clock::now();
+    auto now = std::chrono::steady_clock::now();
     return double(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count())/double(SECOND);
 }
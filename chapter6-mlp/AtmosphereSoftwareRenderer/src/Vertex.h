@@ -5,6 +5,7 @@
 class Vertex
 {
 public:
+    Vertex() = default;
     Vertex(const glm::vec4 & pos, const glm::vec4 & texcoords, const glm::vec4 & normal);
 
     float triangleArea(Vertex b, Vertex c) const;
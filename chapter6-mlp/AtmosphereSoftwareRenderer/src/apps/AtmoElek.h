@@ -1,8 +1,12 @@
 #pragma once
 
 #include "RenderContext.h"
+#include "FrameStats.h"
 
+#include <thread>
+#include <vector>
 #include <glm/vec3.hpp>
+#include <atmosphere/SkyRadianceCache.h>
 #include <atmosphere/raytracer/Camera.h>
 #include <atmosphere/skymodels/precomputed_ss/PrecomputedSS.h>
 #include <atmosphere/skymodels/Atmosphere.h>
@@ -21,7 +25,10 @@ public:
     void setCameraDir(double yaw, double pitch);
     void setCameraPosition(glm::highp_dvec3 new_position);
 
+    const FrameStats& getFrameStats() const { return m_frame_stats; }
+
 private:
+    glm::highp_dvec3 computeSkyRadiance(const Ray& ray);
     void process(const RenderContext * const target, int left, int right, float delta);
     std::vector<int> thread_bounds(int parts, int mem) const;
     glm::highp_ivec3 tonemap(const glm::highp_dvec3& hdr_color, double exposure = 1.0, double gamma = 2.2);
@@ -30,8 +37,11 @@ private:
     std::vector<int> m_bounds;
     int m_num_threads;
 
+    FrameStats m_frame_stats;
+
     Options m_options;
     PrecomputedSS * m_atmosphere;
     Camera * m_cam;
+    SkyRadianceCache * m_sky_cache;
 };
 
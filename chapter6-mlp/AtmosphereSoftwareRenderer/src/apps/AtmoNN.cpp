@@ -4,6 +4,7 @@
 AtmoNN::AtmoNN(const Options& options)
     : m_atmosphere(nullptr),
       m_cam(nullptr),
+      m_sky_cache(nullptr),
       m_options(options)
 {
 }
@@ -12,6 +13,7 @@ AtmoNN::~AtmoNN()
 {
     delete m_atmosphere;
     delete m_cam;
+    delete m_sky_cache;
     m_threads.clear();
 }
 
@@ -41,26 +43,66 @@ void AtmoNN::init(RenderContext* target)
 
     m_bounds = thread_bounds(m_num_threads, target->getHeight());
     m_threads.resize(m_num_threads - 1);
+    m_frame_stats.band_times.resize(m_num_threads);
+
+    /* Sky radiance cache */
+    if (m_options.SKY_CACHE_RESOLUTION > 0)
+    {
+        m_sky_cache = new SkyRadianceCache(m_options.SKY_CACHE_RESOLUTION, m_options.SKY_CACHE_TEXELS_PER_FRAME,
+                                           m_options.SKY_CACHE_SUN_ANGLE);
+    }
 }
 
 void AtmoNN::updateAndRender(RenderContext* target, float delta)
 {
+    double start_time = Time::getTime();
+
+    /* Refresh the part of the sky radiance cache which fits in the frame budget */
+    if (m_sky_cache != nullptr)
+    {
+        m_sky_cache->update(m_cam->getPosition(), m_atmosphere->getSunDirection(), m_num_threads,
+                            [this](const glm::highp_dvec3& direction)
+                            {
+                                return computeSkyRadiance(Ray(m_cam->getPosition(), direction));
+                            });
+    }
+
+    double dispatch_start_time = Time::getTime();
+
     /* Use num_threads - 1 threads to raytrace the scene */
     for (int i = 0; i < m_num_threads - 1; ++i)
     {
-        m_threads[i] = (std::thread(&AtmoNN::process, this, target, m_bounds[i], m_bounds[i + 1], delta));
+        m_threads[i] = std::thread([this, target, i, delta]()
+        {
+            double band_start_time = Time::getTime();
+            process(target, m_bounds[i], m_bounds[i + 1], delta);
+            m_frame_stats.band_times[i] = Time::getTime() - band_start_time;
+        });
     }
 
+    double raytrace_start_time = Time::getTime();
+
     /* Use main thread to raytrace the scene */
     for (int i = m_num_threads - 1; i < m_num_threads; ++i)
     {
         process(target, m_bounds[i], m_bounds[i + 1], delta);
     }
 
+    double join_start_time = Time::getTime();
+    m_frame_stats.band_times[m_num_threads - 1] = join_start_time - raytrace_start_time;
+
     for (auto& t : m_threads)
     {
         t.join();
     }
+
+    double end_time = Time::getTime();
+
+    m_frame_stats.sky_cache = dispatch_start_time - start_time;
+    m_frame_stats.dispatch  = raytrace_start_time - dispatch_start_time;
+    m_frame_stats.raytrace  = join_start_time - raytrace_start_time;
+    m_frame_stats.join      = end_time - join_start_time;
+    m_frame_stats.total     = end_time - start_time;
 }
 
 void AtmoNN::setSunDirection(double elevation_angle, double azimuth_angle)
@@ -86,23 +128,39 @@ void AtmoNN::setCameraPosition(glm::highp_dvec3 new_position)
     m_cam->setPosition(new_position);
 }
 
+glm::highp_dvec3 AtmoNN::computeSkyRadiance(const Ray& ray)
+{
+    double t0, t1, t_max = std::numeric_limits<double>::max();
+    if (m_atmosphere->intersect(ray, t0, t1, true) && t1 > 0.0)
+    {
+        t_max = glm::max(0.0, t0);
+    }
+
+    return m_atmosphere->computeIncidentLight(ray, 0.0, t_max);
+}
+
 void AtmoNN::process(const RenderContext* const target, int left, int right, float delta)
 {
     for (unsigned y = left; y < right; ++y)
     {
         for (unsigned x = 0; x < target->getWidth(); ++x)
         {
+            /* The sky is hidden by the meshes drawn before, keep their pixels */
+            if (target->isCoveredByGeometry(x, y))
+            {
+                continue;
+            }
+
             Ray primary_ray = m_cam->getPrimaryRay(x + 0.5, y + 0.5);
 
             if (primary_ray.is_valid)
             {
-                double t0, t1, t_max = std::numeric_limits<double>::max();
-                if (m_atmosphere->intersect(primary_ray, t0, t1, true) && t1 > 0.0)
+                glm::highp_dvec3 hdr_color;
+                if (m_sky_cache == nullptr || !m_sky_cache->lookup(primary_ray.m_direction, hdr_color))
                 {
-                    t_max = glm::max(0.0, t0);
+                    hdr_color = computeSkyRadiance(primary_ray);
                 }
 
-                auto hdr_color = m_atmosphere->computeIncidentLight(primary_ray, 0.0, t_max);
                 auto ldr_color = tonemap(hdr_color);
 
                 target->drawPixel(x, y, ldr_color.r, ldr_color.g, ldr_color.b, 255);
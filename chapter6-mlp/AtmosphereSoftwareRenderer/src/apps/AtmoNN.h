@@ -1,7 +1,11 @@
 #pragma once
 #include "RenderContext.h"
+#include "FrameStats.h"
 
+#include <thread>
+#include <vector>
 #include <glm/vec3.hpp>
+#include <atmosphere/SkyRadianceCache.h>
 #include <atmosphere/raytracer/Camera.h>
 #include <atmosphere/skymodels/deep_as/DeepAS.h>
 #include <atmosphere/skymodels/Atmosphere.h>
@@ -20,7 +24,10 @@ public:
     void setCameraDir(double yaw, double pitch);
     void setCameraPosition(glm::highp_dvec3 new_position);
 
+    const FrameStats& getFrameStats() const { return m_frame_stats; }
+
 private:
+    glm::highp_dvec3 computeSkyRadiance(const Ray& ray);
     void process(const RenderContext* const target, int left, int right, float delta);
     std::vector<int> thread_bounds(int parts, int mem) const;
     glm::highp_ivec3 tonemap(const glm::highp_dvec3& hdr_color, double exposure = 1.0, double gamma = 2.2);
@@ -29,8 +36,11 @@ private:
     std::vector<int> m_bounds;
     int m_num_threads;
 
+    FrameStats m_frame_stats;
+
     Options m_options;
     DeepAS* m_atmosphere;
     Camera* m_cam;
+    SkyRadianceCache* m_sky_cache;
 };
 
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+
+/* Wall clock time spent in the stages of the last updateAndRender() call, in seconds */
+struct FrameStats
+{
+    double prepass   = 0.0; // drawing the meshes before updateAndRender(), set by its caller
+    double sky_cache = 0.0; // refreshing the sky radiance cache
+    double dispatch  = 0.0; // starting the worker threads
+    double raytrace  = 0.0; // raytracing the band of rows of the main thread
+    double join      = 0.0; // waiting for the worker threads after that
+    double total     = 0.0;
+
+    std::vector<double> band_times; // raytracing time of each band of rows
+};
@@ -0,0 +1,157 @@
+#include "SkyRadianceCache.h"
+
+#include <thread>
+#include <glm/gtc/constants.hpp>
+
+/* Distance in meters by which the camera can move without invalidating the cache */
+static constexpr double CAMERA_POSITION_TOLERANCE = 1.0;
+
+SkyRadianceCache::SkyRadianceCache(int resolution, int texels_per_frame, double sun_angle)
+    : m_resolution       (resolution),
+      m_texels_per_frame (texels_per_frame),
+      m_cos_sun_angle    (glm::cos(glm::radians(sun_angle))),
+      /* A quarter of the angular size of a texel, which covers 4 pi / resolution^2 steradians */
+      m_cos_sun_tolerance(glm::cos(0.25 * glm::sqrt(4.0 * glm::pi<double>()) / resolution)),
+      m_num_fresh_texels (0),
+      m_has_key         (false),
+      m_radiance        (resolution * resolution)
+{
+}
+
+void SkyRadianceCache::update(const glm::highp_dvec3& camera_position,
+                              const glm::highp_dvec3& sun_direction,
+                              int num_threads,
+                              const RadianceFunction& radiance)
+{
+    /* The key is only replaced when it changes by more than the tolerances, so that small moves do not add up */
+    if (!m_has_key ||
+        glm::distance(camera_position, m_camera_position) > CAMERA_POSITION_TOLERANCE ||
+        glm::dot(glm::normalize(sun_direction), glm::normalize(m_sun_direction)) < m_cos_sun_tolerance)
+    {
+        m_has_key          = true;
+        m_camera_position  = camera_position;
+        m_sun_direction    = sun_direction;
+        m_num_fresh_texels = 0;
+
+        /* All the lookups fall back to the direct evaluation until the key stops changing */
+        return;
+    }
+
+    int begin = m_num_fresh_texels;
+    int end   = glm::min(begin + m_texels_per_frame, m_resolution * m_resolution);
+
+    if (begin == end)
+    {
+        return;
+    }
+
+    auto compute = [&](int thread_index)
+    {
+        int thread_begin = begin + (end - begin) * thread_index / num_threads;
+        int thread_end   = begin + (end - begin) * (thread_index + 1) / num_threads;
+
+        for (int i = thread_begin; i < thread_end; ++i)
+        {
+            glm::highp_dvec2 uv((i % m_resolution + 0.5) / m_resolution, (i / m_resolution + 0.5) / m_resolution);
+            m_radiance[i] = glm::vec3(radiance(uvToDirection(uv)));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i)
+    {
+        threads.emplace_back(compute, i);
+    }
+    compute(0);
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    m_num_fresh_texels = end;
+}
+
+bool SkyRadianceCache::lookup(const glm::highp_dvec3& direction, glm::highp_dvec3& radiance) const
+{
+    if (glm::dot(glm::normalize(direction), glm::normalize(m_sun_direction)) > m_cos_sun_angle)
+    {
+        return false;
+    }
+
+    /* In [-0.5, resolution - 0.5], the texels on each side of the borders are wrapped across the octahedral fold */
+    glm::highp_dvec2 uv = directionToUV(direction) * double(m_resolution) - 0.5;
+
+    int x0 = static_cast<int>(glm::floor(uv.x));
+    int y0 = static_cast<int>(glm::floor(uv.y));
+
+    int i00 = texelIndex(x0,     y0);
+    int i10 = texelIndex(x0 + 1, y0);
+    int i01 = texelIndex(x0,     y0 + 1);
+    int i11 = texelIndex(x0 + 1, y0 + 1);
+
+    /* The last texel needed in the row major order */
+    if (glm::max(glm::max(i00, i10), glm::max(i01, i11)) >= m_num_fresh_texels)
+    {
+        return false;
+    }
+
+    double ax = glm::clamp(uv.x - x0, 0.0, 1.0);
+    double ay = glm::clamp(uv.y - y0, 0.0, 1.0);
+
+    glm::highp_dvec3 r00(m_radiance[i00]);
+    glm::highp_dvec3 r10(m_radiance[i10]);
+    glm::highp_dvec3 r01(m_radiance[i01]);
+    glm::highp_dvec3 r11(m_radiance[i11]);
+
+    radiance = glm::mix(glm::mix(r00, r10, ax), glm::mix(r01, r11, ax), ay);
+    return true;
+}
+
+int SkyRadianceCache::texelIndex(int x, int y) const
+{
+    /* The outer edges of the map are folded at their middle, the texel just outside of one of them is the one
+     * mirrored along this edge, on its inner side. The four corners are the same direction */
+    if (x < 0 || x >= m_resolution)
+    {
+        x = x < 0 ? 0 : m_resolution - 1;
+        y = m_resolution - 1 - y;
+    }
+
+    if (y < 0 || y >= m_resolution)
+    {
+        y = y < 0 ? 0 : m_resolution - 1;
+        x = m_resolution - 1 - x;
+    }
+
+    return x + y * m_resolution;
+}
+
+glm::highp_dvec2 SkyRadianceCache::directionToUV(const glm::highp_dvec3& direction) const
+{
+    /* Octahedral mapping, around the y axis which is the vertical one of the apps */
+    glm::highp_dvec3 n = direction / (glm::abs(direction.x) + glm::abs(direction.y) + glm::abs(direction.z));
+    glm::highp_dvec2 p(n.x, n.z);
+
+    if (n.y < 0.0)
+    {
+        p = glm::highp_dvec2((1.0 - glm::abs(n.z)) * (n.x >= 0.0 ? 1.0 : -1.0),
+                             (1.0 - glm::abs(n.x)) * (n.z >= 0.0 ? 1.0 : -1.0));
+    }
+
+    return p * 0.5 + 0.5;
+}
+
+glm::highp_dvec3 SkyRadianceCache::uvToDirection(const glm::highp_dvec2& uv) const
+{
+    glm::highp_dvec2 p = uv * 2.0 - 1.0;
+    glm::highp_dvec3 n(p.x, 1.0 - glm::abs(p.x) - glm::abs(p.y), p.y);
+
+    if (n.y < 0.0)
+    {
+        n.x = (1.0 - glm::abs(p.y)) * (p.x >= 0.0 ? 1.0 : -1.0);
+        n.z = (1.0 - glm::abs(p.x)) * (p.y >= 0.0 ? 1.0 : -1.0);
+    }
+
+    return glm::normalize(n);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+
+/* Sky radiance of all the view directions seen from one camera position, for one sun direction, stored in an
+ * octahedral map. Camera rotations only reproject it. Moving the camera or the sun by more than a small tolerance
+ * makes all its texels stale, they are then recomputed a fixed number of them per frame once the camera and the
+ * sun stop moving, and looking up a stale one fails. The lookups around the sun also fail, the sun disk and its
+ * aureole being too sharp to be interpolated from the map. */
+class SkyRadianceCache
+{
+public:
+    using RadianceFunction = std::function<glm::highp_dvec3(const glm::highp_dvec3& direction)>;
+
+    /* sun_angle is the angle in degrees, around the sun direction, of the directions which are never cached */
+    SkyRadianceCache(int resolution, int texels_per_frame, double sun_angle);
+
+    /* Invalidates the cache if the key changed, then computes the next stale texels with num_threads threads,
+     * unless the key changed in this frame: it would then be likely to change again before they are used */
+    void update(const glm::highp_dvec3& camera_position,
+                const glm::highp_dvec3& sun_direction,
+                int num_threads,
+                const RadianceFunction& radiance);
+
+    /* Bilinearly interpolated radiance, false if one of the texels it needs is stale or if direction is too close
+     * to the sun */
+    bool lookup(const glm::highp_dvec3& direction, glm::highp_dvec3& radiance) const;
+
+    bool isComplete() const { return m_num_fresh_texels == m_resolution * m_resolution; }
+
+private:
+    glm::highp_dvec2 directionToUV(const glm::highp_dvec3& direction) const;
+    glm::highp_dvec3 uvToDirection(const glm::highp_dvec2& uv) const;
+
+    /* Index of the texel (x, y), where x and y can be one texel outside of the map, wrapped across its border */
+    int texelIndex(int x, int y) const;
+
+    int m_resolution;
+    int m_texels_per_frame;
+
+    /* Cosine of the sun angle, and of the angle by which the sun can move without invalidating the cache */
+    double m_cos_sun_angle;
+    double m_cos_sun_tolerance;
+
+    /* Texels are computed in row major order, the ones before this index are up to date */
+    int m_num_fresh_texels;
+
+    bool             m_has_key;
+    glm::highp_dvec3 m_camera_position;
+    glm::highp_dvec3 m_sun_direction;
+
+    std::vector<glm::vec3> m_radiance;
+};
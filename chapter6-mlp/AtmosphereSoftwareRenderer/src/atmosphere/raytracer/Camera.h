@@ -13,6 +13,7 @@ public:
     Ray getPrimaryRay(double x, double y);
     void setDirection(double yaw, double pitch);
     void setPosition(const glm::highp_dvec3& new_pos);
+    const glm::highp_dvec3& getPosition() const { return m_eye; }
 
 
     uint32_t m_width, m_height;
@@ -11,6 +11,14 @@ struct Options
     double CAM_YAW                    = 90.0;
     double CAM_FOV                    = 60.0;
     bool   CAM_FISHEYE                = false;
+
+    /* Sky radiance cache of the interactive apps, 0 disables it */
+    int    SKY_CACHE_RESOLUTION       = 1024;
+    int    SKY_CACHE_TEXELS_PER_FRAME = 262144;
+    double SKY_CACHE_SUN_ANGLE        = 5.0; // degrees around the sun, where the sun disk and its aureole are not cached
+
+    /* Draws the Foreground meshes before the sky in the interactive app, as a depth prepass */
+    bool   DRAW_FOREGROUND            = false;
     
     glm::highp_dvec3 SUN_DIRECTION = glm::normalize(glm::highp_dvec3(0.0, -glm::cos(0.0), glm::sin(0.0)));
     double           SUN_INTENSITY = 13.661;
@@ -70,6 +70,11 @@ public:
         sun_light = glm::normalize(sun_dir);
     }
 
+    const glm::highp_dvec3& getSunDirection() const
+    {
+        return sun_light;
+    }
+
 protected:
     virtual std::vector<IntegrationData> integrator(Ray ray, double a, double b, unsigned n, bool precomptute) = 0;
     virtual double sampleHeight(glm::highp_dvec3 & pos);
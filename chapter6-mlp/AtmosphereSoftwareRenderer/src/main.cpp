@@ -1,8 +1,13 @@
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
 
+#include "Benchmark.h"
 #include "Display.h"
+#include "Foreground.h"
 #include "Timing.h"
 #include "apps/AtmoElek.h"
 #include "apps/AtmoNN.h"
@@ -17,35 +22,121 @@
     #define IMG_HEIGHT 1080
 #endif
 
-struct SceneSettings
+/* Usage: AtmosphereSoftwareRenderer --benchmark [--model elek|nn] [--frames N] [--warmup N]
+ *                                               [--width W] [--height H] [--output report.json]
+ *                                               [--dump-frames directory] [--foreground 0|1]
+ * Renders the key frames path offscreen, without creating a window, and saves a JSON report */
+int runHeadlessBenchmark(int argc, char *argv[], const std::vector<SceneSettings>& path)
 {
-    glm::highp_dvec3 cam_position;
-    glm::highp_dvec2 cam_angles; // yaw, pitch
-    glm::highp_dvec2 sun_angles; // azimuth, elevation
-};
+    BenchmarkSettings settings;
+    std::string model = "elek";
+    int width         = IMG_WIDTH;
+    int height        = IMG_HEIGHT;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg   = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (arg == "--benchmark")
+        {
+            continue;
+        }
+
+        if (value == nullptr)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return -1;
+        }
+
+        if      (arg == "--model")       model                  = value;
+        else if (arg == "--frames")      settings.frames        = std::stoi(value);
+        else if (arg == "--warmup")      settings.warmup_frames = std::stoi(value);
+        else if (arg == "--width")       width                  = std::stoi(value);
+        else if (arg == "--height")      height                 = std::stoi(value);
+        else if (arg == "--output")      settings.output_file   = value;
+        else if (arg == "--dump-frames") settings.frames_dir    = value;
+        else if (arg == "--foreground")  settings.foreground    = std::stoi(value) != 0;
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return -1;
+        }
+        ++i;
+    }
+
+    RenderContext target(width, height);
+    Options opt;
+    BenchmarkResult result;
+
+    if (model == "nn")
+    {
+        AtmoNN atmo(opt);
+        atmo.init(&target);
+        result = runBenchmark(model, atmo, &target, path, settings);
+    }
+    else if (model == "elek")
+    {
+        AtmoElek atmo(opt);
+        atmo.init(&target);
+        result = runBenchmark(model, atmo, &target, path, settings);
+    }
+    else
+    {
+        std::cerr << "Unknown model " << model << std::endl;
+        return -1;
+    }
+
+    if (!saveBenchmarkReport(result, settings.output_file))
+    {
+        return -1;
+    }
+
+    std::cout << "Benchmark report saved to " << settings.output_file << std::endl;
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
-    Display display(IMG_WIDTH, IMG_HEIGHT, "C++ Software Renderer", SDL_WINDOW_BORDERLESS);
-    RenderContext* target = display.getFramebuffer();
+    SceneSettings scene_settings[] = { { { 0.0,       -1000.0,     0.0},        { 116.0, -18.0}, {149.0, 307.0} }, // morning
+                                       { { 0.0,       -1000.0,     0.0},        { 116.0, -18.0}, {90.0,  273.0} }, // sunset
+                                       { { 0.0,       -5061000.00, 9319801.97}, {-90.0,   50.0}, {318.0, 290.0} }, // space view planet 
+                                       { {-977641.32, -65760.64,   3928892.86}, {-52.0,   28.0}, {21.0,  254.0} }  // space view close look
+                                    };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--benchmark") == 0)
+        {
+            return runHeadlessBenchmark(argc, argv, std::vector<SceneSettings>(std::begin(scene_settings), std::end(scene_settings)));
+        }
+    }
 
     Options opt;
 
+    /* Usage: AtmosphereSoftwareRenderer [--foreground 0|1] */
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--foreground") == 0)
+        {
+            opt.DRAW_FOREGROUND = std::stoi(argv[i + 1]) != 0;
+        }
+    }
+
+    Display display(IMG_WIDTH, IMG_HEIGHT, "C++ Software Renderer", SDL_WINDOW_BORDERLESS);
+    RenderContext* target = display.getFramebuffer();
+
     AtmoElek atmo(opt);
     //AtmoNN atmo(opt);
 
     atmo.init(target);
+
+    Foreground foreground;
  
     double current_time;
     double previous_time = Time::getTime();
     float  delta         = 0.0f;
 
-    SceneSettings scene_settings[] = { { { 0.0,       -1000.0,     0.0},        { 116.0, -18.0}, {149.0, 307.0} }, // morning
-                                       { { 0.0,       -1000.0,     0.0},        { 116.0, -18.0}, {90.0,  273.0} }, // sunset
-                                       { { 0.0,       -5061000.00, 9319801.97}, {-90.0,   50.0}, {318.0, 290.0} }, // space view planet 
-                                       { {-977641.32, -65760.64,   3928892.86}, {-52.0,   28.0}, {21.0,  254.0} }  // space view close look
-                                    };
-
     int    current_view        = 0;
     auto   cam_pos             = scene_settings[current_view].cam_position;
     double cam_yaw             = scene_settings[current_view].cam_angles.x;
@@ -64,6 +155,11 @@ int main(int argc, char *argv[])
         delta         = static_cast<float>(current_time - previous_time);
         previous_time = current_time;
 
+        /* Depth prepass, the sky is only computed for the pixels left uncovered */
+        if (opt.DRAW_FOREGROUND)
+        {
+            foreground.draw(target);
+        }
         atmo.updateAndRender(target, delta);
 
         /* Process Input */
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "skymodels/midpoint/Midpoint.h"
+#include "skymodels/precomputed_ss/PrecomputedSS.h"
+#include "skymodels/deep_as/DeepAS.h"
+#include "skymodels/img_based/ImgBased.h"
+#include "util/benchmark.h"
+
+#include "RootDir.h"
+
+namespace
+{
+    /* The view directions of the queries, in the upper hemisphere */
+    const int NUM_VIEW_ZENITHS  = 8;
+    const int NUM_VIEW_AZIMUTHS = 8;
+    const int NUM_QUERIES       = NUM_VIEW_ZENITHS * NUM_VIEW_AZIMUTHS;
+
+    /* Same LUT parameters as in main.cpp, so that the LUT file is shared */
+    const unsigned LUT_VIEW_SAMPLES  = 512;
+    const unsigned LUT_LIGHT_SAMPLES = 128;
+    const unsigned LUT_RESOLUTION    = 64;
+
+    /**
+      * A model to benchmark. create() returns a new instance with the given number of view samples, or with the
+      * number of the options if samples is 0 (the models which have no number of samples ignore it).
+      */
+    struct Model
+    {
+        std::string name;
+        bool has_samples;
+        std::function<std::unique_ptr<Atmosphere>(uint32_t samples)> create;
+    };
+
+    /* Same direction convention as in main.cpp, the y axis points down */
+    glm::highp_dvec3 direction(double zenith_angle, double azimuth_angle)
+    {
+        return glm::normalize(glm::highp_dvec3( glm::cos(azimuth_angle) * glm::sin(zenith_angle),
+                                               -glm::cos(zenith_angle),
+                                                glm::sin(azimuth_angle) * glm::sin(zenith_angle)));
+    }
+}
+
+/* Usage: AtmosphereBenchmark [--models midpoint,precomputed_ss,deep_as,img_based] [--sun-zeniths 15,35,55,75]
+ *                            [--samples 16,64,256] [--min-time seconds] [--repetitions N] [--cold-repetitions N]
+ *                            [--filter substring] [--lut ss_lut.txt] [--output benchmark.json]
+ * Measures the time per computeIncidentLight query of the models, for several sun zenith angles (each benchmark
+ * queries a fixed set of view directions from the ground), and for several numbers of samples of Midpoint. The warm
+ * runs reuse a model, each cold run uses a new one. The results are saved in the JSON format of Google Benchmark. */
+int main(int argc, char ** argv)
+{
+    std::string models      = "";
+    std::string sun_zeniths = "15,35,55,75";
+    std::string samples     = "";
+    std::string lut_file    = "ss_lut_" + std::to_string(LUT_VIEW_SAMPLES)  + "_" +
+                                          std::to_string(LUT_LIGHT_SAMPLES) + "_" +
+                                          std::to_string(LUT_RESOLUTION)    + "_" +
+                                          std::to_string(LUT_RESOLUTION)    + "_" +
+                                          std::to_string(LUT_RESOLUTION)    + "_rm_earth.txt";
+    std::string output_file = ROOT_DIR "/output/benchmark.json";
+
+    benchmark::Options benchmark_options;
+    benchmark_options.out = &std::cout;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return -1;
+        }
+
+        const char* value = argv[++i];
+
+        if      (arg == "--models")           models                             = value;
+        else if (arg == "--sun-zeniths")      sun_zeniths                        = value;
+        else if (arg == "--samples")          samples                            = value;
+        else if (arg == "--min-time")         benchmark_options.min_seconds      = std::stod(value);
+        else if (arg == "--repetitions")      benchmark_options.repetitions      = std::stoi(value);
+        else if (arg == "--cold-repetitions") benchmark_options.cold_repetitions = std::stoi(value);
+        else if (arg == "--filter")           benchmark_options.filter           = value;
+        else if (arg == "--lut")              lut_file                           = value;
+        else if (arg == "--output")           output_file                        = value;
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    Options options;
+
+    /* Loaded (or precomputed) once, the cold runs of PrecomputedSS only copy it */
+    std::vector<std::vector<std::vector<glm::highp_dvec4>>> lut;
+    auto load_lut = [&]()
+    {
+        if (!lut.empty())
+        {
+            return;
+        }
+
+        PrecomputedSS atmosphere(options, LUT_VIEW_SAMPLES, LUT_LIGHT_SAMPLES);
+        atmosphere.loadSingleScatteringLUTToVector(lut_file);
+
+        if (atmosphere.getLUT().empty())
+        {
+            atmosphere.precomputeSingleScattering(LUT_RESOLUTION, LUT_RESOLUTION, LUT_RESOLUTION);
+            atmosphere.saveSingleScatteringLUT(lut_file);
+        }
+
+        lut = atmosphere.getLUT();
+    };
+
+    std::vector<Model> all_models =
+    {
+        { "midpoint", true, [&](uint32_t view_samples)
+            {
+                Options model_options = options;
+                if (view_samples > 0)
+                {
+                    model_options.MIDPOINT_SAMPLES = view_samples;
+                }
+                return std::unique_ptr<Atmosphere>(new Midpoint(model_options));
+            }
+        },
+        { "precomputed_ss", false, [&](uint32_t)
+            {
+                load_lut();
+                std::unique_ptr<PrecomputedSS> atmosphere(new PrecomputedSS(options, LUT_VIEW_SAMPLES, LUT_LIGHT_SAMPLES));
+                atmosphere->loadSingleScatteringLUT(lut);
+                return std::unique_ptr<Atmosphere>(std::move(atmosphere));
+            }
+        },
+        { "deep_as",   false, [&](uint32_t) { return std::unique_ptr<Atmosphere>(new DeepAS(options));   } },
+        { "img_based", false, [&](uint32_t) { return std::unique_ptr<Atmosphere>(new ImgBased(options)); } },
+    };
+
+    std::vector<std::string> model_names = benchmark::SplitList(models);
+    std::vector<uint32_t> sample_counts;
+    for (const std::string & count : benchmark::SplitList(samples))
+    {
+        sample_counts.push_back(uint32_t(std::stoul(count)));
+    }
+    if (sample_counts.empty())
+    {
+        sample_counts.push_back(0);
+    }
+
+    /* Same camera position as Framebuffer, 1 km above the ground */
+    double scaling_factor = options.ATMOSPHERE_PROPERTIES_SCALING_FACTOR;
+    glm::highp_dvec3 camera_position(0.0, -(options.PLANET_RADIUS + 1000.0) * scaling_factor, 0.0);
+
+    std::vector<Ray> rays;
+    std::vector<double> t_max;
+    Midpoint intersection_atmosphere(options);
+    for (int i = 0; i < NUM_VIEW_ZENITHS; ++i)
+    {
+        for (int j = 0; j < NUM_VIEW_AZIMUTHS; ++j)
+        {
+            double view_zenith  = (i + 0.5) / NUM_VIEW_ZENITHS * glm::half_pi<double>();
+            double view_azimuth = j * glm::two_pi<double>() / NUM_VIEW_AZIMUTHS;
+
+            Ray ray(camera_position, direction(view_zenith, view_azimuth));
+            ray.is_valid = true;
+
+            /* As in Framebuffer::processRow(), but outside of the timed queries */
+            double t0, t1, t = std::numeric_limits<double>::max();
+            if (intersection_atmosphere.intersect(ray, t0, t1, true) && t1 > 0.0)
+            {
+                t = glm::max(0.0, t0);
+            }
+
+            rays.push_back(ray);
+            t_max.push_back(t);
+        }
+    }
+
+    benchmark::Runner runner(benchmark_options);
+    runner.AddContext("benchmark", "computeIncidentLight");
+    runner.AddContext("view_directions", std::to_string(NUM_QUERIES));
+
+    for (const Model & model : all_models)
+    {
+        if (!model_names.empty() && std::find(model_names.begin(), model_names.end(), model.name) == model_names.end())
+        {
+            continue;
+        }
+
+        for (uint32_t sample_count : sample_counts)
+        {
+            if (!model.has_samples && sample_count != sample_counts[0])
+            {
+                continue;
+            }
+
+            std::unique_ptr<Atmosphere> atmosphere;
+            for (const std::string & zenith : benchmark::SplitList(sun_zeniths))
+            {
+                benchmark::Parameters parameters;
+                if (model.has_samples && sample_count > 0)
+                {
+                    parameters.push_back({ "samples", std::to_string(sample_count) });
+                }
+                parameters.push_back({ "sun_zenith", zenith });
+
+                if (!runner.Matches(model.name, parameters))
+                {
+                    continue;
+                }
+
+                double sun_zenith = glm::radians(std::stod(zenith));
+
+                FrameState frame;
+                frame.sun_direction = direction(sun_zenith, 0.0);
+                frame.zenith_angle  = sun_zenith;
+                frame.azimuth_angle = 0.0;
+
+                auto query = [&](int i)
+                {
+                    benchmark::DoNotOptimize(atmosphere->computeIncidentLight(rays[i], 0.0, t_max[i], frame));
+                };
+
+                runner.RunCold(model.name, parameters, NUM_QUERIES, [&]() { atmosphere = model.create(sample_count); }, query);
+
+                if (!atmosphere)
+                {
+                    atmosphere = model.create(sample_count);
+                }
+
+                runner.RunWarm(model.name, parameters, NUM_QUERIES, query);
+            }
+        }
+    }
+
+    if (!runner.WriteJson(output_file))
+    {
+        std::cerr << "Can't save file " << output_file << std::endl;
+        return -1;
+    }
+
+    std::cout << "Results saved to " << output_file << std::endl;
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include "DatasetGenerator.h"
+#include "Sobol.h"
+#include "raytracer/Options.h"
+#include "raytracer/Utils.h"
+#include "util/profiling.h"
+#include "skymodels/precomputed_ss/PrecomputedSS.h"
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <thread>
+
+namespace
+{
+    /* Same values as in Options.h */
+    const PlanetParameters PLANETS[] =
+    {
+        { "earth", 6360e3,   6360e3   + 100e3,    8000.0, 1200.0,   glm::highp_dvec3(3.8e-6, 13.5e-6, 33.1e-6),    glm::highp_dvec3(21e-6)      },
+        { "venus", 6052e3,   6052e3   + 200.059e3, 15.9e3, 2.244e3,  glm::highp_dvec3(11.37e-6, 11.37e-6, 1.8e-6),  glm::highp_dvec3(2.12153e-6) },
+        { "mars",  3389.5e3, 3389.5e3 + 30.588e3,  11.1e3, 1.5671e3, glm::highp_dvec3(23.918e-6, 13.57e-6, 5.78e-6), glm::highp_dvec3(5.12153e-6) },
+    };
+
+    /* Rows are generated in blocks, each one with its own random numbers, so the order of the blocks doesn't matter */
+    const uint64_t ROWS_PER_BLOCK = 4096;
+
+    Options planetOptions(const PlanetParameters & planet)
+    {
+        Options options;
+        options.PLANET_RADIUS     = planet.planet_radius;
+        options.ATMOSPHERE_RADIUS = planet.atmosphere_radius;
+        options.H_RAYLEIGH        = planet.h_rayleigh;
+        options.H_MIE             = planet.h_mie;
+        options.BETA_RAYLEIGH     = planet.beta_rayleigh;
+        options.BETA_MIE          = planet.beta_mie;
+
+        /* Distances are in the planet radius units, like in Options.h */
+        options.ATMOSPHERE_PROPERTIES_SCALING_FACTOR = 1.0 / planet.planet_radius;
+
+        return options;
+    }
+
+    uint64_t rowsPerPlanet(const DatasetSettings & settings)
+    {
+        if (settings.sampling == DatasetSampling::SOBOL)
+        {
+            return settings.sobol_samples;
+        }
+
+        return uint64_t(settings.height_samples) * settings.sun_angle_samples * settings.view_angle_samples;
+    }
+}
+
+bool DatasetGenerator::findPlanet(const std::string & name, PlanetParameters & planet)
+{
+    for (const PlanetParameters & p : PLANETS)
+    {
+        if (p.name == name)
+        {
+            planet = p;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<float> DatasetGenerator::generate(const DatasetSettings & settings)
+{
+    uint64_t rows_per_planet   = rowsPerPlanet(settings);
+    uint64_t blocks_per_planet = (rows_per_planet + ROWS_PER_BLOCK - 1) / ROWS_PER_BLOCK;
+    uint64_t num_blocks        = blocks_per_planet * settings.planets.size();
+
+    std::vector<float> data(rows_per_planet * settings.planets.size() * NUM_COLUMNS);
+
+    if (num_blocks == 0)
+    {
+        return data;
+    }
+
+    int num_threads = settings.num_threads > 0 ? settings.num_threads : std::max(1, int(std::thread::hardware_concurrency()));
+    num_threads     = int(std::min<uint64_t>(num_threads, num_blocks));
+
+    /* Shared by all the threads */
+    std::vector<std::unique_ptr<PrecomputedSS>> atmospheres;
+    for (const PlanetParameters & planet : settings.planets)
+    {
+        atmospheres.push_back(std::make_unique<PrecomputedSS>(planetOptions(planet), settings.view_samples, settings.light_samples));
+    }
+
+    std::vector<Sobol3D> sobol;
+    std::mt19937 shift_rng(settings.seed);
+    for (size_t p = 0; p < settings.planets.size(); ++p)
+    {
+        sobol.push_back(Sobol3D(shift_rng(), shift_rng(), shift_rng()));
+    }
+
+    std::atomic<uint64_t> next_block(0);
+    std::atomic<int> finished_blocks(0);
+
+    printProgressBar(0, int(num_blocks), "Generating dataset:", "Complete");
+
+    auto process = [&]()
+    {
+        for (uint64_t block = next_block++; block < num_blocks; block = next_block++)
+        {
+            PROFILE_SCOPE("DatasetGenerator block");
+
+            size_t   planet_index = size_t(block / blocks_per_planet);
+            uint64_t begin        = (block % blocks_per_planet) * ROWS_PER_BLOCK;
+            uint64_t end          = std::min(begin + ROWS_PER_BLOCK, rows_per_planet);
+
+            const PlanetParameters & planet  = settings.planets[planet_index];
+            const PrecomputedSS & atmosphere = *atmospheres[planet_index];
+
+            double planet_radius_input     = planet.planet_radius     / settings.max_planet_radius;
+            double atmosphere_radius_input = planet.atmosphere_radius / settings.max_planet_radius;
+            double atmosphere_thickness    = (planet.atmosphere_radius - planet.planet_radius) / planet.planet_radius;
+
+            std::seed_seq seed{ settings.seed, uint32_t(planet_index), uint32_t(block % blocks_per_planet) };
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<double> jitter(0.0, 1.0);
+
+            for (uint64_t row = begin; row < end; ++row)
+            {
+                /* Normalized height, sun angle and view angle */
+                double u[3];
+
+                if (settings.sampling == DatasetSampling::SOBOL)
+                {
+                    sobol[planet_index].sample(uint32_t(row), u);
+                }
+                else
+                {
+                    int v = int(row % settings.view_angle_samples);
+                    int s = int(row / settings.view_angle_samples % settings.sun_angle_samples);
+                    int h = int(row / settings.view_angle_samples / settings.sun_angle_samples);
+
+                    if (settings.sampling == DatasetSampling::GRID)
+                    {
+                        u[0] = h / (settings.height_samples     - 1.0);
+                        u[1] = s / (settings.sun_angle_samples  - 1.0);
+                        u[2] = v / (settings.view_angle_samples - 1.0);
+                    }
+                    else
+                    {
+                        u[0] = (h + jitter(rng)) / settings.height_samples;
+                        u[1] = (s + jitter(rng)) / settings.sun_angle_samples;
+                        u[2] = (v + jitter(rng)) / settings.view_angle_samples;
+                    }
+                }
+
+                glm::highp_dvec3 rayleigh(0.0), mie(0.0);
+                atmosphere.calculateSingleScattering(glm::pi<double>() * u[2],
+                                                     glm::pi<double>() * u[1],
+                                                     1.0 + atmosphere_thickness * u[0],
+                                                     rayleigh,
+                                                     mie);
+
+                float* out = &data[(planet_index * rows_per_planet + row) * NUM_COLUMNS];
+                out[0] = float(u[0]);
+                out[1] = float(u[1]);
+                out[2] = float(u[2]);
+                out[3] = float(planet_radius_input);
+                out[4] = float(atmosphere_radius_input);
+                out[5] = float(rayleigh.r);
+                out[6] = float(rayleigh.g);
+                out[7] = float(rayleigh.b);
+                out[8] = float(mie.r);
+            }
+
+            printProgressBar(++finished_blocks, int(num_blocks), "Generating dataset:", "Complete");
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i)
+    {
+        threads.push_back(std::thread(process));
+    }
+
+    process();
+
+    for (auto & t : threads)
+    {
+        t.join();
+    }
+
+    std::printf("\n");
+
+    return data;
+}
+
+bool DatasetGenerator::saveNpy(const std::string & filename, const std::vector<float> & data, size_t columns)
+{
+    std::ofstream file(filename, std::ios::binary);
+
+    if (!file.good())
+    {
+        std::cerr << "Can't save file " << filename << std::endl;
+        return false;
+    }
+
+    /* Version 1.0 header, padded so that the data starts at a multiple of 64 bytes. Floats are written in the
+     * byte order of the machine, which is little endian on all the supported ones. */
+    std::string header = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + std::to_string(data.size() / columns) + ", " + std::to_string(columns) + "), }";
+    size_t preamble_size = 10;
+    header.append(63 - (preamble_size + header.size()) % 64, ' ');
+    header += '\n';
+
+    uint16_t header_size = uint16_t(header.size());
+
+    file.write("\x93NUMPY\x01\x00", 8);
+    file.put(char(header_size & 0xff));
+    file.put(char(header_size >> 8));
+    file << header;
+    file.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float));
+
+    if (!file.good())
+    {
+        std::cerr << "Can't save file " << filename << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct PlanetParameters
+{
+    std::string name;
+
+    double planet_radius;
+    double atmosphere_radius;
+    double h_rayleigh;
+    double h_mie;
+    glm::highp_dvec3 beta_rayleigh;
+    glm::highp_dvec3 beta_mie;
+};
+
+enum class DatasetSampling
+{
+    GRID,       // the points of the single scattering LUT, the same as saveSingleScatteringLUT()
+    STRATIFIED, // one random point in every cell of the LUT grid
+    SOBOL       // scrambled Sobol sequence
+};
+
+struct DatasetSettings
+{
+    std::vector<PlanetParameters> planets;
+
+    DatasetSampling sampling = DatasetSampling::SOBOL;
+
+    /* Samples per planet of the Sobol sampling, the grid resolution of the other ones */
+    uint32_t sobol_samples      = 1 << 21;
+    int      height_samples     = 128;
+    int      sun_angle_samples  = 128;
+    int      view_angle_samples = 128;
+
+    uint32_t view_samples  = 512;
+    uint32_t light_samples = 128;
+
+    /* Radii are divided by it in the NN inputs */
+    double max_planet_radius = 6360e3;
+
+    uint32_t seed        = 1;
+    int      num_threads = 0; // 0 means std::thread::hardware_concurrency()
+};
+
+/**
+  * Generates the single scattering datasets used to train the LUT based NNs, with the reference integrator of
+  * PrecomputedSS evaluated in parallel. Every row holds the NN inputs (height, sun angle, view angle, planet radius,
+  * atmosphere radius) and outputs (Rayleigh RGB, Mie R), like the rows of the text LUT files.
+  */
+class DatasetGenerator
+{
+public:
+    static const int NUM_COLUMNS = 9;
+
+    /* The planets of Options.h, by name (earth, venus, mars) */
+    static bool findPlanet(const std::string & name, PlanetParameters & planet);
+
+    /* Rows of all the planets, one after another. The result doesn't depend on the number of threads */
+    static std::vector<float> generate(const DatasetSettings & settings);
+
+    /* NumPy .npy file with a float32 array of rows x NUM_COLUMNS, it can be loaded with numpy.load() */
+    static bool saveNpy(const std::string & filename, const std::vector<float> & data, size_t columns);
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+  * First 3 dimensions of the Sobol sequence (direction numbers of Joe and Kuo), with a random digital shift.
+  * Points are computed directly from their index, so any range of them can be generated on any thread.
+  */
+class Sobol3D
+{
+public:
+    explicit Sobol3D(uint32_t shift_x = 0, uint32_t shift_y = 0, uint32_t shift_z = 0)
+        : m_shift{ shift_x, shift_y, shift_z }
+    {
+        /* Dimension 1 - van der Corput sequence */
+        for (int k = 0; k < 32; ++k)
+        {
+            m_directions[0][k] = 1u << (31 - k);
+        }
+
+        /* Dimension 2 - s = 1, a = 0, m = { 1 } */
+        m_directions[1][0] = 1u << 31;
+        for (int k = 1; k < 32; ++k)
+        {
+            m_directions[1][k] = m_directions[1][k - 1] ^ (m_directions[1][k - 1] >> 1);
+        }
+
+        /* Dimension 3 - s = 2, a = 1, m = { 1, 3 } */
+        m_directions[2][0] = 1u << 31;
+        m_directions[2][1] = 3u << 30;
+        for (int k = 2; k < 32; ++k)
+        {
+            m_directions[2][k] = m_directions[2][k - 2] ^ (m_directions[2][k - 2] >> 2) ^ m_directions[2][k - 1];
+        }
+    }
+
+    /* Point of the given index, in [0, 1)^3 */
+    void sample(uint32_t index, double out[3]) const
+    {
+        for (int d = 0; d < 3; ++d)
+        {
+            uint32_t x = m_shift[d];
+
+            for (int k = 0; index >> k; ++k)
+            {
+                if ((index >> k) & 1u)
+                {
+                    x ^= m_directions[d][k];
+                }
+            }
+
+            out[d] = x / 4294967296.0;
+        }
+    }
+
+private:
+    uint32_t m_directions[3][32];
+    uint32_t m_shift[3];
+};
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "DatasetGenerator.h"
+#include "raytracer/Timing.h"
+#include "util/profiling.h"
+
+/* Usage: AtmosphereDatasetGenerator [--planets earth,venus,mars] [--sampling sobol|stratified|grid] [--samples N]
+ *                                   [--resolution H S V] [--view-samples N] [--light-samples N]
+ *                                   [--max-planet-radius R] [--seed N] [--threads N] [--output dataset.npy]
+ * Generates the training dataset of the LUT based NNs and saves it as a NumPy .npy file */
+int main(int argc, char ** argv)
+{
+    DatasetSettings settings;
+    std::string planets     = "earth";
+    std::string sampling    = "sobol";
+    std::string output_file = "dataset.npy";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg   = argv[i];
+        int num_values    = arg == "--resolution" ? 3 : 1;
+
+        if (i + num_values >= argc)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return -1;
+        }
+
+        const char* value = argv[i + 1];
+
+        if      (arg == "--planets")           planets                    = value;
+        else if (arg == "--sampling")          sampling                   = value;
+        else if (arg == "--samples")           settings.sobol_samples     = std::stoul(value);
+        else if (arg == "--view-samples")      settings.view_samples      = std::stoul(value);
+        else if (arg == "--light-samples")     settings.light_samples     = std::stoul(value);
+        else if (arg == "--max-planet-radius") settings.max_planet_radius = std::stod(value);
+        else if (arg == "--seed")              settings.seed              = std::stoul(value);
+        else if (arg == "--threads")           settings.num_threads       = std::stoi(value);
+        else if (arg == "--output")            output_file                = value;
+        else if (arg == "--resolution")
+        {
+            settings.height_samples     = std::stoi(argv[i + 1]);
+            settings.sun_angle_samples  = std::stoi(argv[i + 2]);
+            settings.view_angle_samples = std::stoi(argv[i + 3]);
+        }
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return -1;
+        }
+        i += num_values;
+    }
+
+    if      (sampling == "sobol")      settings.sampling = DatasetSampling::SOBOL;
+    else if (sampling == "stratified") settings.sampling = DatasetSampling::STRATIFIED;
+    else if (sampling == "grid")       settings.sampling = DatasetSampling::GRID;
+    else
+    {
+        std::cerr << "Unknown sampling " << sampling << std::endl;
+        return -1;
+    }
+
+    std::stringstream planet_names(planets);
+    std::string name;
+    while (std::getline(planet_names, name, ','))
+    {
+        PlanetParameters planet;
+        if (!DatasetGenerator::findPlanet(name, planet))
+        {
+            std::cerr << "Unknown planet " << name << std::endl;
+            return -1;
+        }
+        settings.planets.push_back(planet);
+    }
+
+    profiling::SetEnabled(true);
+
+    auto start_time = Timing::getTime();
+    std::vector<float> data = DatasetGenerator::generate(settings);
+
+    std::cout << data.size() / DatasetGenerator::NUM_COLUMNS << " rows generated in " << Timing::getTime() - start_time << "s" << std::endl;
+    profiling::PrintSummary(std::cout);
+
+    if (!DatasetGenerator::saveNpy(output_file, data, DatasetGenerator::NUM_COLUMNS))
+    {
+        return -1;
+    }
+
+    std::cout << "Dataset saved to " << output_file << std::endl;
+    return 0;
+}
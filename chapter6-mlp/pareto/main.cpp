@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "raytracer/Framebuffer.h"
+#include "raytracer/Scene.h"
+#include "raytracer/Timing.h"
+#include "skymodels/midpoint/Midpoint.h"
+#include "skymodels/precomputed_ss/PrecomputedSS.h"
+#include "skymodels/deep_as/DeepAS.h"
+#include "util/benchmark.h"
+#include "util/pareto.h"
+
+#include "RootDir.h"
+
+namespace
+{
+    /* Same LUT parameters as in main.cpp, so that the reference LUT file is shared */
+    const unsigned LUT_VIEW_SAMPLES         = 512;
+    const unsigned LUT_LIGHT_SAMPLES        = 128;
+    const unsigned REFERENCE_LUT_RESOLUTION = 128;
+
+    /* Sun directions of the Kider measurements, as in main.cpp */
+    const double SUN_ZENITHS[]  = { 48.9379, 46.2088, 43.5081, 40.846, 38.2352, 35.6912, 33.2334, 30.8862, 28.6804, 26.6542, 24.8547, 23.3369, 22.1608, 21.3844, 21.053, 21.1879, 21.7802 };
+    const double SUN_AZIMUTHS[] = { 98.1425, 101.094, 104.233, 107.600, 111.244, 115.223, 119.609, 124.483, 129.936, 136.066, 142.959, 150.668, 159.179, 168.365, 177.978, 187.669, 197.073 };
+
+    /* A configuration of a model, create() returns a new instance of it (with its precomputations done) */
+    struct Candidate
+    {
+        std::string method;
+        std::string parameters;
+        std::function<std::unique_ptr<Atmosphere>()> create;
+    };
+
+    /* Loads the single scattering LUT with the given resolution, or precomputes and saves it if there is none */
+    std::unique_ptr<Atmosphere> createPrecomputedSS(const Options & options, unsigned resolution)
+    {
+        std::string file_name = "ss_lut_" + std::to_string(LUT_VIEW_SAMPLES)  + "_" +
+                                            std::to_string(LUT_LIGHT_SAMPLES) + "_" +
+                                            std::to_string(resolution)        + "_" +
+                                            std::to_string(resolution)        + "_" +
+                                            std::to_string(resolution)        + "_rm_earth.txt";
+
+        std::unique_ptr<PrecomputedSS> atmosphere(new PrecomputedSS(options, LUT_VIEW_SAMPLES, LUT_LIGHT_SAMPLES));
+        atmosphere->loadSingleScatteringLUTToVector(file_name);
+
+        auto lut = atmosphere->getLUT();
+        if (lut.empty())
+        {
+            atmosphere->precomputeSingleScattering(resolution, resolution, resolution);
+            atmosphere->saveSingleScatteringLUT(file_name);
+            lut = atmosphere->getLUT();
+        }
+
+        atmosphere->loadSingleScatteringLUT(lut);
+        return std::unique_ptr<Atmosphere>(std::move(atmosphere));
+    }
+
+    std::vector<FrameState> getFrames(int stride)
+    {
+        std::vector<FrameState> frames;
+        for (size_t i = 0; i < sizeof(SUN_ZENITHS) / sizeof(SUN_ZENITHS[0]); i += stride)
+        {
+            FrameState frame;
+            frame.zenith_angle  = glm::radians(SUN_ZENITHS[i]);
+            frame.azimuth_angle = glm::radians(SUN_AZIMUTHS[i]);
+            frame.sun_direction = glm::normalize(glm::highp_dvec3( glm::cos(frame.azimuth_angle) * glm::sin(frame.zenith_angle),
+                                                                  -glm::cos(frame.zenith_angle),
+                                                                   glm::sin(frame.azimuth_angle) * glm::sin(frame.zenith_angle)));
+            frames.push_back(frame);
+        }
+        return frames;
+    }
+}
+
+/* Usage: AtmosphereParetoExplorer [--methods midpoint,precomputed_ss,deep_as] [--midpoint-samples 4,8,...,256]
+ *                                 [--midpoint-light-samples 4,8,16] [--lut-resolutions 16,32,64]
+ *                                 [--networks a.model,b.model] [--resolution N] [--stride N] [--platform name]
+ *                                 [--max-delta-e 1,2,3,5]
+ * Explores the accuracy versus cost trade-off of the models: renders the fisheye view of the Kider measurements
+ * (every stride-th sun direction) with each configuration, on the calling thread, and compares the renders with
+ * the ones of Elek's model with a 128^3 LUT. The cost of a configuration is its median render time per frame, and
+ * its error is the mean CIE76 colour difference of its renders. Prints the Pareto frontier of the configurations,
+ * and the cheapest one meeting each colour difference budget, and saves all of them to output/pareto_<platform>.txt */
+int main(int argc, char ** argv)
+{
+    std::string methods          = "";
+    std::string midpoint_samples = "4,8,16,32,64,128,256";
+    std::string midpoint_light   = "4,8,16";
+    std::string lut_resolutions  = "16,32,64";
+    std::string networks         = ROOT_DIR "/res/nn_lut_512_128_32_32_32_rm_earth_3layers-437.model,"
+                                   ROOT_DIR "/res/nn_lut_512_128_32_32_32_rm_earth_3layers-1559.model,"
+                                   ROOT_DIR "/res/nn_lut_512_128_64_64_64_rm_earth_3layers-390.model,"
+                                   ROOT_DIR "/res/nn_lut_512_128_128_128_128_rm_earth_3layers-186.model,"
+                                   ROOT_DIR "/res/nn_lut_512_128_128_128_128_rm_earth_10layers-587.model";
+    std::string platform         = "host";
+    std::string max_delta_e      = "1,2,3,5";
+    uint32_t resolution          = 128;
+    int stride                   = 4;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return -1;
+        }
+
+        const char* value = argv[++i];
+
+        if      (arg == "--methods")                methods          = value;
+        else if (arg == "--midpoint-samples")       midpoint_samples = value;
+        else if (arg == "--midpoint-light-samples") midpoint_light   = value;
+        else if (arg == "--lut-resolutions")        lut_resolutions  = value;
+        else if (arg == "--networks")               networks         = value;
+        else if (arg == "--resolution")             resolution       = uint32_t(std::stoul(value));
+        else if (arg == "--stride")                 stride           = std::max(1, std::stoi(value));
+        else if (arg == "--platform")               platform         = value;
+        else if (arg == "--max-delta-e")            max_delta_e      = value;
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    Options options;
+    Scene::loadScene("fisheye_res.txt", options);
+    options.WIDTH            = resolution;
+    options.HEIGHT           = resolution;
+    options.OUTPUT_FILE_NAME = "";
+
+    std::vector<Candidate> candidates;
+    for (const std::string & samples : benchmark::SplitList(midpoint_samples))
+    {
+        for (const std::string & light_samples : benchmark::SplitList(midpoint_light))
+        {
+            Options model_options                = options;
+            model_options.MIDPOINT_SAMPLES       = uint32_t(std::stoul(samples));
+            model_options.MIDPOINT_SAMPLES_LIGHT = uint32_t(std::stoul(light_samples));
+            candidates.push_back({ "midpoint", "samples=" + samples + ",light_samples=" + light_samples,
+                                   [model_options]() { return std::unique_ptr<Atmosphere>(new Midpoint(model_options)); } });
+        }
+    }
+    for (const std::string & lut_resolution : benchmark::SplitList(lut_resolutions))
+    {
+        unsigned lut_size = unsigned(std::stoul(lut_resolution));
+        candidates.push_back({ "precomputed_ss", "lut=" + lut_resolution + "^3",
+                               [&options, lut_size]() { return createPrecomputedSS(options, lut_size); } });
+    }
+    for (const std::string & network : benchmark::SplitList(networks))
+    {
+        std::string network_name = network.substr(network.find_last_of("/\\") + 1);
+        candidates.push_back({ "deep_as", "network=" + network_name,
+                               [&options, network]() { return std::unique_ptr<Atmosphere>(new DeepAS(options, network)); } });
+    }
+
+    std::vector<std::string> method_names = benchmark::SplitList(methods);
+    std::vector<FrameState> frames        = getFrames(stride);
+    size_t num_pixels                     = size_t(options.WIDTH) * options.HEIGHT;
+
+    std::cout << "Rendering the reference..." << std::endl;
+    std::vector<std::vector<glm::highp_dvec3>> reference_renders;
+    {
+        std::unique_ptr<Atmosphere> reference = createPrecomputedSS(options, REFERENCE_LUT_RESOLUTION);
+        Framebuffer framebuffer(options);
+        for (const FrameState & frame : frames)
+        {
+            framebuffer.renderFrame(*reference, frame);
+            reference_renders.push_back(framebuffer.getTonemappedData());
+        }
+    }
+
+    std::vector<pareto::Configuration> configurations;
+    for (const Candidate & candidate : candidates)
+    {
+        if (!method_names.empty() && std::find(method_names.begin(), method_names.end(), candidate.method) == method_names.end())
+        {
+            continue;
+        }
+
+        std::cout << "Exploring " << candidate.method << " " << candidate.parameters << "..." << std::endl;
+        std::unique_ptr<Atmosphere> atmosphere = candidate.create();
+        Framebuffer framebuffer(options);
+
+        std::vector<double> render_times;
+        double delta_e_sum = 0.0;
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            double start_time = Timing::getTime();
+            framebuffer.renderFrame(*atmosphere, frames[i]);
+            render_times.push_back(Timing::getTime() - start_time);
+
+            std::vector<glm::highp_dvec3> render = framebuffer.getTonemappedData();
+            delta_e_sum += Framebuffer::compareImages(reference_renders[i].data(), render.data(), num_pixels).mean_delta_e;
+        }
+
+        std::nth_element(render_times.begin(), render_times.begin() + render_times.size() / 2, render_times.end());
+        configurations.push_back({ candidate.method, candidate.parameters,
+                                   render_times[render_times.size() / 2] * 1000.0, delta_e_sum / frames.size() });
+    }
+
+    std::vector<double> budgets;
+    for (const std::string & budget : benchmark::SplitList(max_delta_e))
+    {
+        budgets.push_back(std::stod(budget));
+    }
+
+    std::string table_file_name = ROOT_DIR "/output/pareto_" + platform + ".txt";
+    if (!pareto::WriteTable(table_file_name, configurations, "ms_per_frame", "delta_e"))
+    {
+        std::cerr << "Can't save file " << table_file_name << std::endl;
+        return -1;
+    }
+
+    pareto::PrintSummary(std::cout, configurations, budgets, "ms_per_frame", "delta_e");
+    std::cout << "Configurations saved to " << table_file_name << std::endl;
+    return 0;
+}
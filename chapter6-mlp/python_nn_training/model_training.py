@@ -26,8 +26,12 @@ def load_dataset(filename: str, directory: str, num_skiprows: int = 0):
 
     start = time.time()
 
-    data = pd.read_csv(directory + filename, sep=' ', header=None, skiprows=num_skiprows)
-    dataset = data.values
+    # Binary datasets generated by AtmosphereDatasetGenerator
+    if filename.endswith('.npy'):
+        dataset = np.load(directory + filename).astype(np.float64)
+    else:
+        data = pd.read_csv(directory + filename, sep=' ', header=None, skiprows=num_skiprows)
+        dataset = data.values
 
     end = time.time()
     print("File loading time: %.2fs" % (end - start))
@@ -333,6 +337,10 @@ def train_nn_multi_planets():
     dataset_planets = np.concatenate((dataset_earth, dataset_venus, dataset_mars))
     model_filename = "nn_lut_512_128_128_128_128_rm_multi_planets"
 
+    # Or a dataset of all the planets generated by AtmosphereDatasetGenerator, e.g. with
+    # --planets earth,venus,mars --sampling sobol --samples 2097152 --output ../output/ss_dataset_multi_planets.npy
+    # dataset_planets = load_dataset("ss_dataset_multi_planets.npy", '../output/')
+
     # Train only on 6 imaginary planets to recreate Earth, Venus and Mars
     # dataset_im1 = load_dataset("ss_lut_512_128_128_128_128_rm_im1.txt", '../output/', num_skiprows=1)
     # dataset_im2 = load_dataset("ss_lut_512_128_128_128_128_rm_im2.txt", '../output/', num_skiprows=1)
@@ -4,15 +4,25 @@
 
 #include "RootDir.h"
 #include "raytracer/Framebuffer.h"
-#include "raytracer/Timing.h"
+#include "raytracer/SequenceRenderer.h"
 #include "skymodels/midpoint/Midpoint.h"
 #include "skymodels/precomputed_ss/PrecomputedSS.h"
 #include "skymodels/deep_as/DeepAS.h"
 #include "skymodels/img_based/ImgBased.h"
+#include "util/profiling.h"
 #include <include/stb_image_write.h>
 
 #define FIGURES_DIR ROOT_DIR "/output/figures/"
 
+/* Prints the time spent in each profiling scope and saves the trace, which can be opened in chrome://tracing */
+void saveProfile()
+{
+    std::cout << "Profile:" << std::endl;
+    profiling::PrintSummary(std::cout);
+    profiling::WriteChromeTrace(FIGURES_DIR "profile_trace.json");
+    profiling::WriteFoldedStacks(FIGURES_DIR "profile_stacks.txt");
+}
+
 /**
   * Enable to generate comparisons and image data like luminance, chromaticity, RMSE.
   * Disable to turn on normal rendering mode, based on below settings, for the enabled methods.
@@ -66,82 +76,79 @@ struct Measurement
     double sun_azimuth;
 };
 
-void calcRMSE(const std::string& name_ref, const std::string& name_src, std::vector<Measurement>& measurements, Options options, double color_error_scale=40.0)
+/* Tone mapped renders of one method, one per measurement */
+typedef std::vector<std::vector<glm::highp_dvec3>> Renders;
+
+/* Loads renders saved as PNG files, for the ones which are not rendered in this run (e.g. Kider's photographs) */
+Renders loadRenders(const std::string& name, const std::vector<Measurement>& measurements)
 {
-    Framebuffer framebuffer(options);
+    Renders renders;
 
     for (auto& m : measurements)
     {
-        std::vector<std::string> experiments = { "rel_error" };
+        std::string renders_dir = ROOT_DIR "/output/egsr/1_renders/";
+        std::string renders_pre_filename = "renders_" + time_to_string(m.hours) + "h" + time_to_string(m.minutes) + "_";
 
-        for (int i = 0; i < experiments.size(); ++i)
-        {
-            std::string dir = ROOT_DIR "/output/egsr/4_" + experiments[i] + "/";
-            std::string pre_filename = experiments[i] + "_" + time_to_string(m.hours) + "h" + time_to_string(m.minutes) + "_";
+        int width, height;
+        renders.push_back(Framebuffer::loadImg(renders_dir + renders_pre_filename + name + ".png", width, height));
+    }
 
-            std::string renders_dir = ROOT_DIR "/output/egsr/1_renders/";
-            std::string renders_pre_filename = "renders_" + time_to_string(m.hours) + "h" + time_to_string(m.minutes) + "_";
+    return renders;
+}
 
-            auto ref = framebuffer.loadImg(renders_dir + renders_pre_filename + name_ref + ".png");
-            auto src = framebuffer.loadImg(renders_dir + renders_pre_filename + name_src + ".png");
+/* Computes the errors from the renders in memory, without their 8-bit quantization, and returns the RMSE of each measurement */
+std::vector<double> calcRMSE(const std::string& name_ref, const std::string& name_src, std::vector<Measurement>& measurements, Options options,
+                             const Renders& ref, const Renders& src, double color_error_scale=40.0)
+{
+    std::vector<double> rmse_values;
+    std::vector<glm::highp_dvec3> error_image(options.WIDTH * options.HEIGHT);
 
-            double mse;
-            framebuffer.saveImg(dir + pre_filename + name_ref + "_vs_" + name_src, framebuffer.getMSE(ref, src, mse, color_error_scale));
-            
-            double rmse = std::sqrt(mse);
+    for (uint32_t j = 0; j < measurements.size(); ++j)
+    {
+        auto& m = measurements[j];
 
-            /* Save rmse to a file */
-            std::ofstream out_file(dir + pre_filename + name_ref + "_vs_" + name_src + ".txt");
-            if (out_file.good())
-            {
-                out_file << rmse;
-            }
-            else
-            {
-                std::cout << "cant open file!" << std::endl;
-            }
-            out_file.close();
+        std::string experiment = "rel_error";
+        std::string dir = ROOT_DIR "/output/egsr/4_" + experiment + "/";
+        std::string pre_filename = experiment + "_" + time_to_string(m.hours) + "h" + time_to_string(m.minutes) + "_";
+
+        ImageMetrics metrics = Framebuffer::compareImages(ref[j].data(), src[j].data(), error_image.size(), error_image.data(), color_error_scale);
+        Framebuffer::saveImg(dir + pre_filename + name_ref + "_vs_" + name_src, options.WIDTH, options.HEIGHT, error_image);
+
+        std::cout << "rmse = " << metrics.rmse << ", max err = " << metrics.max_error << ", min err = " << metrics.min_error
+                  << ", psnr = " << metrics.psnr << " dB, mean delta E = " << metrics.mean_delta_e << std::endl;
+
+        double rmse = metrics.rmse;
+        rmse_values.push_back(rmse);
+
+        /* Save rmse to a file */
+        std::ofstream out_file(dir + pre_filename + name_ref + "_vs_" + name_src + ".txt");
+        if (out_file.good())
+        {
+            out_file << rmse;
+        }
+        else
+        {
+            std::cout << "cant open file!" << std::endl;
         }
+        out_file.close();
     }
+
+    return rmse_values;
 }
 
-void calcAvgRMSE(const std::string& name_ref, const std::string& name_src, std::vector<Measurement>& measurements)
+void calcAvgRMSE(const std::string& name_ref, const std::string& name_src, const std::vector<double>& rmse_values)
 {
     double avg_rmse = 0.0;
-    int samples_count = 0;
-
-    std::vector<std::string> experiments = { "rel_error" };
 
-    for (auto& m : measurements)
+    for (double rmse : rmse_values)
     {
-        for (int i = 0; i < experiments.size(); ++i)
-        {
-            std::string dir = ROOT_DIR "/output/egsr/4_" + experiments[i] + "/";
-            std::string pre_filename = experiments[i] + "_" + time_to_string(m.hours) + "h" + time_to_string(m.minutes) + "_";
-
-            /* Load file and compute rmse */
-            double rmse = 0.0;
-            
-            std::ifstream in_file(dir + pre_filename + name_ref + "_vs_" + name_src + ".txt");
-            if (in_file.good())
-            {
-                in_file >> rmse;
-            }
-            else
-            {
-                std::cout << "cant open file!" << std::endl;
-            }
-            in_file.close();
-            
-            samples_count++;
-            avg_rmse += rmse;
-        }
+        avg_rmse += rmse;
     }
 
-    avg_rmse = avg_rmse / double(samples_count);
+    avg_rmse = avg_rmse / double(rmse_values.size());
 
     /* Save rmse to a file */
-    std::string dir = ROOT_DIR "/output/egsr/4_" + experiments[0] + "/";
+    std::string dir = ROOT_DIR "/output/egsr/4_rel_error/";
 
     std::ofstream out_file(dir + "avg_rmse_" + name_ref + "_vs_" + name_src + ".txt");
     if (out_file.good())
@@ -155,8 +162,10 @@ void calcAvgRMSE(const std::string& name_ref, const std::string& name_src, std::
     out_file.close();
 }
 #if !MANUAL_EXPERIMENTS
-void doExperiments(Atmosphere& atmosphere, const std::string& name, std::vector<Measurement>& measurements, Options options, double exposure = 1.0)
+Renders doExperiments(const Atmosphere& atmosphere, const std::string& name, std::vector<Measurement>& measurements, Options options, double exposure = 1.0)
 {
+    Renders renders;
+
     for (auto& m : measurements)
     {
         auto zenith_angle = glm::radians(m.sun_zenith);
@@ -166,11 +175,20 @@ void doExperiments(Atmosphere& atmosphere, const std::string& name, std::vector<
             -glm::cos(zenith_angle),
             glm::sin(azimuth_angle) * glm::sin(zenith_angle)));
 
+        FrameState frame;
+        frame.sun_direction = options.SUN_DIRECTION;
+        frame.zenith_angle  = zenith_angle;
+        frame.azimuth_angle = azimuth_angle;
+
         Framebuffer framebuffer(options);
-        atmosphere.setSunDirection(options.SUN_DIRECTION);
-        atmosphere.m_zenith_angle = zenith_angle;
-        atmosphere.m_azimuth_angle = azimuth_angle;
-        framebuffer.render(atmosphere);
+        {
+            PROFILE_SCOPE(profiling::Intern(name));
+            framebuffer.render(atmosphere, frame);
+        }
+
+        /* Raw HDR render, the other outputs are derived from the tone mapped one */
+        framebuffer.saveRenderHDR(ROOT_DIR "/output/egsr/0_hdr/hdr_" + time_to_string(m.hours) + "h" + time_to_string(m.minutes) + "_" + name);
+        renders.push_back(framebuffer.getTonemappedData(exposure));
 
         std::vector<std::string> experiments = { "renders", "abs_luminance", "chroma" };
 
@@ -188,18 +206,22 @@ void doExperiments(Atmosphere& atmosphere, const std::string& name, std::vector<
                 framebuffer.saveRender(true, exposure);
                 break;
             case 1: // abs luminance
-                framebuffer.saveImg(filename, framebuffer.getLuminance(framebuffer.getFramebufferRawData()));
+                framebuffer.saveImg(filename, framebuffer.getLuminance(renders.back()));
                 break;
             case 2: // chromaticity
-                framebuffer.saveImg(filename, framebuffer.getChromaticity(framebuffer.getFramebufferRawData()));
+                framebuffer.saveImg(filename, framebuffer.getChromaticity(renders.back()));
                 break;
             }
         }
     }
+
+    return renders;
 }
 
 int main(int argc, char** argv)
 {
+    profiling::SetEnabled(true);
+
     int sizeof_vec3 = sizeof(glm::vec4);
 
     // 6, 7, 8, 9_30, 10_30, 11_30, 12_30, 13_30
@@ -269,49 +291,46 @@ int main(int argc, char** argv)
     /* Perform experiments */
     std::cout << "Calculating Deep ..." << std::endl;
 #if !USE_10LAYERS
-    doExperiments(atmosphere_deep, "deep", measurements, options); 
+    Renders deep_renders = doExperiments(atmosphere_deep, "deep", measurements, options); 
 #else
-    doExperiments(atmosphere_deep, "deep_10layers", measurements, options); 
+    Renders deep_renders = doExperiments(atmosphere_deep, "deep_10layers", measurements, options); 
 #endif
     std::cout << std::endl;
 
     std::cout << "Calculating ImgBased ..." << std::endl;
 #if !IMG_BASED_TF
     #if USE_IMG_BASED_SYNTH
-    doExperiments(atmosphere_img_based, "img_based_synth", measurements, options); 
+    Renders img_based_renders = doExperiments(atmosphere_img_based, "img_based_synth", measurements, options); 
     #else
     Framebuffer::FLIP_HORIZONTALLY = true;
     Framebuffer::FLIP_VERTICALLY   = true;
-    doExperiments(atmosphere_img_based, "img_based_real", measurements, options, 0.28); 
+    Renders img_based_renders = doExperiments(atmosphere_img_based, "img_based_real", measurements, options, 0.28); 
     #endif
 #else
     Framebuffer::FLIP_HORIZONTALLY = true;
     Framebuffer::FLIP_VERTICALLY   = true;
-    doExperiments(atmosphere_img_based, "img_based_tf", measurements, options, 0.28); 
+    Renders img_based_renders = doExperiments(atmosphere_img_based, "img_based_tf", measurements, options, 0.28); 
 #endif
     Framebuffer::FLIP_HORIZONTALLY = false;
     Framebuffer::FLIP_VERTICALLY = false;
     std::cout << std::endl;
 
     std::cout << "Calculating Elek ..." << std::endl;
-    doExperiments(atmosphere_elek, "elek", measurements, options); 
+    Renders elek_renders = doExperiments(atmosphere_elek, "elek", measurements, options); 
     std::cout << std::endl;
 
     /* Calculate RMSE for each image and average */
     std::cout << "Calculating RMSE Elek vs Deep..." << std::endl;
 #if !USE_10LAYERS
-    calcRMSE("elek", "deep", measurements, options); 
-    calcAvgRMSE("elek", "deep", measurements); 
+    calcAvgRMSE("elek", "deep", calcRMSE("elek", "deep", measurements, options, elek_renders, deep_renders)); 
 #else
-    calcRMSE("elek", "deep_10layers", measurements, options);
-    calcAvgRMSE("elek", "deep_10layers", measurements); 
+    calcAvgRMSE("elek", "deep_10layers", calcRMSE("elek", "deep_10layers", measurements, options, elek_renders, deep_renders)); 
 #endif
     std::cout << std::endl;
 
 #if 0
     std::cout << "Calculating RMSE Elek vs ImgBased synth..." << std::endl;
-    calcRMSE("elek", "img_based_synth", measurements, options, 30.0); 
-    calcAvgRMSE("elek", "img_based_synth", measurements);
+    calcAvgRMSE("elek", "img_based_synth", calcRMSE("elek", "img_based_synth", measurements, options, elek_renders, img_based_renders, 30.0));
     std::cout << std::endl;
 #endif
 
@@ -319,19 +338,19 @@ int main(int argc, char** argv)
     measurements = { {9, 30, 0.0, 0.0}, {9, 45, 0.0, 0.0}, {10, 0, 0.0, 0.0}, {10, 15, 0.0, 0.0}, {10, 30, 0.0, 0.0}, {10, 45, 0.0, 0.0}, {11, 0, 0.0, 0.0}, 
                      {11, 15, 0.0, 0.0}, {11, 30, 0.0, 0.0}, {11, 45, 0.0, 0.0}, {12, 0, 0.0, 0.0}, {12, 15, 0.0, 0.0}, {12, 30, 0.0, 0.0}, {12, 45, 0.0, 0.0}, {13, 0, 0.0, 0.0} };
     std::cout << "Calculating RMSE Kiders vs ImgBased TF..." << std::endl;
-    calcRMSE("kiders", "img_based_tf", measurements, options, 2.5);
-    calcAvgRMSE("kiders", "img_based_tf", measurements);
+    calcAvgRMSE("kiders", "img_based_tf", calcRMSE("kiders", "img_based_tf", measurements, options, loadRenders("kiders", measurements), loadRenders("img_based_tf", measurements), 2.5));
     std::cout << std::endl;
 
     std::cout << "Calculating RMSE Kiders vs ImgBased Real..." << std::endl;
-    calcRMSE("kiders", "img_based_real", measurements, options, 2.5);
-    calcAvgRMSE("kiders", "img_based_real", measurements);
+    calcAvgRMSE("kiders", "img_based_real", calcRMSE("kiders", "img_based_real", measurements, options, loadRenders("kiders", measurements), loadRenders("img_based_real", measurements), 2.5));
     std::cout << std::endl;
 #endif
 
     Framebuffer::createColorScaleBar(ROOT_DIR "/output/color_scale_luminance", Framebuffer::ColorScaleBarType::LUMINANCE, 400);
     Framebuffer::createColorScaleBar(ROOT_DIR "/output/color_scale_rmse",      Framebuffer::ColorScaleBarType::RMSE,      400);
 
+    saveProfile();
+
     return EXIT_SUCCESS;
 }
 #elif MANUAL_EXPERIMENTS
@@ -401,6 +420,8 @@ int main(int argc, char** argv)
 #else
 int main(int argc, char ** argv)
 {
+    profiling::SetEnabled(true);
+
     std::string scene_file_name;
 
     std::vector<std::string> all_args(argv + 1, argv + argc);
@@ -468,6 +489,9 @@ int main(int argc, char ** argv)
         options.printConfiguration();
         std::string output_file_name = options.OUTPUT_FILE_NAME;
 
+        FrameState frame;
+        frame.sun_direction = options.SUN_DIRECTION;
+
         #if ENABLE_MIDPOINT
         {
             options.OUTPUT_FILE_NAME = FIGURES_DIR + output_file_name + std::string("_") + "midpoint" + mie_phase_func_name;
@@ -475,9 +499,11 @@ int main(int argc, char ** argv)
             Framebuffer framebuffer(options);
             Midpoint atmosphere(options);
 
-            auto start_time = Timing::getTime();
-            framebuffer.render(atmosphere);
-            std::cout << "\n" << "Midpoint processing time = " << Timing::getTime() - start_time << "s" << std::endl << std::endl;
+            {
+                PROFILE_SCOPE("Midpoint");
+                framebuffer.render(atmosphere, frame);
+            }
+            std::cout << std::endl;
         }
         #endif
 
@@ -488,9 +514,11 @@ int main(int argc, char ** argv)
             Framebuffer framebuffer(options);
             DeepAS atmosphere(options);
 
-            auto start_time = Timing::getTime();
-            framebuffer.render(atmosphere);
-            std::cout << "\n" << "Deep Atmospheric Scattering processing time = " << Timing::getTime() - start_time << "s" << std::endl << std::endl;
+            {
+                PROFILE_SCOPE("DeepAS");
+                framebuffer.render(atmosphere, frame);
+            }
+            std::cout << std::endl;
         }
         #endif
 
@@ -501,9 +529,11 @@ int main(int argc, char ** argv)
             Framebuffer framebuffer(options);
             ImgBased atmosphere(options);
 
-            auto start_time = Timing::getTime();
-            framebuffer.render(atmosphere);
-            std::cout << "\n" << "Image Based NN processing time = " << Timing::getTime() - start_time << "s" << std::endl << std::endl;
+            {
+                PROFILE_SCOPE("ImgBased");
+                framebuffer.render(atmosphere, frame);
+            }
+            std::cout << std::endl;
         }
         #endif
 
@@ -517,18 +547,17 @@ int main(int argc, char ** argv)
             
             atmosphere.loadSingleScatteringLUT(precomputed_lut);
 
-            auto start_time = Timing::getTime();
-            framebuffer.render(atmosphere);
-            std::cout << "\n" << "Elek processing time = " << Timing::getTime() - start_time << "s" << std::endl << std::endl;
+            {
+                PROFILE_SCOPE("Elek");
+                framebuffer.render(atmosphere, frame);
+            }
+            std::cout << std::endl;
         }
         #endif
     }
 
     std::cout << std::endl;
 #else
-	/**
-      * Remember to disable multithreading in Framebuffer::render() for Release version. [TODO: This should be improved in the following versions of the code]
-	  */
     /* Render animation */
     {
         Options options;
@@ -540,7 +569,7 @@ int main(int argc, char ** argv)
 
         options.OUTPUT_FILE_NAME = FIGURES_DIR "animation/" + output_file_name + "_" + "precomputed_ea" + mie_phase_func_name;
 
-        PrecomputedSS atmosphere(options, view_samples, light_samples, FIGURES_DIR "animation/synth_ea_dataset.txt");
+        PrecomputedSS atmosphere(options, view_samples, light_samples);
         atmosphere.loadSingleScatteringLUTToVector(precomputed_file_name);
 
         if (atmosphere.getLUT().empty())
@@ -549,13 +578,11 @@ int main(int argc, char ** argv)
             atmosphere.saveSingleScatteringLUT(precomputed_file_name);
         }
 
-        auto start_time = Timing::getTime();
-
         unsigned num_zenith_angles  = 30;
         unsigned num_azimuth_angles = 30;
         unsigned total_frames = num_zenith_angles * num_azimuth_angles;
 
-        printf("Rendering image sequence of %d frames.\n\n", total_frames);
+        std::vector<SequenceFrame> frames;
         for (unsigned z = 0; z < num_zenith_angles; ++z)
         {
             double zenith_angle = glm::pi<double>() / (num_zenith_angles - 1) * z;
@@ -565,27 +592,34 @@ int main(int argc, char ** argv)
                 int    index         = z * num_zenith_angles + a;
                 double azimuth_angle = glm::pi<double>() / (num_azimuth_angles - 1) * a;
 
-                printf("Rendering image %d/%d, (%.2fm %.2fm) (elevation, azimuth)\n", index + 1, total_frames, glm::degrees(zenith_angle), glm::degrees(azimuth_angle));
-                options.OUTPUT_FILE_NAME = FIGURES_DIR "animation/" + output_file_name + "_" + "precomputed_ea" + std::to_string(index);
+                SequenceFrame frame;
+                frame.output_file_name = FIGURES_DIR "animation/" + output_file_name + "_" + "precomputed_ea" + std::to_string(index);
+                frame.state.sun_direction = glm::normalize(glm::highp_dvec3( glm::cos(azimuth_angle) * glm::sin(zenith_angle),
+                                                                            -glm::cos(zenith_angle),
+                                                                             glm::sin(azimuth_angle) * glm::sin(zenith_angle)));
+                frame.state.zenith_angle  = zenith_angle;
+                frame.state.azimuth_angle = azimuth_angle;
 
-                atmosphere.setSunDirection(glm::highp_dvec3( glm::cos(azimuth_angle)* glm::sin(zenith_angle),
-                                                            -glm::cos(zenith_angle),
-                                                             glm::sin(azimuth_angle)* glm::sin(zenith_angle)));
-                atmosphere.m_azimuth_angle = azimuth_angle;
-                atmosphere.m_zenith_angle = zenith_angle;
-
-                Framebuffer framebuffer(options);
-                framebuffer.render(atmosphere);
+                frames.push_back(frame);
             }
         }
 
-        std::cout << "\n" << "Precomputed processing time = " << Timing::getTime() - start_time << "s" << std::endl << std::endl;
+        SequenceRenderer renderer(options, atmosphere);
+
+        printf("Rendering image sequence of %d frames.\n\n", total_frames);
+        {
+            PROFILE_SCOPE("Elek sequence");
+            renderer.render(frames, FIGURES_DIR "animation/synth_ea_dataset.txt");
+        }
+        std::cout << std::endl;
 
         /* Uncomment to generate video from the generated image sequence using ffmpeg */
         //system("ffmpeg -framerate 60 -i skydome_precomputed_hg_%d.png -vf format=yuv420p skydome_precomputed_hg.mp4");
     }
 #endif
 
+    saveProfile();
+
     return EXIT_SUCCESS;
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/* Queue passing work between threads. push() blocks while the queue is full, so producers can't get ahead
+ * of the consumers by more than its capacity. */
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+        : m_capacity(capacity), m_closed(false)
+    {
+    }
+
+    void push(T item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_not_full.wait(lock, [this] { return m_items.size() < m_capacity; });
+
+        m_items.push_back(std::move(item));
+        m_not_empty.notify_one();
+    }
+
+    /* Waits for an item, returns false once the queue is closed and empty */
+    bool pop(T & item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_not_empty.wait(lock, [this] { return !m_items.empty() || m_closed; });
+
+        if (m_items.empty())
+        {
+            return false;
+        }
+
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_not_full.notify_one();
+
+        return true;
+    }
+
+    /* No more items will be pushed */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_not_empty.notify_all();
+    }
+
+private:
+    size_t m_capacity;
+    bool m_closed;
+
+    std::deque<T> m_items;
+    std::mutex m_mutex;
+    std::condition_variable m_not_full;
+    std::condition_variable m_not_empty;
+};
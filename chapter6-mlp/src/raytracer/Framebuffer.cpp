@@ -1,10 +1,15 @@
 ﻿#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
 #include <string>
 #include <glm/gtc/epsilon.hpp>
 
 #include "Framebuffer.h"
 #include "Ray.h"
 #include "Timing.h"
+#include "util/profiling.h"
 #include "Utils.h"
 
 #include "glm/glm.hpp"
@@ -21,6 +26,120 @@
 bool Framebuffer::FLIP_HORIZONTALLY = false;
 bool Framebuffer::FLIP_VERTICALLY = false;
 
+namespace
+{
+    /* Colours of a sequential colour map with a fixed value range, converted once. The lookup gives the same
+     * colours as ColourManager::getClassColour(), without its global current map, so it can run on many threads. */
+    class ColourLUT
+    {
+    public:
+        ColourLUT(int map_index, float lower, float upper)
+            : m_lower(lower), m_upper(upper)
+        {
+            /* Init_ColourManager() appends all the maps to the global list again on every call */
+            static const std::vector<ColourMap> maps = []()
+            {
+                ColourManager::Init_ColourManager();
+                return CMList::getMapList(CMClassification::SEQUENTIAL);
+            }();
+
+            ColourMap map = maps[map_index];
+            for (Colour& c : map.getColourList())
+            {
+                m_colours.push_back(glm::highp_dvec3(c.getR(), c.getG(), c.getB()));
+            }
+        }
+
+        const glm::highp_dvec3& lookup(float value) const
+        {
+            value = glm::clamp(value, m_lower, m_upper);
+            float value_along_range = std::abs(value - m_lower) / std::abs(m_upper - m_lower);
+            value_along_range -= 0.0005;
+
+            /* getClassColour() reads before the first colour for the lower bound */
+            int size  = static_cast<int>(m_colours.size());
+            int index = glm::clamp(static_cast<int>(std::floor(value_along_range * size)), 0, size - 1);
+            return m_colours[index];
+        }
+
+    private:
+        float m_lower, m_upper;
+        std::vector<glm::highp_dvec3> m_colours;
+    };
+
+    const ColourLUT& luminanceLUT()
+    {
+        static const ColourLUT lut(1, 0.0f, 255.0f);
+        return lut;
+    }
+
+    const ColourLUT& errorLUT()
+    {
+        static const ColourLUT lut(2, -1.0f, 1.0f);
+        return lut;
+    }
+
+    const glm::highp_dvec3 LUMA_WEIGHTS(0.2126, 0.7152, 0.0722);
+
+    /* Pixels are split into chunks of a fixed size, so partial sums and their order don't depend on the number of
+     * threads and the results are the same on every machine */
+    const size_t PIXELS_PER_CHUNK = 4096;
+
+    template <typename ChunkFunction>
+    void forEachChunk(size_t count, const ChunkFunction& function)
+    {
+        size_t num_chunks  = (count + PIXELS_PER_CHUNK - 1) / PIXELS_PER_CHUNK;
+        size_t num_threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), num_chunks);
+
+        auto process = [&](size_t thread_index)
+        {
+            for (size_t chunk = thread_index; chunk < num_chunks; chunk += num_threads)
+            {
+                size_t begin = chunk * PIXELS_PER_CHUNK;
+                function(chunk, begin, std::min(begin + PIXELS_PER_CHUNK, count));
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < num_threads; ++i)
+        {
+            threads.push_back(std::thread(process, i));
+        }
+
+        if (num_threads > 0)
+        {
+            process(0);
+        }
+
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+    }
+
+    /* sRGB encoded colour to CIE L*a*b*, for the D65 white point */
+    glm::highp_dvec3 srgbToLab(const glm::highp_dvec3& srgb)
+    {
+        glm::highp_dvec3 rgb;
+        for (int c = 0; c < 3; ++c)
+        {
+            rgb[c] = srgb[c] <= 0.04045 ? srgb[c] / 12.92 : std::pow((srgb[c] + 0.055) / 1.055, 2.4);
+        }
+
+        glm::highp_dvec3 xyz(glm::dot(rgb, glm::highp_dvec3(0.4124564, 0.3575761, 0.1804375)) / 0.95047,
+                             glm::dot(rgb, glm::highp_dvec3(0.2126729, 0.7151522, 0.0721750)),
+                             glm::dot(rgb, glm::highp_dvec3(0.0193339, 0.1191920, 0.9503041)) / 1.08883);
+
+        glm::highp_dvec3 f;
+        for (int c = 0; c < 3; ++c)
+        {
+            f[c] = xyz[c] > 216.0 / 24389.0 ? std::cbrt(xyz[c]) : (24389.0 / 27.0 * xyz[c] + 16.0) / 116.0;
+        }
+
+        return glm::highp_dvec3(116.0 * f.y - 16.0, 500.0 * (f.x - f.y), 200.0 * (f.y - f.z));
+    }
+}
+
 Framebuffer::Framebuffer(const Options & options)
 {
     m_options = options;
@@ -64,8 +183,10 @@ Framebuffer::~Framebuffer()
     delete m_cam;
 }
 
-void Framebuffer::render(Atmosphere & atmosphere)
+void Framebuffer::render(const Atmosphere & atmosphere, const FrameState & frame)
 {
+    PROFILE_SCOPE("Framebuffer::render");
+
 #ifdef _DEBUG
     int num_threads = 1;
 #else
@@ -75,18 +196,27 @@ void Framebuffer::render(Atmosphere & atmosphere)
     std::vector<int> bounds = thread_bounds(num_threads, m_options.HEIGHT);
     auto start_time         = Timing::getTime();
 
+    /* Every thread writes its dataset records to its own buffer, they are appended in the order of the rows after the threads are done */
+    std::vector<std::ostringstream> dataset_buffers(frame.dataset != nullptr ? num_threads : 0);
+    std::vector<FrameState> thread_frames(num_threads, frame);
+
+    for (size_t i = 0; i < dataset_buffers.size(); ++i)
+    {
+        thread_frames[i].dataset = &dataset_buffers[i];
+    }
+
     printProgressBar(0, m_height, "Rendering:", "Complete");
 
     /* Use num_threads - 1 threads to raytrace the scene */
     for (int i = 0; i < num_threads - 1; ++i)
     {
-        m_threads.push_back(std::thread(&Framebuffer::process, this, std::ref(atmosphere), bounds[i], bounds[i + 1]));
+        m_threads.push_back(std::thread(&Framebuffer::process, this, std::cref(atmosphere), std::cref(thread_frames[i]), bounds[i], bounds[i + 1]));
     }
 
     /* Use main thread to raytrace the scene */
     for (int i = num_threads - 1; i < num_threads; ++i)
     {
-        process(atmosphere, bounds[i], bounds[i + 1]);
+        process(atmosphere, thread_frames[i], bounds[i], bounds[i + 1]);
     }
 
     for (auto &t : m_threads)
@@ -94,6 +224,11 @@ void Framebuffer::render(Atmosphere & atmosphere)
         t.join();
     }
 
+    for (auto& buffer : dataset_buffers)
+    {
+        *frame.dataset << buffer.str();
+    }
+
     std::printf("\n");
 
     if (!m_options.OUTPUT_FILE_NAME.empty())
@@ -106,41 +241,70 @@ void Framebuffer::render(Atmosphere & atmosphere)
 }
 
 std::vector<glm::highp_dvec3> Framebuffer::getFramebufferRawData() const
+{
+    return std::vector<glm::highp_dvec3>(m_framebuffer, m_framebuffer + m_options.WIDTH * m_options.HEIGHT);
+}
+
+std::vector<glm::highp_dvec3> Framebuffer::getTonemappedData(double exposure) const
 {
     std::vector<glm::highp_dvec3> image;
-    image.resize(m_options.WIDTH * m_options.HEIGHT * 4);
+    image.resize(m_options.WIDTH * m_options.HEIGHT);
 
-    for(uint32_t i = 0; i < m_options.WIDTH * m_options.HEIGHT; ++i)
+    for (uint32_t i = 0; i < m_options.WIDTH * m_options.HEIGHT; ++i)
     {
-        image[i] = m_framebuffer[i];
+        // Apply exposure tone mapping
+        image[i].r = 1.0 - glm::exp(-m_framebuffer[i].r * exposure);
+        image[i].g = 1.0 - glm::exp(-m_framebuffer[i].g * exposure);
+        image[i].b = 1.0 - glm::exp(-m_framebuffer[i].b * exposure);
+
+        // Apply gamma correction
+        image[i].r = glm::pow(image[i].r, 1.0f / 2.2f);
+        image[i].g = glm::pow(image[i].g, 1.0f / 2.2f);
+        image[i].b = glm::pow(image[i].b, 1.0f / 2.2f);
     }
 
     return image;
 }
 
-void Framebuffer::process(Atmosphere & atmosphere, int left, int right)
+void Framebuffer::renderFrame(const Atmosphere & atmosphere, const FrameState & frame)
+{
+    PROFILE_SCOPE("Framebuffer::renderFrame");
+
+    for (int y = 0; y < m_height; ++y)
+    {
+        processRow(atmosphere, frame, y);
+    }
+}
+
+void Framebuffer::process(const Atmosphere & atmosphere, const FrameState & frame, int left, int right)
 {
     for (int y = left; y < right; ++y)
     {
         m_processed_pixel_counter += 1;
 
-        for (uint32_t x = 0; x < m_options.WIDTH; ++x)
-        {
-            double x_coord = FLIP_HORIZONTALLY ? m_options.WIDTH - (x + 0.5f) : (x + 0.5f);
-            double y_coord = FLIP_VERTICALLY ? m_options.HEIGHT - (y + 0.5f) : (y + 0.5f);
-            Ray primary_ray = m_cam->getPrimaryRay(x_coord, y_coord);
+        processRow(atmosphere, frame, y);
+
+        printProgressBar(m_processed_pixel_counter.load(), m_height, "Rendering:", "Complete");
+    }
+}
 
-            if (primary_ray.is_valid)
+void Framebuffer::processRow(const Atmosphere & atmosphere, const FrameState & frame, int y)
+{
+    for (uint32_t x = 0; x < m_options.WIDTH; ++x)
+    {
+        double x_coord = FLIP_HORIZONTALLY ? m_options.WIDTH - (x + 0.5f) : (x + 0.5f);
+        double y_coord = FLIP_VERTICALLY ? m_options.HEIGHT - (y + 0.5f) : (y + 0.5f);
+        Ray primary_ray = m_cam->getPrimaryRay(x_coord, y_coord);
+
+        if (primary_ray.is_valid)
+        {
+            double t0, t1, t_max = std::numeric_limits<double>::max();
+            if (atmosphere.intersect(primary_ray, t0, t1, true) && t1 > 0.0)
             {
-                double t0, t1, t_max = std::numeric_limits<double>::max();
-                if (atmosphere.intersect(primary_ray, t0, t1, true) && t1 > 0.0)
-                {
-                    t_max = glm::max(0.0, t0);
-                }
-                m_framebuffer[x + y * m_options.WIDTH] = atmosphere.computeIncidentLight(primary_ray, 0.0, t_max);
+                t_max = glm::max(0.0, t0);
             }
+            m_framebuffer[x + y * m_options.WIDTH] = atmosphere.computeIncidentLight(primary_ray, 0.0, t_max, frame);
         }
-        printProgressBar(m_processed_pixel_counter.load(), m_height, "Rendering:", "Complete");
     }
 }
 
@@ -170,27 +334,17 @@ std::vector<int> Framebuffer::thread_bounds(int parts, int mem) const
 
 void Framebuffer::saveRender(bool tonemap, double exposure) const
 {
+    /* The framebuffer keeps the HDR values, so that they can still be used after saving */
+    std::vector<glm::highp_dvec3> data = tonemap ? getTonemappedData(exposure) : getFramebufferRawData();
+
     std::vector<uint8_t> image;
     image.resize(m_options.WIDTH * m_options.HEIGHT * 4);
 
     for(uint32_t i = 0; i < m_options.WIDTH * m_options.HEIGHT; ++i)
     {
-        if (tonemap)
-        {
-            // Apply exposure tone mapping
-            m_framebuffer[i].r = 1.0 - glm::exp(-m_framebuffer[i].r * exposure);
-            m_framebuffer[i].g = 1.0 - glm::exp(-m_framebuffer[i].g * exposure);
-            m_framebuffer[i].b = 1.0 - glm::exp(-m_framebuffer[i].b * exposure);
-
-            // Apply gamma correction
-            m_framebuffer[i].r = glm::pow(m_framebuffer[i].r, 1.0f / 2.2f);
-            m_framebuffer[i].g = glm::pow(m_framebuffer[i].g, 1.0f / 2.2f);
-            m_framebuffer[i].b = glm::pow(m_framebuffer[i].b, 1.0f / 2.2f);
-        }
-
-        uint8_t r = uint8_t(255 * glm::clamp(m_framebuffer[i].r, 0.0, 100.0));
-        uint8_t g = uint8_t(255 * glm::clamp(m_framebuffer[i].g, 0.0, 100.0));;
-        uint8_t b = uint8_t(255 * glm::clamp(m_framebuffer[i].b, 0.0, 100.0));;
+        uint8_t r = uint8_t(255 * glm::clamp(data[i].r, 0.0, 100.0));
+        uint8_t g = uint8_t(255 * glm::clamp(data[i].g, 0.0, 100.0));;
+        uint8_t b = uint8_t(255 * glm::clamp(data[i].b, 0.0, 100.0));;
         uint8_t a = 255;
 
         image[4 * i + 0] = r;
@@ -202,6 +356,11 @@ void Framebuffer::saveRender(bool tonemap, double exposure) const
     stbi_write_png((m_options.OUTPUT_FILE_NAME + ".png").c_str(), m_options.WIDTH, m_options.HEIGHT, 4, image.data(), 0);
 }
 
+void Framebuffer::saveRenderHDR(const std::string& filename) const
+{
+    savePFM(filename, m_options.WIDTH, m_options.HEIGHT, getFramebufferRawData());
+}
+
 void Framebuffer::saveImg(const std::string& filename, const std::vector<glm::highp_dvec3>& data)
 {
     saveImg(filename, m_options.WIDTH, m_options.HEIGHT, data);
@@ -228,83 +387,131 @@ std::vector<glm::highp_dvec3> Framebuffer::getMSE(const std::vector<glm::highp_d
     std::vector<glm::highp_dvec3> image;
     image.resize(m_options.WIDTH * m_options.HEIGHT);
 
-    double sum_sq = 0.0;
+    ImageMetrics metrics = compareImages(ref.data(), src.data(), image.size(), image.data(), scale);
+    mse_error = metrics.mse;
 
-    ColourManager::Init_ColourManager();
-    ColourManager manager(-1, 1); //err
-    ColourMap map = CMList::getMapList(CMClassification::SEQUENTIAL)[2];
-    ColourManager::setCurrentColourMap(map);
+    std::cout << "mse error = " << mse_error << ", max err = " << metrics.max_error << ", min err = " << metrics.min_error << std::endl;
 
-    double max_err = -999999990.0;
-    double min_err = 99999999.0;
+    return image;
+}
 
-    for (uint32_t i = 0; i < m_options.WIDTH * m_options.HEIGHT; ++i)
-    {
-        auto src_luma = glm::dot(src[i], glm::highp_dvec3(0.2126, 0.7152, 0.0722));
-        auto ref_luma = glm::dot(ref[i], glm::highp_dvec3(0.2126, 0.7152, 0.0722));
+std::vector<glm::highp_dvec3> Framebuffer::getLuminance(uint32_t width, uint32_t height, const std::vector<glm::highp_dvec3>& data)
+{
+    std::vector<glm::highp_dvec3> image;
+    image.resize(width * height);
 
-        double err = ref_luma - src_luma;
-        double err2 = err * err;
-        sum_sq += err2;
-        
-        Colour c = manager.getClassColour(err*scale);
-        image[i] = glm::highp_dvec3(c.getR(), c.getG(), c.getB());
+    getLuminance(data.data(), image.size(), image.data());
 
-        if (err < min_err)
-            min_err = err;
+    return image;
+}
 
-        if (err > max_err)
-            max_err = err;
-    }
-    mse_error = sum_sq / image.size();
+std::vector<glm::highp_dvec3> Framebuffer::getChromaticity(uint32_t width, uint32_t height, const std::vector<glm::highp_dvec3>& data)
+{
+    std::vector<glm::highp_dvec3> image;
+    image.resize(width * height);
 
-    std::cout << "mse error = " << mse_error << ", max err = " << max_err << ", min err = " << min_err << std::endl;
+    getChromaticity(data.data(), image.size(), image.data());
 
     return image;
 }
 
-std::vector<glm::highp_dvec3> Framebuffer::getLuminance(uint32_t width, uint32_t height, const std::vector<glm::highp_dvec3>& data)
+ImageMetrics Framebuffer::compareImages(const glm::highp_dvec3* ref, const glm::highp_dvec3* src, size_t count,
+                                        glm::highp_dvec3* error_image, double scale)
 {
-    std::vector<glm::highp_dvec3> image;
-    image.resize(width * height);
+    struct Partial
+    {
+        double sum_sq      = 0.0;
+        double sum_delta_e = 0.0;
+        double min_err     = std::numeric_limits<double>::max();
+        double max_err     = std::numeric_limits<double>::lowest();
+    };
 
-    ColourManager::Init_ColourManager();
-    ColourManager manager(0.0, 255.0);
-    ColourMap map = CMList::getMapList(CMClassification::SEQUENTIAL)[1];
-    ColourManager::setCurrentColourMap(map);
+    std::vector<Partial> partials((count + PIXELS_PER_CHUNK - 1) / PIXELS_PER_CHUNK);
+    const ColourLUT& lut = errorLUT();
 
-    for (uint32_t i = 0; i < width * height; ++i)
+    forEachChunk(count, [&](size_t chunk, size_t begin, size_t end)
     {
-        auto luma = glm::dot(data[i], glm::highp_dvec3(0.2126, 0.7152, 0.0722));
-        // image[i] = getScaleColor(luma);
+        Partial p;
+
+        /* The chunk stays in the cache between the loops. The first one is branch free, so that the compiler
+         * can vectorize it, the colour conversions of the other ones can't be. */
+        for (size_t i = begin; i < end; ++i)
+        {
+            double err = glm::dot(ref[i], LUMA_WEIGHTS) - glm::dot(src[i], LUMA_WEIGHTS);
+
+            p.sum_sq += err * err;
+            p.min_err = std::min(p.min_err, err);
+            p.max_err = std::max(p.max_err, err);
+        }
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            p.sum_delta_e += glm::distance(srgbToLab(ref[i]), srgbToLab(src[i]));
+        }
+
+        if (error_image != nullptr)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                double err = glm::dot(ref[i], LUMA_WEIGHTS) - glm::dot(src[i], LUMA_WEIGHTS);
+                error_image[i] = lut.lookup(static_cast<float>(err * scale));
+            }
+        }
 
-        //const tinycolormap::Color color = tinycolormap::GetColor(luma, tinycolormap::ColormapType::Viridis);
-        //image[i] = glm::highp_dvec3(color.r(), color.g(), color.b());
+        partials[chunk] = p;
+    });
 
-        Colour c = manager.getClassColour(luma * 255.0);
-        image[i] = glm::highp_dvec3(c.getR(), c.getG(), c.getB());
+    ImageMetrics metrics;
+    if (count == 0)
+    {
+        return metrics;
     }
 
-    return image;
+    Partial total;
+    for (const Partial& p : partials)
+    {
+        total.sum_sq      += p.sum_sq;
+        total.sum_delta_e += p.sum_delta_e;
+        total.min_err      = std::min(total.min_err, p.min_err);
+        total.max_err      = std::max(total.max_err, p.max_err);
+    }
+
+    metrics.mse          = total.sum_sq / count;
+    metrics.rmse         = std::sqrt(metrics.mse);
+    metrics.min_error    = total.min_err;
+    metrics.max_error    = total.max_err;
+    metrics.psnr         = metrics.mse > 0.0 ? -10.0 * std::log10(metrics.mse) : std::numeric_limits<double>::infinity();
+    metrics.mean_delta_e = total.sum_delta_e / count;
+
+    return metrics;
 }
 
-std::vector<glm::highp_dvec3> Framebuffer::getChromaticity(uint32_t width, uint32_t height, const std::vector<glm::highp_dvec3>& data)
+void Framebuffer::getLuminance(const glm::highp_dvec3* data, size_t count, glm::highp_dvec3* out)
 {
-    std::vector<glm::highp_dvec3> image;
-    image.resize(width * height);
+    const ColourLUT& lut = luminanceLUT();
 
-    for (uint32_t i = 0; i < width * height; ++i)
+    forEachChunk(count, [&](size_t, size_t begin, size_t end)
     {
-        // Apply gamma correction
-        image[i].r = glm::pow(data[i].r, 1.0f / 0.4f);
-        image[i].g = glm::pow(data[i].g, 1.0f / 0.4f);
-        image[i].b = glm::pow(data[i].b, 1.0f / 0.4f);
+        for (size_t i = begin; i < end; ++i)
+        {
+            out[i] = lut.lookup(static_cast<float>(glm::dot(data[i], LUMA_WEIGHTS) * 255.0));
+        }
+    });
+}
 
-        double rgb_max = glm::max(image[i].r, glm::max(image[i].g, image[i].b));
-        image[i] = image[i] / rgb_max;
-    }
+void Framebuffer::getChromaticity(const glm::highp_dvec3* data, size_t count, glm::highp_dvec3* out)
+{
+    forEachChunk(count, [&](size_t, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            /* Inverse of the 0.4 gamma, x^2.5 without pow() */
+            glm::highp_dvec3 c = data[i] * data[i] * glm::sqrt(data[i]);
 
-    return image;
+            double rgb_max = glm::max(c.r, glm::max(c.g, c.b));
+            out[i] = c / rgb_max;
+        }
+    });
 }
 
 void Framebuffer::saveImg(const std::string& filename, const uint32_t width, const uint32_t height, const std::vector<glm::highp_dvec3>& data)
@@ -361,20 +568,92 @@ std::vector<glm::highp_dvec3> Framebuffer::loadImg(const std::string& filename,
     return out;
 }
 
+void Framebuffer::savePFM(const std::string& filename, const uint32_t width, const uint32_t height, const std::vector<glm::highp_dvec3>& data)
+{
+    std::ofstream file(filename + ".pfm", std::ios::binary);
+
+    if (!file.good())
+    {
+        std::cerr << "Can't save file " << filename << ".pfm" << std::endl;
+        return;
+    }
+
+    /* Negative scale means little endian, rows are stored from the bottom to the top */
+    file << "PF\n" << width << " " << height << "\n-1.0\n";
+
+    std::vector<float> row(width * 3);
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const glm::highp_dvec3* src = data.data() + (height - 1 - y) * width;
+
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            row[3 * x + 0] = static_cast<float>(src[x].r);
+            row[3 * x + 1] = static_cast<float>(src[x].g);
+            row[3 * x + 2] = static_cast<float>(src[x].b);
+        }
+
+        file.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+    }
+}
+
+std::vector<glm::highp_dvec3> Framebuffer::loadPFM(const std::string& filename, int& w, int& h)
+{
+    std::vector<glm::highp_dvec3> out;
+
+    std::ifstream file(filename, std::ios::binary);
+    std::string format;
+    int width = 0, height = 0;
+    float scale = 0.0f;
+
+    file >> format >> width >> height >> scale;
+    file.get();
+
+    if (!file.good() || format != "PF" || scale >= 0.0f || width <= 0 || height <= 0)
+    {
+        std::cerr << "Can't load file " << filename << std::endl;
+        return out;
+    }
+
+    out.resize(width * height);
+
+    w = width;
+    h = height;
+
+    std::vector<float> row(width * 3);
+
+    for (int y = 0; y < height; ++y)
+    {
+        file.read(reinterpret_cast<char*>(row.data()), row.size() * sizeof(float));
+
+        glm::highp_dvec3* dst = out.data() + (height - 1 - y) * width;
+
+        for (int x = 0; x < width; ++x)
+        {
+            dst[x] = glm::highp_dvec3(row[3 * x + 0], row[3 * x + 1], row[3 * x + 2]);
+        }
+    }
+
+    if (!file.good())
+    {
+        std::cerr << "Can't load file " << filename << std::endl;
+        out.clear();
+    }
+
+    return out;
+}
+
 void Framebuffer::createColorScaleBar(const std::string& output_filename, ColorScaleBarType type, unsigned width)
 {
     std::vector<uint8_t> image;
     image.resize(width * 4);
 
-    ColourManager::Init_ColourManager();
-    ColourManager manager(0.0, 1.0);
-    ColourMap map = CMList::getMapList(CMClassification::SEQUENTIAL)[int(type) + 1];
-    ColourManager::setCurrentColourMap(map);
+    ColourLUT lut(int(type) + 1, 0.0f, 1.0f);
 
     for (uint32_t i = 0; i < width; ++i)
     {
-        Colour c = manager.getClassColour(i / float(width - 1));
-        auto output_color = glm::highp_dvec3(c.getR(), c.getG(), c.getB());
+        auto output_color = lut.lookup(i / float(width - 1));
 
         uint8_t r = uint8_t(255 * glm::clamp(output_color.r, 0.0, 1.0));
         uint8_t g = uint8_t(255 * glm::clamp(output_color.g, 0.0, 1.0));;
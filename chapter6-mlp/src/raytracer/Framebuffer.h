@@ -10,6 +10,17 @@
 
 #define USE_TONE_MAPPING true
 
+/* Differences of two images, computed in a single pass over their pixels */
+struct ImageMetrics
+{
+    double mse          = 0.0; // of the luminance
+    double rmse         = 0.0;
+    double min_error    = 0.0; // signed luminance difference, reference - source
+    double max_error    = 0.0;
+    double psnr         = 0.0; // in dB, for the peak value of 1.0
+    double mean_delta_e = 0.0; // CIE76 colour difference in L*a*b*
+};
+
 class Framebuffer
 {
 public:
@@ -17,9 +28,15 @@ public:
     Framebuffer(const Options & options);
     ~Framebuffer();
 
-    void render(Atmosphere & atmosphere);
+    void render(const Atmosphere & atmosphere, const FrameState & frame);
+
+    /* Renders the whole frame on the calling thread, without the progress bar and without saving it.
+     * Used when many frames are rendered at the same time. */
+    void renderFrame(const Atmosphere & atmosphere, const FrameState & frame);
     std::vector<glm::highp_dvec3> getFramebufferRawData() const;    
+    std::vector<glm::highp_dvec3> getTonemappedData(double exposure = 1.0) const;
     void saveRender(bool tonemap = true, double exposure = 1.0) const;
+    void saveRenderHDR(const std::string & filename) const;
     
     void saveImg(const std::string & filename, const std::vector<glm::highp_dvec3>& data);
     std::vector<glm::highp_dvec3> loadImg(const std::string& filename);
@@ -32,6 +49,17 @@ public:
     static void saveImg(const std::string& filename, const uint32_t width, const uint32_t height, const std::vector<glm::highp_dvec3>& data);
     static std::vector<glm::highp_dvec3> loadImg(const std::string & filename, int& width, int& height);
 
+    /* Raw 32-bit float RGB images (Portable Float Map), without any tone mapping or quantization */
+    static void savePFM(const std::string& filename, const uint32_t width, const uint32_t height, const std::vector<glm::highp_dvec3>& data);
+    static std::vector<glm::highp_dvec3> loadPFM(const std::string& filename, int& width, int& height);
+
+    /* Parallel kernels writing to caller provided buffers of count pixels, used to process many images without
+     * allocating. The error image is only written if it is not null, in the same colours as getMSE(). */
+    static ImageMetrics compareImages(const glm::highp_dvec3* ref, const glm::highp_dvec3* src, size_t count,
+                                      glm::highp_dvec3* error_image = nullptr, double scale = 40.0);
+    static void getLuminance(const glm::highp_dvec3* data, size_t count, glm::highp_dvec3* out);
+    static void getChromaticity(const glm::highp_dvec3* data, size_t count, glm::highp_dvec3* out);
+
     static void createColorScaleBar(const std::string& output_filename, ColorScaleBarType type, unsigned width);
 
     Options m_options;
@@ -40,7 +68,8 @@ public:
     static bool FLIP_VERTICALLY;
 
 private:
-    void process(Atmosphere & atmosphere, int left, int right);
+    void process(const Atmosphere & atmosphere, const FrameState & frame, int left, int right);
+    void processRow(const Atmosphere & atmosphere, const FrameState & frame, int y);
     std::vector<int> thread_bounds(int parts, int mem) const;
 
     glm::highp_dvec3 * m_framebuffer;
@@ -0,0 +1,157 @@
+#include "SequenceRenderer.h"
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include "BoundedQueue.h"
+#include "Framebuffer.h"
+#include "Utils.h"
+#include "util/profiling.h"
+
+namespace
+{
+    struct ImageJob
+    {
+        std::string file_name;
+        std::vector<glm::highp_dvec3> data;
+    };
+
+    struct DatasetJob
+    {
+        size_t frame_index;
+        std::string records;
+    };
+}
+
+SequenceRenderer::SequenceRenderer(const Options & options, const Atmosphere & atmosphere)
+    : m_num_threads(0),
+      m_num_io_threads(2),
+      m_max_queued_frames(8),
+      m_options(options),
+      m_atmosphere(atmosphere)
+{
+}
+
+void SequenceRenderer::render(const std::vector<SequenceFrame> & frames, const std::string & dataset_file_name)
+{
+    int num_threads = m_num_threads > 0 ? m_num_threads : std::max(1, int(std::thread::hardware_concurrency()));
+    num_threads     = std::max(1, std::min(num_threads, int(frames.size())));
+
+    bool write_dataset = !dataset_file_name.empty();
+
+    std::ofstream dataset_file;
+    if (write_dataset)
+    {
+        dataset_file.open(dataset_file_name.c_str());
+
+        if (!dataset_file.good())
+        {
+            std::cerr << "Could not open file " << dataset_file_name << std::endl;
+            write_dataset = false;
+        }
+    }
+
+    BoundedQueue<ImageJob>   image_queue(m_max_queued_frames);
+    BoundedQueue<DatasetJob> dataset_queue(m_max_queued_frames);
+
+    /* PNG encoding */
+    std::vector<std::thread> io_threads;
+    for (int i = 0; i < std::max(1, m_num_io_threads); ++i)
+    {
+        io_threads.push_back(std::thread([&]()
+        {
+            ImageJob job;
+            while (image_queue.pop(job))
+            {
+                PROFILE_SCOPE("Framebuffer::saveImg");
+                Framebuffer::saveImg(job.file_name, m_options.WIDTH, m_options.HEIGHT, job.data);
+            }
+        }));
+    }
+
+    /* Frames finish out of order, the ones which come too early wait until the previous ones are written */
+    std::thread dataset_thread;
+    if (write_dataset)
+    {
+        dataset_thread = std::thread([&]()
+        {
+            std::map<size_t, std::string> pending;
+            size_t next_frame = 0;
+
+            DatasetJob job;
+            while (dataset_queue.pop(job))
+            {
+                pending[job.frame_index] = std::move(job.records);
+
+                for (auto it = pending.find(next_frame); it != pending.end(); it = pending.find(next_frame))
+                {
+                    dataset_file << it->second;
+                    pending.erase(it);
+                    ++next_frame;
+                }
+            }
+        });
+    }
+
+    std::atomic<size_t> next_frame(0);
+    std::atomic<int> rendered_frames(0);
+
+    printProgressBar(0, int(frames.size()), "Rendering:", "Complete");
+
+    auto process = [&]()
+    {
+        Framebuffer framebuffer(m_options);
+
+        for (size_t i = next_frame++; i < frames.size(); i = next_frame++)
+        {
+            const SequenceFrame & frame = frames[i];
+
+            std::ostringstream records;
+            FrameState state = frame.state;
+            state.dataset    = write_dataset ? &records : nullptr;
+
+            framebuffer.renderFrame(m_atmosphere, state);
+
+            image_queue.push({ frame.output_file_name, framebuffer.getTonemappedData() });
+
+            if (write_dataset)
+            {
+                dataset_queue.push({ i, records.str() });
+            }
+
+            printProgressBar(++rendered_frames, int(frames.size()), "Rendering:", "Complete");
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i)
+    {
+        threads.push_back(std::thread(process));
+    }
+
+    process();
+
+    for (auto & t : threads)
+    {
+        t.join();
+    }
+
+    std::printf("\n");
+
+    image_queue.close();
+    dataset_queue.close();
+
+    for (auto & t : io_threads)
+    {
+        t.join();
+    }
+
+    if (dataset_thread.joinable())
+    {
+        dataset_thread.join();
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "skymodels/Atmosphere.h"
+#include "Options.h"
+
+struct SequenceFrame
+{
+    std::string output_file_name;
+    FrameState state;
+};
+
+/**
+  * Renders a sequence of small frames with one frame per thread, since a single 256x256 frame can't keep many cores busy.
+  * All the threads share the atmosphere, every frame has its own state and every thread its own framebuffer.
+  * The images are encoded and the dataset is written by background threads, fed by bounded queues.
+  */
+class SequenceRenderer
+{
+public:
+    SequenceRenderer(const Options & options, const Atmosphere & atmosphere);
+
+    /* If dataset_file_name is not empty, the dataset records of all the frames are written to it, in the order of the frames */
+    void render(const std::vector<SequenceFrame> & frames, const std::string & dataset_file_name = "");
+
+    int m_num_threads;          // 0 means std::thread::hardware_concurrency()
+    int m_num_io_threads;
+    size_t m_max_queued_frames;
+
+private:
+    Options m_options;
+    const Atmosphere & m_atmosphere;
+};
@@ -1,9 +1,8 @@
 ﻿#include "Timing.h"
-#include <chrono>
+#include "util/profiling.h"
 
 double Timing::getTime()
 {
-    auto now = std::chrono::high_resolution_clock::now();
-
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count() / static_cast<double>(SECOND);
+    /* Monotonic, unlike high_resolution_clock which is the system clock with some standard libraries */
+    return profiling::NowSeconds();
 }
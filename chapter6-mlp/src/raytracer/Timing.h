@@ -4,8 +4,8 @@ class Timing
 {
 public:
 
-    /** @brief Get current time 
-      * @result time in seconds
+    /** @brief Get current monotonic time, from the clock of the profiling library
+      * @result time in seconds since an arbitrary origin
      **/
     static double getTime();
 
@@ -3,7 +3,7 @@
 #include "raytracer/Framebuffer.h"
 #include <limits>
 
-glm::highp_dvec3 Atmosphere::computeIncidentLight(const Ray& ray, double t_min, double t_max)
+glm::highp_dvec3 Atmosphere::computeIncidentLight(const Ray& ray, double t_min, double t_max, const FrameState & frame) const
 {
     double t0, t1;
     if (!intersect(ray, t0, t1) || t1 < 0.0)
@@ -31,7 +31,7 @@ glm::highp_dvec3 Atmosphere::computeIncidentLight(const Ray& ray, double t_min,
     double optical_depth_r = 0, optical_depth_m = 0;
 
     /* mu in the paper which is the cosine of the angle between the sun direction and the ray direction */
-    double mu = glm::dot(ray.m_direction, sun_light);
+    double mu = glm::dot(ray.m_direction, frame.sun_direction);
 
     double phase_r = rayleigh_phase_func(mu);
     double phase_m = mie_phase_func(g, mu);
@@ -45,7 +45,7 @@ glm::highp_dvec3 Atmosphere::computeIncidentLight(const Ray& ray, double t_min,
         optical_depth_r += h_r_m[i].rayleigh;
         optical_depth_m += h_r_m[i].mie;
 
-        Ray light_ray(h_r_m[i].sample_position, sun_light);
+        Ray light_ray(h_r_m[i].sample_position, frame.sun_direction);
 
         double t0_light, t1_light;
         intersect(light_ray, t0_light, t1_light);
@@ -63,7 +63,7 @@ glm::highp_dvec3 Atmosphere::computeIncidentLight(const Ray& ray, double t_min,
     return (sum_r * BETA_RAYLEIGH * phase_r + sum_m * BETA_MIE * phase_m) * sun_intensity;
 }
 
-bool Atmosphere::intersect(const Ray & ray, double & t0, double & t1, bool is_planet)
+bool Atmosphere::intersect(const Ray & ray, double & t0, double & t1, bool is_planet) const
 {
     const double radius = is_planet ? planet_radius : atmosphere_radius;
 
@@ -79,7 +79,7 @@ bool Atmosphere::intersect(const Ray & ray, double & t0, double & t1, bool is_pl
     return true; 
 }
 
-double Atmosphere::sampleHeight(glm::highp_dvec3 & pos)
+double Atmosphere::sampleHeight(const glm::highp_dvec3 & pos) const
 {
     return glm::length(pos) - planet_radius;
 }
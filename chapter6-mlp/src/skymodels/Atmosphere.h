@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <glm/glm.hpp>
+#include <iosfwd>
 #include <mutex>
 
 #include "raytracer/Options.h"
@@ -32,12 +33,30 @@ struct IntegrationData
     double rayleigh = 0.0;
 };
 
+/**
+  * Sun and view state of one frame. Atmospheres only read it, so many frames can be rendered at the same time
+  * with one atmosphere, each with its own state.
+  */
+struct FrameState
+{
+    glm::highp_dvec3 sun_direction = glm::highp_dvec3(0.0, -1.0, 0.0);
+    double zenith_angle  = 0.0;
+    double azimuth_angle = 0.0;
+
+    /* If set, the models which support it append a dataset record of each computed radiance to this stream.
+     * Every render thread has to use its own stream, they are merged after the threads are done. */
+    std::ostream * dataset = nullptr;
+};
+
+/**
+  * Parameters of the atmosphere and the data precomputed for them. After the precomputations it is only read,
+  * through the const methods, so it can be shared by all the render threads.
+  */
 class Atmosphere
 {
 public:
     explicit Atmosphere(const Options & _options)
-        : sun_light(_options.SUN_DIRECTION),
-          sun_intensity(_options.SUN_INTENSITY),
+        : sun_intensity(_options.SUN_INTENSITY),
           planet_radius(_options.PLANET_RADIUS),
           atmosphere_radius(_options.ATMOSPHERE_RADIUS),
           h_rayleigh(_options.H_RAYLEIGH),
@@ -62,46 +81,38 @@ public:
 
     virtual ~Atmosphere() = default;
 
-    virtual glm::highp_dvec3 computeIncidentLight(const Ray & ray, double t_min, double t_max);
-    virtual bool intersect(const Ray & ray, double & t0, double & t1, bool is_planet = false);
-
-    void setSunDirection(const glm::highp_dvec3 & sun_dir)
-    {
-        sun_light = glm::normalize(sun_dir);
-    }
-
-    double m_azimuth_angle = 0.0;
-    double m_zenith_angle = 0.0;
+    virtual glm::highp_dvec3 computeIncidentLight(const Ray & ray, double t_min, double t_max, const FrameState & frame) const;
+    virtual bool intersect(const Ray & ray, double & t0, double & t1, bool is_planet = false) const;
 
 protected:
-    virtual std::vector<IntegrationData> integrator(Ray ray, double a, double b, unsigned n, bool precomptute) = 0;
-    virtual double sampleHeight(glm::highp_dvec3 & pos);
+    virtual std::vector<IntegrationData> integrator(Ray ray, double a, double b, unsigned n, bool precomptute) const = 0;
+    virtual double sampleHeight(const glm::highp_dvec3 & pos) const;
 
-    double rayleigh_phase_func(double mu)
+    double rayleigh_phase_func(double mu) const
     {
         return 3.0 * (1.0 + mu * mu) / (16.0 * glm::pi<double>());
     }
 
-    double rayleigh_phase_func_elek(double mu)
+    double rayleigh_phase_func_elek(double mu) const
     {
         return 0.7 * (1.4 + 0.5 * mu) / (4.0 * glm::pi<double>());
     }
 
 #if HG_PHASE_FUNC
     /* Henyey-Greenstein Mie Phase Function Approximation */
-    double mie_phase_func(double g, double mu)
+    double mie_phase_func(double g, double mu) const
     {
         return (1.0 - g * g) / (4.0 * glm::pi<double>() * glm::pow(1.0 + g*g - 2*g * mu, 1.5));
     }
 #elif CS_PHASE_FUNC
     /* Cornette-Shanks Mie Phase Function Approximation */
-    double mie_phase_func(double g, double mu)
+    double mie_phase_func(double g, double mu) const
     {
         return (3.0 * (1.0 - g*g) * (1.0 + mu*mu)) / (4.0 * glm::pi<double>() * 2.0 * (2.0 + g*g) * pow(1.0 + g*g - 2*g * mu, 1.5));
     }
 #elif S_PHASE_FUNC
     /* Schlick Mie Phase Function Approximation */
-    double mie_phase_func(double g, double mu)
+    double mie_phase_func(double g, double mu) const
     {
         const double k = 1.55 * g - 0.55 * g*g*g;
         mu = -mu;
@@ -113,7 +124,6 @@ protected:
     glm::highp_dvec3 BETA_RAYLEIGH;
     glm::highp_dvec3 BETA_MIE;
 
-    glm::highp_dvec3 sun_light;
     double sun_intensity;
 
     double planet_radius;
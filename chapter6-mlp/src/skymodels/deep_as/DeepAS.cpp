@@ -10,9 +10,16 @@
 #include <3rdparty\keras2cpp\src\layers\dense.h>
 
 DeepAS::DeepAS(const Options & options)
-    : Atmosphere(options)
+    : DeepAS(options, DEFAULT_MODEL_FILE_NAME)
+{
+}
+
+DeepAS::DeepAS(const Options & options, const std::string & model_file_name)
+    : Atmosphere(options),
+      m_neural_network(keras2cpp::Model::load(model_file_name))
 {
     std::cout << "DEEP ATMOSPHERIC SCATTERING INFO" << std::endl;
+    std::cout << "MODEL                = " << model_file_name << std::endl;
         
     auto tmp_beta_r = BETA_RAYLEIGH / (1.0 / options.ATMOSPHERE_PROPERTIES_SCALING_FACTOR);
     auto tmp_beta_m = BETA_MIE      / (1.0 / options.ATMOSPHERE_PROPERTIES_SCALING_FACTOR);
@@ -28,7 +35,7 @@ DeepAS::DeepAS(const Options & options)
     m_opt = options;
 }
 
-glm::highp_dvec3 DeepAS::computeIncidentLight(const Ray & ray, double t_min, double t_max)
+glm::highp_dvec3 DeepAS::computeIncidentLight(const Ray & ray, double t_min, double t_max, const FrameState & frame) const
 {
     double t0, t1;
     if (!intersect(ray, t0, t1) || t1 < 0.0)
@@ -47,7 +54,7 @@ glm::highp_dvec3 DeepAS::computeIncidentLight(const Ray & ray, double t_min, dou
     }
 
     /* mu in the paper which is the cosine of the angle between the sun direction and the ray direction */
-    double mu = glm::dot(ray.m_direction, sun_light);
+    double mu = glm::dot(ray.m_direction, frame.sun_direction);
     double phase_r = rayleigh_phase_func(mu);
     double phase_m = mie_phase_func(g, mu);
 
@@ -62,7 +69,7 @@ glm::highp_dvec3 DeepAS::computeIncidentLight(const Ray & ray, double t_min, dou
 
     /* Calculate light intensity for the P_v */
     double view_angle = glm::acos(glm::dot(glm::normalize(P_v), R_v));
-    double sun_angle  = glm::acos(glm::dot(glm::normalize(P_v), sun_light));
+    double sun_angle  = glm::acos(glm::dot(glm::normalize(P_v), frame.sun_direction));
     double height     = sampleHeight(P_v);
     
     auto in = keras2cpp::Tensor{ 3 };
@@ -140,7 +147,7 @@ glm::highp_dvec3 DeepAS::computeIncidentLight(const Ray & ray, double t_min, dou
     return atmo_color;
 }
 
-std::vector<IntegrationData> DeepAS::integrator(Ray ray, double a, double b, unsigned n, bool precomptute)
+std::vector<IntegrationData> DeepAS::integrator(Ray ray, double a, double b, unsigned n, bool precomptute) const
 {
     std::vector<IntegrationData> data(1);
     return data;
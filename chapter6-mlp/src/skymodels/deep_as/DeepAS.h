@@ -11,19 +11,24 @@ class DeepAS : public Atmosphere
 {
 public:
     explicit DeepAS(const Options & options);
-    ~DeepAS() = default;
-
-    glm::highp_dvec3 computeIncidentLight(const Ray & ray, double t_min, double t_max) override;
 
-private:
-    std::vector<IntegrationData> integrator(Ray ray, double a, double b, unsigned n, bool precomptute) override;
+    /* Uses the network of the given keras2cpp model file, e.g. one of the smaller networks in res/ */
+    DeepAS(const Options & options, const std::string & model_file_name);
+    ~DeepAS() = default;
 
 #if !USE_10LAYERS
-    keras2cpp::Model m_neural_network = keras2cpp::Model::load(ROOT_DIR "/res/nn_lut_512_128_128_128_128_rm_earth_3layers-186.model");
+    static constexpr const char * DEFAULT_MODEL_FILE_NAME = ROOT_DIR "/res/nn_lut_512_128_128_128_128_rm_earth_3layers-186.model";
 #else
-    keras2cpp::Model m_neural_network = keras2cpp::Model::load(ROOT_DIR "/res/nn_lut_512_128_128_128_128_rm_earth_10layers-587.model");
+    static constexpr const char * DEFAULT_MODEL_FILE_NAME = ROOT_DIR "/res/nn_lut_512_128_128_128_128_rm_earth_10layers-587.model";
 #endif
 
+    glm::highp_dvec3 computeIncidentLight(const Ray & ray, double t_min, double t_max, const FrameState & frame) const override;
+
+private:
+    std::vector<IntegrationData> integrator(Ray ray, double a, double b, unsigned n, bool precomptute) const override;
+
+    keras2cpp::Model m_neural_network;
+
     Options m_opt;
 };
 
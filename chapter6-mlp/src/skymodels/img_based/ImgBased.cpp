@@ -28,7 +28,7 @@ ImgBased::ImgBased(const Options & options)
     m_opt = options;
 }
 
-glm::highp_dvec3 ImgBased::computeIncidentLight(const Ray & ray, double t_min, double t_max)
+glm::highp_dvec3 ImgBased::computeIncidentLight(const Ray & ray, double t_min, double t_max, const FrameState & frame) const
 {
     double t0, t1;
     if (!intersect(ray, t0, t1) || t1 < 0.0)
@@ -57,10 +57,10 @@ glm::highp_dvec3 ImgBased::computeIncidentLight(const Ray & ray, double t_min, d
     }
 
     /* Calculate light intensity for the P_v */
-    double sun_angle = glm::acos(glm::dot(glm::normalize(P_v), sun_light));
+    double sun_angle = glm::acos(glm::dot(glm::normalize(P_v), frame.sun_direction));
     
     auto in = keras2cpp::Tensor{ 5 };
-    in.data_ = { float( m_zenith_angle / glm::pi<double>()), float(m_azimuth_angle / glm::pi<double>()), float(R_v.x), float(R_v.y), float(R_v.z) };
+    in.data_ = { float(frame.zenith_angle / glm::pi<double>()), float(frame.azimuth_angle / glm::pi<double>()), float(R_v.x), float(R_v.y), float(R_v.z) };
     auto out = m_neural_network(in);
 
     auto predicted_pixel = glm::highp_dvec3(out.data_[0], out.data_[1], out.data_[2]);
@@ -69,7 +69,7 @@ glm::highp_dvec3 ImgBased::computeIncidentLight(const Ray & ray, double t_min, d
     return atmo_color;
 }
 
-std::vector<IntegrationData> ImgBased::integrator(Ray ray, double a, double b, unsigned n, bool precomptute)
+std::vector<IntegrationData> ImgBased::integrator(Ray ray, double a, double b, unsigned n, bool precomptute) const
 {
     std::vector<IntegrationData> data(1);
     return data;
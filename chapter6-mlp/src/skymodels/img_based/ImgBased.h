@@ -14,10 +14,10 @@ public:
     explicit ImgBased(const Options & options);
     ~ImgBased() = default;
 
-    glm::highp_dvec3 computeIncidentLight(const Ray & ray, double t_min, double t_max) override;
+    glm::highp_dvec3 computeIncidentLight(const Ray & ray, double t_min, double t_max, const FrameState & frame) const override;
 
 private:
-    std::vector<IntegrationData> integrator(Ray ray, double a, double b, unsigned n, bool precomptute) override;
+    std::vector<IntegrationData> integrator(Ray ray, double a, double b, unsigned n, bool precomptute) const override;
 
 #if !IMG_BASED_TF
     #if USE_IMG_BASED_SYNTH
@@ -11,7 +11,7 @@ Midpoint::Midpoint(const Options & options)
     std::cout << "LIGHT SAMPLES = " << samples_light << std::endl << std::endl;
 }
 
-std::vector<IntegrationData> Midpoint::integrator(Ray ray, double a, double b, unsigned n, bool precomptute)
+std::vector<IntegrationData> Midpoint::integrator(Ray ray, double a, double b, unsigned n, bool precomptute) const
 {
     std::vector<IntegrationData> data(1);
 
@@ -8,6 +8,6 @@ public:
     ~Midpoint() = default;
 
 private:
-    std::vector<IntegrationData> integrator(Ray ray, double a, double b, unsigned n, bool precomptute) override;
+    std::vector<IntegrationData> integrator(Ray ray, double a, double b, unsigned n, bool precomptute) const override;
 };
 
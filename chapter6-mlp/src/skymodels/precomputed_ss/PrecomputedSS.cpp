@@ -1,6 +1,7 @@
 #include "PrecomputedSS.h"
 #include "raytracer/Utils.h"
 #include "raytracer/Timing.h"
+#include "util/profiling.h"
 #include "RootDir.h"
 #include "MemoryMapped.h"
 
@@ -9,7 +10,7 @@
 #include <sstream>
 #include <glm/gtc/epsilon.hpp>
 
-PrecomputedSS::PrecomputedSS(const Options & options, uint32_t _samples, uint32_t _samples_light, const std::string & output_filename)
+PrecomputedSS::PrecomputedSS(const Options & options, uint32_t _samples, uint32_t _samples_light)
     : Atmosphere(options)
 {
     samples       = _samples;
@@ -30,20 +31,9 @@ PrecomputedSS::PrecomputedSS(const Options & options, uint32_t _samples, uint32_
     std::cout << "BETA_m               = " << "(" << tmp_beta_m.x << ", " << tmp_beta_m.y << "," << tmp_beta_m.z << ")" << std::endl << std::endl;
 
     m_opt = options;
-
-    /* If output_filename is not empty, it indicates that user wants to create dataset based on generated images */
-    if (!output_filename.empty())
-    {
-        output_file.open(output_filename.c_str());
-
-        if (!output_file.good())
-        {
-            std::cerr << "Could not open file " << output_filename << std::endl;
-        }
-    }
 }
 
-glm::highp_dvec3 PrecomputedSS::computeIncidentLight(const Ray & ray, double t_min, double t_max)
+glm::highp_dvec3 PrecomputedSS::computeIncidentLight(const Ray & ray, double t_min, double t_max, const FrameState & frame) const
 {
     if (m_single_scattering_data_r_m.empty())
     {
@@ -68,7 +58,7 @@ glm::highp_dvec3 PrecomputedSS::computeIncidentLight(const Ray & ray, double t_m
     }
 
     /* mu in the paper which is the cosine of the angle between the sun direction and the ray direction */
-    double mu = glm::dot(ray.m_direction, sun_light);
+    double mu = glm::dot(ray.m_direction, frame.sun_direction);
     double phase_r = rayleigh_phase_func(mu);
     double phase_m = mie_phase_func(g, mu);
 
@@ -83,7 +73,7 @@ glm::highp_dvec3 PrecomputedSS::computeIncidentLight(const Ray & ray, double t_m
 
     /* Calculate light intensity for the P_v */
     double view_angle = glm::acos(glm::dot(glm::normalize(P_v), R_v));
-    double sun_angle  = glm::acos(glm::dot(glm::normalize(P_v), sun_light));
+    double sun_angle  = glm::acos(glm::dot(glm::normalize(P_v), frame.sun_direction));
     double height     = sampleHeight(P_v);
 
     int view_angle_idx = view_angle * (m_view_angle_samples - 1.0) / glm::pi<double>();
@@ -126,18 +116,18 @@ glm::highp_dvec3 PrecomputedSS::computeIncidentLight(const Ray & ray, double t_m
     auto atmo_color = (glm::highp_dvec3(intensity_rayleigh) * phase_r + intensity_mie * phase_m) * sun_intensity;
 
     /* If user expressed their will to generate dataset based on the generated images */
-    if (output_file.good())
+    if (frame.dataset != nullptr)
     {
         auto tmp_color = atmo_color / (atmo_color + 10.0);
 
-        output_file << m_zenith_angle  / glm::pi<double>() << " "
-                    << m_azimuth_angle / glm::pi<double>() << " "
-                    <<  R_v.x                              << " "
-                    << -R_v.y                              << " "
-                    <<  R_v.z                              << " "
-                    <<  tmp_color.r                        << " "
-                    <<  tmp_color.g                        << " "
-                    <<  tmp_color.b                        << std::endl;
+        *frame.dataset << frame.zenith_angle  / glm::pi<double>() << " "
+                       << frame.azimuth_angle / glm::pi<double>() << " "
+                       <<  R_v.x                                  << " "
+                       << -R_v.y                                  << " "
+                       <<  R_v.z                                  << " "
+                       <<  tmp_color.r                            << " "
+                       <<  tmp_color.g                            << " "
+                       <<  tmp_color.b                            << "\n";
     }
 
     return atmo_color;
@@ -148,7 +138,7 @@ glm::highp_dvec4 PrecomputedSS::bilinearInterpolation(double tx,
                                                       const glm::highp_dvec4 & c00, 
                                                       const glm::highp_dvec4 & c10, 
                                                       const glm::highp_dvec4 & c01, 
-                                                      const glm::highp_dvec4 & c11)
+                                                      const glm::highp_dvec4 & c11) const
 {
     auto a = glm::mix(c00, c10, tx);
     auto b = glm::mix(c01, c11, tx);
@@ -166,7 +156,7 @@ glm::highp_dvec4 PrecomputedSS::trilinearInterpolation(double tx,
                                                        const glm::highp_dvec4 & c001,
                                                        const glm::highp_dvec4 & c101, 
                                                        const glm::highp_dvec4 & c011, 
-                                                       const glm::highp_dvec4 & c111)
+                                                       const glm::highp_dvec4 & c111) const
 {
     auto e = bilinearInterpolation(tx, ty, c000, c100, c010, c110);
     auto f = bilinearInterpolation(tx, ty, c001, c101, c011, c111);
@@ -174,20 +164,19 @@ glm::highp_dvec4 PrecomputedSS::trilinearInterpolation(double tx,
     return glm::mix(e, f, tz);;
 }
 
-std::vector<IntegrationData> PrecomputedSS::integrator(Ray ray, double a, double b, unsigned n, bool precomptute)
+std::vector<IntegrationData> PrecomputedSS::integrator(Ray ray, double a, double b, unsigned n, bool precomptute) const
 {
     std::vector<IntegrationData> data(1);
     return data;
 }
 
-void PrecomputedSS::calculateSingleScattering(double view_angle, double sun_angle, double height, glm::highp_dvec3 & out_rayleigh, glm::highp_dvec3 & out_mie)
+void PrecomputedSS::calculateSingleScattering(double view_angle, double sun_angle, double height, glm::highp_dvec3 & out_rayleigh, glm::highp_dvec3 & out_mie) const
 {
     Ray ray;
     ray.m_origin = glm::highp_dvec3(0.0, height, 0.0);
     ray.m_direction = glm::normalize(glm::highp_dvec3(glm::sin(view_angle), glm::cos(view_angle), 0.0));
 
-    auto prev_sun_dir = sun_light;
-    sun_light = glm::normalize(glm::highp_dvec3(glm::sin(sun_angle), glm::cos(sun_angle), 0.0));
+    auto sun_direction = glm::normalize(glm::highp_dvec3(glm::sin(sun_angle), glm::cos(sun_angle), 0.0));
 
     double t0, t1, t_max = std::numeric_limits<double>::max();
     if (intersect(ray, t0, t1, true) && t1 > 0.0)
@@ -195,11 +184,10 @@ void PrecomputedSS::calculateSingleScattering(double view_angle, double sun_angl
         t_max = glm::max(0.0, t0);
     }
 
-    integrateSingleScattering(ray, 0.0, t_max, out_rayleigh, out_mie);
-    sun_light = prev_sun_dir;
+    integrateSingleScattering(ray, sun_direction, 0.0, t_max, out_rayleigh, out_mie);
 }
 
-void PrecomputedSS::integrateSingleScattering(const Ray & ray, double t_min, double t_max, glm::highp_dvec3 & out_rayleigh, glm::highp_dvec3 & out_mie)
+void PrecomputedSS::integrateSingleScattering(const Ray & ray, const glm::highp_dvec3 & sun_direction, double t_min, double t_max, glm::highp_dvec3 & out_rayleigh, glm::highp_dvec3 & out_mie) const
 {
     double t0, t1;
     if (!intersect(ray, t0, t1) || t1 < 0.0)
@@ -237,7 +225,7 @@ void PrecomputedSS::integrateSingleScattering(const Ray & ray, double t_min, dou
         optical_depth_m += hm;
 
         /* Transmittance light path */
-        Ray light_ray(sample_position, sun_light);
+        Ray light_ray(sample_position, sun_direction);
         double optical_depth_light_r = 0.0, optical_depth_light_m = 0.0;
 
         if (computeSunLight(light_ray, optical_depth_light_r, optical_depth_light_m))
@@ -256,7 +244,7 @@ void PrecomputedSS::integrateSingleScattering(const Ray & ray, double t_min, dou
     out_mie      = sum_m * BETA_MIE;
 }
 
-bool PrecomputedSS::computeSunLight(Ray light_ray, double & optical_depth_light_r, double & optical_depth_light_m)
+bool PrecomputedSS::computeSunLight(Ray light_ray, double & optical_depth_light_r, double & optical_depth_light_m) const
 {
     double t0_light, t1_light;
     intersect(light_ray, t0_light, t1_light);
@@ -280,6 +268,8 @@ bool PrecomputedSS::computeSunLight(Ray light_ray, double & optical_depth_light_
 
 void PrecomputedSS::precomputeSingleScattering(int view_angle_samples, int sun_angle_samples, int height_samples)
 {
+    PROFILE_SCOPE("PrecomputedSS::precomputeSingleScattering");
+
     constexpr double PI    = glm::pi<double>();
     const     double H_TOP = atmosphere_radius - planet_radius;
 
@@ -390,6 +380,8 @@ void PrecomputedSS::saveSingleScatteringLUT(const std::string & filename)
 
 void PrecomputedSS::loadSingleScatteringLUTToVector(const std::string & filename)
 {
+    PROFILE_SCOPE("PrecomputedSS::loadSingleScatteringLUTToVector");
+
     if (filename.empty())
     {
         fprintf(stderr, "Could not open file %s\n\n", filename.c_str());
@@ -5,10 +5,10 @@
 class PrecomputedSS : public Atmosphere
 {
 public:
-    explicit PrecomputedSS(const Options & options, uint32_t _samples = 16, uint32_t _samples_light = 8, const std::string & output_filename = "");
+    explicit PrecomputedSS(const Options & options, uint32_t _samples = 16, uint32_t _samples_light = 8);
     ~PrecomputedSS() = default;
 
-    glm::highp_dvec3 computeIncidentLight(const Ray & ray, double t_min, double t_max) override;
+    glm::highp_dvec3 computeIncidentLight(const Ray & ray, double t_min, double t_max, const FrameState & frame) const override;
 
     void precomputeSingleScattering(int view_angle_samples, int sun_angle_samples, int height_samples);
     void saveSingleScatteringLUT(const std::string & filename);
@@ -19,16 +19,18 @@ public:
 
     std::vector<std::vector<std::vector<glm::highp_dvec4>>> getLUT();
 
+    /* Reference single scattering integration for one entry of the LUT, also used to generate NN training datasets */
+    void calculateSingleScattering(double view_angle, double sun_angle, double height, glm::highp_dvec3 & out_rayleigh, glm::highp_dvec3 & out_mie) const;
+
 private:
-    std::vector<IntegrationData> integrator(Ray ray, double a, double b, unsigned n, bool precomptute) override;
-    bool computeSunLight(Ray light_ray, double & optical_depth_light_r, double & optical_depth_light_m);
+    std::vector<IntegrationData> integrator(Ray ray, double a, double b, unsigned n, bool precomptute) const override;
+    bool computeSunLight(Ray light_ray, double & optical_depth_light_r, double & optical_depth_light_m) const;
 
-    void calculateSingleScattering(double view_angle, double sun_angle, double height, glm::highp_dvec3 & out_rayleigh, glm::highp_dvec3 & out_mie);
-    void integrateSingleScattering(const Ray & ray, double t_min, double t_max, glm::highp_dvec3 & out_rayleigh, glm::highp_dvec3 & out_mie);
+    void integrateSingleScattering(const Ray & ray, const glm::highp_dvec3 & sun_direction, double t_min, double t_max, glm::highp_dvec3 & out_rayleigh, glm::highp_dvec3 & out_mie) const;
 
-    glm::highp_dvec4 bilinearInterpolation(double tx, double ty, const glm::highp_dvec4 & c00, const glm::highp_dvec4 & c10, const glm::highp_dvec4 & c01, const glm::highp_dvec4 & c11);
+    glm::highp_dvec4 bilinearInterpolation(double tx, double ty, const glm::highp_dvec4 & c00, const glm::highp_dvec4 & c10, const glm::highp_dvec4 & c01, const glm::highp_dvec4 & c11) const;
     glm::highp_dvec4 trilinearInterpolation(double tx, double ty, double tz, const glm::highp_dvec4 & c000, const glm::highp_dvec4 & c100, const glm::highp_dvec4 & c010, const glm::highp_dvec4 & c110,
-                                                                             const glm::highp_dvec4 & c001, const glm::highp_dvec4 & c101, const glm::highp_dvec4 & c011, const glm::highp_dvec4 & c111);
+                                                                             const glm::highp_dvec4 & c001, const glm::highp_dvec4 & c101, const glm::highp_dvec4 & c011, const glm::highp_dvec4 & c111) const;
 
     std::vector<std::vector<std::vector<glm::highp_dvec4>>> m_single_scattering_data_r_m;
 
@@ -36,7 +38,5 @@ private:
     int m_sun_angle_samples;
     int m_height_samples;
     Options m_opt;
-
-    std::ofstream output_file;
 };
 
@@ -0,0 +1,286 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "util/benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include "util/profiling.h"
+
+namespace benchmark {
+
+namespace internal {
+
+// Defined in this file, and thus opaque to the compiler in the callers of
+// DoNotOptimize (unless link time optimizations are enabled).
+void UseCharPointer(const volatile char*) {}
+
+}  // namespace internal
+
+namespace {
+
+// Larger than the last level cache of current processors.
+constexpr size_t kCacheEvictionBytes = 64 << 20;
+
+void EvictCaches() {
+  static std::vector<char> buffer(kCacheEvictionBytes);
+  static char value = 0;
+  value += 1;
+  for (size_t i = 0; i < buffer.size(); i += 64) {
+    buffer[i] += value;
+  }
+  DoNotOptimize(buffer[buffer.size() / 2]);
+}
+
+double GetCpuSeconds() {
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+std::string EscapeJson(const std::string& s) {
+  return profiling::internal::EscapeJson(s.c_str());
+}
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  const size_t n = values.size();
+  if (n == 0) {
+    return 0.0;
+  }
+  return n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+}  // anonymous namespace
+
+Runner::Runner(const Options& options) : options_(options) {}
+
+void Runner::AddContext(const std::string& key, const std::string& value) {
+  context_.push_back(std::make_pair(key, value));
+}
+
+bool Runner::Matches(const std::string& name,
+    const Parameters& parameters) const {
+  return GetFullName(name, parameters).find(options_.filter) !=
+      std::string::npos;
+}
+
+void Runner::RunWarm(const std::string& name, const Parameters& parameters,
+    int num_queries, const std::function<void(int)>& query) {
+  if (!Matches(name, parameters) || num_queries <= 0) {
+    return;
+  }
+  for (int pass = 0; pass < options_.warmup_passes; ++pass) {
+    for (int i = 0; i < num_queries; ++i) {
+      query(i);
+    }
+  }
+  // Estimates the number of passes needed per repetition from a single one.
+  int64_t begin = profiling::NowNanoseconds();
+  for (int i = 0; i < num_queries; ++i) {
+    query(i);
+  }
+  const double pass_seconds =
+      std::max<int64_t>(profiling::NowNanoseconds() - begin, 1) * 1e-9;
+  const int64_t passes = std::max<int64_t>(
+      1, static_cast<int64_t>(std::ceil(options_.min_seconds / pass_seconds)));
+
+  std::vector<double> ns_per_query;
+  std::vector<double> cpu_ns_per_query;
+  for (int repetition = 0; repetition < options_.repetitions; ++repetition) {
+    const double cpu_begin = GetCpuSeconds();
+    begin = profiling::NowNanoseconds();
+    for (int64_t pass = 0; pass < passes; ++pass) {
+      for (int i = 0; i < num_queries; ++i) {
+        query(i);
+      }
+    }
+    const double nanoseconds = profiling::NowNanoseconds() - begin;
+    const double cpu_nanoseconds = (GetCpuSeconds() - cpu_begin) * 1e9;
+    ns_per_query.push_back(nanoseconds / (passes * num_queries));
+    cpu_ns_per_query.push_back(cpu_nanoseconds / (passes * num_queries));
+  }
+  AddResult(name, parameters, false,
+      passes * num_queries * options_.repetitions, ns_per_query,
+      cpu_ns_per_query, std::vector<double>());
+}
+
+void Runner::RunCold(const std::string& name, const Parameters& parameters,
+    int num_queries, const std::function<void()>& setup,
+    const std::function<void(int)>& query) {
+  if (!Matches(name, parameters) || num_queries <= 0) {
+    return;
+  }
+  std::vector<double> ns_per_query;
+  std::vector<double> cpu_ns_per_query;
+  std::vector<double> setup_seconds;
+  for (int repetition = 0; repetition < options_.cold_repetitions;
+       ++repetition) {
+    const double setup_begin = profiling::NowSeconds();
+    setup();
+    setup_seconds.push_back(profiling::NowSeconds() - setup_begin);
+    EvictCaches();
+
+    const double cpu_begin = GetCpuSeconds();
+    const int64_t begin = profiling::NowNanoseconds();
+    for (int i = 0; i < num_queries; ++i) {
+      query(i);
+    }
+    const double nanoseconds = profiling::NowNanoseconds() - begin;
+    const double cpu_nanoseconds = (GetCpuSeconds() - cpu_begin) * 1e9;
+    ns_per_query.push_back(nanoseconds / num_queries);
+    cpu_ns_per_query.push_back(cpu_nanoseconds / num_queries);
+  }
+  AddResult(name, parameters, true,
+      static_cast<int64_t>(num_queries) * options_.cold_repetitions,
+      ns_per_query, cpu_ns_per_query, setup_seconds);
+}
+
+void Runner::AddResult(const std::string& name, const Parameters& parameters,
+    bool cold, int64_t queries, const std::vector<double>& ns_per_query,
+    const std::vector<double>& cpu_ns_per_query,
+    const std::vector<double>& setup_seconds) {
+  if (ns_per_query.empty()) {
+    return;
+  }
+  Result result;
+  result.name = GetFullName(name, parameters) + (cold ? "/cold" : "/warm");
+  result.parameters = parameters;
+  result.cold = cold;
+  result.repetitions = ns_per_query.size();
+  result.queries = queries;
+  result.min_ns = *std::min_element(ns_per_query.begin(), ns_per_query.end());
+  result.median_ns = Median(ns_per_query);
+  result.mean_ns = 0.0;
+  for (double ns : ns_per_query) {
+    result.mean_ns += ns / ns_per_query.size();
+  }
+  result.stddev_ns = 0.0;
+  for (double ns : ns_per_query) {
+    result.stddev_ns += (ns - result.mean_ns) * (ns - result.mean_ns);
+  }
+  result.stddev_ns = ns_per_query.size() > 1 ?
+      std::sqrt(result.stddev_ns / (ns_per_query.size() - 1)) : 0.0;
+  result.cpu_ns = Median(cpu_ns_per_query);
+  result.setup_seconds = Median(setup_seconds);
+  results_.push_back(result);
+
+  if (options_.out != nullptr) {
+    std::ostream& out = *options_.out;
+    out << std::left << std::setw(56) << result.name << std::right
+        << std::fixed << std::setprecision(1) << std::setw(14)
+        << result.median_ns << " ns/query  +-" << std::setw(5)
+        << (result.mean_ns > 0.0 ? 100.0 * result.stddev_ns / result.mean_ns :
+            0.0) << "%" << std::setw(12) << result.queries << " queries";
+    if (cold) {
+      out << std::setprecision(3) << "  setup " << result.setup_seconds << "s";
+    }
+    out << std::endl;
+  }
+}
+
+bool Runner::WriteJson(const std::string& filename) const {
+  std::time_t now = std::time(nullptr);
+  char date[64];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z",
+      std::localtime(&now));
+
+  std::ofstream file(filename);
+  file << "{\n  \"context\": {\n"
+       << "    \"date\": \"" << date << "\",\n"
+       << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+       << "    \"library_build_type\": \"release\",\n"
+#else
+       << "    \"library_build_type\": \"debug\",\n"
+#endif
+       << "    \"min_time\": " << options_.min_seconds << ",\n"
+       << "    \"repetitions\": " << options_.repetitions << ",\n"
+       << "    \"cold_repetitions\": " << options_.cold_repetitions;
+  for (const auto& entry : context_) {
+    file << ",\n    \"" << EscapeJson(entry.first) << "\": \""
+         << EscapeJson(entry.second) << "\"";
+  }
+  file << "\n  },\n  \"benchmarks\": [";
+  file << std::setprecision(10);
+  for (size_t i = 0; i < results_.size(); ++i) {
+    const Result& result = results_[i];
+    file << (i == 0 ? "\n" : ",\n") << "    {\n"
+         << "      \"name\": \"" << EscapeJson(result.name) << "\",\n"
+         << "      \"run_name\": \"" << EscapeJson(result.name) << "\",\n"
+         << "      \"run_type\": \"iteration\",\n"
+         << "      \"repetitions\": " << result.repetitions << ",\n"
+         << "      \"threads\": 1,\n"
+         << "      \"iterations\": " << result.queries << ",\n"
+         << "      \"real_time\": " << result.median_ns << ",\n"
+         << "      \"cpu_time\": " << result.cpu_ns << ",\n"
+         << "      \"time_unit\": \"ns\",\n"
+         << "      \"mode\": \"" << (result.cold ? "cold" : "warm") << "\",\n"
+         << "      \"min_time_ns\": " << result.min_ns << ",\n"
+         << "      \"mean_time_ns\": " << result.mean_ns << ",\n"
+         << "      \"stddev_time_ns\": " << result.stddev_ns << ",\n"
+         << "      \"setup_seconds\": " << result.setup_seconds << ",\n"
+         << "      \"parameters\": {";
+    for (size_t j = 0; j < result.parameters.size(); ++j) {
+      const auto& parameter = result.parameters[j];
+      file << (j == 0 ? "" : ", ") << "\"" << EscapeJson(parameter.first)
+           << "\": \"" << EscapeJson(parameter.second) << "\"";
+    }
+    file << "}\n    }";
+  }
+  file << "\n  ]\n}" << std::endl;
+  return file.good();
+}
+
+std::string GetFullName(const std::string& name,
+    const Parameters& parameters) {
+  std::string full_name = name;
+  for (const auto& parameter : parameters) {
+    full_name += "/" + parameter.first + ":" + parameter.second;
+  }
+  return full_name;
+}
+
+std::vector<std::string> SplitList(const std::string& list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+}  // namespace benchmark
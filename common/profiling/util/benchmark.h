@@ -0,0 +1,156 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef UTIL_BENCHMARK_H_
+#define UTIL_BENCHMARK_H_
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A microbenchmark runner, in the style of Google Benchmark, for functions
+// evaluated on a fixed set of inputs (e.g. the sky radiance in a set of view
+// directions). It measures the time per query in "warm" runs, repeated until
+// they last long enough, and in "cold" runs, made of a single pass over the
+// inputs just after a setup function (e.g. a model construction) and after
+// evicting the CPU caches. The results are saved in the JSON format of Google
+// Benchmark, so that its tools (e.g. compare.py) can compare them.
+namespace benchmark {
+
+namespace internal {
+
+void UseCharPointer(const volatile char* pointer);
+
+}  // namespace internal
+
+// Prevents the compiler from optimizing away the computation of 'value'.
+template<class T>
+inline void DoNotOptimize(const T& value) {
+  internal::UseCharPointer(reinterpret_cast<const volatile char*>(&value));
+}
+
+// The parameters of a benchmark, as (name, value) pairs, e.g. ("samples",
+// "1024"). They are appended to the benchmark names, and saved in the results.
+typedef std::vector<std::pair<std::string, std::string>> Parameters;
+
+struct Options {
+  Options()
+      : min_seconds(0.2), repetitions(5), cold_repetitions(3),
+        warmup_passes(1), out(nullptr) {}
+
+  // The minimum duration of each warm repetition.
+  double min_seconds;
+  int repetitions;
+  int cold_repetitions;
+  // The number of untimed passes over the inputs before the warm repetitions.
+  int warmup_passes;
+  // Only the benchmarks whose name contains this string are run.
+  std::string filter;
+  // Where each result is printed when it is measured, if not null.
+  std::ostream* out;
+};
+
+struct Result {
+  // The benchmark name, followed by the parameters and by "/warm" or "/cold",
+  // e.g. "taylor/samples:1024/sun_zenith:30/warm".
+  std::string name;
+  Parameters parameters;
+  bool cold;
+  int repetitions;
+  // The total number of timed queries, in all the repetitions.
+  int64_t queries;
+  // The statistics of the time per query of each repetition, in nanoseconds.
+  double min_ns;
+  double median_ns;
+  double mean_ns;
+  double stddev_ns;
+  // The median processor time per query of the repetitions, in nanoseconds.
+  double cpu_ns;
+  // The median duration of the setup of the cold repetitions, in seconds (0 for
+  // the warm ones).
+  double setup_seconds;
+};
+
+class Runner {
+ public:
+  explicit Runner(const Options& options);
+
+  // Adds a (key, value) pair to the context saved with the results, e.g. the
+  // input data or the compiler flags.
+  void AddContext(const std::string& key, const std::string& value);
+
+  // Returns whether the benchmark with the given name and parameters passes the
+  // filter of the options (the warm and cold runs are filtered together).
+  bool Matches(const std::string& name, const Parameters& parameters) const;
+
+  // Measures 'query(i)' for 'i' from 0 to 'num_queries' - 1, in passes over all
+  // these queries repeated during at least options.min_seconds, after
+  // options.warmup_passes untimed passes. Each of the options.repetitions
+  // repetitions gives one time per query sample.
+  void RunWarm(const std::string& name, const Parameters& parameters,
+      int num_queries, const std::function<void(int)>& query);
+
+  // Measures a single pass of 'query(i)' for 'i' from 0 to 'num_queries' - 1,
+  // options.cold_repetitions times. Before each pass 'setup' is called (and
+  // timed separately), and then the CPU caches are evicted. 'setup' should
+  // reset everything the queries reuse, e.g. by constructing a new model.
+  void RunCold(const std::string& name, const Parameters& parameters,
+      int num_queries, const std::function<void()>& setup,
+      const std::function<void(int)>& query);
+
+  const std::vector<Result>& results() const { return results_; }
+
+  // Saves the context and the results in the JSON format of Google Benchmark,
+  // with the additional fields of Result.
+  bool WriteJson(const std::string& filename) const;
+
+ private:
+  void AddResult(const std::string& name, const Parameters& parameters,
+      bool cold, int64_t queries, const std::vector<double>& ns_per_query,
+      const std::vector<double>& cpu_ns_per_query,
+      const std::vector<double>& setup_seconds);
+
+  const Options options_;
+  std::vector<std::pair<std::string, std::string>> context_;
+  std::vector<Result> results_;
+};
+
+// Returns the full name of a benchmark, i.e. 'name' followed by "/key:value"
+// for each parameter.
+std::string GetFullName(const std::string& name, const Parameters& parameters);
+
+// Splits a comma separated list, e.g. a command line argument value.
+std::vector<std::string> SplitList(const std::string& list);
+
+}  // namespace benchmark
+
+#endif  // UTIL_BENCHMARK_H_
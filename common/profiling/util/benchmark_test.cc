@@ -0,0 +1,158 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "util/benchmark.h"
+
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "test/test_case.h"
+
+class TestBenchmark : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestBenchmark(const std::string& name, T test)
+      : TestCase("TestBenchmark " + name, static_cast<Test>(test)) {}
+
+  void TestNames() {
+    benchmark::Parameters parameters;
+    parameters.push_back(std::make_pair("samples", "16"));
+    parameters.push_back(std::make_pair("sun_zenith", "30"));
+    ExpectTrue(benchmark::GetFullName("taylor", parameters) ==
+        "taylor/samples:16/sun_zenith:30");
+
+    std::vector<std::string> items = benchmark::SplitList("a,bc,,d");
+    ExpectEquals(3, items.size());
+    ExpectTrue(items[0] == "a");
+    ExpectTrue(items[1] == "bc");
+    ExpectTrue(items[2] == "d");
+  }
+
+  void TestRuns() {
+    benchmark::Options options;
+    options.min_seconds = 0.01;
+    options.repetitions = 3;
+    options.cold_repetitions = 2;
+    benchmark::Runner runner(options);
+
+    std::vector<int> calls(4, 0);
+    int setups = 0;
+    const auto query = [&calls](int i) {
+      calls[i] += 1;
+      double value = 0.0;
+      for (int j = 0; j < 1000; ++j) {
+        value += std::sqrt(i + j);
+      }
+      benchmark::DoNotOptimize(value);
+    };
+    runner.RunWarm("sqrt", benchmark::Parameters(), 4, query);
+    runner.RunCold("sqrt", benchmark::Parameters(), 4,
+        [&setups]() { setups += 1; }, query);
+
+    ExpectEquals(2, runner.results().size());
+    const benchmark::Result& warm = runner.results()[0];
+    const benchmark::Result& cold = runner.results()[1];
+    ExpectTrue(warm.name == "sqrt/warm");
+    ExpectTrue(cold.name == "sqrt/cold");
+    ExpectEquals(3, warm.repetitions);
+    ExpectEquals(2, cold.repetitions);
+    ExpectEquals(8, cold.queries);
+    ExpectEquals(2, setups);
+    ExpectTrue(warm.min_ns > 0.0);
+    ExpectTrue(warm.min_ns <= warm.median_ns);
+    // Each query is called in the warm up pass, the pass estimating the number
+    // of passes, the timed passes, and the cold passes.
+    for (int i = 0; i < 4; ++i) {
+      ExpectEquals(2 + warm.queries / 4 + 2, calls[i]);
+    }
+  }
+
+  void TestFilter() {
+    benchmark::Options options;
+    options.min_seconds = 0.0;
+    options.repetitions = 1;
+    options.cold_repetitions = 1;
+    options.filter = "samples:16/";
+    benchmark::Runner runner(options);
+
+    benchmark::Parameters parameters;
+    parameters.push_back(std::make_pair("samples", "16"));
+    parameters.push_back(std::make_pair("sun_zenith", "0"));
+    benchmark::Parameters other_parameters;
+    other_parameters.push_back(std::make_pair("samples", "160"));
+    other_parameters.push_back(std::make_pair("sun_zenith", "0"));
+    ExpectTrue(runner.Matches("model", parameters));
+    ExpectTrue(!runner.Matches("model", other_parameters));
+
+    int calls = 0;
+    runner.RunWarm("model", other_parameters, 1, [&calls](int) { ++calls; });
+    ExpectEquals(0, calls);
+    runner.RunWarm("model", parameters, 1, [&calls](int) { ++calls; });
+    ExpectEquals(1, runner.results().size());
+  }
+
+  void TestJson() {
+    benchmark::Options options;
+    options.min_seconds = 0.0;
+    options.repetitions = 1;
+    options.cold_repetitions = 1;
+    benchmark::Runner runner(options);
+    runner.AddContext("input", "a \"quoted\" value");
+    benchmark::Parameters parameters;
+    parameters.push_back(std::make_pair("samples", "16"));
+    runner.RunWarm("model", parameters, 1, [](int) {});
+    runner.RunCold("model", parameters, 1, []() {}, [](int) {});
+
+    const std::string filename = "output/Debug/benchmark_test.json";
+    ExpectTrue(runner.WriteJson(filename));
+    std::ifstream file(filename);
+    std::string json((std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>());
+    ExpectTrue(json.find("\"input\": \"a \\\"quoted\\\" value\"") !=
+        std::string::npos);
+    ExpectTrue(json.find("\"name\": \"model/samples:16/warm\"") !=
+        std::string::npos);
+    ExpectTrue(json.find("\"name\": \"model/samples:16/cold\"") !=
+        std::string::npos);
+    ExpectTrue(json.find("\"time_unit\": \"ns\"") != std::string::npos);
+    ExpectTrue(json.find("\"parameters\": {\"samples\": \"16\"}") !=
+        std::string::npos);
+  }
+};
+
+namespace {
+
+TestBenchmark names("names", &TestBenchmark::TestNames);
+TestBenchmark runs("runs", &TestBenchmark::TestRuns);
+TestBenchmark filter("filter", &TestBenchmark::TestFilter);
+TestBenchmark json("json", &TestBenchmark::TestJson);
+
+}  // anonymous namespace
@@ -0,0 +1,115 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "util/pareto.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace pareto {
+
+std::vector<Configuration> GetFrontier(
+    const std::vector<Configuration>& configurations) {
+  std::vector<Configuration> sorted = configurations;
+  std::stable_sort(sorted.begin(), sorted.end(),
+      [](const Configuration& a, const Configuration& b) {
+    return a.cost < b.cost || (a.cost == b.cost && a.error < b.error);
+  });
+  // A configuration is dominated iff a cheaper one (or an equally expensive
+  // one sorted before it) has a smaller or equal error.
+  std::vector<Configuration> frontier;
+  for (const Configuration& configuration : sorted) {
+    if (frontier.empty() || configuration.error < frontier.back().error) {
+      frontier.push_back(configuration);
+    }
+  }
+  return frontier;
+}
+
+const Configuration* GetCheapest(
+    const std::vector<Configuration>& configurations, double max_error) {
+  const Configuration* cheapest = nullptr;
+  for (const Configuration& configuration : configurations) {
+    if (configuration.error <= max_error &&
+        (cheapest == nullptr || configuration.cost < cheapest->cost)) {
+      cheapest = &configuration;
+    }
+  }
+  return cheapest;
+}
+
+bool WriteTable(const std::string& filename,
+    const std::vector<Configuration>& configurations,
+    const std::string& cost_name, const std::string& error_name) {
+  const std::vector<Configuration> frontier = GetFrontier(configurations);
+  std::ofstream file(filename);
+  file << "# method parameters " << cost_name << " " << error_name
+       << " frontier" << std::endl;
+  for (const Configuration& configuration : configurations) {
+    bool on_frontier = false;
+    for (const Configuration& frontier_configuration : frontier) {
+      on_frontier |= frontier_configuration.method == configuration.method &&
+          frontier_configuration.parameters == configuration.parameters;
+    }
+    file << configuration.method << " "
+         << (configuration.parameters.empty() ? "-" : configuration.parameters)
+         << " " << configuration.cost << " " << configuration.error << " "
+         << (on_frontier ? 1 : 0) << std::endl;
+  }
+  return file.good();
+}
+
+void PrintSummary(std::ostream& out,
+    const std::vector<Configuration>& configurations,
+    const std::vector<double>& error_budgets, const std::string& cost_name,
+    const std::string& error_name) {
+  out << "Pareto frontier (" << configurations.size() << " configurations):"
+      << std::endl;
+  out << std::setw(14) << cost_name << std::setw(14) << error_name
+      << "  configuration" << std::endl;
+  for (const Configuration& configuration : GetFrontier(configurations)) {
+    out << std::setw(14) << configuration.cost << std::setw(14)
+        << configuration.error << "  " << configuration.method << " "
+        << configuration.parameters << std::endl;
+  }
+  for (double max_error : error_budgets) {
+    const Configuration* cheapest = GetCheapest(configurations, max_error);
+    out << "Cheapest with " << error_name << " <= " << max_error << ": ";
+    if (cheapest == nullptr) {
+      out << "none" << std::endl;
+    } else {
+      out << cheapest->method << " " << cheapest->parameters << " ("
+          << cost_name << " " << cheapest->cost << ", " << error_name << " "
+          << cheapest->error << ")" << std::endl;
+    }
+  }
+}
+
+}  // namespace pareto
@@ -0,0 +1,78 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef UTIL_PARETO_H_
+#define UTIL_PARETO_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Helpers to choose between the configurations of several methods (e.g. the
+// sample counts of the sky models) according to two criteria to minimize, a
+// cost and an error: the Pareto frontier of the configurations, and the
+// cheapest configuration meeting an error budget.
+namespace pareto {
+
+struct Configuration {
+  std::string method;
+  // The parameter values, without spaces, e.g. "samples=64,light_samples=8".
+  std::string parameters;
+  double cost;
+  double error;
+};
+
+// Returns the configurations which are not dominated by another one, i.e. for
+// which no other configuration has both a smaller or equal cost and a smaller
+// or equal error, with at least one of them smaller. The result is sorted by
+// increasing cost, and thus by decreasing error.
+std::vector<Configuration> GetFrontier(
+    const std::vector<Configuration>& configurations);
+
+// Returns the cheapest configuration whose error is at most 'max_error', or
+// null if there is none.
+const Configuration* GetCheapest(
+    const std::vector<Configuration>& configurations, double max_error);
+
+// Saves the configurations, one per line, with their method, parameters, cost,
+// error and whether they are on the frontier (1 or 0), separated by spaces (to
+// plot them with gnuplot). The first line is a comment with the column names.
+bool WriteTable(const std::string& filename,
+    const std::vector<Configuration>& configurations,
+    const std::string& cost_name, const std::string& error_name);
+
+// Prints the frontier, and the cheapest configuration for each error budget.
+void PrintSummary(std::ostream& out,
+    const std::vector<Configuration>& configurations,
+    const std::vector<double>& error_budgets, const std::string& cost_name,
+    const std::string& error_name);
+
+}  // namespace pareto
+
+#endif  // UTIL_PARETO_H_
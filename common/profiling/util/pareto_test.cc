@@ -0,0 +1,111 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "util/pareto.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test/test_case.h"
+
+class TestPareto : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestPareto(const std::string& name, T test)
+      : TestCase("TestPareto " + name, static_cast<Test>(test)) {}
+
+  void TestFrontier() {
+    const std::vector<pareto::Configuration> frontier =
+        pareto::GetFrontier(MakeConfigurations());
+    ExpectEquals(3, frontier.size());
+    ExpectTrue(frontier[0].parameters == "samples=4");
+    ExpectTrue(frontier[1].parameters == "samples=16");
+    ExpectTrue(frontier[2].method == "lut");
+    ExpectTrue(pareto::GetFrontier(
+        std::vector<pareto::Configuration>()).empty());
+  }
+
+  void TestCheapest() {
+    const std::vector<pareto::Configuration> configurations =
+        MakeConfigurations();
+    const pareto::Configuration* cheapest =
+        pareto::GetCheapest(configurations, 2.0);
+    ExpectTrue(cheapest != nullptr);
+    ExpectTrue(cheapest->parameters == "samples=16");
+    cheapest = pareto::GetCheapest(configurations, 100.0);
+    ExpectTrue(cheapest != nullptr);
+    ExpectTrue(cheapest->parameters == "samples=4");
+    ExpectTrue(pareto::GetCheapest(configurations, 0.1) == nullptr);
+  }
+
+  void TestOutputs() {
+    const std::vector<pareto::Configuration> configurations =
+        MakeConfigurations();
+    const std::string filename = "output/Debug/pareto_test.txt";
+    ExpectTrue(pareto::WriteTable(filename, configurations, "ns", "delta_e"));
+    std::ifstream file(filename);
+    std::string line;
+    std::getline(file, line);
+    ExpectTrue(line == "# method parameters ns delta_e frontier");
+    std::getline(file, line);
+    ExpectTrue(line == "taylor samples=4 10 8 1");
+    std::getline(file, line);
+    ExpectTrue(line == "taylor samples=8 30 9 0");
+
+    std::stringstream summary;
+    pareto::PrintSummary(summary, configurations, {2.0, 0.1}, "ns", "delta_e");
+    ExpectTrue(summary.str().find("Cheapest with delta_e <= 2: taylor "
+        "samples=16 (ns 40, delta_e 1.5)") != std::string::npos);
+    ExpectTrue(summary.str().find("Cheapest with delta_e <= 0.1: none") !=
+        std::string::npos);
+  }
+
+ private:
+  static std::vector<pareto::Configuration> MakeConfigurations() {
+    std::vector<pareto::Configuration> configurations;
+    configurations.push_back({"taylor", "samples=4", 10.0, 8.0});
+    // Dominated by the previous one.
+    configurations.push_back({"taylor", "samples=8", 30.0, 9.0});
+    configurations.push_back({"taylor", "samples=16", 40.0, 1.5});
+    // Dominated by the next one, which is as expensive but more accurate.
+    configurations.push_back({"spline", "", 100.0, 1.0});
+    configurations.push_back({"lut", "", 100.0, 0.5});
+    return configurations;
+  }
+};
+
+namespace {
+
+TestPareto frontier("frontier", &TestPareto::TestFrontier);
+TestPareto cheapest("cheapest", &TestPareto::TestCheapest);
+TestPareto outputs("outputs", &TestPareto::TestOutputs);
+
+}  // anonymous namespace
@@ -0,0 +1,260 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "util/profiling.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
+
+namespace profiling {
+
+namespace internal {
+
+std::atomic<bool> enabled(false);
+
+}  // namespace internal
+
+namespace {
+
+// The events of a thread, in a ring buffer which grows up to
+// kMaxEventsPerThread events. Only its thread adds events, but the reports can
+// read them at any time, hence the mutex.
+struct ThreadBuffer {
+  explicit ThreadBuffer(int thread_index)
+      : thread_index(thread_index), next(0), depth(0) {}
+
+  const int thread_index;
+  std::mutex mutex;
+  std::vector<Event> events;
+  unsigned int next;
+  // The number of currently open scopes, only used by the thread itself.
+  int depth;
+};
+
+// The buffers of all the threads which recorded events, kept after the end of
+// their thread so that their events can be reported.
+std::mutex buffers_mutex;
+std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+ThreadBuffer& GetThreadBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer;
+  if (!buffer) {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffer = std::make_shared<ThreadBuffer>(buffers.size());
+    buffers.push_back(buffer);
+  }
+  return *buffer;
+}
+
+}  // anonymous namespace
+
+namespace internal {
+
+std::string EscapeJson(const char* s) {
+  std::string result;
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\') {
+      result += '\\';
+      result += *s;
+    } else if (static_cast<unsigned char>(*s) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+          static_cast<unsigned>(static_cast<unsigned char>(*s)));
+      result += escaped;
+    } else {
+      result += *s;
+    }
+  }
+  return result;
+}
+
+int64_t BeginScope() {
+  GetThreadBuffer().depth += 1;
+  return NowNanoseconds();
+}
+
+void EndScope(const char* name, int64_t begin) {
+  const int64_t end = NowNanoseconds();
+  ThreadBuffer& buffer = GetThreadBuffer();
+  buffer.depth -= 1;
+  Event event = {name, begin, end, buffer.thread_index, buffer.depth};
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  if (buffer.events.size() < kMaxEventsPerThread) {
+    buffer.events.push_back(event);
+  } else {
+    buffer.events[buffer.next] = event;
+    buffer.next = (buffer.next + 1) % kMaxEventsPerThread;
+  }
+}
+
+}  // namespace internal
+
+void SetEnabled(bool enabled) {
+  internal::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+const char* Intern(const std::string& name) {
+  static std::mutex mutex;
+  static std::set<std::string> names;
+  std::lock_guard<std::mutex> lock(mutex);
+  return names.insert(name).first->c_str();
+}
+
+std::vector<Event> GetEvents() {
+  std::vector<std::shared_ptr<ThreadBuffer>> all_buffers;
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    all_buffers = buffers;
+  }
+  std::vector<Event> events;
+  for (const auto& buffer : all_buffers) {
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    events.insert(events.end(), buffer->events.begin(), buffer->events.end());
+  }
+  std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+    if (a.thread_index != b.thread_index) {
+      return a.thread_index < b.thread_index;
+    }
+    if (a.begin != b.begin) {
+      return a.begin < b.begin;
+    }
+    return a.depth < b.depth;
+  });
+  return events;
+}
+
+void Reset() {
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  for (const auto& buffer : buffers) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    buffer->events.clear();
+    buffer->next = 0;
+  }
+}
+
+std::vector<PathStats> GetPathStats() {
+  const std::vector<Event> events = GetEvents();
+  std::map<std::string, PathStats> stats;
+  // The path and the stats of the enclosing scopes of the current event, at
+  // each depth. Since the events of each thread are sorted by begin time, the
+  // enclosing scopes of an event are the last ones seen at lower depths.
+  std::vector<std::string> paths;
+  std::vector<PathStats*> parents;
+  int thread_index = -1;
+  for (const Event& event : events) {
+    if (event.thread_index != thread_index) {
+      thread_index = event.thread_index;
+      paths.clear();
+      parents.clear();
+    }
+    const unsigned int depth = event.depth;
+    if (paths.size() < depth + 1) {
+      paths.resize(depth + 1);
+      parents.resize(depth + 1, nullptr);
+    }
+    // If the enclosing scopes were overwritten in the ring buffer, the path
+    // starts at the oldest one still present.
+    paths[depth] = depth > 0 && !paths[depth - 1].empty() ?
+        paths[depth - 1] + ";" + event.name : event.name;
+    const double seconds = (event.end - event.begin) * 1e-9;
+    PathStats& path_stats = stats[paths[depth]];
+    path_stats.path = paths[depth];
+    path_stats.count += 1;
+    path_stats.total_seconds += seconds;
+    path_stats.self_seconds += seconds;
+    if (depth > 0 && parents[depth - 1] != nullptr) {
+      parents[depth - 1]->self_seconds -= seconds;
+    }
+    parents[depth] = &path_stats;
+    std::fill(paths.begin() + depth + 1, paths.end(), std::string());
+    std::fill(parents.begin() + depth + 1, parents.end(), nullptr);
+  }
+  std::vector<PathStats> result;
+  for (const auto& entry : stats) {
+    result.push_back(entry.second);
+  }
+  return result;
+}
+
+bool WriteChromeTrace(const std::string& filename) {
+  const std::vector<Event> events = GetEvents();
+  int64_t origin = events.empty() ? 0 : events[0].begin;
+  for (const Event& event : events) {
+    origin = std::min(origin, event.begin);
+  }
+  std::ofstream file(filename);
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  file << std::fixed << std::setprecision(3);
+  for (unsigned int i = 0; i < events.size(); ++i) {
+    const Event& event = events[i];
+    file << (i == 0 ? "\n" : ",\n") << "{\"name\": \""
+         << internal::EscapeJson(event.name) << "\", \"ph\": \"X\", \"pid\": 0, "
+         << "\"tid\": " << event.thread_index << ", "
+         << "\"ts\": " << (event.begin - origin) * 1e-3 << ", "
+         << "\"dur\": " << (event.end - event.begin) * 1e-3 << "}";
+  }
+  file << "\n]}" << std::endl;
+  return file.good();
+}
+
+bool WriteFoldedStacks(const std::string& filename) {
+  std::ofstream file(filename);
+  for (const PathStats& path_stats : GetPathStats()) {
+    long long self_microseconds = path_stats.self_seconds * 1e6 + 0.5;
+    if (self_microseconds > 0) {
+      file << path_stats.path << " " << self_microseconds << std::endl;
+    }
+  }
+  return file.good();
+}
+
+void PrintSummary(std::ostream& out) {
+  std::vector<PathStats> stats = GetPathStats();
+  std::sort(stats.begin(), stats.end(),
+      [](const PathStats& a, const PathStats& b) {
+    return a.total_seconds > b.total_seconds;
+  });
+  out << std::setw(10) << "count" << std::setw(12) << "total (s)"
+      << std::setw(12) << "self (s)" << "  path" << std::endl;
+  for (const PathStats& path_stats : stats) {
+    out << std::setw(10) << path_stats.count << std::fixed
+        << std::setprecision(3) << std::setw(12) << path_stats.total_seconds
+        << std::setw(12) << path_stats.self_seconds << "  " << path_stats.path
+        << std::endl;
+  }
+}
+
+}  // namespace profiling
@@ -0,0 +1,164 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef UTIL_PROFILING_H_
+#define UTIL_PROFILING_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A small instrumentation library, shared by the chapters: a monotonic clock,
+// RAII profiling scopes recorded in per-thread ring buffers, and reports
+// aggregating these records by call path (Chrome trace JSON, folded stacks for
+// flame graphs, and a text summary).
+//
+// Recording is disabled by default. A disabled scope costs a relaxed atomic
+// load, and an enabled one two clock reads and an uncontended lock of the
+// buffer of its thread. Scopes are meant for stages taking at least a few
+// microseconds (a frame, a table precomputation, a model comparison), not for
+// per-sample work.
+namespace profiling {
+
+// The current monotonic time, in nanoseconds since an arbitrary origin.
+inline int64_t NowNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The current monotonic time, in seconds since an arbitrary origin.
+inline double NowSeconds() {
+  return NowNanoseconds() * 1e-9;
+}
+
+namespace internal {
+
+extern std::atomic<bool> enabled;
+
+// Enters a new scope in the current thread, and returns its begin time.
+int64_t BeginScope();
+// Leaves the current scope of the current thread, and records it.
+void EndScope(const char* name, int64_t begin);
+
+// Returns 's' as the content of a JSON string, with the special characters
+// escaped.
+std::string EscapeJson(const char* s);
+
+}  // namespace internal
+
+void SetEnabled(bool enabled);
+
+inline bool IsEnabled() {
+  return internal::enabled.load(std::memory_order_relaxed);
+}
+
+// Returns a copy of 'name' which lives until the end of the program, to use as
+// a scope name built at runtime (scope names are not copied).
+const char* Intern(const std::string& name);
+
+// A recorded scope. Times are in nanoseconds, as returned by NowNanoseconds.
+// 'depth' is the number of enclosing scopes in the same thread.
+struct Event {
+  const char* name;
+  int64_t begin;
+  int64_t end;
+  int thread_index;
+  int depth;
+};
+
+// Records the time between its construction and its destruction, with the
+// given name, if recording is enabled when it is constructed. 'name' must
+// outlive all the reports, i.e. be a string literal or come from Intern().
+class Scope {
+ public:
+  explicit Scope(const char* name)
+      : name_(IsEnabled() ? name : nullptr),
+        begin_(name_ ? internal::BeginScope() : 0) {}
+
+  ~Scope() {
+    if (name_) {
+      internal::EndScope(name_, begin_);
+    }
+  }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  const char* const name_;
+  const int64_t begin_;
+};
+
+#define PROFILING_CONCATENATE_(a, b) a##b
+#define PROFILING_CONCATENATE(a, b) PROFILING_CONCATENATE_(a, b)
+#define PROFILE_SCOPE(name) \
+  ::profiling::Scope PROFILING_CONCATENATE(profiling_scope_, __LINE__)(name)
+
+// The maximum number of events kept per thread. When a thread records more,
+// its oldest events are overwritten.
+constexpr unsigned int kMaxEventsPerThread = 1 << 16;
+
+// Returns the recorded events of all the threads, sorted by thread and then by
+// begin time (enclosing scopes first).
+std::vector<Event> GetEvents();
+
+// Removes all the recorded events.
+void Reset();
+
+// The aggregated events with the same call path, i.e. the same scope name and
+// the same enclosing scope names, joined with ';' (outermost first). The self
+// time excludes the time spent in nested scopes.
+struct PathStats {
+  std::string path;
+  unsigned int count;
+  double total_seconds;
+  double self_seconds;
+};
+
+// Returns the statistics of each call path, sorted by path.
+std::vector<PathStats> GetPathStats();
+
+// Saves the events in the Chrome trace event format, which can be opened in
+// chrome://tracing or https://ui.perfetto.dev.
+bool WriteChromeTrace(const std::string& filename);
+
+// Saves the self time of each call path, in microseconds, in the folded stacks
+// format of flamegraph.pl.
+bool WriteFoldedStacks(const std::string& filename);
+
+// Prints the count, total time and self time of each call path, by decreasing
+// total time.
+void PrintSummary(std::ostream& out);
+
+}  // namespace profiling
+
+#endif  // UTIL_PROFILING_H_
@@ -0,0 +1,175 @@
+/**
+ Copyright (c) 2022 Tomasz Galaj
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+ this list of conditions and the following disclaimer in the documentation
+ and/or other materials provided with the distribution.
+
+ 3. Neither the name of the copyright holder nor the names of its contributors
+ may be used to endorse or promote products derived from this software without
+ specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "util/profiling.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/test_case.h"
+
+class TestProfiling : public dimensional::TestCase {
+ public:
+  template<typename T>
+  TestProfiling(const std::string& name, T test)
+      : TestCase("TestProfiling " + name, static_cast<Test>(test)) {}
+
+  void TestClock() {
+    int64_t previous = profiling::NowNanoseconds();
+    for (int i = 0; i < 1000; ++i) {
+      int64_t now = profiling::NowNanoseconds();
+      ExpectTrue(now >= previous);
+      previous = now;
+    }
+  }
+
+  void TestDisabled() {
+    profiling::Reset();
+    profiling::SetEnabled(false);
+    {
+      PROFILE_SCOPE("disabled");
+    }
+    ExpectEquals(0, profiling::GetEvents().size());
+  }
+
+  void TestNestedScopes() {
+    profiling::Reset();
+    profiling::SetEnabled(true);
+    {
+      PROFILE_SCOPE("outer");
+      for (int i = 0; i < 3; ++i) {
+        PROFILE_SCOPE("inner");
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      }
+      PROFILE_SCOPE(profiling::Intern(std::string("dyn") + "amic"));
+    }
+    profiling::SetEnabled(false);
+
+    std::vector<profiling::Event> events = profiling::GetEvents();
+    ExpectEquals(5, events.size());
+    ExpectTrue(std::string(events[0].name) == "outer");
+    ExpectEquals(0, events[0].depth);
+    ExpectEquals(1, events[1].depth);
+
+    std::vector<profiling::PathStats> stats = profiling::GetPathStats();
+    ExpectEquals(3, stats.size());
+    ExpectTrue(stats[0].path == "outer");
+    ExpectTrue(stats[1].path == "outer;dynamic");
+    ExpectTrue(stats[2].path == "outer;inner");
+    ExpectEquals(1, stats[0].count);
+    ExpectEquals(3, stats[2].count);
+    ExpectTrue(stats[2].total_seconds >= 0.006);
+    ExpectNear(stats[0].total_seconds,
+        stats[0].self_seconds + stats[1].total_seconds + stats[2].total_seconds,
+        1e-9);
+
+    std::ostringstream summary;
+    profiling::PrintSummary(summary);
+    ExpectTrue(summary.str().find("outer;inner") != std::string::npos);
+  }
+
+  void TestThreads() {
+    profiling::Reset();
+    profiling::SetEnabled(true);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.push_back(std::thread([]() {
+        for (int j = 0; j < 100; ++j) {
+          PROFILE_SCOPE("job");
+        }
+      }));
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    profiling::SetEnabled(false);
+    std::vector<profiling::PathStats> stats = profiling::GetPathStats();
+    ExpectEquals(1, stats.size());
+    ExpectEquals(400, stats[0].count);
+  }
+
+  void TestRingBuffer() {
+    profiling::Reset();
+    profiling::SetEnabled(true);
+    std::thread thread([]() {
+      for (unsigned int i = 0; i < profiling::kMaxEventsPerThread + 10; ++i) {
+        PROFILE_SCOPE("event");
+      }
+    });
+    thread.join();
+    profiling::SetEnabled(false);
+    ExpectEquals(profiling::kMaxEventsPerThread, profiling::GetEvents().size());
+  }
+
+  void TestReports() {
+    profiling::Reset();
+    profiling::SetEnabled(true);
+    {
+      PROFILE_SCOPE("a \"quoted\" name");
+      PROFILE_SCOPE("nested");
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    profiling::SetEnabled(false);
+
+    const std::string trace = "output/Debug/profiling_test_trace.json";
+    ExpectTrue(profiling::WriteChromeTrace(trace));
+    std::ifstream trace_file(trace);
+    std::string json((std::istreambuf_iterator<char>(trace_file)),
+        std::istreambuf_iterator<char>());
+    ExpectTrue(json.find("\"traceEvents\"") != std::string::npos);
+    ExpectTrue(json.find("\"name\": \"a \\\"quoted\\\" name\"") !=
+        std::string::npos);
+    ExpectTrue(json.find("\"ph\": \"X\"") != std::string::npos);
+
+    const std::string stacks = "output/Debug/profiling_test_stacks.txt";
+    ExpectTrue(profiling::WriteFoldedStacks(stacks));
+    std::ifstream stacks_file(stacks);
+    bool found_nested_path = false;
+    std::string line;
+    while (std::getline(stacks_file, line)) {
+      found_nested_path |= line.find("a \"quoted\" name;nested ") == 0;
+    }
+    ExpectTrue(found_nested_path);
+  }
+};
+
+namespace {
+
+TestProfiling monotonicclock("clock", &TestProfiling::TestClock);
+TestProfiling disabled("disabled", &TestProfiling::TestDisabled);
+TestProfiling nestedscopes("nestedscopes", &TestProfiling::TestNestedScopes);
+TestProfiling threads("threads", &TestProfiling::TestThreads);
+TestProfiling ringbuffer("ringbuffer", &TestProfiling::TestRingBuffer);
+TestProfiling reports("reports", &TestProfiling::TestReports);
+
+}  // anonymous namespace